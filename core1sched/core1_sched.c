@@ -0,0 +1,87 @@
+// core1_sched.c
+#include "core1_sched.h"
+#include <stddef.h>
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "hardware/sync.h"
+
+typedef struct {
+    core1_task_fn_t volatile fn;
+    void* volatile           user;
+} core1_task_t;
+
+static core1_task_t  tasks[CORE1_MAX_TASKS];
+static volatile int  running = -1;   // task id core 1 is currently inside, -1 if none
+static bool          launched;
+static uint32_t      core1_stack[CORE1_STACK_WORDS];
+static absolute_time_t task_idle_until;  // set by the task being called (core 1 only)
+
+static void core1_loop(void) {
+    // Lets flash writes on core 0 park this core instead of racing it on XIP
+    multicore_lockout_victim_init();
+    while (1) {
+        bool busy = false;
+        absolute_time_t wake = at_the_end_of_time;
+        for (int i = 0; i < CORE1_MAX_TASKS; i++) {
+            // Publish `running` before re-reading the slot, pairs with core1_task_remove()
+            running = i;
+            __dmb();
+            core1_task_fn_t fn = tasks[i].fn;
+            if (fn) {
+                task_idle_until = make_timeout_time_us(CORE1_IDLE_US);
+                busy |= fn(tasks[i].user);
+                if (absolute_time_diff_us(task_idle_until, wake) > 0) wake = task_idle_until;
+            }
+            __dmb();
+            running = -1;
+        }
+        if (busy) continue;
+        // The lockout IRQ and core1_wake() both end the wait early; the loop re-polls
+        if (is_at_the_end_of_time(wake)) {
+            __wfe();
+        } else {
+            best_effort_wfe_or_timeout(wake);
+        }
+    }
+}
+
+void core1_task_idle_for(uint32_t us) {
+    task_idle_until = us == CORE1_UNTIL_WAKE ? at_the_end_of_time : make_timeout_time_us(us);
+}
+
+void core1_wake(void) {
+    // The caller's stores (the work it hands over) land before the event
+    __dmb();
+    __sev();
+}
+
+int core1_task_add(core1_task_fn_t fn, void* user) {
+    for (int i = 0; i < CORE1_MAX_TASKS; i++) {
+        if (tasks[i].fn == NULL) {
+            tasks[i].user = user;
+            __dmb();
+            tasks[i].fn = fn;
+            if (!launched) {
+                multicore_reset_core1();
+                multicore_launch_core1_with_stack(core1_loop, core1_stack, sizeof(core1_stack));
+                launched = true;
+            }
+            return i;
+        }
+    }
+    return -1;
+}
+
+void core1_task_sync(int id) {
+    if (id < 0 || id >= CORE1_MAX_TASKS || !launched) return;
+    while (running == id) {
+        tight_loop_contents();
+    }
+}
+
+void core1_task_remove(int id) {
+    if (id < 0 || id >= CORE1_MAX_TASKS) return;
+    tasks[id].fn = NULL;
+    __dmb();
+    core1_task_sync(id);
+}
@@ -0,0 +1,31 @@
+// core1_sched.h
+// Cooperative task loop on core 1, shared by the display refresh and the MP3 decoder.
+// Modules register a task instead of launching core 1 themselves; the loop calls each
+// registered task in turn, and when none of them had work it sleeps in WFE until the
+// soonest time a task asked to be called again, or until someone calls core1_wake().
+// (The multicore FIFO and its IRQ stay with multicore_lockout, so the doorbell is SEV.)
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CORE1_MAX_TASKS     4
+#define CORE1_STACK_WORDS   1024   // 4KB; tasks must keep large buffers off the stack
+#define CORE1_IDLE_US       500    // re-poll period of idle tasks that give no deadline
+#define CORE1_UNTIL_WAKE    UINT32_MAX
+
+// Task body: do one bounded slice of work and return. Return true if work was done
+// (the loop comes straight back), false if idle. Runs on core 1: no MicroPython API.
+typedef bool (*core1_task_fn_t)(void* user);
+
+// Register a task, launching the core 1 loop on first use. Returns a task id or -1.
+int  core1_task_add(core1_task_fn_t fn, void* user);
+// Unregister a task. On return core 1 is not inside it and will not call it again.
+void core1_task_remove(int id);
+// Wait until core 1 is not inside task `id` (the task stays registered).
+void core1_task_sync(int id);
+// From inside a task about to report idle: it needs no call for `us` microseconds
+// (CORE1_UNTIL_WAKE: not before the next core1_wake()). Without it, CORE1_IDLE_US.
+void core1_task_idle_for(uint32_t us);
+// Wake the loop from its idle wait so every task is called again. Any core, IRQ safe;
+// a wake sent while the tasks are running is latched and not lost.
+void core1_wake(void);
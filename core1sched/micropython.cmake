@@ -0,0 +1,19 @@
+# Shared core 1 task loop. Included by every module that runs work on core 1, so
+# it is only defined once however many of them are in USER_C_MODULES.
+if(NOT TARGET usermod_core1sched)
+    add_library(usermod_core1sched INTERFACE)
+
+    target_sources(usermod_core1sched INTERFACE
+        ${CMAKE_CURRENT_LIST_DIR}/core1_sched.c
+    )
+
+    target_include_directories(usermod_core1sched INTERFACE
+        ${CMAKE_CURRENT_LIST_DIR}
+    )
+
+    target_link_libraries(usermod_core1sched INTERFACE
+        pico_multicore
+    )
+
+    target_link_libraries(usermod INTERFACE usermod_core1sched)
+endif()
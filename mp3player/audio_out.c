@@ -0,0 +1,42 @@
+// audio_out.c : Dispatch to the selected output backend
+#include "audio_out.h"
+#include "audio_out_mock.h"
+#ifndef MP3_HOST
+#include "audio_out_pwm.h"
+#include "audio_out_i2s.h"
+#endif
+
+#ifdef MP3_HOST
+// Host build (host/CMakeLists.txt): no hardware, every backend is the mock
+static const audio_out_backend_t* be = &audio_out_mock_backend;
+
+bool audio_out_init(const audio_out_cfg_t* cfg) {
+    return be->init(cfg);
+}
+#else
+static const audio_out_backend_t* be = &audio_out_pwm_backend;
+
+bool audio_out_init(const audio_out_cfg_t* cfg) {
+    switch (cfg->backend) {
+        case AUDIO_OUT_I2S:  be = &audio_out_i2s_backend; break;
+        case AUDIO_OUT_MOCK: be = &audio_out_mock_backend; break;
+        default:             be = &audio_out_pwm_backend; break;
+    }
+    return be->init(cfg);
+}
+#endif
+
+void audio_out_set_provider(audio_out_provider_t cb, audio_out_consume_t consume, void* user) {
+    be->set_provider(cb, consume, user);
+}
+
+void audio_out_start(void) { be->start(); }
+void audio_out_stop(void)  { be->stop(); }
+void audio_out_set_rate(int sample_rate) { be->set_rate(sample_rate); }
+
+bool audio_out_set_refill_ms(int ms) {
+    return be->set_refill_ms ? be->set_refill_ms(ms) : false;
+}
+
+uint32_t audio_out_underruns(void)   { return be->underruns(); }
+uint32_t audio_out_actual_rate(void) { return be->actual_rate(); }
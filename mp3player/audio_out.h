@@ -0,0 +1,62 @@
+// audio_out.h : Audio output contract, implemented by several backends
+//  - PWM (audio_out_pwm.c): the PicoCalc's own speaker/headphone path, resampled to a
+//    fixed PWM rate and noise-shaped
+//  - I2S (audio_out_i2s.c): external DAC through a PIO state machine, 16-bit at the
+//    stream's own rate
+//  - mock (audio_out_mock.c): no hardware; pulls the provider in real time on the
+//    device, or only when pumped on a host build
+// The backend is picked per audio_out_init() call; the rest of the API goes to whichever
+// was initialised last.
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef enum { AUDIO_OUT_PWM = 0, AUDIO_OUT_I2S, AUDIO_OUT_MOCK } audio_out_backend_id_t;
+
+typedef struct {
+    int backend;     // audio_out_backend_id_t
+    int pin_l;
+    int pin_r;       // must share pin_l's PWM slice (GP26/27): one DMA feeds both
+    int sample_rate; // input rate, e.g., 44100 (the PWM itself runs at a fixed rate)
+    int channels;    // 1 or 2
+    int oversample;  // PWM periods per output sample: 1, 2, 4 or 8 (0 = default 4)
+    bool dither;     // add TPDF dither ahead of the noise shaper (needs oversample >= 2)
+    int refill_ms;   // 0: refill 64-frame batches from a DMA IRQ (~1.45 ms). >0: the DMA
+                     // loops over a level ring by itself and a timer refills it this often
+    int i2s_data;    // I2S: DIN pin of the DAC
+    int i2s_bclk;    // I2S: BCLK pin; LRCLK is the next pin up
+} audio_out_cfg_t;
+
+// Provider callback (zero-copy): point *frames at up to max_frames contiguous frames of
+// interleaved PCM (int16 LRLR...) and return how many; 0 on underrun. The output converts
+// them in place, then calls the consume callback with the number it used. It may call
+// the pair more than once per batch (e.g. when the provider's ring wraps).
+typedef size_t (*audio_out_provider_t)(const int16_t** frames, size_t max_frames, void* user);
+typedef void   (*audio_out_consume_t)(size_t frames, void* user);
+
+// One backend: the functions behind the API below
+typedef struct {
+    bool     (*init)(const audio_out_cfg_t* cfg);
+    void     (*set_provider)(audio_out_provider_t cb, audio_out_consume_t consume, void* user);
+    void     (*start)(void);
+    void     (*stop)(void);
+    void     (*set_rate)(int sample_rate);
+    bool     (*set_refill_ms)(int ms);   // NULL: not supported
+    uint32_t (*underruns)(void);
+    uint32_t (*actual_rate)(void);
+} audio_out_backend_t;
+
+bool   audio_out_init(const audio_out_cfg_t* cfg);
+void   audio_out_set_provider(audio_out_provider_t cb, audio_out_consume_t consume, void* user);
+void   audio_out_start(void);   // requires provider set
+void   audio_out_stop(void);
+// Change the input sample rate of a running output, e.g. for speed changes. PWM only
+// retunes its resampler; I2S retunes the bit clock. Buffers and DMA are untouched.
+void   audio_out_set_rate(int sample_rate);
+// PWM ring mode: change the refill period (and with it the lead kept ahead of the DMA)
+// while playing. Clamped to what the ring holds; false in batch mode or other backends.
+bool   audio_out_set_refill_ms(int ms);
+
+uint32_t audio_out_underruns(void);
+uint32_t audio_out_actual_rate(void);   // rate the output really plays at
@@ -0,0 +1,227 @@
+// audio_out_i2s.c : I2S backend of audio_out
+#include "audio_out_i2s.h"
+#include "audio_trace.h"
+
+#include "hardware/pio.h"
+#include "hardware/gpio.h"
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+
+#include <string.h>
+
+#ifndef count_of
+#define count_of(a) (sizeof(a)/sizeof((a)[0]))
+#endif
+
+// ===== Config =====
+#define I2S_BATCH_FRAMES   256u   // ~5.8ms @44.1kHz per DMA IRQ
+#define I2S_NUM_BUFFERS    2u
+
+// ===== PIO program =====
+// Standard I2S transmitter: 16-bit left and right per 32-bit FIFO word (left in the low
+// half, as int16 L,R sit in memory), MSB first, data one BCLK behind LRCLK. Two PIO
+// cycles per bit, so the state machine runs at 64x the sample rate.
+//
+//  .side_set 2                    ; LRCLK, BCLK
+//  bitloop1: out pins, 1   side 0b10
+//            jmp x-- bitloop1 side 0b11
+//            out pins, 1   side 0b00
+//            set x, 14     side 0b01
+//  bitloop0: out pins, 1   side 0b00
+//            jmp x-- bitloop0 side 0b01
+//            out pins, 1   side 0b10
+//  entry:    set x, 14     side 0b11
+static const uint16_t i2s_program_instructions[] = {
+    0x7001, //  0: out    pins, 1         side 2
+    0x1840, //  1: jmp    x--, 0          side 3
+    0x6001, //  2: out    pins, 1         side 0
+    0xe82e, //  3: set    x, 14           side 1
+    0x6001, //  4: out    pins, 1         side 0
+    0x0844, //  5: jmp    x--, 4          side 1
+    0x7001, //  6: out    pins, 1         side 2
+    0xf82e, //  7: set    x, 14           side 3
+};
+#define I2S_WRAP_TARGET  0u
+#define I2S_WRAP         7u
+#define I2S_ENTRY        7u
+
+static const pio_program_t i2s_program = {
+    .instructions = i2s_program_instructions,
+    .length = count_of(i2s_program_instructions),
+    .origin = -1,
+};
+
+// ===== Internal state =====
+typedef struct {
+    PIO            pio;
+    uint           sm;
+    uint           offset;
+    int            dma;
+    int            channels;
+    uint32_t       actual_rate;
+
+    uint32_t       buf[I2S_NUM_BUFFERS][I2S_BATCH_FRAMES];   // packed L | R << 16
+    volatile uint  play_idx;
+    bool           started;
+    uint32_t       last;        // last frame sent, held through underruns
+
+    audio_out_provider_t provider;
+    audio_out_consume_t  consume;
+    void*         provider_user;
+
+    volatile uint32_t underruns;
+} i2s_state_t;
+
+static i2s_state_t s = {0};
+
+static inline uint32_t pack(int16_t l, int16_t r) {
+    return (uint32_t)(uint16_t)l | ((uint32_t)(uint16_t)r << 16);
+}
+
+// PIO clock divider (16.8 fixed point) for 64 cycles per frame
+static void i2s_set_clock(uint32_t rate) {
+    uint32_t clk = clock_get_hz(clk_sys);
+    uint32_t div = (uint32_t)(((uint64_t)clk * 4u + rate / 2) / rate);
+    pio_sm_set_clkdiv_int_frac(s.pio, s.sm, (uint16_t)(div >> 8), (uint8_t)(div & 0xFFu));
+    s.actual_rate = (uint32_t)(((uint64_t)clk * 4u) / div);
+}
+
+// Straight copy from the provider: no resampling, no level conversion
+static void i2s_fill_buffer(uint buf_index) {
+    uint32_t* out = s.buf[buf_index];
+    size_t i = 0;
+    while (s.provider && i < I2S_BATCH_FRAMES) {
+        const int16_t* src;
+        trace_mark_t tm = trace_begin();
+        size_t got = s.provider(&src, I2S_BATCH_FRAMES - i, s.provider_user);
+        trace_end(TR_PROVIDE, tm);
+        if (got == 0) break;
+        if (s.channels == 2) {
+            for (size_t k = 0; k < got; ++k) out[i + k] = pack(src[2*k], src[2*k + 1]);
+        } else {
+            for (size_t k = 0; k < got; ++k) out[i + k] = pack(src[k], src[k]);
+        }
+        if (s.consume) s.consume(got, s.provider_user);
+        i += got;
+    }
+    if (i) s.last = out[i - 1];
+    if (i < I2S_BATCH_FRAMES) {
+        if (s.provider) s.underruns++;
+        // Underrun: hold the last frame (no step to zero, so no click)
+        for (; i < I2S_BATCH_FRAMES; ++i) out[i] = s.last;
+    }
+}
+
+static void i2s_kick_dma(uint buf_index) {
+    dma_channel_config c = dma_channel_get_default_config(s.dma);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, pio_get_dreq(s.pio, s.sm, true));
+    dma_channel_configure(s.dma, &c, (void*)&s.pio->txf[s.sm], s.buf[buf_index], I2S_BATCH_FRAMES, true);
+}
+
+// DMA IRQ: one batch went out; queue the other one, then refill this one
+static void __isr i2s_dma_irq(void) {
+    if (dma_hw->ints1 & (1u << s.dma)) {
+        trace_mark_t tm = trace_begin();
+        dma_hw->ints1 = (1u << s.dma);
+        uint finished = s.play_idx;
+        uint next = finished ^ 1u;
+        i2s_kick_dma(next);
+        s.play_idx = next;
+        i2s_fill_buffer(finished);
+        trace_end(TR_IRQ, tm);
+    }
+}
+
+static bool i2s_init(const audio_out_cfg_t* cfg) {
+    memset(&s, 0, sizeof(s));
+    s.dma = -1;
+    if (cfg->i2s_data < 0 || cfg->i2s_bclk < 0) return false;
+    s.channels = cfg->channels <= 1 ? 1 : 2;
+    if (!pio_claim_free_sm_and_add_program(&i2s_program, &s.pio, &s.sm, &s.offset)) return false;
+
+    uint data = (uint)cfg->i2s_data, bclk = (uint)cfg->i2s_bclk;
+    pio_gpio_init(s.pio, data);
+    pio_gpio_init(s.pio, bclk);
+    pio_gpio_init(s.pio, bclk + 1);
+
+    pio_sm_config c = pio_get_default_sm_config();
+    sm_config_set_wrap(&c, s.offset + I2S_WRAP_TARGET, s.offset + I2S_WRAP);
+    sm_config_set_sideset(&c, 2, false, false);
+    sm_config_set_out_pins(&c, data, 1);
+    sm_config_set_sideset_pins(&c, bclk);
+    sm_config_set_out_shift(&c, false, true, 32);   // MSB first, autopull whole words
+    sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_TX);
+    pio_sm_init(s.pio, s.sm, s.offset, &c);
+    pio_sm_set_consecutive_pindirs(s.pio, s.sm, data, 1, true);
+    pio_sm_set_consecutive_pindirs(s.pio, s.sm, bclk, 2, true);
+    pio_sm_exec(s.pio, s.sm, pio_encode_jmp(s.offset + I2S_ENTRY));
+    i2s_set_clock((uint32_t)cfg->sample_rate);
+
+    s.dma = dma_claim_unused_channel(true);
+    irq_set_exclusive_handler(DMA_IRQ_1, i2s_dma_irq);
+    irq_set_priority(DMA_IRQ_1, 0x40);
+    irq_set_enabled(DMA_IRQ_1, true);
+    dma_channel_set_irq1_enabled(s.dma, true);
+
+    memset(s.buf, 0, sizeof(s.buf));
+    return true;
+}
+
+static void i2s_set_provider(audio_out_provider_t cb, audio_out_consume_t consume, void* user) {
+    s.provider = cb;
+    s.consume = consume;
+    s.provider_user = user;
+}
+
+static void i2s_start(void) {
+    if (s.started || !s.pio) return;
+    i2s_fill_buffer(0);
+    i2s_fill_buffer(1);
+    s.play_idx = 0;
+    i2s_kick_dma(0);
+    pio_sm_set_enabled(s.pio, s.sm, true);
+    s.started = true;
+}
+
+static void i2s_stop(void) {
+    if (s.started) {
+        dma_channel_abort(s.dma);
+        pio_sm_set_enabled(s.pio, s.sm, false);
+        s.started = false;
+    }
+    if (s.dma >= 0) {
+        dma_channel_set_irq1_enabled(s.dma, false);
+        irq_set_enabled(DMA_IRQ_1, false);
+        irq_remove_handler(DMA_IRQ_1, i2s_dma_irq);
+        dma_channel_unclaim(s.dma);
+        s.dma = -1;
+    }
+    if (s.pio) {
+        pio_remove_program_and_unclaim_sm(&i2s_program, s.pio, s.sm, s.offset);
+        s.pio = NULL;
+    }
+}
+
+static void i2s_set_rate(int sample_rate) {
+    // Only the bit clock changes; the DMA and buffers run on
+    if (s.pio && sample_rate > 0) i2s_set_clock((uint32_t)sample_rate);
+}
+
+static uint32_t i2s_underruns(void) { return s.underruns; }
+
+static uint32_t i2s_actual_rate(void) { return s.actual_rate; }
+
+const audio_out_backend_t audio_out_i2s_backend = {
+    .init          = i2s_init,
+    .set_provider  = i2s_set_provider,
+    .start         = i2s_start,
+    .stop          = i2s_stop,
+    .set_rate      = i2s_set_rate,
+    .set_refill_ms = NULL,
+    .underruns     = i2s_underruns,
+    .actual_rate   = i2s_actual_rate,
+};
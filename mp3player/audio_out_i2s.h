@@ -0,0 +1,9 @@
+// audio_out_i2s.h : I2S backend of audio_out (see audio_out.h)
+// Drives an external I2S DAC (PCM5102A, UDA1334 and alike) from a PIO state machine:
+// DIN on cfg->i2s_data, BCLK on cfg->i2s_bclk and LRCLK on the pin after it. Samples
+// go out as they are, 16-bit at the stream's rate, from the PIO's fractional clock
+// divider (a few ppm off at most), so neither resampling nor noise shaping is needed.
+#pragma once
+#include "audio_out.h"
+
+extern const audio_out_backend_t audio_out_i2s_backend;
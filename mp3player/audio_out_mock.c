@@ -0,0 +1,116 @@
+// audio_out_mock.c : Hardware-free backend of audio_out
+#include "audio_out_mock.h"
+#include <string.h>
+
+#ifndef MP3_HOST
+#include "pico/time.h"
+#define MOCK_TICK_MS 5
+#endif
+
+typedef struct {
+    int            channels;
+    uint32_t       rate;
+    bool           started;
+    uint64_t       frames;
+    volatile uint32_t underruns;
+
+    audio_out_provider_t provider;
+    audio_out_consume_t  consume;
+    void*         provider_user;
+
+#ifndef MP3_HOST
+    repeating_timer_t timer;
+    uint32_t       frac;        // fractional frames carried between ticks, Q16
+    int16_t        scratch[2 * 256];
+#endif
+} mock_state_t;
+
+static mock_state_t m = {0};
+
+size_t audio_out_mock_pump(int16_t* dst, size_t frames) {
+    size_t done = 0;
+    while (m.provider && done < frames) {
+        const int16_t* src;
+        size_t got = m.provider(&src, frames - done, m.provider_user);
+        if (got == 0) break;
+        if (dst) {
+            int16_t* o = dst + 2 * done;
+            if (m.channels == 2) {
+                memcpy(o, src, got * 2 * sizeof(int16_t));
+            } else {
+                for (size_t k = 0; k < got; ++k) o[2*k] = o[2*k + 1] = src[k];
+            }
+        }
+        if (m.consume) m.consume(got, m.provider_user);
+        done += got;
+    }
+    if (done < frames && m.provider) m.underruns++;
+    m.frames += done;
+    return done;
+}
+
+uint64_t audio_out_mock_frames(void) { return m.frames; }
+
+#ifndef MP3_HOST
+// Real-time consumer: one tick's worth of frames, dropped
+static bool mock_tick(repeating_timer_t* rt) {
+    (void)rt;
+    m.frac += (uint32_t)(((uint64_t)m.rate << 16) * MOCK_TICK_MS / 1000u);
+    size_t n = m.frac >> 16;
+    m.frac &= 0xFFFFu;
+    while (n) {
+        size_t chunk = n < 256 ? n : 256;
+        audio_out_mock_pump(m.scratch, chunk);
+        n -= chunk;
+    }
+    return true;
+}
+#endif
+
+static bool mock_init(const audio_out_cfg_t* cfg) {
+    memset(&m, 0, sizeof(m));
+    m.channels = cfg->channels <= 1 ? 1 : 2;
+    m.rate = cfg->sample_rate > 0 ? (uint32_t)cfg->sample_rate : 44100u;
+    return true;
+}
+
+static void mock_set_provider(audio_out_provider_t cb, audio_out_consume_t consume, void* user) {
+    m.provider = cb;
+    m.consume = consume;
+    m.provider_user = user;
+}
+
+static void mock_start(void) {
+    if (m.started) return;
+#ifndef MP3_HOST
+    add_repeating_timer_ms(-MOCK_TICK_MS, mock_tick, NULL, &m.timer);
+#endif
+    m.started = true;
+}
+
+static void mock_stop(void) {
+    if (!m.started) return;
+#ifndef MP3_HOST
+    cancel_repeating_timer(&m.timer);
+#endif
+    m.started = false;
+}
+
+static void mock_set_rate(int sample_rate) {
+    if (sample_rate > 0) m.rate = (uint32_t)sample_rate;
+}
+
+static uint32_t mock_underruns(void) { return m.underruns; }
+
+static uint32_t mock_actual_rate(void) { return m.rate; }
+
+const audio_out_backend_t audio_out_mock_backend = {
+    .init          = mock_init,
+    .set_provider  = mock_set_provider,
+    .start         = mock_start,
+    .stop          = mock_stop,
+    .set_rate      = mock_set_rate,
+    .set_refill_ms = NULL,
+    .underruns     = mock_underruns,
+    .actual_rate   = mock_actual_rate,
+};
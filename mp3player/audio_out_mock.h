@@ -0,0 +1,14 @@
+// audio_out_mock.h : Hardware-free backend of audio_out (see audio_out.h)
+// Drives the provider/mixer pipeline without any output device. On the device it pulls
+// (and drops) frames from a timer at the configured rate, so decode load and underruns
+// can be measured with nothing attached. In a host build nothing runs by itself: the
+// caller pumps frames and gets the exact PCM the hardware would have played.
+#pragma once
+#include "audio_out.h"
+
+extern const audio_out_backend_t audio_out_mock_backend;
+
+// Pull up to `frames` stereo frames into `dst` (NULL: drop them). Returns the frames the
+// provider had; a short pull counts as an underrun, as on hardware.
+size_t   audio_out_mock_pump(int16_t* dst, size_t frames);
+uint64_t audio_out_mock_frames(void);   // frames pulled since init
@@ -1,25 +1,5 @@
-// audio_out_pwm.h
+// audio_out_pwm.h : PWM backend of audio_out (see audio_out.h)
 #pragma once
-#include <stdint.h>
-#include <stdbool.h>
-#include <stddef.h>
+#include "audio_out.h"
 
-typedef struct {
-    int pin_l;
-    int pin_r;
-    int sample_rate; // e.g., 44100
-    int channels;    // 1 or 2
-} audio_out_cfg_t;
-
-// Provider callback: fill up to max_frames of interleaved PCM (int16 LRLR...).
-// Return number of frames actually provided (may be < max_frames on underrun).
-typedef size_t (*audio_out_provider_t)(int16_t* dst, size_t max_frames, void* user);
-
-bool   audio_out_init(const audio_out_cfg_t* cfg);
-void   audio_out_set_provider(audio_out_provider_t cb, void* user);
-void   audio_out_start(void);   // requires provider set
-void   audio_out_stop(void);
-
-// (Legacy push/free API removed in pull-model; keep stubs if needed.)
-uint32_t audio_out_underruns(void);
-uint32_t audio_out_actual_rate(void);
\ No newline at end of file
+extern const audio_out_backend_t audio_out_pwm_backend;
@@ -0,0 +1,149 @@
+// audio_trace.c : Timing probes for the audio pipeline
+#include "audio_trace.h"
+
+#if MP3_TRACE
+#include "hardware/structs/systick.h"
+#include "hardware/clocks.h"
+#include "hardware/sync.h"
+#include "pico/time.h"
+
+#include <string.h>
+
+#define SYST_ENABLE     (1u << 0)
+#define SYST_CLKSOURCE  (1u << 2)   // processor clock
+#define SYST_MASK       0x00FFFFFFu
+
+typedef struct {
+    uint32_t count;
+    uint32_t max;
+    uint32_t bucket[TRACE_HIST];
+} trace_hist_t;
+
+volatile bool trace_on = false;
+
+static struct {
+    spin_lock_t*  lock;         // probes run on both cores and in IRQs
+    uint32_t      cyc_per_us;
+    uint32_t      head;         // records written so far
+    trace_rec_t   ring[TRACE_LEN];
+    trace_hist_t  hist[TR_PROBES];
+} t;
+
+// Free-running SysTick over the full 24 bits, set up on whichever core first needs it.
+// If something else already runs it with another reload, spans use the us timer.
+static inline bool systick_ours(void) {
+    if (!(systick_hw->csr & SYST_ENABLE)) {
+        systick_hw->rvr = SYST_MASK;
+        systick_hw->cvr = 0;
+        systick_hw->csr = SYST_CLKSOURCE | SYST_ENABLE;
+    }
+    return systick_hw->rvr == SYST_MASK;
+}
+
+trace_mark_t trace_mark(void) {
+    trace_mark_t m;
+    m.cyc = systick_ours() ? systick_hw->cvr : 0;
+    m.us = time_us_32() | 1u;   // never 0, which marks "not started"
+    return m;
+}
+
+// Bucket: exact below 4, then 4 steps per octave
+static inline uint32_t bucket_of(uint32_t v) {
+    if (v < 4) return v;
+    uint32_t e = 31u - (uint32_t)__builtin_clz(v);
+    uint32_t i = 4u + (e - 2u) * 4u + ((v >> (e - 2u)) & 3u);
+    return i < TRACE_HIST ? i : TRACE_HIST - 1;
+}
+
+// Middle of a bucket's range
+static uint32_t bucket_value(uint32_t i) {
+    if (i < 4) return i;
+    uint32_t e = (i - 4u) / 4u + 2u, m = (i - 4u) % 4u;
+    uint32_t lo = (4u + m) << (e - 2u);
+    return lo + ((1u << (e - 2u)) >> 1);
+}
+
+static void record(uint8_t probe, uint32_t value, uint32_t us) {
+    if (!t.lock) return;
+    uint32_t save = spin_lock_blocking(t.lock);
+    trace_hist_t* h = &t.hist[probe];
+    h->count++;
+    h->bucket[bucket_of(value)]++;
+    if (value > h->max) h->max = value;
+    trace_rec_t* r = &t.ring[t.head % TRACE_LEN];
+    r->us = us;
+    r->value = value;
+    r->probe = probe;
+    r->core = (uint8_t)get_core_num();
+    r->reserved = 0;
+    t.head++;
+    spin_unlock(t.lock, save);
+}
+
+void trace_span(uint8_t probe, trace_mark_t start) {
+    uint32_t cyc_end = systick_hw->cvr;
+    uint32_t us = time_us_32();
+    uint32_t us_span = us - (start.us & ~1u);
+    uint32_t cyc;
+    if (systick_hw->rvr == SYST_MASK && us_span < (SYST_MASK / 2) / t.cyc_per_us) {
+        cyc = (start.cyc - cyc_end) & SYST_MASK;    // counts down
+    } else {
+        cyc = us_span * t.cyc_per_us;
+    }
+    record(probe, cyc, us);
+}
+
+void trace_value(uint8_t probe, uint32_t value) {
+    record(probe, value, time_us_32());
+}
+
+void trace_enable(bool on) {
+    trace_on = false;
+    if (!t.lock) t.lock = spin_lock_instance((uint)spin_lock_claim_unused(true));
+    uint32_t save = spin_lock_blocking(t.lock);
+    t.cyc_per_us = clock_get_hz(clk_sys) / 1000000u;
+    if (!t.cyc_per_us) t.cyc_per_us = 1;
+    t.head = 0;
+    memset(t.hist, 0, sizeof(t.hist));
+    spin_unlock(t.lock, save);
+    if (on) systick_ours();
+    trace_on = on;
+}
+
+void trace_stats(uint8_t probe, uint32_t* count, uint32_t* p50, uint32_t* p99, uint32_t* max) {
+    *count = *p50 = *p99 = *max = 0;
+    if (probe >= TR_PROBES || !t.lock) return;
+    uint32_t save = spin_lock_blocking(t.lock);
+    const trace_hist_t* h = &t.hist[probe];
+    uint32_t n = h->count;
+    *count = n;
+    *max = h->max;
+    if (n) {
+        // Ranks of the percentiles, 1-based
+        uint32_t r50 = (n + 1) / 2, r99 = n - n / 100;
+        uint32_t seen = 0;
+        bool got50 = false;
+        for (uint32_t i = 0; i < TRACE_HIST; ++i) {
+            seen += h->bucket[i];
+            if (!got50 && seen >= r50) { *p50 = bucket_value(i); got50 = true; }
+            if (seen >= r99) { *p99 = bucket_value(i); break; }
+        }
+        // A bucket's middle can overshoot the largest sample in it
+        if (*p50 > *max) *p50 = *max;
+        if (*p99 > *max) *p99 = *max;
+    }
+    spin_unlock(t.lock, save);
+}
+
+uint32_t trace_copy(trace_rec_t* dst, uint32_t max) {
+    if (!t.lock) return 0;
+    uint32_t save = spin_lock_blocking(t.lock);
+    uint32_t n = t.head < TRACE_LEN ? t.head : TRACE_LEN;
+    if (n > max) n = max;
+    uint32_t first = t.head - n;
+    for (uint32_t k = 0; k < n; ++k) dst[k] = t.ring[(first + k) % TRACE_LEN];
+    spin_unlock(t.lock, save);
+    return n;
+}
+
+#endif
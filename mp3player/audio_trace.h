@@ -0,0 +1,79 @@
+// audio_trace.h : Timing probes for the audio pipeline
+// Each probe feeds a log-linear histogram (4 steps per octave, so percentiles are within
+// ~12%) plus an exact maximum, and every sample also goes into a fixed trace ring for
+// offline analysis. Durations are in CPU cycles, from the SysTick of the core running
+// the probe (each core has its own), falling back to the microsecond timer times the
+// clock for spans too long for SysTick's 24 bits. Value probes (ring level) record the
+// value instead of a duration.
+//
+// Probes cost a load and a branch while tracing is off (mp3.trace(False), the default);
+// building with MP3_TRACE=0 removes them altogether.
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef MP3_TRACE
+#define MP3_TRACE 1
+#endif
+
+enum {
+    TR_IRQ = 0,     // audio DMA IRQ / ring refill, entry to exit
+    TR_PROVIDE,     // one provider (mixer) call from the output
+    TR_DECODE,      // one mp3dec_decode_frame call
+    TR_READ,        // one file read (FAT sectors or VFS stream)
+    TR_RING,        // PCM ring level in bytes, at each decode timer tick
+    TR_PROBES
+};
+
+#define TRACE_LEN   256     // records in the trace ring
+#define TRACE_HIST  128     // histogram buckets per probe
+
+typedef struct {
+    uint32_t us;            // time_us_32() at the end of the span
+    uint32_t value;         // cycles, or the sampled value
+    uint8_t  probe;
+    uint8_t  core;
+    uint16_t reserved;
+} trace_rec_t;
+
+typedef struct {
+    uint32_t us;
+    uint32_t cyc;
+} trace_mark_t;
+
+#if MP3_TRACE
+
+extern volatile bool trace_on;
+
+trace_mark_t trace_mark(void);
+void trace_span(uint8_t probe, trace_mark_t start);
+void trace_value(uint8_t probe, uint32_t value);
+
+// Start a span; { 0 } while tracing is off
+static inline trace_mark_t trace_begin(void) {
+    if (!trace_on) return (trace_mark_t){ 0, 0 };
+    return trace_mark();
+}
+
+static inline void trace_end(uint8_t probe, trace_mark_t start) {
+    if (trace_on && start.us) trace_span(probe, start);
+}
+
+static inline void trace_sample(uint8_t probe, uint32_t value) {
+    if (trace_on) trace_value(probe, value);
+}
+
+// Clear everything and start (or stop) recording
+void     trace_enable(bool on);
+// Samples, percentiles and maximum of one probe
+void     trace_stats(uint8_t probe, uint32_t* count, uint32_t* p50, uint32_t* p99, uint32_t* max);
+// Copy the ring out, oldest first; returns the records copied (at most `max`)
+uint32_t trace_copy(trace_rec_t* dst, uint32_t max);
+
+#else
+
+static inline trace_mark_t trace_begin(void) { return (trace_mark_t){ 0, 0 }; }
+static inline void trace_end(uint8_t probe, trace_mark_t start) { (void)probe; (void)start; }
+static inline void trace_sample(uint8_t probe, uint32_t value) { (void)probe; (void)value; }
+
+#endif
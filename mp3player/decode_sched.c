@@ -0,0 +1,88 @@
+// decode_sched.c : Adaptive decode scheduling for the PCM ring
+#include "decode_sched.h"
+#include <string.h>
+
+// Exponential average with weight 1/8; signed so it can move both ways
+static inline uint32_t ewma(uint32_t avg, uint32_t x) {
+    return (uint32_t)((int32_t)avg + ((int32_t)x - (int32_t)avg) / 8);
+}
+
+void dsched_config(dsched_t* d, uint32_t capacity, uint32_t low_pct, uint32_t high_pct) {
+    d->capacity = capacity;
+    d->low  = (uint32_t)((uint64_t)capacity * low_pct / 100u);
+    d->high = (uint32_t)((uint64_t)capacity * high_pct / 100u);
+}
+
+void dsched_start(dsched_t* d, uint32_t nominal_bps) {
+    d->nominal_bps = nominal_bps;
+    d->drain_bps = nominal_bps;
+    d->filling = true;          // the ring starts from whatever play() predecoded
+    d->primed = false;
+    d->wakeups = d->services = d->decodes = 0;
+    d->period_us = DSCHED_MIN_US;
+    d->ttu_us = 0;
+    d->ttu_min_us = UINT32_MAX;
+    memset(d->hist, 0, sizeof(d->hist));
+}
+
+uint32_t dsched_tick(dsched_t* d, uint32_t level, uint32_t consumed, uint32_t now_us, bool* want) {
+    d->wakeups++;
+
+    // Drain rate from what the consumer took since the last measurement
+    if (!d->primed) {
+        d->last_t = now_us;
+        d->last_consumed = consumed;
+        d->primed = true;
+    } else {
+        uint32_t dt = now_us - d->last_t;
+        if (dt >= DSCHED_MIN_US) {
+            uint32_t bps = (uint32_t)((uint64_t)(consumed - d->last_consumed) * 1000000u / dt);
+            d->drain_bps = ewma(d->drain_bps, bps);
+            d->last_t = now_us;
+            d->last_consumed = consumed;
+        }
+    }
+    // A stalled output (underrun, rate switch) must not stretch the sleep: once it runs
+    // again it drains at the nominal rate straight away
+    uint32_t drain = d->drain_bps;
+    if (drain < d->nominal_bps / 2) drain = d->nominal_bps / 2;
+    if (drain == 0) drain = 1;
+
+    uint32_t bin = d->capacity ? (uint32_t)((uint64_t)level * DSCHED_HIST_BINS / d->capacity) : 0;
+    d->hist[bin < DSCHED_HIST_BINS ? bin : DSCHED_HIST_BINS - 1]++;
+    uint64_t ttu = (uint64_t)level * 1000000u / drain;
+    d->ttu_us = ttu > UINT32_MAX ? UINT32_MAX : (uint32_t)ttu;
+    if (d->ttu_us < d->ttu_min_us) d->ttu_min_us = d->ttu_us;
+
+    // Hysteresis: refill from low to high, then leave the ring alone until it is back
+    // at low, so a service call decodes a useful amount every time
+    if (level < d->low) d->filling = true;
+    else if (level >= d->high) d->filling = false;
+    *want = d->filling;
+
+    uint32_t next = DSCHED_MIN_US;
+    if (!d->filling) {
+        // Wake one minimum period before the ring reaches low
+        uint64_t wait = (uint64_t)(level - d->low) * 1000000u / drain;
+        if (wait > 2u * DSCHED_MIN_US) next = wait - DSCHED_MIN_US > DSCHED_MAX_US ? DSCHED_MAX_US : (uint32_t)(wait - DSCHED_MIN_US);
+    }
+    d->period_us = next;
+    return next;
+}
+
+uint32_t dsched_budget(const dsched_t* d, uint32_t level) {
+    // Nothing measured yet: the old fixed caps
+    if (!d->call_bytes || !d->cost_us) return level < d->low / 2 ? 96u : 32u;
+    uint32_t missing = level < d->high ? d->high - level : 0;
+    uint32_t n = (uint32_t)(((uint64_t)missing * 16u + d->call_bytes - 1) / d->call_bytes);
+    uint32_t cap = DSCHED_BUDGET_US * 16u / d->cost_us;
+    if (level < d->low / 2) cap *= 3;          // close to an underrun: catch up first
+    if (n > cap) n = cap;
+    return n ? n : 1u;
+}
+
+void dsched_note_decode(dsched_t* d, uint32_t bytes, uint32_t us) {
+    d->decodes++;
+    d->call_bytes = d->call_bytes ? ewma(d->call_bytes, bytes << 4) : bytes << 4;
+    d->cost_us    = d->cost_us    ? ewma(d->cost_us, us << 4)       : (us << 4) | 1u;
+}
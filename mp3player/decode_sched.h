@@ -0,0 +1,56 @@
+// decode_sched.h : Adaptive decode scheduling for the PCM ring
+// Instead of polling at a fixed rate and decoding a fixed number of frames, the decode
+// timer asks this scheduler when to wake next and whether the VM should decode now.
+// It measures the ring's drain rate (from the bytes the output consumes) and the cost
+// of one decode call, then works with two watermarks: once the ring drops below `low`
+// it is refilled to `high` (in service calls no longer than DSCHED_BUDGET_US), and in
+// between the timer sleeps until the ring is about to reach `low` again. Higher
+// bitrates, a slower clock or other load on the VM only move the estimates.
+//
+// Integer only (no FPU on the M0+). Times are in microseconds from time_us_32().
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define DSCHED_MIN_US      2000u    // wake period bounds
+#define DSCHED_MAX_US      50000u
+#define DSCHED_BUDGET_US   20000u   // decode time per service call (more when nearly empty)
+#define DSCHED_HIST_BINS   8        // fill level histogram, in eighths of the ring
+
+typedef struct {
+    // Config (bytes)
+    uint32_t capacity;
+    uint32_t low, high;
+
+    // Estimates
+    uint32_t nominal_bps;       // what the output should drain (floor for drain_bps)
+    uint32_t drain_bps;         // bytes drained per second, measured
+    uint32_t cost_us;           // per decode call (EWMA, Q4)
+    uint32_t call_bytes;        // PCM bytes per decode call (EWMA, Q4)
+    uint32_t last_t;
+    uint32_t last_consumed;
+    bool     filling;           // below low: refill until high
+    bool     primed;            // last_t / last_consumed are valid
+
+    // Telemetry, cleared by dsched_start
+    uint32_t wakeups;           // timer ticks
+    uint32_t services;          // service calls requested
+    uint32_t decodes;           // decode calls timed
+    uint32_t period_us;         // current wake period
+    uint32_t ttu_us;            // time to underrun at the last tick
+    uint32_t ttu_min_us;        // lowest of those while playing
+    uint32_t hist[DSCHED_HIST_BINS];
+} dsched_t;
+
+// Set the ring size and watermarks (percent of capacity); keeps the estimates
+void     dsched_config(dsched_t* d, uint32_t capacity, uint32_t low_pct, uint32_t high_pct);
+// New stream: clear the telemetry and seed the drain rate with the nominal one
+void     dsched_start(dsched_t* d, uint32_t nominal_bps);
+// Timer tick with the ring level and the consumer's running byte count. Returns the
+// delay to the next tick; *want is set when a service call should run now.
+uint32_t dsched_tick(dsched_t* d, uint32_t level, uint32_t consumed, uint32_t now_us, bool* want);
+// Decode calls the service may make at `level` (>= 1)
+uint32_t dsched_budget(const dsched_t* d, uint32_t level);
+// One timed decode call that produced `bytes` of PCM
+void     dsched_note_decode(dsched_t* d, uint32_t bytes, uint32_t us);
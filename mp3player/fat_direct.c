@@ -0,0 +1,147 @@
+// fat_direct.c : Sector-level reader for files on a FatFs (VfsFat) mount
+#include "fat_direct.h"
+#include <string.h>
+#include "py/runtime.h"
+#include "py/mperrno.h"
+
+#if MICROPY_VFS_FAT
+#include "lib/oofatfs/ff.h"
+#include "lib/oofatfs/diskio.h"
+#include "extmod/vfs_fat.h"
+
+// Layout of VfsFat's file object (pyb_file_obj_t, private to extmod/vfs_fat_file.c)
+typedef struct {
+    mp_obj_base_t base;
+    FIL           fp;
+} fat_file_obj_t;
+
+static inline uint32_t ld_u16(const uint8_t* p){ return (uint32_t)p[0] | ((uint32_t)p[1] << 8); }
+static inline uint32_t ld_u32(const uint8_t* p){ return ld_u16(p) | (ld_u16(p + 2) << 16); }
+
+// Next cluster in the chain, 0 on end of chain, 1 on a bad entry or read error.
+// Uses f->bounce as a one-sector FAT cache so FatFs' own window is left alone.
+static uint32_t fat_next(fat_direct_t* f, FATFS* fs, uint32_t clst){
+    uint32_t off = (fs->fs_type == FS_FAT16) ? clst * 2 : clst * 4;
+    uint32_t lba = (uint32_t)fs->fatbase + off / FAT_DIRECT_SECTOR;
+    if (lba != f->bounce_lba) {
+        if (disk_read(fs->drv, f->bounce, lba, 1) != RES_OK) { f->bounce_lba = UINT32_MAX; return 1; }
+        f->bounce_lba = lba;
+    }
+    const uint8_t* e = f->bounce + off % FAT_DIRECT_SECTOR;
+    uint32_t next;
+    if (fs->fs_type == FS_FAT16) {
+        next = ld_u16(e);
+        if (next >= 0xFFF8) return 0;
+    } else {
+        next = ld_u32(e) & 0x0FFFFFFF;
+        if (next >= 0x0FFFFFF8) return 0;
+    }
+    return (next >= 2 && next < fs->n_fatent) ? next : 1;
+}
+
+static bool add_run(fat_direct_t* f, uint32_t lba, uint32_t count){
+    if (f->n_ext && f->ext[f->n_ext - 1].lba + f->ext[f->n_ext - 1].count == lba) {
+        f->ext[f->n_ext - 1].count += count;
+        return true;
+    }
+    if (f->n_ext >= FAT_DIRECT_MAX_EXTENTS) return false;
+    f->ext[f->n_ext].lba = lba;
+    f->ext[f->n_ext].count = count;
+    f->n_ext++;
+    return true;
+}
+
+bool fat_direct_open(fat_direct_t* f, mp_obj_t file){
+    memset(f, 0, sizeof(*f));
+    f->bounce_lba = UINT32_MAX;
+    if (!mp_obj_is_type(file, &mp_type_vfs_fat_fileio)) return false;
+    FIL* fp = &((fat_file_obj_t*)MP_OBJ_TO_PTR(file))->fp;
+    FATFS* fs = fp->obj.fs;
+    #if FF_MAX_SS != FF_MIN_SS
+    if (fs->ssize != FAT_DIRECT_SECTOR) return false;
+    #elif FF_MAX_SS != FAT_DIRECT_SECTOR
+    return false;
+    #endif
+    if ((uint64_t)fp->obj.objsize > UINT32_MAX) return false;
+    f->drv  = fs->drv;
+    f->size = (uint32_t)fp->obj.objsize;
+    uint32_t need = (f->size + FAT_DIRECT_SECTOR - 1) / FAT_DIRECT_SECTOR;
+    uint32_t clst = fp->obj.sclust;
+    if (need == 0) return true;
+    if (clst < 2 || clst >= fs->n_fatent) return false;
+    #if FF_FS_EXFAT
+    if (fs->fs_type == FS_EXFAT) {
+        // exFAT only skips the FAT for files flagged contiguous
+        if (!(fp->obj.stat & 2)) return false;
+        return add_run(f, (uint32_t)fs->database + (clst - 2) * fs->csize, need);
+    }
+    #endif
+    if (fs->fs_type != FS_FAT16 && fs->fs_type != FS_FAT32) return false;
+    uint32_t mapped = 0;
+    while (mapped < need) {
+        if (!add_run(f, (uint32_t)fs->database + (clst - 2) * fs->csize, fs->csize)) return false;
+        mapped += fs->csize;
+        if (mapped >= need) break;
+        clst = fat_next(f, fs, clst);
+        if (clst < 2) return false;   // chain shorter than the file, or I/O error
+    }
+    // Trim the last cluster's slack so reads never run past the file's sectors
+    f->ext[f->n_ext - 1].count -= mapped - need;
+    f->bounce_lba = UINT32_MAX;
+    return true;
+}
+
+void fat_direct_seek(fat_direct_t* f, uint32_t pos){
+    f->pos = pos < f->size ? pos : f->size;
+    f->cur_ext = 0;
+    f->cur_base = 0;
+}
+
+int fat_direct_read(fat_direct_t* f, uint8_t* dst, size_t n){
+    if (f->pos >= f->size) return 0;
+    if (n > f->size - f->pos) n = f->size - f->pos;
+    size_t done = 0;
+    while (done < n) {
+        uint32_t fsect = f->pos / FAT_DIRECT_SECTOR;
+        uint32_t off   = f->pos % FAT_DIRECT_SECTOR;
+        while (fsect >= f->cur_base + f->ext[f->cur_ext].count) {
+            f->cur_base += f->ext[f->cur_ext].count;
+            f->cur_ext++;
+        }
+        const fat_direct_extent_t* e = &f->ext[f->cur_ext];
+        uint32_t lba = e->lba + (fsect - f->cur_base);
+        size_t left = n - done;
+        if (off == 0 && left >= FAT_DIRECT_SECTOR) {
+            // Whole sectors straight into the destination, as many as the extent allows
+            uint32_t cnt = (uint32_t)(left / FAT_DIRECT_SECTOR);
+            uint32_t run = e->count - (fsect - f->cur_base);
+            if (cnt > run) cnt = run;
+            if (disk_read(f->drv, dst + done, lba, cnt) != RES_OK) return done ? (int)done : -MP_EIO;
+            done   += (size_t)cnt * FAT_DIRECT_SECTOR;
+            f->pos += cnt * FAT_DIRECT_SECTOR;
+        } else {
+            // Partial sector (unaligned start or file tail) through the bounce buffer
+            if (f->bounce_lba != lba) {
+                if (disk_read(f->drv, f->bounce, lba, 1) != RES_OK) {
+                    f->bounce_lba = UINT32_MAX;
+                    return done ? (int)done : -MP_EIO;
+                }
+                f->bounce_lba = lba;
+            }
+            size_t take = FAT_DIRECT_SECTOR - off;
+            if (take > left) take = left;
+            memcpy(dst + done, f->bounce + off, take);
+            done   += take;
+            f->pos += (uint32_t)take;
+        }
+    }
+    return (int)done;
+}
+
+#else // !MICROPY_VFS_FAT
+
+bool fat_direct_open(fat_direct_t* f, mp_obj_t file){ (void)file; memset(f, 0, sizeof(*f)); return false; }
+int  fat_direct_read(fat_direct_t* f, uint8_t* dst, size_t n){ (void)f; (void)dst; (void)n; return -MP_EIO; }
+void fat_direct_seek(fat_direct_t* f, uint32_t pos){ (void)f; (void)pos; }
+
+#endif // MICROPY_VFS_FAT
@@ -0,0 +1,38 @@
+// fat_direct.h : Sector-level reader for files on a FatFs (VfsFat) mount
+// Resolves the file's cluster chain once at open into a short list of contiguous
+// extents, then reads with multi-block disk_read calls straight into the caller's
+// buffer. No stream layer, FatFs file state or Python objects on the read path.
+// The block device itself may still be Python (sdcard.py), so reads stay in VM context.
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "py/obj.h"
+
+#define FAT_DIRECT_MAX_EXTENTS 32   // more fragmented files use the stream path
+#define FAT_DIRECT_SECTOR      512
+
+typedef struct {
+    uint32_t lba;      // first sector on the device
+    uint32_t count;    // sectors
+} fat_direct_extent_t;
+
+typedef struct {
+    void*               drv;        // FatFs drive handle (MicroPython block device)
+    uint32_t            size;       // file size in bytes
+    uint32_t            pos;        // read offset in bytes
+    uint8_t             n_ext;
+    uint8_t             cur_ext;    // extent holding `pos` (search hint)
+    uint32_t            cur_base;   // file sector where cur_ext starts
+    fat_direct_extent_t ext[FAT_DIRECT_MAX_EXTENTS];
+    uint32_t            bounce_lba; // sector held in `bounce`, or UINT32_MAX
+    uint8_t             bounce[FAT_DIRECT_SECTOR];
+} fat_direct_t;
+
+// Map an open VfsFat file object. Returns false for other file types, unsupported
+// volumes (FAT12, non-512 byte sectors) or chains longer than FAT_DIRECT_MAX_EXTENTS.
+bool fat_direct_open(fat_direct_t* f, mp_obj_t file);
+// Read up to n bytes at the current offset. Returns bytes read, 0 at EOF, <0 on I/O error.
+int  fat_direct_read(fat_direct_t* f, uint8_t* dst, size_t n);
+// Move the read offset (clamped to the file size).
+void fat_direct_seek(fat_direct_t* f, uint32_t pos);
@@ -0,0 +1,23 @@
+// mp3_decode_float.c : mp3_decode_minimp3.c built once more with the float engine, every
+// external name moved to an mp3f_ prefix (see mp3_decode_float.h)
+#undef  MP3_FIXED_POINT
+#define MP3_FIXED_POINT 0
+
+#define mp3_decoder_s           mp3f_decoder_s
+#define mp3_decoder_create      mp3f_decoder_create
+#define mp3_decoder_destroy     mp3f_decoder_destroy
+#define mp3_decoder_open        mp3f_decoder_open
+#define mp3_decoder_decode      mp3f_decoder_decode
+#define mp3_decoder_rewind      mp3f_decoder_rewind
+#define mp3_decoder_seek        mp3f_decoder_seek
+#define mp3_decoder_tell        mp3f_decoder_tell
+#define mp3_decoder_set_fast    mp3f_decoder_set_fast
+#define mp3_decoder_is_eof      mp3f_decoder_is_eof
+#define mp3_decoder_get_diag    mp3f_decoder_get_diag
+#define mp3_decoder_set_source  mp3f_decoder_set_source
+#define mp3_decoder_read_input  mp3f_decoder_read_input
+#define mp3dec_init             mp3f_dec_init
+#define mp3dec_decode_frame     mp3f_dec_decode_frame
+#define mp3dec_f32_to_s16       mp3f_dec_f32_to_s16
+
+#include "../mp3_decode_minimp3.c"
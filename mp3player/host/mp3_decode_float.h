@@ -0,0 +1,13 @@
+// mp3_decode_float.h : The float minimp3 engine under an mp3f_ prefix, linked next to the
+// build's own (fixed-point) decoder so mp3bench --compare-float can run both on a file.
+// Same behaviour as the mp3_decode.h functions of the same name.
+#pragma once
+#include "mp3_decode.h"
+
+typedef struct mp3f_decoder_s mp3f_decoder_t;
+
+mp3f_decoder_t* mp3f_decoder_create(void);
+void mp3f_decoder_destroy(mp3f_decoder_t* dec);
+bool mp3f_decoder_open(mp3f_decoder_t* dec, const char* path, mp3_stream_info_t* out_info);
+int  mp3f_decoder_decode(mp3f_decoder_t* dec, int16_t* out_interleaved, size_t max_frames);
+bool mp3f_decoder_is_eof(mp3f_decoder_t* dec);
@@ -0,0 +1,495 @@
+// mp3bench.c : Host benchmark and golden-PCM check of the playback pipeline
+// Each file goes through the same path as on the device: decoder -> PCM ring -> mixer
+// (music voice) -> audio_out, with the mock backend standing in for the DMA. Reports
+//  - decode cost per MP3 frame (mean, p99, max) on this machine
+//  - bytes moved by memcpy/memmove per output frame (all of the pipeline's copies)
+//  - a CRC32 of the PCM the output received, checked against or written to a golden list
+//  - a virtual-time replay of the decode timer (decode_sched) with the measured per-call
+//    costs, scaled by --slow and with --load percent of the VM taken by other work:
+//    wakeups, underruns and the lowest time-to-underrun seen
+//
+//   mp3bench [options] file.mp3...
+//     --ring-bits 16|8|4   ring storage (mp3.init ring_bits), default 16
+//     --buffer-ms N        ring length (mp3.init buffer_ms), default 250
+//     --slow X             decode cost multiplier for the replay, default 1; ~20-30 puts
+//                          a desktop core near an RP2040 at 125 MHz
+//     --load P             percent of VM time used by the rest of the program, default 0
+//     --fast               decode at half rate (mp3.load fast=True)
+//     --runs N             decode passes per file, default 3; each call keeps its fastest
+//                          time (so host preemption does not show up as decode cost) and
+//                          every pass must produce the same PCM
+//     --crc                print the CRC line of each file
+//     --golden FILE        compare against FILE; exit status 1 on any mismatch
+//     --write-golden FILE  write the CRC lines to FILE
+//     --pcm DIR            write the output PCM (s16le stereo) to DIR/<name>.pcm
+//     --compare-float      also decode each file with the float engine and report the
+//                          build engine's max and RMS error against it, in LSBs, and
+//                          how many samples the float engine clipped; exit status 1
+//                          above the FLOAT_* limits
+#include "mp3_decode.h"
+#include "pcm_ring.h"
+#include "mixer.h"
+#include "audio_out.h"
+#include "audio_out_mock.h"
+#include "decode_sched.h"
+#include "mp3_decode_float.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+
+// --compare-float tolerance: largest single-sample and RMS difference from the float
+// engine, as minimp3_fixed.h states them, for MP3 frames without and with clipping
+#define FLOAT_MAX_LSB       4
+#define FLOAT_MAX_CLIP_LSB  8
+#define FLOAT_RMS_LSB       0.5
+#define FLOAT_CLIP_PCT      5.0     // most samples the float engine may clip, percent
+
+// ===== Copy accounting (linked with --wrap=memcpy,--wrap=memmove) =====
+static uint64_t copy_bytes;
+
+void* __real_memcpy(void* dst, const void* src, size_t n);
+void* __real_memmove(void* dst, const void* src, size_t n);
+
+void* __wrap_memcpy(void* dst, const void* src, size_t n) {
+    copy_bytes += n;
+    return __real_memcpy(dst, src, n);
+}
+
+void* __wrap_memmove(void* dst, const void* src, size_t n) {
+    copy_bytes += n;
+    return __real_memmove(dst, src, n);
+}
+
+// ===== Options =====
+static struct {
+    int         ring_bits;
+    int         buffer_ms;
+    double      slow;
+    int         load;
+    int         runs;
+    bool        fast;
+    bool        crc;
+    const char* golden;
+    const char* write_golden;
+    const char* pcm_dir;
+    bool        compare_float;
+} opt = { 16, 250, 1.0, 0, 3, false, false, NULL, NULL, NULL, false };
+
+// ===== CRC32 (IEEE, reflected) =====
+static uint32_t crc_table[256];
+
+static void crc_setup(void) {
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        crc_table[i] = c;
+    }
+}
+
+static uint32_t crc_update(uint32_t crc, const void* data, size_t n) {
+    const uint8_t* p = (const uint8_t*)data;
+    crc = ~crc;
+    while (n--) crc = crc_table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+// ===== Music voice, as mp3player.c's provider_cb / consume_cb =====
+static pcm_ring_t ring;
+
+static size_t ring_provide(const int16_t** frames, size_t max_frames, void* user) {
+    (void)user;
+    size_t avail = pcm_ring_peek(&ring, frames);
+    return avail < max_frames ? avail : max_frames;
+}
+
+static void ring_consume(size_t frames, void* user) {
+    (void)user;
+    pcm_ring_consume(&ring, frames);
+}
+
+// ===== One file =====
+typedef struct {
+    uint32_t frames;        // PCM frames produced by the call
+    uint32_t ns;            // its cost on this machine
+} call_t;
+
+typedef struct {
+    const char* path;
+    int         rate, channels;
+    uint64_t    out_frames;
+    uint32_t    crc;
+    uint64_t    copies;
+    uint32_t    ring_bytes;     // capacity as PCM bytes
+    call_t*     calls;
+    size_t      ncalls;
+    uint32_t    mp3_frames;
+} run_t;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static const char* base_name(const char* path) {
+    const char* s = strrchr(path, '/');
+    return s ? s + 1 : path;
+}
+
+// Pull `n` frames from the output into the CRC (and the PCM file)
+static size_t pump(run_t* r, FILE* pcm, size_t n) {
+    static int16_t buf[2 * MP3_DECODE_MAX_FRAMES];
+    size_t got = audio_out_mock_pump(buf, n);
+    r->crc = crc_update(r->crc, buf, got * 2 * sizeof(int16_t));
+    if (pcm) fwrite(buf, 2 * sizeof(int16_t), got, pcm);
+    r->out_frames += got;
+    return got;
+}
+
+// Decode the whole file through the pipeline, timing each decode call. Pass 0 records
+// the calls, later passes keep the faster time of each.
+static bool decode_pass(run_t* r, int pass) {
+    mp3_decoder_t* dec = mp3_decoder_create();
+    mp3_stream_info_t info;
+    if (dec && !mp3_decoder_set_fast(dec, opt.fast)) {
+        fprintf(stderr, "--fast needs the fixed-point decoder\n");
+        mp3_decoder_destroy(dec);
+        return false;
+    }
+    if (!dec || !mp3_decoder_open(dec, r->path, &info)) {
+        fprintf(stderr, "%s: cannot open\n", r->path);
+        if (dec) mp3_decoder_destroy(dec);
+        return false;
+    }
+    r->rate = info.sample_rate;
+    r->channels = info.channels;
+
+    size_t frames = (size_t)info.sample_rate * (size_t)opt.buffer_ms / 1000u;
+    if (frames < 3 * MP3_DECODE_MAX_FRAMES) frames = 3 * MP3_DECODE_MAX_FRAMES;
+    pcm_ring_fmt_t fmt = (pcm_ring_fmt_t)opt.ring_bits;
+    size_t bytes = pcm_ring_mem(frames, fmt, info.channels, MP3_DECODE_MAX_FRAMES);
+    void* mem = malloc(bytes);
+    if (!mem || !pcm_ring_init(&ring, mem, bytes, fmt, info.channels, MP3_DECODE_MAX_FRAMES)) {
+        fprintf(stderr, "%s: ring setup failed\n", r->path);
+        free(mem);
+        mp3_decoder_destroy(dec);
+        return false;
+    }
+
+    r->ring_bytes = (uint32_t)(pcm_ring_capacity(&ring) * ring.frame_bytes);
+
+    // As mp3.play(): a mono track gets a mono output, which widens it to stereo last
+    mixer_init((uint32_t)info.sample_rate);
+    mixer_set_channels(info.channels);
+    mixer_stream(0, ring_provide, ring_consume, NULL, info.channels);
+    audio_out_cfg_t cfg = { .backend = AUDIO_OUT_MOCK, .sample_rate = info.sample_rate, .channels = info.channels };
+    audio_out_init(&cfg);
+    audio_out_set_provider(mixer_provide, mixer_consume, NULL);
+    audio_out_start();
+
+    uint32_t prev_crc = r->crc;
+    uint64_t prev_frames = r->out_frames;
+    r->crc = 0;
+    r->out_frames = 0;
+    FILE* pcm = NULL;
+    if (opt.pcm_dir && pass == 0) {
+        char name[1024];
+        snprintf(name, sizeof(name), "%s/%s.pcm", opt.pcm_dir, base_name(r->path));
+        pcm = fopen(name, "wb");
+    }
+
+    size_t cap = r->ncalls ? r->ncalls : 1024, idx = 0;
+    if (pass == 0) r->calls = malloc(cap * sizeof(call_t));
+    copy_bytes = 0;
+    bool ok = true;
+    for (;;) {
+        int16_t* dst;
+        if (pcm_ring_reserve(&ring, &dst) == 0) {
+            pump(r, pcm, MP3_DECODE_MAX_FRAMES);
+            continue;
+        }
+        uint64_t t0 = now_ns();
+        int n = mp3_decoder_decode(dec, dst, MP3_DECODE_MAX_FRAMES);
+        uint64_t t1 = now_ns();
+        if (n < 0) { fprintf(stderr, "%s: decode error %d\n", r->path, n); ok = false; break; }
+        if (n > 0) pcm_ring_commit(&ring, (size_t)n);
+        uint32_t ns = (uint32_t)(t1 - t0);
+        if (pass == 0) {
+            if (r->ncalls == cap) r->calls = realloc(r->calls, (cap *= 2) * sizeof(call_t));
+            r->calls[r->ncalls++] = (call_t){ (uint32_t)n, ns };
+        } else if (idx < r->ncalls && r->calls[idx].ns > ns) {
+            r->calls[idx].ns = ns;
+        }
+        idx++;
+        if (n == 0 && mp3_decoder_is_eof(dec)) break;
+    }
+    while (!pcm_ring_finish(&ring)) pump(r, pcm, MP3_DECODE_MAX_FRAMES);
+    while (pump(r, pcm, MP3_DECODE_MAX_FRAMES)) {}
+    r->copies = copy_bytes;
+
+    uint32_t zero;
+    mp3_decoder_get_diag(dec, &r->mp3_frames, &zero);
+    audio_out_stop();
+    mixer_stop(0);
+    if (pcm) fclose(pcm);
+    mp3_decoder_destroy(dec);
+    free(mem);
+    if (ok && pass && (r->crc != prev_crc || r->out_frames != prev_frames || idx != r->ncalls)) {
+        fprintf(stderr, "%s: pass %d differs from pass 0\n", r->path, pass);
+        ok = false;
+    }
+    return ok;
+}
+
+// ===== Float engine comparison =====
+// Decode the file with both engines in step and print the build engine's error against
+// the float one, over every sample. Where the float output sits on a rail, it only
+// bounds the true value: those samples are left out of max/RMS, and only checked to be
+// on the same rail. The other samples of a frame with clipping are held to
+// FLOAT_MAX_CLIP_LSB, all others to FLOAT_MAX_LSB. False above a limit, with more than
+// FLOAT_CLIP_PCT of the samples on a rail, or if the engines disagree on length.
+static bool compare_float(const char* path) {
+    static int16_t a[2 * MP3_DECODE_MAX_FRAMES], b[2 * MP3_DECODE_MAX_FRAMES];
+    mp3_decoder_t* dec = mp3_decoder_create();
+    mp3f_decoder_t* fdec = mp3f_decoder_create();
+    mp3_stream_info_t info, finfo;
+    if (!dec || !fdec || !mp3_decoder_open(dec, path, &info) || !mp3f_decoder_open(fdec, path, &finfo)) {
+        fprintf(stderr, "%s: cannot open\n", path);
+        if (dec) mp3_decoder_destroy(dec);
+        if (fdec) mp3f_decoder_destroy(fdec);
+        return false;
+    }
+    bool same = info.sample_rate == finfo.sample_rate && info.channels == finfo.channels;
+    int max = 0, clip_max = 0, rail_max = 0;
+    double sq = 0;
+    uint64_t samples = 0, clipped = 0;
+    while (same) {
+        int n = mp3_decoder_decode(dec, a, MP3_DECODE_MAX_FRAMES);
+        int nf = mp3f_decoder_decode(fdec, b, MP3_DECODE_MAX_FRAMES);
+        if (n != nf) { same = false; break; }
+        if (n < 0) break;
+        if (n == 0) {
+            if (mp3_decoder_is_eof(dec) || mp3f_decoder_is_eof(fdec)) break;
+            continue;
+        }
+        size_t count = (size_t)n * (size_t)info.channels;
+        bool frame_clips = false;
+        for (size_t i = 0; i < count; ++i) frame_clips |= b[i] == 32767 || b[i] == -32768;
+        int* worst = frame_clips ? &clip_max : &max;
+        for (size_t i = 0; i < count; ++i) {
+            int d = abs((int)a[i] - (int)b[i]);
+            if (b[i] == 32767 || b[i] == -32768) {
+                // Clipped: the build engine must reach the same rail
+                clipped++;
+                if (d > rail_max) rail_max = d;
+                continue;
+            }
+            if (d > *worst) *worst = d;
+            sq += (double)d * d;
+            samples++;
+        }
+    }
+    same = same && mp3_decoder_is_eof(dec) == mp3f_decoder_is_eof(fdec);
+    mp3_decoder_destroy(dec);
+    mp3f_decoder_destroy(fdec);
+
+    double rms = samples ? sqrt(sq / (double)samples) : 0;
+    double pct = samples + clipped ? 100.0 * (double)clipped / (double)(samples + clipped) : 0;
+    bool ok = same && max <= FLOAT_MAX_LSB && clip_max <= FLOAT_MAX_CLIP_LSB &&
+              rms <= FLOAT_RMS_LSB && rail_max <= FLOAT_MAX_CLIP_LSB && pct <= FLOAT_CLIP_PCT;
+    printf("  vs float: max %d lsb (%d in frames that clip), rms %.3f lsb; %llu clipped "
+           "samples (%.2f%%), max %d lsb off the rail%s%s\n",
+           max, clip_max, rms, (unsigned long long)clipped, pct, rail_max,
+           same ? "" : ", output differs in length", ok ? "" : "  FAIL");
+    return ok;
+}
+
+// ===== Decode timer replay =====
+// Virtual time in microseconds; the output drains at the stream rate, the VM decodes
+// when decode_sched asks it to, one recorded call at a time.
+typedef struct {
+    double   t;             // now
+    double   level;         // PCM bytes buffered
+    double   consumed;      // PCM bytes drained
+    double   bps;           // drain rate, bytes/us
+    uint32_t underruns;
+    bool     dry;
+} sim_t;
+
+static void sim_advance(sim_t* s, double dt) {
+    double want = dt * s->bps;
+    if (want > s->level) {
+        if (!s->dry) s->underruns++;
+        s->dry = true;
+        want = s->level;
+    } else if (want > 0) {
+        s->dry = false;
+    }
+    s->level -= want;
+    s->consumed += want;
+    s->t += dt;
+}
+
+static void replay(const run_t* r, dsched_t* d, uint32_t* underruns) {
+    uint32_t frame_bytes = (uint32_t)r->channels * 2;
+    uint32_t cap = r->ring_bytes;
+    uint32_t max_call = MP3_DECODE_MAX_FRAMES * frame_bytes;
+
+    memset(d, 0, sizeof(*d));
+    dsched_config(d, cap, 25, 90);
+    dsched_start(d, (uint32_t)r->rate * frame_bytes);
+
+    sim_t s = { 0 };
+    s.bps = (double)r->rate * frame_bytes / 1e6;
+    double busy = opt.load >= 100 ? 99.0 : (double)opt.load;
+    double stretch = 100.0 / (100.0 - busy);   // VM time shared with other work
+    size_t next = 0;
+    // play() predecodes to half the high watermark before the output starts
+    while (next < r->ncalls && s.level < d->high / 2) s.level += (double)r->calls[next++].frames * frame_bytes;
+    // Until the decoder is done; the tail drains without it
+    while (next < r->ncalls) {
+        bool want = false;
+        uint32_t delay = dsched_tick(d, (uint32_t)s.level, (uint32_t)s.consumed, (uint32_t)s.t, &want);
+        double tick_end = s.t + delay;
+        if (want) {
+            d->services++;
+            uint32_t budget = dsched_budget(d, (uint32_t)s.level);
+            for (uint32_t k = 0; k < budget && next < r->ncalls; ++k) {
+                if (s.level + max_call > cap) break;   // pcm_ring_reserve would refuse
+                const call_t* c = &r->calls[next++];
+                double us = c->ns / 1000.0 * opt.slow * stretch;
+                sim_advance(&s, us);
+                s.level += (double)c->frames * frame_bytes;
+                dsched_note_decode(d, c->frames * frame_bytes, (uint32_t)us);
+            }
+        }
+        if (tick_end > s.t) sim_advance(&s, tick_end - s.t);
+    }
+    *underruns = s.underruns;
+}
+
+// ===== Report =====
+static int cmp_u32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static void report(const run_t* r) {
+    // Per-MP3-frame cost over the calls that produced audio
+    uint32_t* ns = malloc((r->ncalls + 1) * sizeof(uint32_t));
+    size_t n = 0;
+    double sum = 0;
+    for (size_t i = 0; i < r->ncalls; ++i) {
+        if (!r->calls[i].frames) continue;
+        ns[n++] = r->calls[i].ns;
+        sum += r->calls[i].ns;
+    }
+    qsort(ns, n, sizeof(uint32_t), cmp_u32);
+    double mean = n ? sum / n / 1000.0 : 0;
+    double p99 = n ? ns[n - 1 - n / 100] / 1000.0 : 0;
+    double max = n ? ns[n - 1] / 1000.0 : 0;
+    free(ns);
+
+    dsched_t d;
+    uint32_t under;
+    replay(r, &d, &under);
+
+    printf("%s: %d Hz %dch, %u mp3 frames, %llu pcm frames\n", base_name(r->path),
+           r->rate, r->channels, (unsigned)r->mp3_frames, (unsigned long long)r->out_frames);
+    printf("  decode us/frame  mean %.1f  p99 %.1f  max %.1f\n", mean, p99, max);
+    printf("  copy bytes/frame %.2f\n", r->out_frames ? (double)r->copies / r->out_frames : 0.0);
+    printf("  replay x%.1f load %d%%: %u wakeups, %u services, %u underruns, ttu min %u ms\n",
+           opt.slow, opt.load, (unsigned)d.wakeups, (unsigned)d.services, (unsigned)under,
+           (unsigned)(d.ttu_min_us / 1000u));
+}
+
+// ===== Golden list: "crc32 frames name" per line =====
+static int check_golden(const char* file, const run_t* runs, size_t n) {
+    FILE* f = fopen(file, "r");
+    if (!f) { fprintf(stderr, "%s: cannot open\n", file); return 1; }
+    int bad = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const char* name = base_name(runs[i].path);
+        char line[1100], gname[1024];
+        unsigned crc;
+        unsigned long long frames;
+        bool found = false;
+        rewind(f);
+        while (fgets(line, sizeof(line), f)) {
+            if (sscanf(line, "%x %llu %1023s", &crc, &frames, gname) != 3) continue;
+            if (strcmp(gname, name) != 0) continue;
+            found = true;
+            if (crc != runs[i].crc || frames != runs[i].out_frames) {
+                printf("MISMATCH %s: %08x %llu, golden %08x %llu\n", name, (unsigned)runs[i].crc,
+                       (unsigned long long)runs[i].out_frames, crc, frames);
+                bad = 1;
+            }
+            break;
+        }
+        if (!found) { printf("MISSING %s\n", name); bad = 1; }
+    }
+    fclose(f);
+    if (!bad) printf("golden: %u files match\n", (unsigned)n);
+    return bad;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: mp3bench [--ring-bits 16|8|4] [--buffer-ms N] [--slow X] [--load P] [--runs N]\n"
+                    "                [--fast] [--crc] [--golden FILE] [--write-golden FILE] [--pcm DIR]\n"
+                    "                [--compare-float] file.mp3...\n");
+    exit(2);
+}
+
+int main(int argc, char** argv) {
+    run_t* runs = calloc((size_t)argc, sizeof(run_t));
+    size_t n = 0;
+    for (int i = 1; i < argc; ++i) {
+        const char* a = argv[i];
+        bool has = i + 1 < argc;
+        if (!strcmp(a, "--ring-bits") && has) opt.ring_bits = atoi(argv[++i]);
+        else if (!strcmp(a, "--buffer-ms") && has) opt.buffer_ms = atoi(argv[++i]);
+        else if (!strcmp(a, "--slow") && has) opt.slow = atof(argv[++i]);
+        else if (!strcmp(a, "--load") && has) opt.load = atoi(argv[++i]);
+        else if (!strcmp(a, "--runs") && has) opt.runs = atoi(argv[++i]);
+        else if (!strcmp(a, "--fast")) opt.fast = true;
+        else if (!strcmp(a, "--crc")) opt.crc = true;
+        else if (!strcmp(a, "--golden") && has) opt.golden = argv[++i];
+        else if (!strcmp(a, "--write-golden") && has) opt.write_golden = argv[++i];
+        else if (!strcmp(a, "--pcm") && has) opt.pcm_dir = argv[++i];
+        else if (!strcmp(a, "--compare-float")) opt.compare_float = true;
+        else if (a[0] == '-') usage();
+        else runs[n++].path = a;
+    }
+    if (!n || (opt.ring_bits != 16 && opt.ring_bits != 8 && opt.ring_bits != 4) ||
+        opt.buffer_ms < 50 || opt.slow <= 0 || opt.load < 0 || opt.runs < 1 ||
+        (opt.fast && opt.compare_float)) usage();
+
+    crc_setup();
+    int status = 0;
+    for (size_t i = 0; i < n; ++i) {
+        bool ok = true;
+        for (int pass = 0; ok && pass < opt.runs; ++pass) ok = decode_pass(&runs[i], pass);
+        if (!ok) { status = 1; continue; }
+        report(&runs[i]);
+        if (opt.crc) printf("  crc %08x\n", (unsigned)runs[i].crc);
+        if (opt.compare_float && !compare_float(runs[i].path)) status = 1;
+    }
+
+    if (opt.write_golden) {
+        FILE* f = fopen(opt.write_golden, "w");
+        if (!f) { fprintf(stderr, "%s: cannot write\n", opt.write_golden); return 1; }
+        for (size_t i = 0; i < n; ++i) {
+            fprintf(f, "%08x %llu %s\n", (unsigned)runs[i].crc,
+                    (unsigned long long)runs[i].out_frames, base_name(runs[i].path));
+        }
+        fclose(f);
+    }
+    if (opt.golden && check_golden(opt.golden, runs, n)) status = 1;
+
+    for (size_t i = 0; i < n; ++i) free(runs[i].calls);
+    free(runs);
+    return status;
+}
@@ -0,0 +1,9 @@
+// py/misc.h : Host stand-in for MicroPython's heap macros
+#pragma once
+#include <stdlib.h>
+
+typedef unsigned char byte;
+
+#define m_new(type, num)        ((type*)malloc(sizeof(type) * (num)))
+#define m_del(type, ptr, num)   ((void)(num), free(ptr))
+#define m_renew(type, ptr, old_num, new_num) ((void)(old_num), (type*)realloc((ptr), sizeof(type) * (new_num)))
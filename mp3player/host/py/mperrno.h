@@ -0,0 +1,5 @@
+// py/mperrno.h : Host stand-in for MicroPython's errno values
+#pragma once
+#include <errno.h>
+
+#define MP_EIO  EIO
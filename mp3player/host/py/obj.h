@@ -0,0 +1,11 @@
+// py/obj.h : Host stand-in for the few MicroPython object types the player core uses
+// (file handles are plain FILE* here, see vfs_posix.c)
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef void* mp_obj_t;
+#define MP_OBJ_NULL         ((mp_obj_t)0)
+#define MP_OBJ_TO_PTR(o)    ((void*)(o))
+#define MP_OBJ_FROM_PTR(p)  ((mp_obj_t)(p))
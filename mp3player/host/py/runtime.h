@@ -0,0 +1,13 @@
+// py/runtime.h : Host stand-in for MicroPython's runtime
+// Host file I/O reports errors through return values and never raises, so an nlr
+// block always runs to nlr_pop(); the few explicit raises abort.
+#pragma once
+#include "py/obj.h"
+#include "py/misc.h"
+
+typedef struct { void* ret_val; } nlr_buf_t;
+
+static inline int  nlr_push(nlr_buf_t* nlr) { (void)nlr; return 0; }
+static inline void nlr_pop(void) {}
+static inline void nlr_jump(void* val) { (void)val; abort(); }
+static inline void mp_raise_OSError(int errno_) { (void)errno_; abort(); }
@@ -0,0 +1,190 @@
+// snrbench.c : Sine-sweep SNR check of the PWM output path (resampler + noise shaper)
+// Each case runs a sine at a stream rate (55.125 kHz is 44.1 kHz at set_rate(125))
+// through the resampler to the PWM's fixed rate, then through the noise shaper at the
+// oversampling factor, exactly as audio_out_pwm renders a batch. The PWM levels are
+// windowed and transformed, and the SNR (noise and distortion, 20 Hz..20 kHz) of every
+// tone up to 15 kHz (and 0.4 of the stream rate) is checked against a floor per
+// oversampling factor: one for streams the resampler passes through (RS_PASS_PPM), one
+// for filtered streams. The floors hold at 125 MHz and faster clocks.
+//
+//   snrbench [options]
+//     --clk HZ      system clock the PWM divides, default 125000000
+//     --no-dither   shaper without TPDF dither (mp3.init dither=False)
+//     --verbose     print every tone, not only the worst one per case
+// Exit status 1 if any tone is below its floor.
+#include "resampler.h"
+#include "noise_shaper.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PWM_RATE     44100u     // AUDIO_OUT_RATE of audio_out_pwm.c
+#define FFT_BITS     16
+#define FFT_N        (1u << FFT_BITS)
+#define WARMUP       4096u      // PWM periods dropped while filter and shaper settle
+#define SIG_BINS     8          // bins either side of the peak counted as the tone
+#define AMPLITUDE    0.891      // -1 dBFS
+#define PI           3.14159265358979323846
+
+// Floors by oversampling factor (index log2), 0.5-1 dB under what this measures at
+// 125 MHz with dither (the default): 2x loses to plain truncation, since the shaper's
+// second-order noise still rises inside 20 kHz and the dither adds to it
+static const double pass_floor_db[] = { 69.5, 62.5, 75.0, 87.0 };
+static const double filter_floor_db[] = { 69.0, 62.0, 74.0, 81.5 };
+
+static resampler_t rs;
+static noise_shaper_t ns;
+static double levels[FFT_N];
+static double re[FFT_N], im[FFT_N];
+
+// As audio_out_pwm.c: plain truncation without oversampling
+static uint8_t shaper_order(unsigned osr) {
+    return osr >= 4 ? 3 : (osr == 2 ? 2 : 0);
+}
+
+// In-place radix-2 FFT
+static void fft(double* x, double* y, unsigned n) {
+    for (unsigned i = 1, j = 0; i < n; i++) {
+        unsigned bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) {
+            double t = x[i]; x[i] = x[j]; x[j] = t;
+            t = y[i]; y[i] = y[j]; y[j] = t;
+        }
+    }
+    for (unsigned len = 2; len <= n; len <<= 1) {
+        double a = -2.0 * PI / len;
+        for (unsigned i = 0; i < n; i += len) {
+            for (unsigned k = 0; k < len / 2; k++) {
+                double c = cos(a * k), s = sin(a * k);
+                double ur = x[i + k], ui = y[i + k];
+                double vr = x[i + k + len/2] * c - y[i + k + len/2] * s;
+                double vi = x[i + k + len/2] * s + y[i + k + len/2] * c;
+                x[i + k] = ur + vr; y[i + k] = ui + vi;
+                x[i + k + len/2] = ur - vr; y[i + k + len/2] = ui - vi;
+            }
+        }
+    }
+}
+
+// Render `freq` Hz at `in_rate` into FFT_N left-channel PWM levels (after WARMUP)
+static void render(uint32_t in_rate, uint32_t out_rate, unsigned osr, uint16_t top,
+                   double freq, bool dither) {
+    memset(&rs, 0, sizeof(rs));
+    resampler_init(&rs, in_rate, out_rate);
+    ns_init(&ns, top, shaper_order(osr), dither);
+    uint64_t in_pos = 0;
+    size_t got = 0, skip = WARMUP;
+    int16_t out[2 * RS_MAX_OUT];
+    while (got < FFT_N) {
+        size_t need = resampler_needed(&rs, RS_MAX_OUT);
+        while (need) {
+            int16_t* dst;
+            size_t room = resampler_space(&rs, &dst);
+            if (room > need) room = need;
+            for (size_t k = 0; k < room; k++, in_pos++) {
+                double v = AMPLITUDE * 32767.0 * sin(2.0 * PI * freq * (double)in_pos / in_rate);
+                dst[2*k] = dst[2*k + 1] = (int16_t)lrint(v);
+            }
+            resampler_push(&rs, room);
+            need -= room;
+        }
+        size_t n = resampler_run(&rs, out, RS_MAX_OUT);
+        for (size_t i = 0; i < n; i++) {
+            for (unsigned k = 0; k < osr; k++) {
+                uint16_t l = ns_level(&ns, &ns.ch[0], out[2*i]);
+                (void)ns_level(&ns, &ns.ch[1], out[2*i + 1]);
+                if (skip) skip--;
+                else if (got < FFT_N) levels[got++] = l;
+            }
+        }
+    }
+}
+
+// SNR in dB of the rendered levels, 20 Hz..20 kHz at `pwm_rate` levels per second
+static double measure(double pwm_rate, double tone) {
+    double mean = 0;
+    for (unsigned i = 0; i < FFT_N; i++) mean += levels[i];
+    mean /= FFT_N;
+    for (unsigned i = 0; i < FFT_N; i++) {
+        // 4-term Blackman-Harris: sidelobes far below any floor checked here
+        double p = 2.0 * PI * i / FFT_N;
+        double w = 0.35875 - 0.48829 * cos(p) + 0.14128 * cos(2*p) - 0.01168 * cos(3*p);
+        re[i] = (levels[i] - mean) * w;
+        im[i] = 0;
+    }
+    fft(re, im, FFT_N);
+    double hz = pwm_rate / FFT_N;
+    unsigned lo = (unsigned)ceil(20.0 / hz), hi = (unsigned)(20000.0 / hz);
+    if (hi > FFT_N / 2 - 1) hi = FFT_N / 2 - 1;
+    // The tone's bin: the largest near where it should be (a passed-through stream
+    // plays slightly off pitch)
+    unsigned guess = (unsigned)lrint(tone / hz), peak = guess;
+    for (unsigned k = guess > 2 * SIG_BINS ? guess - 2 * SIG_BINS : 1; k <= guess + 2 * SIG_BINS; k++) {
+        if (re[k]*re[k] + im[k]*im[k] > re[peak]*re[peak] + im[peak]*im[peak]) peak = k;
+    }
+    double sig = 0, noise = 0;
+    for (unsigned k = lo; k <= hi; k++) {
+        double pw = re[k]*re[k] + im[k]*im[k];
+        if (k + SIG_BINS >= peak && k <= peak + SIG_BINS) sig += pw;
+        else noise += pw;
+    }
+    return 10.0 * log10(sig / noise);
+}
+
+int main(int argc, char** argv) {
+    uint32_t clk = 125000000u;
+    bool dither = true, verbose = false;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--clk") && i + 1 < argc) clk = (uint32_t)strtoul(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "--no-dither")) dither = false;
+        else if (!strcmp(argv[i], "--verbose")) verbose = true;
+        else {
+            fprintf(stderr, "usage: snrbench [--clk HZ] [--no-dither] [--verbose]\n");
+            return 2;
+        }
+    }
+
+    static const uint32_t rates[] = { 44100, 48000, 32000, 22050, 55125 };
+    static const unsigned osrs[] = { 1, 2, 4, 8 };
+    static const double freqs[] = { 100, 400, 1000, 2500, 6000, 10000, 15000 };
+    int failed = 0;
+    printf("clk %u Hz, dither %s\n", clk, dither ? "on" : "off");
+    printf("%6s %3s %7s %6s  %8s %7s %6s\n", "in Hz", "osr", "out Hz", "path", "tone Hz", "SNR dB", "floor");
+    for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+        for (size_t o = 0; o < sizeof(osrs) / sizeof(osrs[0]); o++) {
+            // TOP and the resulting rate as audio_configure_pwm picks them
+            unsigned osr = osrs[o];
+            uint32_t pwm = PWM_RATE * osr;
+            uint16_t top = (uint16_t)((clk + pwm / 2) / pwm - 1);
+            uint32_t out_rate = clk / (((uint32_t)top + 1) * osr);
+            memset(&rs, 0, sizeof(rs));
+            resampler_init(&rs, rates[r], out_rate);
+            bool pass = rs.step == (1u << 16);
+            double fl = pass ? pass_floor_db[o] : filter_floor_db[o];
+            double worst = 1e9, worst_f = 0;
+            for (size_t f = 0; f < sizeof(freqs) / sizeof(freqs[0]); f++) {
+                // Stay inside the stream's own band
+                if (freqs[f] > 0.4 * rates[r]) continue;
+                render(rates[r], out_rate, osr, top, freqs[f], dither);
+                double tone = pass ? freqs[f] * out_rate / rates[r] : freqs[f];
+                double snr = measure((double)out_rate * osr, tone);
+                if (verbose) {
+                    printf("%6u %3u %7u %6s  %8.0f %7.1f %6.1f%s\n", rates[r], osr, out_rate,
+                           pass ? "pass" : "filter", freqs[f], snr, fl, snr < fl ? "  FAIL" : "");
+                }
+                if (snr < worst) { worst = snr; worst_f = freqs[f]; }
+            }
+            if (!verbose) {
+                printf("%6u %3u %7u %6s  %8.0f %7.1f %6.1f%s\n", rates[r], osr, out_rate,
+                       pass ? "pass" : "filter", worst_f, worst, fl, worst < fl ? "  FAIL" : "");
+            }
+            if (worst < fl) failed++;
+        }
+    }
+    printf(failed ? "%d FAILED\n" : "all ok\n", failed);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,81 @@
+// vfs_posix.c : vfs_bridge.h on stdio, for the host build
+#include "vfs_bridge.h"
+#include <stdio.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+static bool open_mode(const char* path, const char* mode, mp_obj_t* out_file){
+    FILE* f = fopen(path, mode);
+    *out_file = MP_OBJ_FROM_PTR(f);
+    return f != NULL;
+}
+
+bool vfs_open_rb(const char* path, mp_obj_t* out_file){ return open_mode(path, "rb", out_file); }
+bool vfs_open_wb(const char* path, mp_obj_t* out_file){ return open_mode(path, "wb", out_file); }
+
+int vfs_read(mp_obj_t file, uint8_t* buf, size_t nbytes){
+    if (file == MP_OBJ_NULL) return -1;
+    size_t n = fread(buf, 1, nbytes, (FILE*)file);
+    if (n == 0 && ferror((FILE*)file)) return -1;
+    return (int)n;
+}
+
+int vfs_write(mp_obj_t file, const uint8_t* buf, size_t nbytes){
+    size_t n = fwrite(buf, 1, nbytes, (FILE*)file);
+    return n == nbytes ? (int)n : -1;
+}
+
+bool vfs_seek(mp_obj_t file, uint32_t offset){
+    return fseek((FILE*)file, (long)offset, SEEK_SET) == 0;
+}
+
+int32_t vfs_size(mp_obj_t file){
+    FILE* f = (FILE*)file;
+    long pos = ftell(f);
+    if (pos < 0 || fseek(f, 0, SEEK_END) != 0) return -1;
+    long end = ftell(f);
+    fseek(f, pos, SEEK_SET);
+    return (int32_t)end;
+}
+
+void vfs_close(mp_obj_t* file){
+    if (*file != MP_OBJ_NULL) fclose((FILE*)*file);
+    *file = MP_OBJ_NULL;
+}
+
+bool vfs_stat(const char* path, uint32_t* size, uint32_t* mtime){
+    struct stat st;
+    if (stat(path, &st) != 0) return false;
+    *size = (uint32_t)st.st_size;
+    *mtime = (uint32_t)st.st_mtime;
+    return true;
+}
+
+bool vfs_dir_open(const char* path, mp_obj_t* out_iter){
+    DIR* d = opendir(path);
+    *out_iter = MP_OBJ_FROM_PTR(d);
+    return d != NULL;
+}
+
+bool vfs_dir_next(mp_obj_t iter, char* name, size_t cap, bool* is_dir){
+    struct dirent* e;
+    do {
+        e = readdir((DIR*)iter);
+        if (!e) return false;
+    } while (!strcmp(e->d_name, ".") || !strcmp(e->d_name, ".."));
+    size_t len = strlen(e->d_name);
+    if (len >= cap) len = cap - 1;
+    memcpy(name, e->d_name, len);
+    name[len] = '\0';
+    *is_dir = e->d_type == DT_DIR;
+    return true;
+}
+
+void vfs_dir_close(mp_obj_t* iter){
+    if (*iter != MP_OBJ_NULL) closedir((DIR*)*iter);
+    *iter = MP_OBJ_NULL;
+}
+
+bool vfs_remove(const char* path){ return remove(path) == 0; }
+bool vfs_rename(const char* from, const char* to){ return rename(from, to) == 0; }
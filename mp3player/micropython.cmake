@@ -4,9 +4,21 @@ add_library(usermod_mp3player INTERFACE)
 target_sources(usermod_mp3player INTERFACE
     ${CMAKE_CURRENT_LIST_DIR}/mp3player.c
     ${CMAKE_CURRENT_LIST_DIR}/ring_buffer.c
+    ${CMAKE_CURRENT_LIST_DIR}/pcm_ring.c
     ${CMAKE_CURRENT_LIST_DIR}/mp3_decode_minimp3.c
+    ${CMAKE_CURRENT_LIST_DIR}/audio_out.c
     ${CMAKE_CURRENT_LIST_DIR}/audio_out_pwm.c
+    ${CMAKE_CURRENT_LIST_DIR}/audio_out_i2s.c
+    ${CMAKE_CURRENT_LIST_DIR}/audio_out_mock.c
+    ${CMAKE_CURRENT_LIST_DIR}/mixer.c
+    ${CMAKE_CURRENT_LIST_DIR}/resampler.c
+    ${CMAKE_CURRENT_LIST_DIR}/decode_sched.c
+    ${CMAKE_CURRENT_LIST_DIR}/audio_trace.c
     ${CMAKE_CURRENT_LIST_DIR}/vfs_bridge.c
+    ${CMAKE_CURRENT_LIST_DIR}/fat_direct.c
+    ${CMAKE_CURRENT_LIST_DIR}/mp3_index.c
+    ${CMAKE_CURRENT_LIST_DIR}/mp3_meta.c
+    ${CMAKE_CURRENT_LIST_DIR}/mp3_library.c
 )
 
 target_include_directories(usermod_mp3player INTERFACE
@@ -15,9 +27,42 @@ target_include_directories(usermod_mp3player INTERFACE
 
 target_link_libraries(usermod_mp3player INTERFACE
     hardware_pwm
+    hardware_pio
     hardware_dma
     hardware_irq
     hardware_clocks
+    hardware_sync
+)
+
+# Optional core 1 decode shares core 1 with the display through core1sched
+include(${CMAKE_CURRENT_LIST_DIR}/../core1sched/micropython.cmake)
+target_link_libraries(usermod_mp3player INTERFACE usermod_core1sched)
+
+# Decode engine: integer-only minimp3_fixed.h on RP2040 (no FPU), float minimp3.h elsewhere.
+# Override with -DMP3_FIXED_POINT=0/1.
+if(NOT DEFINED MP3_FIXED_POINT)
+    if(PICO_PLATFORM STREQUAL "rp2040")
+        set(MP3_FIXED_POINT 1)
+    else()
+        set(MP3_FIXED_POINT 0)
+    endif()
+endif()
+
+# Link-time PCM ring outside the GC heap for mp3.init(buffer="static"), e.g.
+# -DMP3_STATIC_RING_BYTES=32768. 0 (default) leaves it out.
+if(NOT DEFINED MP3_STATIC_RING_BYTES)
+    set(MP3_STATIC_RING_BYTES 0)
+endif()
+
+# Pipeline timing probes (mp3.trace); -DMP3_TRACE=0 compiles them out
+if(NOT DEFINED MP3_TRACE)
+    set(MP3_TRACE 1)
+endif()
+
+target_compile_definitions(usermod_mp3player INTERFACE
+    MP3_FIXED_POINT=${MP3_FIXED_POINT}
+    MP3_STATIC_RING_BYTES=${MP3_STATIC_RING_BYTES}
+    MP3_TRACE=${MP3_TRACE}
 )
 
 # Link into MicroPython's usermod umbrella
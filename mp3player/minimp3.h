@@ -1715,6 +1715,10 @@ int mp3dec_decode_frame(mp3dec_t *dec, const uint8_t *mp3, int mp3_bytes, mp3d_s
     int i = 0, igr, frame_size = 0, success = 1;
     const uint8_t *hdr;
     bs_t bs_frame[1];
+#ifdef MINIMP3_STATIC_SCRATCH
+    /* Not reentrant: for one decoder on a small stack (RP2040 core 1) */
+    static
+#endif /* MINIMP3_STATIC_SCRATCH */
     mp3dec_scratch_t scratch;
 
     if (mp3_bytes > 4 && dec->header[0] == 0xff && hdr_compare(dec->header, mp3))
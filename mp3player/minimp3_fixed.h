@@ -0,0 +1,1418 @@
+#ifndef MINIMP3_FIXED_H
+#define MINIMP3_FIXED_H
+/*
+    Integer-only MPEG-1/2/2.5 Layer III decoder for cores without an FPU (RP2040).
+    Derived from https://github.com/lieff/minimp3 (CC0, same terms apply): header,
+    side info, scalefactor and Huffman parsing are unchanged, the DSP runs on int32.
+
+    Drop-in replacement for minimp3.h built with MINIMP3_ONLY_MP3: same mp3dec_t,
+    mp3dec_init() and mp3dec_decode_frame(), int16 output only.
+
+    Number formats:
+      samples      Q23 in int32 (1.0 == float minimp3's 1.0f, full scale is about 0.37),
+                   dequantiser clamps at +-4.0
+      coefficients Q30, the few DCT constants above 2.0 carry their own Q (see fx_mulq)
+      synthesis    integer window exactly as the float build, products split at 14 bits
+    Every multiply is built from 32x32->32 MULS, so no 64-bit or soft-float helpers are
+    pulled in on Cortex-M0+.
+
+    Accuracy against the float build (MINIMP3_NO_SIMD, int16 output), measured on
+    MPEG-1/2 mono, stereo, M/S and intensity stereo streams that do not clip:
+    max |error| <= 4 LSB, RMS error < 0.5 LSB. In frames that clip, samples the float
+    build clips land on the same rail (within 1 LSB) and the others are within 8 LSB
+    (host/mp3bench --compare-float).
+
+    Work the float build does and this one skips, output unchanged:
+      - subbands above the last non-zero coefficient (and without overlap left from the
+        previous granule) go through neither the antialias butterflies nor the IMDCT
+      - mono synthesis runs the two left lanes of the window only
+    Set mp3dec_t.half_rate for speech: subbands above a quarter of the sample rate are
+    dropped and only every other sample is synthesised, so a frame decodes to half the
+    samples at half the rate for about half the DSP work. It survives mp3dec_init() and
+    resyncs; a NULL-pcm probe still returns the stream's own samples per frame.
+*/
+#include <stdint.h>
+
+#define MINIMP3_MAX_SAMPLES_PER_FRAME (1152*2)
+
+typedef struct
+{
+    int frame_bytes, frame_offset, channels, hz, layer, bitrate_kbps;
+} mp3dec_frame_info_t;
+
+typedef struct
+{
+    int32_t mdct_overlap[2][9*32], qmf_state[15*2*32];
+    int reserv, free_format_bytes;
+    unsigned char header[4], reserv_buf[511];
+    unsigned char mdct_bands[2];    /* subbands whose overlap may be non-zero */
+    unsigned char half_rate;        /* caller's setting, see above */
+} mp3dec_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+void mp3dec_init(mp3dec_t *dec);
+typedef int16_t mp3d_sample_t;
+int mp3dec_decode_frame(mp3dec_t *dec, const uint8_t *mp3, int mp3_bytes, mp3d_sample_t *pcm, mp3dec_frame_info_t *info);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* MINIMP3_FIXED_H */
+#if defined(MINIMP3_IMPLEMENTATION) && !defined(_MINIMP3_FIXED_IMPLEMENTATION_GUARD)
+#define _MINIMP3_FIXED_IMPLEMENTATION_GUARD
+
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_FREE_FORMAT_FRAME_SIZE  2304    /* more than ISO spec's */
+#ifndef MAX_FRAME_SYNC_MATCHES
+#define MAX_FRAME_SYNC_MATCHES      10
+#endif /* MAX_FRAME_SYNC_MATCHES */
+
+#define MAX_L3_FRAME_PAYLOAD_BYTES  MAX_FREE_FORMAT_FRAME_SIZE /* MUST be >= 320000/8/32000*1152 = 1440 */
+
+#define MAX_BITRESERVOIR_BYTES      511
+#define SHORT_BLOCK_TYPE            2
+#define STOP_BLOCK_TYPE             3
+#define MODE_MONO                   3
+#define MODE_JOINT_STEREO           1
+#define HDR_SIZE                    4
+#define HDR_IS_MONO(h)              (((h[3]) & 0xC0) == 0xC0)
+#define HDR_IS_MS_STEREO(h)         (((h[3]) & 0xE0) == 0x60)
+#define HDR_IS_FREE_FORMAT(h)       (((h[2]) & 0xF0) == 0)
+#define HDR_IS_CRC(h)               (!((h[1]) & 1))
+#define HDR_TEST_PADDING(h)         ((h[2]) & 0x2)
+#define HDR_TEST_MPEG1(h)           ((h[1]) & 0x8)
+#define HDR_TEST_NOT_MPEG25(h)      ((h[1]) & 0x10)
+#define HDR_TEST_I_STEREO(h)        ((h[3]) & 0x10)
+#define HDR_TEST_MS_STEREO(h)       ((h[3]) & 0x20)
+#define HDR_GET_STEREO_MODE(h)      (((h[3]) >> 6) & 3)
+#define HDR_GET_STEREO_MODE_EXT(h)  (((h[3]) >> 4) & 3)
+#define HDR_GET_LAYER(h)            (((h[1]) >> 1) & 3)
+#define HDR_GET_BITRATE(h)          ((h[2]) >> 4)
+#define HDR_GET_SAMPLE_RATE(h)      (((h[2]) >> 2) & 3)
+#define HDR_GET_MY_SAMPLE_RATE(h)   (HDR_GET_SAMPLE_RATE(h) + (((h[1] >> 3) & 1) + ((h[1] >> 4) & 1))*3)
+#define HDR_IS_FRAME_576(h)         ((h[1] & 14) == 2)
+#define HDR_IS_LAYER_1(h)           ((h[1] & 6) == 6)
+
+#define BITS_DEQUANTIZER_OUT        -1
+#define MAX_SCF                     (255 + BITS_DEQUANTIZER_OUT*4 - 210)
+#define MAX_SCFI                    ((MAX_SCF + 3) & ~3)
+
+#define MINIMP3_MIN(a, b)           ((a) > (b) ? (b) : (a))
+#define MINIMP3_MAX(a, b)           ((a) < (b) ? (b) : (a))
+
+
+#define FX_FRAC                     23
+#define FX_SAT                      (1 << (FX_FRAC + 2))
+/* Round a real constant to Q(q); only ever used in static initialisers */
+#define FX_ROUND(x, q)              ((int32_t)((x)*(double)(1 << (q)) + ((x) < 0 ? -0.5 : 0.5)))
+/* Transform constants are Q30; the few above 2.0 carry the largest Q that still fits */
+#define K30(x)                      FX_ROUND(x, 30)
+#define FX_ABS(x)                   ((x) < 0 ? -(x) : (x))
+#define FX_QOF(x)                   (FX_ABS(x) >= 8 ? 27 : FX_ABS(x) >= 4 ? 28 : FX_ABS(x) >= 2 ? 29 : 30)
+#define FXC(x)                      { FX_ROUND(x, FX_QOF(x)), FX_QOF(x) }
+
+typedef struct
+{
+    int32_t c;
+    uint8_t q;
+} fx_coef_t;
+
+/* (a*c) >> q, rounded, for 16 <= q <= 30 and |c| < 2^31. c is split at bit 15 and the
+   high half applied as (a >> s)*hi plus the low s bits of a times hi, so all three
+   products stay inside a 32-bit MULS; the low half only needs a >> 15. */
+static inline int32_t fx_mulq(int32_t a, int32_t c, int q)
+{
+    int s = q - 15;
+    int32_t hi = c >> 15, lo = c & 0x7FFF;
+    return (a >> s)*hi + (((a & ((1 << s) - 1))*hi + (1 << (s - 1))) >> s) + (((a >> 15)*lo) >> s);
+}
+
+static inline int32_t fx_mul(int32_t a, int32_t c)
+{
+    return fx_mulq(a, c, 30);
+}
+
+typedef struct
+{
+    const uint8_t *buf;
+    int pos, limit;
+} bs_t;
+
+typedef struct
+{
+    const uint8_t *sfbtab;
+    uint16_t part_23_length, big_values, scalefac_compress;
+    uint8_t global_gain, block_type, mixed_block_flag, n_long_sfb, n_short_sfb;
+    uint8_t table_select[3], region_count[3], subblock_gain[3];
+    uint8_t preflag, scalefac_scale, count1_table, scfsi;
+} L3_gr_info_t;
+
+/* Band gain 2^(E/4) as a Q15 mantissa in [0.5, 1) and a shift for the dequantiser */
+typedef struct
+{
+    uint16_t m;
+    int8_t sh;
+} L3_scf_t;
+
+typedef struct
+{
+    bs_t bs;
+    uint8_t maindata[MAX_BITRESERVOIR_BYTES + MAX_L3_FRAME_PAYLOAD_BYTES];
+    L3_gr_info_t gr_info[4];
+    int32_t grbuf[2][576], syn[18 + 15][2*32];
+    L3_scf_t scf[40];
+    uint8_t ist_pos[2][39];
+} mp3dec_scratch_t;
+
+static void bs_init(bs_t *bs, const uint8_t *data, int bytes)
+{
+    bs->buf   = data;
+    bs->pos   = 0;
+    bs->limit = bytes*8;
+}
+
+static uint32_t get_bits(bs_t *bs, int n)
+{
+    uint32_t next, cache = 0, s = bs->pos & 7;
+    int shl = n + s;
+    const uint8_t *p = bs->buf + (bs->pos >> 3);
+    if ((bs->pos += n) > bs->limit)
+        return 0;
+    next = *p++ & (255 >> s);
+    while ((shl -= 8) > 0)
+    {
+        cache |= next << shl;
+        next = *p++;
+    }
+    return cache | (next >> -shl);
+}
+
+static int hdr_valid(const uint8_t *h)
+{
+    return h[0] == 0xff &&
+        ((h[1] & 0xF0) == 0xf0 || (h[1] & 0xFE) == 0xe2) &&
+        (HDR_GET_LAYER(h) != 0) &&
+        (HDR_GET_BITRATE(h) != 15) &&
+        (HDR_GET_SAMPLE_RATE(h) != 3);
+}
+
+static int hdr_compare(const uint8_t *h1, const uint8_t *h2)
+{
+    return hdr_valid(h2) &&
+        ((h1[1] ^ h2[1]) & 0xFE) == 0 &&
+        ((h1[2] ^ h2[2]) & 0x0C) == 0 &&
+        !(HDR_IS_FREE_FORMAT(h1) ^ HDR_IS_FREE_FORMAT(h2));
+}
+
+static unsigned hdr_bitrate_kbps(const uint8_t *h)
+{
+    static const uint8_t halfrate[2][3][15] = {
+        { { 0,4,8,12,16,20,24,28,32,40,48,56,64,72,80 }, { 0,4,8,12,16,20,24,28,32,40,48,56,64,72,80 }, { 0,16,24,28,32,40,48,56,64,72,80,88,96,112,128 } },
+        { { 0,16,20,24,28,32,40,48,56,64,80,96,112,128,160 }, { 0,16,24,28,32,40,48,56,64,80,96,112,128,160,192 }, { 0,16,32,48,64,80,96,112,128,144,160,176,192,208,224 } },
+    };
+    return 2*halfrate[!!HDR_TEST_MPEG1(h)][HDR_GET_LAYER(h) - 1][HDR_GET_BITRATE(h)];
+}
+
+static unsigned hdr_sample_rate_hz(const uint8_t *h)
+{
+    static const unsigned g_hz[3] = { 44100, 48000, 32000 };
+    return g_hz[HDR_GET_SAMPLE_RATE(h)] >> (int)!HDR_TEST_MPEG1(h) >> (int)!HDR_TEST_NOT_MPEG25(h);
+}
+
+static unsigned hdr_frame_samples(const uint8_t *h)
+{
+    return HDR_IS_LAYER_1(h) ? 384 : (1152 >> (int)HDR_IS_FRAME_576(h));
+}
+
+static int hdr_frame_bytes(const uint8_t *h, int free_format_size)
+{
+    int frame_bytes = hdr_frame_samples(h)*hdr_bitrate_kbps(h)*125/hdr_sample_rate_hz(h);
+    if (HDR_IS_LAYER_1(h))
+    {
+        frame_bytes &= ~3; /* slot align */
+    }
+    return frame_bytes ? frame_bytes : free_format_size;
+}
+
+static int hdr_padding(const uint8_t *h)
+{
+    return HDR_TEST_PADDING(h) ? (HDR_IS_LAYER_1(h) ? 4 : 1) : 0;
+}
+
+
+static int L3_read_side_info(bs_t *bs, L3_gr_info_t *gr, const uint8_t *hdr)
+{
+    static const uint8_t g_scf_long[8][23] = {
+        { 6,6,6,6,6,6,8,10,12,14,16,20,24,28,32,38,46,52,60,68,58,54,0 },
+        { 12,12,12,12,12,12,16,20,24,28,32,40,48,56,64,76,90,2,2,2,2,2,0 },
+        { 6,6,6,6,6,6,8,10,12,14,16,20,24,28,32,38,46,52,60,68,58,54,0 },
+        { 6,6,6,6,6,6,8,10,12,14,16,18,22,26,32,38,46,54,62,70,76,36,0 },
+        { 6,6,6,6,6,6,8,10,12,14,16,20,24,28,32,38,46,52,60,68,58,54,0 },
+        { 4,4,4,4,4,4,6,6,8,8,10,12,16,20,24,28,34,42,50,54,76,158,0 },
+        { 4,4,4,4,4,4,6,6,6,8,10,12,16,18,22,28,34,40,46,54,54,192,0 },
+        { 4,4,4,4,4,4,6,6,8,10,12,16,20,24,30,38,46,56,68,84,102,26,0 }
+    };
+    static const uint8_t g_scf_short[8][40] = {
+        { 4,4,4,4,4,4,4,4,4,6,6,6,8,8,8,10,10,10,12,12,12,14,14,14,18,18,18,24,24,24,30,30,30,40,40,40,18,18,18,0 },
+        { 8,8,8,8,8,8,8,8,8,12,12,12,16,16,16,20,20,20,24,24,24,28,28,28,36,36,36,2,2,2,2,2,2,2,2,2,26,26,26,0 },
+        { 4,4,4,4,4,4,4,4,4,6,6,6,6,6,6,8,8,8,10,10,10,14,14,14,18,18,18,26,26,26,32,32,32,42,42,42,18,18,18,0 },
+        { 4,4,4,4,4,4,4,4,4,6,6,6,8,8,8,10,10,10,12,12,12,14,14,14,18,18,18,24,24,24,32,32,32,44,44,44,12,12,12,0 },
+        { 4,4,4,4,4,4,4,4,4,6,6,6,8,8,8,10,10,10,12,12,12,14,14,14,18,18,18,24,24,24,30,30,30,40,40,40,18,18,18,0 },
+        { 4,4,4,4,4,4,4,4,4,4,4,4,6,6,6,8,8,8,10,10,10,12,12,12,14,14,14,18,18,18,22,22,22,30,30,30,56,56,56,0 },
+        { 4,4,4,4,4,4,4,4,4,4,4,4,6,6,6,6,6,6,10,10,10,12,12,12,14,14,14,16,16,16,20,20,20,26,26,26,66,66,66,0 },
+        { 4,4,4,4,4,4,4,4,4,4,4,4,6,6,6,8,8,8,12,12,12,16,16,16,20,20,20,26,26,26,34,34,34,42,42,42,12,12,12,0 }
+    };
+    static const uint8_t g_scf_mixed[8][40] = {
+        { 6,6,6,6,6,6,6,6,6,8,8,8,10,10,10,12,12,12,14,14,14,18,18,18,24,24,24,30,30,30,40,40,40,18,18,18,0 },
+        { 12,12,12,4,4,4,8,8,8,12,12,12,16,16,16,20,20,20,24,24,24,28,28,28,36,36,36,2,2,2,2,2,2,2,2,2,26,26,26,0 },
+        { 6,6,6,6,6,6,6,6,6,6,6,6,8,8,8,10,10,10,14,14,14,18,18,18,26,26,26,32,32,32,42,42,42,18,18,18,0 },
+        { 6,6,6,6,6,6,6,6,6,8,8,8,10,10,10,12,12,12,14,14,14,18,18,18,24,24,24,32,32,32,44,44,44,12,12,12,0 },
+        { 6,6,6,6,6,6,6,6,6,8,8,8,10,10,10,12,12,12,14,14,14,18,18,18,24,24,24,30,30,30,40,40,40,18,18,18,0 },
+        { 4,4,4,4,4,4,6,6,4,4,4,6,6,6,8,8,8,10,10,10,12,12,12,14,14,14,18,18,18,22,22,22,30,30,30,56,56,56,0 },
+        { 4,4,4,4,4,4,6,6,4,4,4,6,6,6,6,6,6,10,10,10,12,12,12,14,14,14,16,16,16,20,20,20,26,26,26,66,66,66,0 },
+        { 4,4,4,4,4,4,6,6,4,4,4,6,6,6,8,8,8,12,12,12,16,16,16,20,20,20,26,26,26,34,34,34,42,42,42,12,12,12,0 }
+    };
+
+    unsigned tables, scfsi = 0;
+    int main_data_begin, part_23_sum = 0;
+    int sr_idx = HDR_GET_MY_SAMPLE_RATE(hdr); sr_idx -= (sr_idx != 0);
+    int gr_count = HDR_IS_MONO(hdr) ? 1 : 2;
+
+    if (HDR_TEST_MPEG1(hdr))
+    {
+        gr_count *= 2;
+        main_data_begin = get_bits(bs, 9);
+        scfsi = get_bits(bs, 7 + gr_count);
+    } else
+    {
+        main_data_begin = get_bits(bs, 8 + gr_count) >> gr_count;
+    }
+
+    do
+    {
+        if (HDR_IS_MONO(hdr))
+        {
+            scfsi <<= 4;
+        }
+        gr->part_23_length = (uint16_t)get_bits(bs, 12);
+        part_23_sum += gr->part_23_length;
+        gr->big_values = (uint16_t)get_bits(bs,  9);
+        if (gr->big_values > 288)
+        {
+            return -1;
+        }
+        gr->global_gain = (uint8_t)get_bits(bs, 8);
+        gr->scalefac_compress = (uint16_t)get_bits(bs, HDR_TEST_MPEG1(hdr) ? 4 : 9);
+        gr->sfbtab = g_scf_long[sr_idx];
+        gr->n_long_sfb  = 22;
+        gr->n_short_sfb = 0;
+        if (get_bits(bs, 1))
+        {
+            gr->block_type = (uint8_t)get_bits(bs, 2);
+            if (!gr->block_type)
+            {
+                return -1;
+            }
+            gr->mixed_block_flag = (uint8_t)get_bits(bs, 1);
+            gr->region_count[0] = 7;
+            gr->region_count[1] = 255;
+            if (gr->block_type == SHORT_BLOCK_TYPE)
+            {
+                scfsi &= 0x0F0F;
+                if (!gr->mixed_block_flag)
+                {
+                    gr->region_count[0] = 8;
+                    gr->sfbtab = g_scf_short[sr_idx];
+                    gr->n_long_sfb = 0;
+                    gr->n_short_sfb = 39;
+                } else
+                {
+                    gr->sfbtab = g_scf_mixed[sr_idx];
+                    gr->n_long_sfb = HDR_TEST_MPEG1(hdr) ? 8 : 6;
+                    gr->n_short_sfb = 30;
+                }
+            }
+            tables = get_bits(bs, 10);
+            tables <<= 5;
+            gr->subblock_gain[0] = (uint8_t)get_bits(bs, 3);
+            gr->subblock_gain[1] = (uint8_t)get_bits(bs, 3);
+            gr->subblock_gain[2] = (uint8_t)get_bits(bs, 3);
+        } else
+        {
+            gr->block_type = 0;
+            gr->mixed_block_flag = 0;
+            tables = get_bits(bs, 15);
+            gr->region_count[0] = (uint8_t)get_bits(bs, 4);
+            gr->region_count[1] = (uint8_t)get_bits(bs, 3);
+            gr->region_count[2] = 255;
+        }
+        gr->table_select[0] = (uint8_t)(tables >> 10);
+        gr->table_select[1] = (uint8_t)((tables >> 5) & 31);
+        gr->table_select[2] = (uint8_t)((tables) & 31);
+        gr->preflag = HDR_TEST_MPEG1(hdr) ? get_bits(bs, 1) : (gr->scalefac_compress >= 500);
+        gr->scalefac_scale = (uint8_t)get_bits(bs, 1);
+        gr->count1_table = (uint8_t)get_bits(bs, 1);
+        gr->scfsi = (uint8_t)((scfsi >> 12) & 15);
+        scfsi <<= 4;
+        gr++;
+    } while(--gr_count);
+
+    if (part_23_sum + bs->pos > bs->limit + main_data_begin*8)
+    {
+        return -1;
+    }
+
+    return main_data_begin;
+}
+
+static void L3_read_scalefactors(uint8_t *scf, uint8_t *ist_pos, const uint8_t *scf_size, const uint8_t *scf_count, bs_t *bitbuf, int scfsi)
+{
+    int i, k;
+    for (i = 0; i < 4 && scf_count[i]; i++, scfsi *= 2)
+    {
+        int cnt = scf_count[i];
+        if (scfsi & 8)
+        {
+            memcpy(scf, ist_pos, cnt);
+        } else
+        {
+            int bits = scf_size[i];
+            if (!bits)
+            {
+                memset(scf, 0, cnt);
+                memset(ist_pos, 0, cnt);
+            } else
+            {
+                int max_scf = (scfsi < 0) ? (1 << bits) - 1 : -1;
+                for (k = 0; k < cnt; k++)
+                {
+                    int s = get_bits(bitbuf, bits);
+                    ist_pos[k] = (s == max_scf ? -1 : s);
+                    scf[k] = s;
+                }
+            }
+        }
+        ist_pos += cnt;
+        scf += cnt;
+    }
+    scf[0] = scf[1] = scf[2] = 0;
+}
+
+/* x^(4/3) = g_pow43_m[x] * 2^g_pow43_e[x], mantissa normalised to 16 bits */
+static const uint16_t g_pow43_m[130] = {
+    0,32768,41285,35445,52016,35020,44658,54848,32768,38340,44123,50102,56265,62602,34552,37881,
+    41285,44761,48306,51916,55591,59328,63124,33489,35445,37427,39437,41472,43533,45618,47727,49860,
+    52016,54195,56395,58618,60861,63126,65411,33858,35020,36192,37374,38565,39766,40975,42194,43421,
+    44658,45902,47156,48417,49687,50965,52251,53546,54848,56157,57475,58800,60132,61472,62820,64174,
+    32768,33452,34140,34832,35527,36225,36927,37632,38340,39052,39767,40485,41206,41931,42658,43389,
+    44123,44860,45600,46343,47089,47838,48589,49344,50102,50862,51626,52392,53161,53933,54708,55485,
+    56265,57048,57833,58621,59412,60206,61002,61801,62602,63406,64212,65021,32916,33323,33732,34141,
+    34552,34964,35377,35791,36207,36624,37042,37461,37881,38303,38725,39149,39574,40000,40427,40856,
+    41285,41716
+};
+static const int8_t g_pow43_e[130] = {
+    0,-15,-14,-13,-13,-12,-12,-12,-11,-11,-11,-11,-11,-11,-10,-10,-10,-10,-10,-10,-10,-10,-10,-9,-9,-9,
+    -9,-9,-9,-9,-9,-9,-9,-9,-9,-9,-9,-9,-9,-8,-8,-8,-8,-8,-8,-8,-8,-8,-8,-8,-8,-8,
+    -8,-8,-8,-8,-8,-8,-8,-8,-8,-8,-8,-8,-7,-7,-7,-7,-7,-7,-7,-7,-7,-7,-7,-7,-7,-7,
+    -7,-7,-7,-7,-7,-7,-7,-7,-7,-7,-7,-7,-7,-7,-7,-7,-7,-7,-7,-7,-7,-7,-7,-7,-7,-7,
+    -7,-7,-7,-7,-6,-6,-6,-6,-6,-6,-6,-6,-6,-6,-6,-6,-6,-6,-6,-6,-6,-6,-6,-6,-6,-6
+};
+
+/* |x|^(4/3) * band gain in Q(FX_FRAC), saturated to +-FX_SAT */
+static int32_t L3_dequant(int x, const L3_scf_t *g)
+{
+    uint32_t m;
+    int sh;
+
+    if (x < 130)
+    {
+        m = g_pow43_m[x];
+        sh = g_pow43_e[x];
+    } else
+    {
+        /* linbits escapes: quadratic interpolation of (x/2^k)^(4/3) in Q16 around the
+           nearest table entry, then scale by 2^(4k/3) */
+        int k = x < 1032 ? 3 : 6, xi = x >> k, f = x & ((1 << k) - 1);
+        int32_t vm = (int32_t)g_pow43_m[xi - 1] << (g_pow43_e[xi - 1] + 16);
+        int32_t v0 = (int32_t)g_pow43_m[xi] << (g_pow43_e[xi] + 16);
+        int32_t v1 = (int32_t)g_pow43_m[xi + 1] << (g_pow43_e[xi + 1] + 16);
+        uint32_t v = (uint32_t)(v0 + (((v1 - vm)*f) >> (k + 1)) + (((v1 - 2*v0 + vm)*f*f) >> (2*k + 1)));
+        sh = 4*k/3 - 16;
+        while (v >= 65536)
+        {
+            v >>= 1;
+            sh++;
+        }
+        m = v;
+    }
+    m *= g->m;
+    sh += g->sh;
+    if (sh <= 0)
+    {
+        /* nonzero lines must stay nonzero, the intensity stereo bound search tests for 0 */
+        int32_t v = sh > -31 ? (int32_t)((m + (1u << (-sh) >> 1)) >> -sh) : 0;
+        return v ? v : (int32_t)(m != 0);
+    }
+    return m > ((uint32_t)FX_SAT >> sh) ? FX_SAT : (int32_t)(m << sh);
+}
+
+static void L3_decode_scalefactors(const uint8_t *hdr, uint8_t *ist_pos, bs_t *bs, const L3_gr_info_t *gr, L3_scf_t *scf, int ch)
+{
+    static const uint8_t g_scf_partitions[3][28] = {
+        { 6,5,5, 5,6,5,5,5,6,5, 7,3,11,10,0,0, 7, 7, 7,0, 6, 6,6,3, 8, 8,5,0 },
+        { 8,9,6,12,6,9,9,9,6,9,12,6,15,18,0,0, 6,15,12,0, 6,12,9,6, 6,18,9,0 },
+        { 9,9,6,12,9,9,9,9,9,9,12,6,18,18,0,0,12,12,12,0,12, 9,9,6,15,12,9,0 }
+    };
+    const uint8_t *scf_partition = g_scf_partitions[!!gr->n_short_sfb + !gr->n_long_sfb];
+    uint8_t scf_size[4], iscf[40];
+    static const uint16_t g_expfrac[4] = { 16384, 19484, 23170, 27554 }; /* 2^(r/4)/2 in Q15 */
+    int i, scf_shift = gr->scalefac_scale + 1, gain_exp, scfsi = gr->scfsi;
+
+    if (HDR_TEST_MPEG1(hdr))
+    {
+        static const uint8_t g_scfc_decode[16] = { 0,1,2,3, 12,5,6,7, 9,10,11,13, 14,15,18,19 };
+        int part = g_scfc_decode[gr->scalefac_compress];
+        scf_size[1] = scf_size[0] = (uint8_t)(part >> 2);
+        scf_size[3] = scf_size[2] = (uint8_t)(part & 3);
+    } else
+    {
+        static const uint8_t g_mod[6*4] = { 5,5,4,4,5,5,4,1,4,3,1,1,5,6,6,1,4,4,4,1,4,3,1,1 };
+        int k, modprod, sfc, ist = HDR_TEST_I_STEREO(hdr) && ch;
+        sfc = gr->scalefac_compress >> ist;
+        for (k = ist*3*4; sfc >= 0; sfc -= modprod, k += 4)
+        {
+            for (modprod = 1, i = 3; i >= 0; i--)
+            {
+                scf_size[i] = (uint8_t)(sfc / modprod % g_mod[k + i]);
+                modprod *= g_mod[k + i];
+            }
+        }
+        scf_partition += k;
+        scfsi = -16;
+    }
+    L3_read_scalefactors(iscf, ist_pos, scf_size, scf_partition, bs, scfsi);
+
+    if (gr->n_short_sfb)
+    {
+        int sh = 3 - scf_shift;
+        for (i = 0; i < gr->n_short_sfb; i += 3)
+        {
+            iscf[gr->n_long_sfb + i + 0] += gr->subblock_gain[0] << sh;
+            iscf[gr->n_long_sfb + i + 1] += gr->subblock_gain[1] << sh;
+            iscf[gr->n_long_sfb + i + 2] += gr->subblock_gain[2] << sh;
+        }
+    } else if (gr->preflag)
+    {
+        static const uint8_t g_preamp[10] = { 1,1,1,1,2,2,3,3,3,2 };
+        for (i = 0; i < 10; i++)
+        {
+            iscf[11 + i] += g_preamp[i];
+        }
+    }
+
+    gain_exp = gr->global_gain + BITS_DEQUANTIZER_OUT*4 - 210 - (HDR_IS_MS_STEREO(hdr) ? 2 : 0);
+    for (i = 0; i < (int)(gr->n_long_sfb + gr->n_short_sfb); i++)
+    {
+        /* 2^(e/4) = 2^(e>>2) * 2 * (2^((e&3)/4)/2); the extra 2 and the Q(FX_FRAC)/Q15 gap fold into sh */
+        int e = gain_exp - (iscf[i] << scf_shift);
+        scf[i].m = g_expfrac[e & 3];
+        scf[i].sh = (int8_t)MINIMP3_MAX((e >> 2) + 1 + FX_FRAC - 15, -64);
+    }
+}
+
+/* Returns an upper bound on the coefficients written, so the silent top can be skipped */
+static int L3_huffman(int32_t *dst, bs_t *bs, const L3_gr_info_t *gr_info, const L3_scf_t *scf, int layer3gr_limit)
+{
+    static const int16_t tabs[] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        785,785,785,785,784,784,784,784,513,513,513,513,513,513,513,513,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,
+        -255,1313,1298,1282,785,785,785,785,784,784,784,784,769,769,769,769,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,290,288,
+        -255,1313,1298,1282,769,769,769,769,529,529,529,529,529,529,529,529,528,528,528,528,528,528,528,528,512,512,512,512,512,512,512,512,290,288,
+        -253,-318,-351,-367,785,785,785,785,784,784,784,784,769,769,769,769,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,819,818,547,547,275,275,275,275,561,560,515,546,289,274,288,258,
+        -254,-287,1329,1299,1314,1312,1057,1057,1042,1042,1026,1026,784,784,784,784,529,529,529,529,529,529,529,529,769,769,769,769,768,768,768,768,563,560,306,306,291,259,
+        -252,-413,-477,-542,1298,-575,1041,1041,784,784,784,784,769,769,769,769,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,-383,-399,1107,1092,1106,1061,849,849,789,789,1104,1091,773,773,1076,1075,341,340,325,309,834,804,577,577,532,532,516,516,832,818,803,816,561,561,531,531,515,546,289,289,288,258,
+        -252,-429,-493,-559,1057,1057,1042,1042,529,529,529,529,529,529,529,529,784,784,784,784,769,769,769,769,512,512,512,512,512,512,512,512,-382,1077,-415,1106,1061,1104,849,849,789,789,1091,1076,1029,1075,834,834,597,581,340,340,339,324,804,833,532,532,832,772,818,803,817,787,816,771,290,290,290,290,288,258,
+        -253,-349,-414,-447,-463,1329,1299,-479,1314,1312,1057,1057,1042,1042,1026,1026,785,785,785,785,784,784,784,784,769,769,769,769,768,768,768,768,-319,851,821,-335,836,850,805,849,341,340,325,336,533,533,579,579,564,564,773,832,578,548,563,516,321,276,306,291,304,259,
+        -251,-572,-733,-830,-863,-879,1041,1041,784,784,784,784,769,769,769,769,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,-511,-527,-543,1396,1351,1381,1366,1395,1335,1380,-559,1334,1138,1138,1063,1063,1350,1392,1031,1031,1062,1062,1364,1363,1120,1120,1333,1348,881,881,881,881,375,374,359,373,343,358,341,325,791,791,1123,1122,-703,1105,1045,-719,865,865,790,790,774,774,1104,1029,338,293,323,308,-799,-815,833,788,772,818,803,816,322,292,307,320,561,531,515,546,289,274,288,258,
+        -251,-525,-605,-685,-765,-831,-846,1298,1057,1057,1312,1282,785,785,785,785,784,784,784,784,769,769,769,769,512,512,512,512,512,512,512,512,1399,1398,1383,1367,1382,1396,1351,-511,1381,1366,1139,1139,1079,1079,1124,1124,1364,1349,1363,1333,882,882,882,882,807,807,807,807,1094,1094,1136,1136,373,341,535,535,881,775,867,822,774,-591,324,338,-671,849,550,550,866,864,609,609,293,336,534,534,789,835,773,-751,834,804,308,307,833,788,832,772,562,562,547,547,305,275,560,515,290,290,
+        -252,-397,-477,-557,-622,-653,-719,-735,-750,1329,1299,1314,1057,1057,1042,1042,1312,1282,1024,1024,785,785,785,785,784,784,784,784,769,769,769,769,-383,1127,1141,1111,1126,1140,1095,1110,869,869,883,883,1079,1109,882,882,375,374,807,868,838,881,791,-463,867,822,368,263,852,837,836,-543,610,610,550,550,352,336,534,534,865,774,851,821,850,805,593,533,579,564,773,832,578,578,548,548,577,577,307,276,306,291,516,560,259,259,
+        -250,-2107,-2507,-2764,-2909,-2974,-3007,-3023,1041,1041,1040,1040,769,769,769,769,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,-767,-1052,-1213,-1277,-1358,-1405,-1469,-1535,-1550,-1582,-1614,-1647,-1662,-1694,-1726,-1759,-1774,-1807,-1822,-1854,-1886,1565,-1919,-1935,-1951,-1967,1731,1730,1580,1717,-1983,1729,1564,-1999,1548,-2015,-2031,1715,1595,-2047,1714,-2063,1610,-2079,1609,-2095,1323,1323,1457,1457,1307,1307,1712,1547,1641,1700,1699,1594,1685,1625,1442,1442,1322,1322,-780,-973,-910,1279,1278,1277,1262,1276,1261,1275,1215,1260,1229,-959,974,974,989,989,-943,735,478,478,495,463,506,414,-1039,1003,958,1017,927,942,987,957,431,476,1272,1167,1228,-1183,1256,-1199,895,895,941,941,1242,1227,1212,1135,1014,1014,490,489,503,487,910,1013,985,925,863,894,970,955,1012,847,-1343,831,755,755,984,909,428,366,754,559,-1391,752,486,457,924,997,698,698,983,893,740,740,908,877,739,739,667,667,953,938,497,287,271,271,683,606,590,712,726,574,302,302,738,736,481,286,526,725,605,711,636,724,696,651,589,681,666,710,364,467,573,695,466,466,301,465,379,379,709,604,665,679,316,316,634,633,436,436,464,269,424,394,452,332,438,363,347,408,393,448,331,422,362,407,392,421,346,406,391,376,375,359,1441,1306,-2367,1290,-2383,1337,-2399,-2415,1426,1321,-2431,1411,1336,-2447,-2463,-2479,1169,1169,1049,1049,1424,1289,1412,1352,1319,-2495,1154,1154,1064,1064,1153,1153,416,390,360,404,403,389,344,374,373,343,358,372,327,357,342,311,356,326,1395,1394,1137,1137,1047,1047,1365,1392,1287,1379,1334,1364,1349,1378,1318,1363,792,792,792,792,1152,1152,1032,1032,1121,1121,1046,1046,1120,1120,1030,1030,-2895,1106,1061,1104,849,849,789,789,1091,1076,1029,1090,1060,1075,833,833,309,324,532,532,832,772,818,803,561,561,531,560,515,546,289,274,288,258,
+        -250,-1179,-1579,-1836,-1996,-2124,-2253,-2333,-2413,-2477,-2542,-2574,-2607,-2622,-2655,1314,1313,1298,1312,1282,785,785,785,785,1040,1040,1025,1025,768,768,768,768,-766,-798,-830,-862,-895,-911,-927,-943,-959,-975,-991,-1007,-1023,-1039,-1055,-1070,1724,1647,-1103,-1119,1631,1767,1662,1738,1708,1723,-1135,1780,1615,1779,1599,1677,1646,1778,1583,-1151,1777,1567,1737,1692,1765,1722,1707,1630,1751,1661,1764,1614,1736,1676,1763,1750,1645,1598,1721,1691,1762,1706,1582,1761,1566,-1167,1749,1629,767,766,751,765,494,494,735,764,719,749,734,763,447,447,748,718,477,506,431,491,446,476,461,505,415,430,475,445,504,399,460,489,414,503,383,474,429,459,502,502,746,752,488,398,501,473,413,472,486,271,480,270,-1439,-1455,1357,-1471,-1487,-1503,1341,1325,-1519,1489,1463,1403,1309,-1535,1372,1448,1418,1476,1356,1462,1387,-1551,1475,1340,1447,1402,1386,-1567,1068,1068,1474,1461,455,380,468,440,395,425,410,454,364,467,466,464,453,269,409,448,268,432,1371,1473,1432,1417,1308,1460,1355,1446,1459,1431,1083,1083,1401,1416,1458,1445,1067,1067,1370,1457,1051,1051,1291,1430,1385,1444,1354,1415,1400,1443,1082,1082,1173,1113,1186,1066,1185,1050,-1967,1158,1128,1172,1097,1171,1081,-1983,1157,1112,416,266,375,400,1170,1142,1127,1065,793,793,1169,1033,1156,1096,1141,1111,1155,1080,1126,1140,898,898,808,808,897,897,792,792,1095,1152,1032,1125,1110,1139,1079,1124,882,807,838,881,853,791,-2319,867,368,263,822,852,837,866,806,865,-2399,851,352,262,534,534,821,836,594,594,549,549,593,593,533,533,848,773,579,579,564,578,548,563,276,276,577,576,306,291,516,560,305,305,275,259,
+        -251,-892,-2058,-2620,-2828,-2957,-3023,-3039,1041,1041,1040,1040,769,769,769,769,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,-511,-527,-543,-559,1530,-575,-591,1528,1527,1407,1526,1391,1023,1023,1023,1023,1525,1375,1268,1268,1103,1103,1087,1087,1039,1039,1523,-604,815,815,815,815,510,495,509,479,508,463,507,447,431,505,415,399,-734,-782,1262,-815,1259,1244,-831,1258,1228,-847,-863,1196,-879,1253,987,987,748,-767,493,493,462,477,414,414,686,669,478,446,461,445,474,429,487,458,412,471,1266,1264,1009,1009,799,799,-1019,-1276,-1452,-1581,-1677,-1757,-1821,-1886,-1933,-1997,1257,1257,1483,1468,1512,1422,1497,1406,1467,1496,1421,1510,1134,1134,1225,1225,1466,1451,1374,1405,1252,1252,1358,1480,1164,1164,1251,1251,1238,1238,1389,1465,-1407,1054,1101,-1423,1207,-1439,830,830,1248,1038,1237,1117,1223,1148,1236,1208,411,426,395,410,379,269,1193,1222,1132,1235,1221,1116,976,976,1192,1162,1177,1220,1131,1191,963,963,-1647,961,780,-1663,558,558,994,993,437,408,393,407,829,978,813,797,947,-1743,721,721,377,392,844,950,828,890,706,706,812,859,796,960,948,843,934,874,571,571,-1919,690,555,689,421,346,539,539,944,779,918,873,932,842,903,888,570,570,931,917,674,674,-2575,1562,-2591,1609,-2607,1654,1322,1322,1441,1441,1696,1546,1683,1593,1669,1624,1426,1426,1321,1321,1639,1680,1425,1425,1305,1305,1545,1668,1608,1623,1667,1592,1638,1666,1320,1320,1652,1607,1409,1409,1304,1304,1288,1288,1664,1637,1395,1395,1335,1335,1622,1636,1394,1394,1319,1319,1606,1621,1392,1392,1137,1137,1137,1137,345,390,360,375,404,373,1047,-2751,-2767,-2783,1062,1121,1046,-2799,1077,-2815,1106,1061,789,789,1105,1104,263,355,310,340,325,354,352,262,339,324,1091,1076,1029,1090,1060,1075,833,833,788,788,1088,1028,818,818,803,803,561,561,531,531,816,771,546,546,289,274,288,258,
+        -253,-317,-381,-446,-478,-509,1279,1279,-811,-1179,-1451,-1756,-1900,-2028,-2189,-2253,-2333,-2414,-2445,-2511,-2526,1313,1298,-2559,1041,1041,1040,1040,1025,1025,1024,1024,1022,1007,1021,991,1020,975,1019,959,687,687,1018,1017,671,671,655,655,1016,1015,639,639,758,758,623,623,757,607,756,591,755,575,754,559,543,543,1009,783,-575,-621,-685,-749,496,-590,750,749,734,748,974,989,1003,958,988,973,1002,942,987,957,972,1001,926,986,941,971,956,1000,910,985,925,999,894,970,-1071,-1087,-1102,1390,-1135,1436,1509,1451,1374,-1151,1405,1358,1480,1420,-1167,1507,1494,1389,1342,1465,1435,1450,1326,1505,1310,1493,1373,1479,1404,1492,1464,1419,428,443,472,397,736,526,464,464,486,457,442,471,484,482,1357,1449,1434,1478,1388,1491,1341,1490,1325,1489,1463,1403,1309,1477,1372,1448,1418,1433,1476,1356,1462,1387,-1439,1475,1340,1447,1402,1474,1324,1461,1371,1473,269,448,1432,1417,1308,1460,-1711,1459,-1727,1441,1099,1099,1446,1386,1431,1401,-1743,1289,1083,1083,1160,1160,1458,1445,1067,1067,1370,1457,1307,1430,1129,1129,1098,1098,268,432,267,416,266,400,-1887,1144,1187,1082,1173,1113,1186,1066,1050,1158,1128,1143,1172,1097,1171,1081,420,391,1157,1112,1170,1142,1127,1065,1169,1049,1156,1096,1141,1111,1155,1080,1126,1154,1064,1153,1140,1095,1048,-2159,1125,1110,1137,-2175,823,823,1139,1138,807,807,384,264,368,263,868,838,853,791,867,822,852,837,866,806,865,790,-2319,851,821,836,352,262,850,805,849,-2399,533,533,835,820,336,261,578,548,563,577,532,532,832,772,562,562,547,547,305,275,560,515,290,290,288,258 };
+    static const uint8_t tab32[] = { 130,162,193,209,44,28,76,140,9,9,9,9,9,9,9,9,190,254,222,238,126,94,157,157,109,61,173,205 };
+    static const uint8_t tab33[] = { 252,236,220,204,188,172,156,140,124,108,92,76,60,44,28,12 };
+    static const int16_t tabindex[2*16] = { 0,32,64,98,0,132,180,218,292,364,426,538,648,746,0,1126,1460,1460,1460,1460,1460,1460,1460,1460,1842,1842,1842,1842,1842,1842,1842,1842 };
+    static const uint8_t g_linbits[] =  { 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,2,3,4,6,8,10,13,4,5,6,7,8,9,11,13 };
+
+#define PEEK_BITS(n)  (bs_cache >> (32 - n))
+#define FLUSH_BITS(n) { bs_cache <<= (n); bs_sh += (n); }
+#define CHECK_BITS    while (bs_sh >= 0) { bs_cache |= (uint32_t)*bs_next_ptr++ << bs_sh; bs_sh -= 8; }
+#define BSPOS         ((bs_next_ptr - bs->buf)*8 - 24 + bs_sh)
+
+    const L3_scf_t *one = scf;
+    int32_t *start = dst, one1;
+    int ireg = 0, big_val_cnt = gr_info->big_values;
+    const uint8_t *sfb = gr_info->sfbtab;
+    const uint8_t *bs_next_ptr = bs->buf + bs->pos/8;
+    uint32_t bs_cache = (((bs_next_ptr[0]*256u + bs_next_ptr[1])*256u + bs_next_ptr[2])*256u + bs_next_ptr[3]) << (bs->pos & 7);
+    int pairs_to_decode, np, bs_sh = (bs->pos & 7) - 8;
+    bs_next_ptr += 4;
+
+    while (big_val_cnt > 0)
+    {
+        int tab_num = gr_info->table_select[ireg];
+        int sfb_cnt = gr_info->region_count[ireg++];
+        const int16_t *codebook = tabs + tabindex[tab_num];
+        int linbits = g_linbits[tab_num];
+        if (linbits)
+        {
+            do
+            {
+                np = *sfb++ / 2;
+                pairs_to_decode = MINIMP3_MIN(big_val_cnt, np);
+                one = scf++;
+                do
+                {
+                    int j, w = 5;
+                    int leaf = codebook[PEEK_BITS(w)];
+                    while (leaf < 0)
+                    {
+                        FLUSH_BITS(w);
+                        w = leaf & 7;
+                        leaf = codebook[PEEK_BITS(w) - (leaf >> 3)];
+                    }
+                    FLUSH_BITS(leaf >> 8);
+
+                    for (j = 0; j < 2; j++, dst++, leaf >>= 4)
+                    {
+                        int lsb = leaf & 0x0F;
+                        if (lsb == 15)
+                        {
+                            lsb += PEEK_BITS(linbits);
+                            FLUSH_BITS(linbits);
+                            CHECK_BITS;
+                            *dst = L3_dequant(lsb, one);
+                            if ((int32_t)bs_cache < 0) *dst = -*dst;
+                        } else
+                        {
+                            *dst = L3_dequant(lsb, one);
+                            if ((int32_t)bs_cache < 0) *dst = -*dst;
+                        }
+                        FLUSH_BITS(lsb ? 1 : 0);
+                    }
+                    CHECK_BITS;
+                } while (--pairs_to_decode);
+            } while ((big_val_cnt -= np) > 0 && --sfb_cnt >= 0);
+        } else
+        {
+            do
+            {
+                np = *sfb++ / 2;
+                pairs_to_decode = MINIMP3_MIN(big_val_cnt, np);
+                one = scf++;
+                do
+                {
+                    int j, w = 5;
+                    int leaf = codebook[PEEK_BITS(w)];
+                    while (leaf < 0)
+                    {
+                        FLUSH_BITS(w);
+                        w = leaf & 7;
+                        leaf = codebook[PEEK_BITS(w) - (leaf >> 3)];
+                    }
+                    FLUSH_BITS(leaf >> 8);
+
+                    for (j = 0; j < 2; j++, dst++, leaf >>= 4)
+                    {
+                        int lsb = leaf & 0x0F;
+                        *dst = L3_dequant(lsb, one);
+                        if ((int32_t)bs_cache < 0) *dst = -*dst;
+                        FLUSH_BITS(lsb ? 1 : 0);
+                    }
+                    CHECK_BITS;
+                } while (--pairs_to_decode);
+            } while ((big_val_cnt -= np) > 0 && --sfb_cnt >= 0);
+        }
+    }
+
+    one1 = L3_dequant(1, one);
+    for (np = 1 - big_val_cnt;; dst += 4)
+    {
+        const uint8_t *codebook_count1 = (gr_info->count1_table) ? tab33 : tab32;
+        int leaf = codebook_count1[PEEK_BITS(4)];
+        if (!(leaf & 8))
+        {
+            leaf = codebook_count1[(leaf >> 3) + (bs_cache << 4 >> (32 - (leaf & 3)))];
+        }
+        FLUSH_BITS(leaf & 7);
+        if (BSPOS > layer3gr_limit)
+        {
+            break;
+        }
+#define RELOAD_SCALEFACTOR  if (!--np) { np = *sfb++/2; if (!np) break; one = scf++; one1 = L3_dequant(1, one); }
+#define DEQ_COUNT1(s) if (leaf & (128 >> s)) { dst[s] = ((int32_t)bs_cache < 0) ? -one1 : one1; FLUSH_BITS(1) }
+        RELOAD_SCALEFACTOR;
+        DEQ_COUNT1(0);
+        DEQ_COUNT1(1);
+        RELOAD_SCALEFACTOR;
+        DEQ_COUNT1(2);
+        DEQ_COUNT1(3);
+        CHECK_BITS;
+    }
+
+    bs->pos = layer3gr_limit;
+    return MINIMP3_MIN((int)(dst - start) + 4, 576);   /* a quad may stop half written */
+}
+
+static void L3_midside_stereo(int32_t *left, int n)
+{
+    int i;
+    int32_t *right = left + 576;
+    for (i = 0; i < n; i++)
+    {
+        int32_t a = left[i];
+        int32_t b = right[i];
+        left[i] = a + b;
+        right[i] = a - b;
+    }
+}
+
+static void L3_intensity_stereo_band(int32_t *left, int n, int32_t kl, int32_t kr)
+{
+    int i;
+    for (i = 0; i < n; i++)
+    {
+        left[i + 576] = fx_mul(left[i], kr);
+        left[i] = fx_mul(left[i], kl);
+    }
+}
+
+static void L3_stereo_top_band(const int32_t *right, const uint8_t *sfb, int nbands, int max_band[3])
+{
+    int i, k;
+
+    max_band[0] = max_band[1] = max_band[2] = -1;
+
+    for (i = 0; i < nbands; i++)
+    {
+        for (k = 0; k < sfb[i]; k += 2)
+        {
+            if (right[k] != 0 || right[k + 1] != 0)
+            {
+                max_band[i % 3] = i;
+                break;
+            }
+        }
+        right += sfb[i];
+    }
+}
+
+static void L3_stereo_process(int32_t *left, const uint8_t *ist_pos, const uint8_t *sfb, const uint8_t *hdr, int max_band[3], int mpeg2_sh)
+{
+    static const int32_t g_pan[7*2] = {
+        K30(0),K30(1),K30(0.21132487),K30(0.78867513),K30(0.36602540),K30(0.63397460),K30(0.5),K30(0.5),
+        K30(0.63397460),K30(0.36602540),K30(0.78867513),K30(0.21132487),K30(1),K30(0)
+    };
+    static const int32_t g_expfrac[4] = { K30(1), K30(0.84089642), K30(0.70710678), K30(0.59460356) };
+    unsigned i, max_pos = HDR_TEST_MPEG1(hdr) ? 7 : 64;
+
+    for (i = 0; sfb[i]; i++)
+    {
+        unsigned ipos = ist_pos[i];
+        if ((int)i > max_band[i % 3] && ipos < max_pos)
+        {
+            int32_t kl, kr;
+            if (HDR_TEST_MPEG1(hdr))
+            {
+                kl = g_pan[2*ipos];
+                kr = g_pan[2*ipos + 1];
+            } else
+            {
+                int e = (ipos + 1) >> 1 << mpeg2_sh;
+                kl = K30(1);
+                kr = (e >> 2) < 31 ? g_expfrac[e & 3] >> (e >> 2) : 0;
+                if (ipos & 1)
+                {
+                    kl = kr;
+                    kr = K30(1);
+                }
+            }
+            if (HDR_TEST_MS_STEREO(hdr))
+            {
+                kl = fx_mul(kl, K30(1.41421356));
+                kr = fx_mul(kr, K30(1.41421356));
+            }
+            L3_intensity_stereo_band(left, sfb[i], kl, kr);
+        } else if (HDR_TEST_MS_STEREO(hdr))
+        {
+            L3_midside_stereo(left, sfb[i]);
+        }
+        left += sfb[i];
+    }
+}
+
+static void L3_intensity_stereo(int32_t *left, uint8_t *ist_pos, const L3_gr_info_t *gr, const uint8_t *hdr)
+{
+    int max_band[3], n_sfb = gr->n_long_sfb + gr->n_short_sfb;
+    int i, max_blocks = gr->n_short_sfb ? 3 : 1;
+
+    L3_stereo_top_band(left + 576, gr->sfbtab, n_sfb, max_band);
+    if (gr->n_long_sfb)
+    {
+        max_band[0] = max_band[1] = max_band[2] = MINIMP3_MAX(MINIMP3_MAX(max_band[0], max_band[1]), max_band[2]);
+    }
+    for (i = 0; i < max_blocks; i++)
+    {
+        int default_pos = HDR_TEST_MPEG1(hdr) ? 3 : 0;
+        int itop = n_sfb - max_blocks + i;
+        int prev = itop - max_blocks;
+        ist_pos[itop] = max_band[i] >= prev ? default_pos : ist_pos[prev];
+    }
+    L3_stereo_process(left, ist_pos, gr->sfbtab, hdr, max_band, gr[1].scalefac_compress & 1);
+}
+
+static void L3_reorder(int32_t *grbuf, int32_t *scratch, const uint8_t *sfb)
+{
+    int i, len;
+    int32_t *src = grbuf, *dst = scratch;
+
+    for (;0 != (len = *sfb); sfb += 3, src += 2*len)
+    {
+        for (i = 0; i < len; i++, src++)
+        {
+            *dst++ = src[0*len];
+            *dst++ = src[1*len];
+            *dst++ = src[2*len];
+        }
+    }
+    memcpy(grbuf, scratch, (dst - scratch)*sizeof(int32_t));
+}
+
+static void L3_antialias(int32_t *grbuf, int nbands)
+{
+    static const int32_t g_aa[2][8] = {
+        {K30(0.85749293),K30(0.88174200),K30(0.94962865),K30(0.98331459),K30(0.99551782),K30(0.99916056),K30(0.99989920),K30(0.99999316)},
+        {K30(0.51449576),K30(0.47173197),K30(0.31337745),K30(0.18191320),K30(0.09457419),K30(0.04096558),K30(0.01419856),K30(0.00369997)}
+    };
+
+    for (; nbands > 0; nbands--, grbuf += 18)
+    {
+        int i;
+        for (i = 0; i < 8; i++)
+        {
+            int32_t u = grbuf[18 + i];
+            int32_t d = grbuf[17 - i];
+            grbuf[18 + i] = fx_mul(u, g_aa[0][i]) - fx_mul(d, g_aa[1][i]);
+            grbuf[17 - i] = fx_mul(u, g_aa[1][i]) + fx_mul(d, g_aa[0][i]);
+        }
+    }
+}
+
+static void L3_dct3_9(int32_t *y)
+{
+    int32_t s0, s1, s2, s3, s4, s5, s6, s7, s8, t0, t2, t4;
+
+    s0 = y[0]; s2 = y[2]; s4 = y[4]; s6 = y[6]; s8 = y[8];
+    t0 = s0 + (s6 >> 1);
+    s0 -= s6;
+    t4 = fx_mul(s4 + s2, K30(0.93969262));
+    t2 = fx_mul(s8 + s2, K30(0.76604444));
+    s6 = fx_mul(s4 - s8, K30(0.17364818));
+    s4 += s8 - s2;
+
+    s2 = s0 - (s4 >> 1);
+    y[4] = s4 + s0;
+    s8 = t0 - t2 + s6;
+    s0 = t0 - t4 + t2;
+    s4 = t0 + t4 - s6;
+
+    s1 = y[1]; s3 = y[3]; s5 = y[5]; s7 = y[7];
+
+    s3 = fx_mul(s3, K30(0.86602540));
+    t0 = fx_mul(s5 + s1, K30(0.98480775));
+    t4 = fx_mul(s5 - s7, K30(0.34202014));
+    t2 = fx_mul(s1 + s7, K30(0.64278761));
+    s1 = fx_mul(s1 - s5 - s7, K30(0.86602540));
+
+    s5 = t0 - s3 - t2;
+    s7 = t4 - s3 - t0;
+    s3 = t4 + s3 - t2;
+
+    y[0] = s4 - s7;
+    y[1] = s2 + s1;
+    y[2] = s0 - s3;
+    y[3] = s8 + s5;
+    y[5] = s8 - s5;
+    y[6] = s0 + s3;
+    y[7] = s2 - s1;
+    y[8] = s4 + s7;
+}
+
+static void L3_imdct36(int32_t *grbuf, int32_t *overlap, const int32_t *window, int nbands)
+{
+    int i, j;
+    static const int32_t g_twid9[18] = {
+        K30(0.73727734),K30(0.79335334),K30(0.84339145),K30(0.88701083),K30(0.92387953),K30(0.95371695),K30(0.97629601),K30(0.99144486),K30(0.99904822),
+        K30(0.67559021),K30(0.60876143),K30(0.53729961),K30(0.46174861),K30(0.38268343),K30(0.30070580),K30(0.21643961),K30(0.13052619),K30(0.04361938)
+    };
+
+    for (j = 0; j < nbands; j++, grbuf += 18, overlap += 9)
+    {
+        int32_t co[9], si[9];
+        co[0] = -grbuf[0];
+        si[0] = grbuf[17];
+        for (i = 0; i < 4; i++)
+        {
+            si[8 - 2*i] =   grbuf[4*i + 1] - grbuf[4*i + 2];
+            co[1 + 2*i] =   grbuf[4*i + 1] + grbuf[4*i + 2];
+            si[7 - 2*i] =   grbuf[4*i + 4] - grbuf[4*i + 3];
+            co[2 + 2*i] = -(grbuf[4*i + 3] + grbuf[4*i + 4]);
+        }
+        L3_dct3_9(co);
+        L3_dct3_9(si);
+
+        si[1] = -si[1];
+        si[3] = -si[3];
+        si[5] = -si[5];
+        si[7] = -si[7];
+
+        for (i = 0; i < 9; i++)
+        {
+            int32_t ovl  = overlap[i];
+            int32_t sum  = fx_mul(co[i], g_twid9[9 + i]) + fx_mul(si[i], g_twid9[0 + i]);
+            overlap[i] = fx_mul(co[i], g_twid9[0 + i]) - fx_mul(si[i], g_twid9[9 + i]);
+            grbuf[i]      = fx_mul(ovl, window[0 + i]) - fx_mul(sum, window[9 + i]);
+            grbuf[17 - i] = fx_mul(ovl, window[9 + i]) + fx_mul(sum, window[0 + i]);
+        }
+    }
+}
+
+static void L3_idct3(int32_t x0, int32_t x1, int32_t x2, int32_t *dst)
+{
+    int32_t m1 = fx_mul(x1, K30(0.86602540));
+    int32_t a1 = x0 - (x2 >> 1);
+    dst[1] = x0 + x2;
+    dst[0] = a1 + m1;
+    dst[2] = a1 - m1;
+}
+
+static void L3_imdct12(int32_t *x, int32_t *dst, int32_t *overlap)
+{
+    static const int32_t g_twid3[6] = { K30(0.79335334),K30(0.92387953),K30(0.99144486), K30(0.60876143),K30(0.38268343),K30(0.13052619) };
+    int32_t co[3], si[3];
+    int i;
+
+    L3_idct3(-x[0], x[6] + x[3], x[12] + x[9], co);
+    L3_idct3(x[15], x[12] - x[9], x[6] - x[3], si);
+    si[1] = -si[1];
+
+    for (i = 0; i < 3; i++)
+    {
+        int32_t ovl  = overlap[i];
+        int32_t sum  = fx_mul(co[i], g_twid3[3 + i]) + fx_mul(si[i], g_twid3[0 + i]);
+        overlap[i] = fx_mul(co[i], g_twid3[0 + i]) - fx_mul(si[i], g_twid3[3 + i]);
+        dst[i]     = fx_mul(ovl, g_twid3[2 - i]) - fx_mul(sum, g_twid3[5 - i]);
+        dst[5 - i] = fx_mul(ovl, g_twid3[5 - i]) + fx_mul(sum, g_twid3[2 - i]);
+    }
+}
+
+static void L3_imdct_short(int32_t *grbuf, int32_t *overlap, int nbands)
+{
+    for (;nbands > 0; nbands--, overlap += 9, grbuf += 18)
+    {
+        int32_t tmp[18];
+        memcpy(tmp, grbuf, sizeof(tmp));
+        memcpy(grbuf, overlap, 6*sizeof(int32_t));
+        L3_imdct12(tmp, grbuf + 6, overlap + 6);
+        L3_imdct12(tmp + 1, grbuf + 12, overlap + 6);
+        L3_imdct12(tmp + 2, overlap, overlap + 6);
+    }
+}
+
+static void L3_change_sign(int32_t *grbuf)
+{
+    int b, i;
+    for (b = 0, grbuf += 18; b < 32; b += 2, grbuf += 36)
+        for (i = 1; i < 18; i += 2)
+            grbuf[i] = -grbuf[i];
+}
+
+/* The first `nbands` subbands; the rest are silent with no overlap left */
+static void L3_imdct_gr(int32_t *grbuf, int32_t *overlap, unsigned block_type, unsigned n_long_bands, unsigned nbands)
+{
+    static const int32_t g_mdct_window[2][18] = {
+        { K30(0.99904822),K30(0.99144486),K30(0.97629601),K30(0.95371695),K30(0.92387953),K30(0.88701083),K30(0.84339145),K30(0.79335334),K30(0.73727734),
+          K30(0.04361938),K30(0.13052619),K30(0.21643961),K30(0.30070580),K30(0.38268343),K30(0.46174861),K30(0.53729961),K30(0.60876143),K30(0.67559021) },
+        { K30(1),K30(1),K30(1),K30(1),K30(1),K30(1),K30(0.99144486),K30(0.92387953),K30(0.79335334),
+          0,0,0,0,0,0,K30(0.13052619),K30(0.38268343),K30(0.60876143) }
+    };
+    if (n_long_bands)
+    {
+        L3_imdct36(grbuf, overlap, g_mdct_window[0], MINIMP3_MIN(n_long_bands, nbands));
+        grbuf += 18*n_long_bands;
+        overlap += 9*n_long_bands;
+    }
+    if (nbands <= n_long_bands)
+        return;
+    if (block_type == SHORT_BLOCK_TYPE)
+        L3_imdct_short(grbuf, overlap, nbands - n_long_bands);
+    else
+        L3_imdct36(grbuf, overlap, g_mdct_window[block_type == STOP_BLOCK_TYPE], nbands - n_long_bands);
+}
+
+static void L3_save_reservoir(mp3dec_t *h, mp3dec_scratch_t *s)
+{
+    int pos = (s->bs.pos + 7)/8u;
+    int remains = s->bs.limit/8u - pos;
+    if (remains > MAX_BITRESERVOIR_BYTES)
+    {
+        pos += remains - MAX_BITRESERVOIR_BYTES;
+        remains = MAX_BITRESERVOIR_BYTES;
+    }
+    if (remains > 0)
+    {
+        memmove(h->reserv_buf, s->maindata + pos, remains);
+    }
+    h->reserv = remains;
+}
+
+static int L3_restore_reservoir(mp3dec_t *h, bs_t *bs, mp3dec_scratch_t *s, int main_data_begin)
+{
+    int frame_bytes = (bs->limit - bs->pos)/8;
+    int bytes_have = MINIMP3_MIN(h->reserv, main_data_begin);
+    memcpy(s->maindata, h->reserv_buf + MINIMP3_MAX(0, h->reserv - main_data_begin), MINIMP3_MIN(h->reserv, main_data_begin));
+    memcpy(s->maindata + bytes_have, bs->buf + bs->pos/8, frame_bytes);
+    bs_init(&s->bs, s->maindata, bytes_have + frame_bytes);
+    return h->reserv >= main_data_begin;
+}
+
+static void L3_decode(mp3dec_t *h, mp3dec_scratch_t *s, L3_gr_info_t *gr_info, int nch)
+{
+    int ch, nz[2];
+
+    for (ch = 0; ch < nch; ch++)
+    {
+        int layer3gr_limit = s->bs.pos + gr_info[ch].part_23_length;
+        L3_decode_scalefactors(h->header, s->ist_pos[ch], &s->bs, gr_info + ch, s->scf, ch);
+        nz[ch] = L3_huffman(s->grbuf[ch], &s->bs, gr_info + ch, s->scf, layer3gr_limit);
+    }
+    if (nch == 2)
+    {
+        /* M/S and intensity stereo spread either channel into both */
+        nz[0] = nz[1] = MINIMP3_MAX(nz[0], nz[1]);
+    }
+
+    if (HDR_TEST_I_STEREO(h->header))
+    {
+        L3_intensity_stereo(s->grbuf[0], s->ist_pos[1], gr_info, h->header);
+    } else if (HDR_IS_MS_STEREO(h->header))
+    {
+        L3_midside_stereo(s->grbuf[0], 576);
+    }
+
+    for (ch = 0; ch < nch; ch++, gr_info++)
+    {
+        int aa_bands = 31, nbands = (nz[ch] + 17)/18;
+        int n_long_bands = (gr_info->mixed_block_flag ? 2 : 0) << (int)(HDR_GET_MY_SAMPLE_RATE(h->header) == 2);
+
+        if (gr_info->n_short_sfb)
+        {
+            aa_bands = n_long_bands - 1;
+            L3_reorder(s->grbuf[ch] + n_long_bands*18, s->syn[0], gr_info->sfbtab + gr_info->n_long_sfb);
+            nbands = 32;    /* reordering moves coefficients across subband edges */
+        }
+        if (h->half_rate)
+        {
+            memset(s->grbuf[ch] + 16*18, 0, 16*18*sizeof(int32_t));
+            nbands = MINIMP3_MIN(nbands, 16);
+            aa_bands = MINIMP3_MIN(aa_bands, 15);
+        }
+
+        /* Each butterfly reaches one subband up; past that, and past what the previous
+           granule overlaps into this one, the IMDCT input and output are zero */
+        aa_bands = MINIMP3_MIN(aa_bands, nbands);
+        L3_antialias(s->grbuf[ch], aa_bands);
+        nbands = MINIMP3_MAX(nbands, aa_bands + 1);
+        L3_imdct_gr(s->grbuf[ch], h->mdct_overlap[ch], gr_info->block_type, n_long_bands, MINIMP3_MAX(nbands, h->mdct_bands[ch]));
+        h->mdct_bands[ch] = (unsigned char)nbands;
+        L3_change_sign(s->grbuf[ch]);
+    }
+}
+
+/* Synthesis input limit, ~40x full scale: the largest that keeps SYN_MUL and its
+   accumulators inside int32 (window taps sum to < 179000 per output, so
+   179000 * 2^27 >> 14 < 2^31) on corrupt streams. Loud but valid streams that clip at
+   the output stay below it, so their samples next to the clipped ones match the float
+   build; at half this limit they could be off by over 10000 LSB. */
+#define SYN_LIMIT                   (1 << (FX_FRAC + 4))
+#define SYN_CLAMP(v)                ((v) > SYN_LIMIT ? SYN_LIMIT : (v) < -SYN_LIMIT ? -SYN_LIMIT : (v))
+
+static void mp3d_DCT_II(int32_t *grbuf, int n)
+{
+    static const fx_coef_t g_sec[24] = {
+        FXC(10.19000816),FXC(0.50060302),FXC(0.50241929),FXC(3.40760851),FXC(0.50547093),FXC(0.52249861),FXC(2.05778098),FXC(0.51544732),FXC(0.56694406),FXC(1.48416460),FXC(0.53104258),FXC(0.64682180),
+        FXC(1.16943991),FXC(0.55310392),FXC(0.78815460),FXC(0.97256821),FXC(0.58293498),FXC(1.06067765),FXC(0.83934963),FXC(0.62250412),FXC(1.72244716),FXC(0.74453628),FXC(0.67480832),FXC(5.10114861)
+    };
+    int i, k = 0;
+
+    for (; k < n; k++)
+    {
+        int32_t t[4][8], *x, *y = grbuf + k;
+
+        for (x = t[0], i = 0; i < 8; i++, x++)
+        {
+            const fx_coef_t *c = g_sec + 3*i;
+            int32_t x0 = y[i*18];
+            int32_t x1 = y[(15 - i)*18];
+            int32_t x2 = y[(16 + i)*18];
+            int32_t x3 = y[(31 - i)*18];
+            int32_t t0 = x0 + x3;
+            int32_t t1 = x1 + x2;
+            int32_t t2 = fx_mulq(x1 - x2, c[0].c, c[0].q);
+            int32_t t3 = fx_mulq(x0 - x3, c[1].c, c[1].q);
+            x[0] = t0 + t1;
+            x[8] = fx_mulq(t0 - t1, c[2].c, c[2].q);
+            x[16] = t3 + t2;
+            x[24] = fx_mulq(t3 - t2, c[2].c, c[2].q);
+        }
+        for (x = t[0], i = 0; i < 4; i++, x += 8)
+        {
+            int32_t x0 = x[0], x1 = x[1], x2 = x[2], x3 = x[3], x4 = x[4], x5 = x[5], x6 = x[6], x7 = x[7], xt;
+            xt = x0 - x7; x0 += x7;
+            x7 = x1 - x6; x1 += x6;
+            x6 = x2 - x5; x2 += x5;
+            x5 = x3 - x4; x3 += x4;
+            x4 = x0 - x3; x0 += x3;
+            x3 = x1 - x2; x1 += x2;
+            x[0] = x0 + x1;
+            x[4] = fx_mul(x0 - x1, K30(0.70710677));
+            x5 =  x5 + x6;
+            x6 = fx_mul(x6 + x7, K30(0.70710677));
+            x7 =  x7 + xt;
+            x3 = fx_mul(x3 + x4, K30(0.70710677));
+            x5 -= fx_mul(x7, K30(0.198912367));  /* rotate by PI/8 */
+            x7 += fx_mul(x5, K30(0.382683432));
+            x5 -= fx_mul(x7, K30(0.198912367));
+            x0 = xt - x6; xt += x6;
+            x[1] = fx_mul(xt + x7, K30(0.50979561));
+            x[2] = fx_mul(x4 + x3, K30(0.54119611));
+            x[3] = fx_mul(x0 - x5, K30(0.60134488));
+            x[5] = fx_mul(x0 + x5, K30(0.89997619));
+            x[6] = fx_mul(x4 - x3, K30(1.30656302));
+            x[7] = fx_mulq(xt - x7, FX_ROUND(2.56291556, 29), 29);
+        }
+        for (i = 0; i < 7; i++, y += 4*18)
+        {
+            y[0*18] = SYN_CLAMP(t[0][i]);
+            y[1*18] = SYN_CLAMP(t[2][i] + t[3][i] + t[3][i + 1]);
+            y[2*18] = SYN_CLAMP(t[1][i] + t[1][i + 1]);
+            y[3*18] = SYN_CLAMP(t[2][i + 1] + t[3][i] + t[3][i + 1]);
+        }
+        y[0*18] = SYN_CLAMP(t[0][7]);
+        y[1*18] = SYN_CLAMP(t[2][7] + t[3][7]);
+        y[2*18] = SYN_CLAMP(t[1][7]);
+        y[3*18] = SYN_CLAMP(t[3][7]);
+    }
+}
+
+/* z * w for the integer synthesis window (|w| < 2^17), split at bit 14 so both partial
+   products fit a 32-bit MULS. Result is Q(FX_FRAC - 14). */
+#define SYN_MUL(z, w)  (((z) >> 14)*(w) + ((((z) & 0x3FFF)*(w)) >> 14))
+
+static int16_t mp3d_scale_pcm(int32_t acc)
+{
+    int32_t s = (acc + (1 << (FX_FRAC - 15))) >> (FX_FRAC - 14);
+    if (s >  32767) return (int16_t) 32767;
+    if (s < -32768) return (int16_t)-32768;
+    return (int16_t)s;
+}
+
+static void mp3d_synth_pair(mp3d_sample_t *pcm, int nch, int half, const int32_t *z)
+{
+    int32_t a;
+    a  = SYN_MUL(z[14*64] - z[    0], 29);
+    a += SYN_MUL(z[ 1*64] + z[13*64], 213);
+    a += SYN_MUL(z[12*64] - z[ 2*64], 459);
+    a += SYN_MUL(z[ 3*64] + z[11*64], 2037);
+    a += SYN_MUL(z[10*64] - z[ 4*64], 5153);
+    a += SYN_MUL(z[ 5*64] + z[ 9*64], 6574);
+    a += SYN_MUL(z[ 8*64] - z[ 6*64], 37489);
+    a += SYN_MUL(z[ 7*64],            75038);
+    pcm[0] = mp3d_scale_pcm(a);
+
+    z += 2;
+    a  = SYN_MUL(z[14*64], 104);
+    a += SYN_MUL(z[12*64], 1567);
+    a += SYN_MUL(z[10*64], 9727);
+    a += SYN_MUL(z[ 8*64], 64019);
+    a += SYN_MUL(z[ 6*64], -9975);
+    a += SYN_MUL(z[ 4*64], -45);
+    a += SYN_MUL(z[ 2*64], 146);
+    a += SYN_MUL(z[ 0*64], -5);
+    pcm[(16 >> half)*nch] = mp3d_scale_pcm(a);
+}
+
+/* Two time slots of 32 samples per channel (16 with `half`, the even ones). The window
+   runs on four lanes, left and right of each slot; mono computes the left ones only. */
+static void mp3d_synth(int32_t *xl, mp3d_sample_t *dstl, int nch, int half, int32_t *lins)
+{
+    int i;
+    int32_t *xr = xl + 576*(nch - 1);
+    mp3d_sample_t *dstr = dstl + (nch - 1);
+
+    static const int32_t g_win[] = {
+        -1,26,-31,208,218,401,-519,2063,2000,4788,-5517,7134,5959,35640,-39336,74992,
+        -1,24,-35,202,222,347,-581,2080,1952,4425,-5879,7640,5288,33791,-41176,74856,
+        -1,21,-38,196,225,294,-645,2087,1893,4063,-6237,8092,4561,31947,-43006,74630,
+        -1,19,-41,190,227,244,-711,2085,1822,3705,-6589,8492,3776,30112,-44821,74313,
+        -1,17,-45,183,228,197,-779,2075,1739,3351,-6935,8840,2935,28289,-46617,73908,
+        -1,16,-49,176,228,153,-848,2057,1644,3004,-7271,9139,2037,26482,-48390,73415,
+        -2,14,-53,169,227,111,-919,2032,1535,2663,-7597,9389,1082,24694,-50137,72835,
+        -2,13,-58,161,224,72,-991,2001,1414,2330,-7910,9592,70,22929,-51853,72169,
+        -2,11,-63,154,221,36,-1064,1962,1280,2006,-8209,9750,-998,21189,-53534,71420,
+        -2,10,-68,147,215,2,-1137,1919,1131,1692,-8491,9863,-2122,19478,-55178,70590,
+        -3,9,-73,139,208,-29,-1210,1870,970,1388,-8755,9935,-3300,17799,-56778,69679,
+        -3,8,-79,132,200,-57,-1283,1817,794,1095,-8998,9966,-4533,16155,-58333,68692,
+        -4,7,-85,125,189,-83,-1356,1759,605,814,-9219,9959,-5818,14548,-59838,67629,
+        -4,7,-91,117,177,-106,-1428,1698,402,545,-9416,9916,-7154,12980,-61289,66494,
+        -5,6,-97,111,163,-127,-1498,1634,185,288,-9585,9838,-8540,11455,-62684,65290
+    };
+    int32_t *zlin = lins + 15*64;
+    const int32_t *w = g_win;
+
+    zlin[4*15]     = xl[18*16];
+    zlin[4*15 + 1] = xr[18*16];
+    zlin[4*15 + 2] = xl[0];
+    zlin[4*15 + 3] = xr[0];
+
+    zlin[4*31]     = xl[1 + 18*16];
+    zlin[4*31 + 1] = xr[1 + 18*16];
+    zlin[4*31 + 2] = xl[1];
+    zlin[4*31 + 3] = xr[1];
+
+    if (nch == 2)
+    {
+        mp3d_synth_pair(dstr, nch, half, lins + 4*15 + 1);
+        mp3d_synth_pair(dstr + (32 >> half)*nch, nch, half, lins + 4*15 + 64 + 1);
+    }
+    mp3d_synth_pair(dstl, nch, half, lins + 4*15);
+    mp3d_synth_pair(dstl + (32 >> half)*nch, nch, half, lins + 4*15 + 64);
+
+    for (i = 14; i >= 0; i--)
+    {
+#define LOAD(k) int32_t w0 = *w++; int32_t w1 = *w++; int32_t *vz = &zlin[4*i - k*64]; int32_t *vy = &zlin[4*i - (15 - k)*64];
+#define S0(k) { int j; LOAD(k); for (j = 0; j < 4; j += step) b[j]  = SYN_MUL(vz[j], w1) + SYN_MUL(vy[j], w0), a[j]  = SYN_MUL(vz[j], w0) - SYN_MUL(vy[j], w1); }
+#define S1(k) { int j; LOAD(k); for (j = 0; j < 4; j += step) b[j] += SYN_MUL(vz[j], w1) + SYN_MUL(vy[j], w0), a[j] += SYN_MUL(vz[j], w0) - SYN_MUL(vy[j], w1); }
+#define S2(k) { int j; LOAD(k); for (j = 0; j < 4; j += step) b[j] += SYN_MUL(vz[j], w1) + SYN_MUL(vy[j], w0), a[j] += SYN_MUL(vy[j], w1) - SYN_MUL(vz[j], w0); }
+        int32_t a[4], b[4];
+
+        zlin[4*i]     = xl[18*(31 - i)];
+        zlin[4*i + 1] = xr[18*(31 - i)];
+        zlin[4*i + 2] = xl[1 + 18*(31 - i)];
+        zlin[4*i + 3] = xr[1 + 18*(31 - i)];
+        zlin[4*(i + 16)]   = xl[1 + 18*(1 + i)];
+        zlin[4*(i + 16) + 1] = xr[1 + 18*(1 + i)];
+        zlin[4*(i - 16) + 2] = xl[18*(1 + i)];
+        zlin[4*(i - 16) + 3] = xr[18*(1 + i)];
+
+        if (half && !(i & 1))
+        {
+            w += 16;    /* odd output samples */
+            continue;
+        }
+
+#define SYN_WINDOW  S0(0) S2(1) S1(2) S2(3) S1(4) S2(5) S1(6) S2(7)
+        if (nch == 2)
+        {
+            const int step = 1;
+            SYN_WINDOW
+        } else
+        {
+            const int step = 2;
+            SYN_WINDOW
+        }
+
+#define SYN_OUT(dst, n, v)  dst[((n) >> half)*nch] = mp3d_scale_pcm(v)
+        if (nch == 2)
+        {
+            SYN_OUT(dstr, 15 - i, a[1]);
+            SYN_OUT(dstr, 17 + i, b[1]);
+            SYN_OUT(dstr, 47 - i, a[3]);
+            SYN_OUT(dstr, 49 + i, b[3]);
+        }
+        SYN_OUT(dstl, 15 - i, a[0]);
+        SYN_OUT(dstl, 17 + i, b[0]);
+        SYN_OUT(dstl, 47 - i, a[2]);
+        SYN_OUT(dstl, 49 + i, b[2]);
+    }
+}
+
+static void mp3d_synth_granule(int32_t *qmf_state, int32_t *grbuf, int nbands, int nch, int half, mp3d_sample_t *pcm, int32_t *lins)
+{
+    int i;
+    for (i = 0; i < nch; i++)
+    {
+        mp3d_DCT_II(grbuf + 576*i, nbands);
+    }
+
+    memcpy(lins, qmf_state, sizeof(int32_t)*15*64);
+
+    for (i = 0; i < nbands; i += 2)
+    {
+        mp3d_synth(grbuf + i, pcm + ((32*i) >> half)*nch, nch, half, lins + i*64);
+    }
+#ifndef MINIMP3_NONSTANDARD_BUT_LOGICAL
+    if (nch == 1)
+    {
+        for (i = 0; i < 15*64; i += 2)
+        {
+            qmf_state[i] = lins[nbands*64 + i];
+        }
+    } else
+#endif /* MINIMP3_NONSTANDARD_BUT_LOGICAL */
+    {
+        memcpy(qmf_state, lins + nbands*64, sizeof(int32_t)*15*64);
+    }
+}
+
+static int mp3d_match_frame(const uint8_t *hdr, int mp3_bytes, int frame_bytes)
+{
+    int i, nmatch;
+    for (i = 0, nmatch = 0; nmatch < MAX_FRAME_SYNC_MATCHES; nmatch++)
+    {
+        i += hdr_frame_bytes(hdr + i, frame_bytes) + hdr_padding(hdr + i);
+        if (i + HDR_SIZE > mp3_bytes)
+            return nmatch > 0;
+        if (!hdr_compare(hdr, hdr + i))
+            return 0;
+    }
+    return 1;
+}
+
+static int mp3d_find_frame(const uint8_t *mp3, int mp3_bytes, int *free_format_bytes, int *ptr_frame_bytes)
+{
+    int i, k;
+    for (i = 0; i < mp3_bytes - HDR_SIZE; i++, mp3++)
+    {
+        if (hdr_valid(mp3))
+        {
+            int frame_bytes = hdr_frame_bytes(mp3, *free_format_bytes);
+            int frame_and_padding = frame_bytes + hdr_padding(mp3);
+
+            for (k = HDR_SIZE; !frame_bytes && k < MAX_FREE_FORMAT_FRAME_SIZE && i + 2*k < mp3_bytes - HDR_SIZE; k++)
+            {
+                if (hdr_compare(mp3, mp3 + k))
+                {
+                    int fb = k - hdr_padding(mp3);
+                    int nextfb = fb + hdr_padding(mp3 + k);
+                    if (i + k + nextfb + HDR_SIZE > mp3_bytes || !hdr_compare(mp3, mp3 + k + nextfb))
+                        continue;
+                    frame_and_padding = k;
+                    frame_bytes = fb;
+                    *free_format_bytes = fb;
+                }
+            }
+            if ((frame_bytes && i + frame_and_padding <= mp3_bytes &&
+                mp3d_match_frame(mp3, mp3_bytes - i, frame_bytes)) ||
+                (!i && frame_and_padding == mp3_bytes))
+            {
+                *ptr_frame_bytes = frame_and_padding;
+                return i;
+            }
+            *free_format_bytes = 0;
+        }
+    }
+    *ptr_frame_bytes = 0;
+    return mp3_bytes;
+}
+
+void mp3dec_init(mp3dec_t *dec)
+{
+    dec->header[0] = 0;
+}
+
+
+int mp3dec_decode_frame(mp3dec_t *dec, const uint8_t *mp3, int mp3_bytes, mp3d_sample_t *pcm, mp3dec_frame_info_t *info)
+{
+    int i = 0, igr, frame_size = 0, success = 1;
+    const uint8_t *hdr;
+    bs_t bs_frame[1];
+#ifdef MINIMP3_STATIC_SCRATCH
+    /* Not reentrant: for one decoder on a small stack (RP2040 core 1) */
+    static
+#endif /* MINIMP3_STATIC_SCRATCH */
+    mp3dec_scratch_t scratch;
+
+    if (mp3_bytes > 4 && dec->header[0] == 0xff && hdr_compare(dec->header, mp3))
+    {
+        frame_size = hdr_frame_bytes(mp3, dec->free_format_bytes) + hdr_padding(mp3);
+        if (frame_size != mp3_bytes && (frame_size + HDR_SIZE > mp3_bytes || !hdr_compare(mp3, mp3 + frame_size)))
+        {
+            frame_size = 0;
+        }
+    }
+    if (!frame_size)
+    {
+        unsigned char half_rate = dec->half_rate;
+        memset(dec, 0, sizeof(mp3dec_t));
+        dec->half_rate = half_rate;
+        i = mp3d_find_frame(mp3, mp3_bytes, &dec->free_format_bytes, &frame_size);
+        if (!frame_size || i + frame_size > mp3_bytes)
+        {
+            info->frame_bytes = i;
+            return 0;
+        }
+    }
+
+    hdr = mp3 + i;
+    memcpy(dec->header, hdr, HDR_SIZE);
+    info->frame_bytes = i + frame_size;
+    info->frame_offset = i;
+    info->channels = HDR_IS_MONO(hdr) ? 1 : 2;
+    info->hz = hdr_sample_rate_hz(hdr);
+    info->layer = 4 - HDR_GET_LAYER(hdr);
+    info->bitrate_kbps = hdr_bitrate_kbps(hdr);
+
+    if (!pcm)
+    {
+        return hdr_frame_samples(hdr);
+    }
+    if (info->layer != 3)
+    {
+        return 0;
+    }
+
+    bs_init(bs_frame, hdr + HDR_SIZE, frame_size - HDR_SIZE);
+    if (HDR_IS_CRC(hdr))
+    {
+        get_bits(bs_frame, 16);
+    }
+
+    {
+        int main_data_begin = L3_read_side_info(bs_frame, scratch.gr_info, hdr);
+        if (main_data_begin < 0 || bs_frame->pos > bs_frame->limit)
+        {
+            mp3dec_init(dec);
+            return 0;
+        }
+        success = L3_restore_reservoir(dec, bs_frame, &scratch, main_data_begin);
+        if (success)
+        {
+            for (igr = 0; igr < (HDR_TEST_MPEG1(hdr) ? 2 : 1); igr++, pcm += (576 >> dec->half_rate)*info->channels)
+            {
+                memset(scratch.grbuf[0], 0, 576*2*sizeof(int32_t));
+                L3_decode(dec, &scratch, scratch.gr_info + igr*info->channels, info->channels);
+                mp3d_synth_granule(dec->qmf_state, scratch.grbuf[0], 18, info->channels, dec->half_rate, pcm, scratch.syn[0]);
+            }
+        }
+        L3_save_reservoir(dec, &scratch);
+    }
+    return success*hdr_frame_samples(dec->header) >> dec->half_rate;
+}
+#endif /* MINIMP3_IMPLEMENTATION && !_MINIMP3_FIXED_IMPLEMENTATION_GUARD */
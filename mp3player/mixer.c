@@ -0,0 +1,339 @@
+// mixer.c
+#include "mixer.h"
+#include <string.h>
+
+typedef enum { MIX_OFF = 0, MIX_STREAM, MIX_TONE, MIX_SAMPLE } mix_kind_t;
+
+typedef struct {
+    volatile uint8_t  kind;
+    uint8_t           channels;   // stream
+    uint8_t           wave;       // tone
+    bool              endless;    // tone: single note without a length
+    volatile uint32_t gains;      // Q12 left | right << 16, one store so a change is never torn
+
+    // Stream voice
+    audio_out_provider_t provide;
+    audio_out_consume_t  consume;
+    void*                user;
+
+    // Tone voice: current note plays `sound` frames, then `rest` frames of silence
+    uint32_t   phase, step;
+    uint32_t   sound, rest;
+    uint16_t   idx, len;
+    mix_note_t seq[MIX_SEQ_MAX];
+
+    // Sample voice: position `pos` frames + `frac` (Q16), advancing `step` per frame
+    mix_sample_t smp;
+    uint32_t   pos, frac;
+    uint32_t   age;           // trigger order, for stealing the oldest
+} mix_voice_t;
+
+static mix_voice_t voices[MIX_VOICES];
+static volatile uint32_t mix_rate = 44100;
+static int      out_channels = 2;
+static int32_t  acc[2 * MIX_BATCH];
+static int16_t  out[2 * MIX_BATCH];
+static mix_voice_t* passthrough;   // stream handed straight through by the last provide
+static uint32_t trigger_count;
+
+#define TONE_AMP 16384   // -6 dBFS before the voice gain
+
+static inline uint32_t pack_gains(int32_t l, int32_t r){
+    return (uint32_t)(uint16_t)l | ((uint32_t)(uint16_t)r << 16);
+}
+
+static inline int16_t sat16(int32_t v){
+    if (v > 32767) return 32767;
+    if (v < -32768) return -32768;
+    return (int16_t)v;
+}
+
+static inline uint32_t tone_step(uint32_t freq){
+    return (uint32_t)(((uint64_t)freq << 32) / mix_rate);
+}
+
+static inline uint32_t sample_step(uint32_t rate){
+    return (uint32_t)(((uint64_t)rate << 16) / mix_rate);
+}
+
+static uint32_t gains_for(int32_t gain, int32_t pan){
+    if (gain < 0) gain = 0;
+    if (gain > 4 * MIX_UNITY) gain = 4 * MIX_UNITY;
+    if (pan < -MIX_UNITY) pan = -MIX_UNITY;
+    if (pan > MIX_UNITY) pan = MIX_UNITY;
+    int32_t l = pan > 0 ? MIX_UNITY - pan : MIX_UNITY;
+    int32_t r = pan < 0 ? MIX_UNITY + pan : MIX_UNITY;
+    return pack_gains(gain * l / MIX_UNITY, gain * r / MIX_UNITY);
+}
+
+// Load the next note of a tone voice; false (and the voice off) after the last one.
+// Notes are articulated: 7/8 sounding, 1/8 rest, so repeated notes stay distinct.
+static bool next_note(mix_voice_t* v){
+    if (v->idx >= v->len) { __atomic_store_n(&v->kind, MIX_OFF, __ATOMIC_RELEASE); return false; }
+    const mix_note_t* nt = &v->seq[v->idx++];
+    uint32_t frames = (uint32_t)(((uint64_t)nt->ms * mix_rate) / 1000);
+    v->step = tone_step(nt->freq);
+    if (!nt->freq) {
+        v->sound = 0;
+        v->rest = frames;
+    } else {
+        v->sound = v->len > 1 ? frames - frames / 8 : frames;
+        v->rest = frames - v->sound;
+    }
+    return true;
+}
+
+static void voice_off(int voice){
+    __atomic_store_n(&voices[voice].kind, MIX_OFF, __ATOMIC_RELEASE);
+}
+
+void mixer_init(uint32_t rate){
+    for (int i = 0; i < MIX_VOICES; i++) {
+        voice_off(i);
+        voices[i].gains = pack_gains(MIX_UNITY, MIX_UNITY);
+    }
+    passthrough = NULL;
+    mix_rate = rate ? rate : 44100;
+    out_channels = 2;
+}
+
+void mixer_set_rate(uint32_t rate){
+    if (!rate || rate == mix_rate) return;
+    mix_rate = rate;
+    // Re-tune running tones; note lengths pick the new rate up from their next note
+    for (int i = 0; i < MIX_VOICES; i++) {
+        mix_voice_t* v = &voices[i];
+        if (v->kind == MIX_TONE && v->idx) v->step = tone_step(v->seq[v->idx - 1].freq);
+        else if (v->kind == MIX_SAMPLE) v->step = sample_step(v->smp.rate);
+    }
+}
+
+void mixer_set_channels(int channels){
+    out_channels = channels <= 1 ? 1 : 2;
+}
+
+void mixer_stream(int voice, audio_out_provider_t provide, audio_out_consume_t consume, void* user, int channels){
+    mix_voice_t* v = &voices[voice];
+    voice_off(voice);
+    v->provide = provide;
+    v->consume = consume;
+    v->user = user;
+    v->channels = channels <= 1 ? 1 : 2;
+    __atomic_store_n(&v->kind, MIX_STREAM, __ATOMIC_RELEASE);
+}
+
+bool mixer_tone(int voice, const mix_note_t* notes, size_t n, mix_wave_t wave){
+    if (n == 0 || n > MIX_SEQ_MAX) return false;
+    mix_voice_t* v = &voices[voice];
+    voice_off(voice);
+    memcpy(v->seq, notes, n * sizeof(mix_note_t));
+    v->len = (uint16_t)n;
+    v->idx = 0;
+    v->wave = (uint8_t)wave;
+    v->phase = 0;
+    v->endless = n == 1 && notes[0].ms == 0;
+    next_note(v);
+    __atomic_store_n(&v->kind, MIX_TONE, __ATOMIC_RELEASE);
+    return true;
+}
+
+void mixer_gain(int voice, int32_t gain, int32_t pan){
+    voices[voice].gains = gains_for(gain, pan);
+}
+
+int mixer_trigger(const mix_sample_t* smp, int first, int last, int32_t gain, int32_t pan){
+    int pick = first;
+    for (int i = first; i <= last; i++) {
+        if (voices[i].kind == MIX_OFF) { pick = i; break; }
+        // Only sample voices are stolen; a tone or stream keeps its voice unless all are
+        if (voices[pick].kind != MIX_SAMPLE ||
+            (voices[i].kind == MIX_SAMPLE && voices[i].age < voices[pick].age)) pick = i;
+    }
+    mix_voice_t* v = &voices[pick];
+    voice_off(pick);
+    v->smp = *smp;
+    v->pos = 0;
+    v->frac = 0;
+    v->step = sample_step(smp->rate);
+    v->age = ++trigger_count;
+    v->gains = gains_for(gain, pan);
+    __atomic_store_n(&v->kind, MIX_SAMPLE, __ATOMIC_RELEASE);
+    return pick;
+}
+
+void mixer_stop_data(const void* data){
+    for (int i = 0; i < MIX_VOICES; i++) {
+        if (voices[i].kind == MIX_SAMPLE && voices[i].smp.data == data) voice_off(i);
+    }
+}
+
+void mixer_stop(int voice){
+    voice_off(voice);
+}
+
+bool mixer_busy(int voice){
+    return voices[voice].kind != MIX_OFF;
+}
+
+bool mixer_active(void){
+    for (int i = 0; i < MIX_VOICES; i++) if (voices[i].kind != MIX_OFF) return true;
+    return false;
+}
+
+// Add up to `n` frames of a stream voice into acc; returns frames it had
+static size_t mix_stream(mix_voice_t* v, size_t n){
+    uint32_t g = v->gains;
+    int32_t gl = (int32_t)(g & 0xFFFFu), gr = (int32_t)(g >> 16);
+    size_t done = 0;
+    while (done < n) {
+        const int16_t* src;
+        size_t got = v->provide(&src, n - done, v->user);
+        if (got == 0) break;
+        int32_t* a = acc + 2 * done;
+        if (v->channels == 2) {
+            for (size_t k = 0; k < got; k++) {
+                a[2*k]     += (src[2*k]     * gl) >> 12;
+                a[2*k + 1] += (src[2*k + 1] * gr) >> 12;
+            }
+        } else {
+            for (size_t k = 0; k < got; k++) {
+                a[2*k]     += (src[k] * gl) >> 12;
+                a[2*k + 1] += (src[k] * gr) >> 12;
+            }
+        }
+        if (v->consume) v->consume(got, v->user);
+        done += got;
+    }
+    return done;
+}
+
+// Add `n` frames of a tone voice into acc (rests and the tail after the last note are
+// silence, so a tone always covers the whole batch)
+static size_t mix_tone(mix_voice_t* v, size_t n){
+    uint32_t g = v->gains;
+    int32_t gl = (int32_t)(g & 0xFFFFu), gr = (int32_t)(g >> 16);
+    size_t i = 0;
+    while (i < n) {
+        if (v->sound || v->endless) {
+            size_t run = n - i;
+            if (!v->endless && run > v->sound) run = v->sound;
+            uint32_t ph = v->phase, st = v->step;
+            int32_t* a = acc + 2 * i;
+            if (v->wave == MIX_WAVE_SQUARE) {
+                int32_t hl = (TONE_AMP * gl) >> 12, hr = (TONE_AMP * gr) >> 12;
+                for (size_t k = 0; k < run; k++, ph += st) {
+                    bool hi = ph < 0x80000000u;
+                    a[2*k]     += hi ? hl : -hl;
+                    a[2*k + 1] += hi ? hr : -hr;
+                }
+            } else {
+                for (size_t k = 0; k < run; k++, ph += st) {
+                    int32_t saw = (int32_t)(ph >> 16) - 32768;
+                    int32_t x = saw - (saw * saw / 32768) / 4;   // softened saw
+                    a[2*k]     += (x * gl) >> 12;
+                    a[2*k + 1] += (x * gr) >> 12;
+                }
+            }
+            v->phase = ph;
+            if (!v->endless) v->sound -= run;
+            i += run;
+        } else if (v->rest) {
+            size_t run = n - i;
+            if (run > v->rest) run = v->rest;
+            v->rest -= run;
+            i += run;
+        } else if (!next_note(v)) {
+            break;
+        }
+    }
+    return n;
+}
+
+// Channel `c` of frame `i` as int16
+static inline int32_t sample_at(const mix_sample_t* s, uint32_t i, int c){
+    uint32_t k = i * s->channels + (uint32_t)c;
+    switch (s->format) {
+        case MIX_S8: return (int32_t)((const int8_t*)s->data)[k] << 8;
+        case MIX_U8: return ((int32_t)((const uint8_t*)s->data)[k] - 128) << 8;
+        default:     return ((const int16_t*)s->data)[k];
+    }
+}
+
+// Add up to `n` frames of a sample voice into acc; the voice ends with the sample.
+// Linear interpolation between neighbouring frames covers any rate ratio.
+static size_t mix_sample(mix_voice_t* v, size_t n){
+    uint32_t g = v->gains;
+    int32_t gl = (int32_t)(g & 0xFFFFu), gr = (int32_t)(g >> 16);
+    const mix_sample_t* s = &v->smp;
+    uint32_t pos = v->pos, frac = v->frac, step = v->step;
+    uint32_t last = s->frames - 1;
+    int rc = s->channels == 2 ? 1 : 0;
+    size_t k = 0;
+    for (; k < n && pos < s->frames; k++) {
+        uint32_t nx = pos < last ? pos + 1 : last;
+        int32_t l0 = sample_at(s, pos, 0), l1 = sample_at(s, nx, 0);
+        int32_t r0 = sample_at(s, pos, rc), r1 = sample_at(s, nx, rc);
+        int32_t l = l0 + (((l1 - l0) * (int32_t)(frac >> 1)) >> 15);   // Q15: no overflow
+        int32_t r = r0 + (((r1 - r0) * (int32_t)(frac >> 1)) >> 15);
+        acc[2*k]     += (l * gl) >> 12;
+        acc[2*k + 1] += (r * gr) >> 12;
+        frac += step;
+        pos += frac >> 16;
+        frac &= 0xFFFFu;
+    }
+    v->pos = pos;
+    v->frac = frac;
+    if (pos >= s->frames) __atomic_store_n(&v->kind, MIX_OFF, __ATOMIC_RELEASE);
+    // Like a tone, the rest of the batch after the end is silence, not missing data
+    return n;
+}
+
+size_t mixer_provide(const int16_t** frames, size_t max_frames, void* user){
+    (void)user;
+    passthrough = NULL;
+    size_t n = max_frames < MIX_BATCH ? max_frames : MIX_BATCH;
+
+    mix_voice_t* only = NULL;
+    int active = 0;
+    for (int i = 0; i < MIX_VOICES; i++) {
+        if (voices[i].kind != MIX_OFF) { only = &voices[i]; active++; }
+    }
+    if (active == 1 && only->kind == MIX_STREAM && only->channels == out_channels &&
+        only->gains == pack_gains(MIX_UNITY, MIX_UNITY)) {
+        // Plain music playback: nothing to mix, keep it zero-copy
+        passthrough = only;
+        return only->provide(frames, max_frames, only->user);
+    }
+
+    *frames = out;
+    if (!active) {
+        // Output running for effects that have finished: silence, not an underrun
+        memset(out, 0, n * (size_t)out_channels * sizeof(int16_t));
+        return n;
+    }
+    memset(acc, 0, n * 2 * sizeof(int32_t));
+    size_t made = 0;
+    for (int i = 0; i < MIX_VOICES; i++) {
+        mix_voice_t* v = &voices[i];
+        size_t got = 0;
+        uint8_t kind = __atomic_load_n(&v->kind, __ATOMIC_ACQUIRE);
+        if (kind == MIX_STREAM) got = mix_stream(v, n);
+        else if (kind == MIX_TONE) got = mix_tone(v, n);
+        else if (kind == MIX_SAMPLE) got = mix_sample(v, n);
+        if (got > made) made = got;
+    }
+    // Nothing from any voice (a lone stream ran dry) is reported as an underrun
+    if (out_channels == 1) {
+        for (size_t k = 0; k < made; k++) out[k] = sat16((acc[2*k] + acc[2*k + 1]) >> 1);
+    } else {
+        for (size_t k = 0; k < 2 * made; k++) out[k] = sat16(acc[k]);
+    }
+    return made;
+}
+
+void mixer_consume(size_t frames, void* user){
+    (void)user;
+    // Mixed voices were consumed while mixing; only a passed-through stream is left
+    if (passthrough && passthrough->consume) passthrough->consume(frames, passthrough->user);
+    passthrough = NULL;
+}
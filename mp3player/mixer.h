@@ -0,0 +1,70 @@
+// mixer.h : N-voice software mixer in front of audio_out
+// Sums a fixed set of voices into the stream audio_out pulls (stereo, or mono behind a
+// mono track), with per-voice gain and pan and a saturating Q12 fixed-point inner loop.
+// Voice kinds:
+//  - stream: another provider/consume pair (the MP3 ring), taken 1:1 at the mixer rate
+//  - tone:   square or saw oscillator playing a (freq, ms) note list, e.g. RTTTL
+//  - sample: one-shot PCM straight from RAM at its own rate (linear interpolation)
+// The mixer runs at the output's input rate (the current track's rate); tones and
+// samples are stepped against it, so they keep their pitch when it changes.
+//
+// Voices are configured from the VM and mixed in the DMA IRQ on the same core: a voice
+// is switched off while its fields change and published again last, so the IRQ only
+// ever sees a whole configuration.
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "audio_out.h"
+
+#define MIX_VOICES    6     // voice 0 is the MP3 player's, 1.. are free for effects
+#define MIX_BATCH     64    // frames mixed per provider call
+#define MIX_SEQ_MAX   128   // notes per tone voice
+#define MIX_UNITY     4096  // gain 1.0 in Q12
+
+typedef enum { MIX_WAVE_SQUARE = 0, MIX_WAVE_SAW } mix_wave_t;
+
+typedef enum { MIX_S16 = 0, MIX_S8, MIX_U8 } mix_format_t;
+
+// PCM held by the caller (not copied): it must stay put while a voice plays it
+typedef struct {
+    const void* data;
+    uint32_t    frames;
+    uint32_t    rate;
+    uint8_t     channels;   // 1 or 2, interleaved
+    uint8_t     format;     // mix_format_t
+} mix_sample_t;
+
+typedef struct {
+    uint16_t freq;   // Hz, 0 = rest
+    uint16_t ms;     // 0 on the only note = until stopped
+} mix_note_t;
+
+// Clear all voices (unity gain, centred). `rate` is the output's input rate.
+void   mixer_init(uint32_t rate);
+void   mixer_set_rate(uint32_t rate);
+// Output frames: 2 (the default) or 1, set while the output is stopped. A mono output
+// takes a mono stream through as it is; anything mixed is summed to mono, pan and all.
+void   mixer_set_channels(int channels);
+// Attach a stream voice: `channels` 1 or 2 frames from the provider pair
+void   mixer_stream(int voice, audio_out_provider_t provide, audio_out_consume_t consume, void* user, int channels);
+// Start a tone voice on `n` notes (copied, at most MIX_SEQ_MAX); false if too many
+bool   mixer_tone(int voice, const mix_note_t* notes, size_t n, mix_wave_t wave);
+// Gain in Q12 (MIX_UNITY = 1.0, up to 4.0) and pan in Q12 (-MIX_UNITY left .. +MIX_UNITY
+// right). Centre leaves both sides at `gain`; panning only attenuates the far side.
+void   mixer_gain(int voice, int32_t gain, int32_t pan);
+// Play `smp` once on a free voice in [first, last], else on the one triggered longest
+// ago. Gain/pan as mixer_gain. Returns the voice. No allocation, no VFS: safe to call
+// from a game loop at any rate.
+int    mixer_trigger(const mix_sample_t* smp, int first, int last, int32_t gain, int32_t pan);
+// Stop every voice playing from `data` (before its buffer goes away)
+void   mixer_stop_data(const void* data);
+void   mixer_stop(int voice);
+bool   mixer_busy(int voice);
+bool   mixer_active(void);   // any voice playing
+
+// audio_out provider pair (pass NULL user). With a single stream voice at unity gain
+// whose channel count matches the output, the stream's memory is handed through
+// untouched (no copy, no mixing).
+size_t mixer_provide(const int16_t** frames, size_t max_frames, void* user);
+void   mixer_consume(size_t frames, void* user);
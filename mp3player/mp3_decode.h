@@ -15,17 +15,50 @@ mp3_decoder_t* mp3_decoder_create(void);
 void mp3_decoder_destroy(mp3_decoder_t* dec);
 
 // Open from VFS path (for fake decoder this is ignored or used to seed)
+// A Xing/Info frame is not played, and with a LAME tag the encoder delay and end padding
+// are trimmed too, so consecutive tracks of an album join without a gap.
 bool mp3_decoder_open(mp3_decoder_t* dec, const char* path, mp3_stream_info_t* out_info);
 
-// Decode up to `max_frames` PCM frames into interleaved int16 (LRLR...)
-// Returns number of frames produced; 0 on EOF; negative on error
+// Largest frame count one decode call can produce (one MPEG-1 Layer III frame)
+#define MP3_DECODE_MAX_FRAMES 1152
+
+// Decode the next MP3 frame straight into `out` as int16 frames of the channel count
+// open reported: interleaved LRLR... for stereo, one sample per frame for a mono stream.
+// `out` must hold at least MP3_DECODE_MAX_FRAMES frames (max_frames is its capacity),
+// so callers can point it into their output ring and skip any intermediate copy.
+// Returns number of frames produced; 0 on EOF or while resyncing; negative on error
 int mp3_decoder_decode(mp3_decoder_t* dec, int16_t* out_interleaved, size_t max_frames);
 
 // Optional: reset/seek-to-beginning
 bool mp3_decoder_rewind(mp3_decoder_t* dec);
 
+// Continue decoding at `sample` (per channel, from the start of the stream) (VM context).
+// Frames are found through the frame index (built as frames are seen, or by a header-only
+// scan), the CBR frame size, or the Xing/VBRI table; a few frames before the target are
+// decoded and dropped to refill the bit reservoir. Seeking past the end lands on the last
+// frame. Returns false if the position could not be reached.
+bool mp3_decoder_seek(mp3_decoder_t* dec, uint32_t sample);
+// Per-channel position of the next sample decode will return
+uint32_t mp3_decoder_tell(mp3_decoder_t* dec);
+
+// Fast decode for speech, from the next open on: only the lower half of the spectrum is
+// synthesised and every other sample is produced, so a 44.1 kHz stream comes out at
+// 22.05 kHz (open reports the halved rate, and positions count output samples) for
+// about half the decode work and PCM traffic. Streams below 22.05 kHz decode normally.
+// False if this build's engine cannot (the float one).
+bool mp3_decoder_set_fast(mp3_decoder_t* dec, bool on);
+
 // Returns true if decoder reached end-of-file (no more data to read)
 bool mp3_decoder_is_eof(mp3_decoder_t* dec);
 
 // Optional diagnostics: number of successful frames decoded and zero (scan) returns
 void mp3_decoder_get_diag(mp3_decoder_t* dec, uint32_t* frames, uint32_t* zero_returns);
+
+// Optional byte source replacing the decoder's own file reads, so decode can run where
+// the MicroPython VFS is not reachable (core 1). Returns bytes copied (>0), 0 if nothing
+// is buffered yet (decode returns 0 and retries later), <0 at end of stream.
+typedef int (*mp3_byte_source_t)(uint8_t* dst, size_t max, void* user);
+// Install (or clear with NULL) the byte source. Call after open: open/seek/rewind still read the file.
+void mp3_decoder_set_source(mp3_decoder_t* dec, mp3_byte_source_t src, void* user);
+// Read the next raw bytes of the opened file (VM context). Returns bytes read, 0 at EOF.
+int mp3_decoder_read_input(mp3_decoder_t* dec, uint8_t* buf, size_t n);
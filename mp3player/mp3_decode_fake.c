@@ -10,6 +10,7 @@ struct mp3_decoder_s {
     int   sr, ch;
     float phase;
     bool  eof;
+    uint32_t pos;
 };
 
 static struct mp3_decoder_s g_dec;
@@ -28,6 +29,7 @@ bool mp3_decoder_open(mp3_decoder_t* dec, const char* path, mp3_stream_info_t* o
 int mp3_decoder_decode(mp3_decoder_t* dec, int16_t* out, size_t max_frames) {
     const float freq = 440.0f;
     const float inc  = 2.f * (float)M_PI * freq / (float)dec->sr;
+    if (max_frames > MP3_DECODE_MAX_FRAMES) max_frames = MP3_DECODE_MAX_FRAMES;
     for (size_t i = 0; i < max_frames; ++i) {
         float s = sinf(dec->phase);
         dec->phase += inc;
@@ -36,6 +38,12 @@ int mp3_decoder_decode(mp3_decoder_t* dec, int16_t* out, size_t max_frames) {
         out[2*i + 0] = sample;
         out[2*i + 1] = sample;
     }
+    dec->pos += (uint32_t)max_frames;
     return (int)max_frames;
 }
-bool mp3_decoder_rewind(mp3_decoder_t* dec) { dec->phase = 0.f; return true; }
+bool mp3_decoder_set_fast(mp3_decoder_t* dec, bool on) { (void)dec; return !on; }
+bool mp3_decoder_rewind(mp3_decoder_t* dec) { dec->phase = 0.f; dec->pos = 0; return true; }
+bool mp3_decoder_seek(mp3_decoder_t* dec, uint32_t sample) { dec->phase = 0.f; dec->pos = sample; return true; }
+uint32_t mp3_decoder_tell(mp3_decoder_t* dec) { return dec->pos; }
+void mp3_decoder_set_source(mp3_decoder_t* dec, mp3_byte_source_t src, void* user) { (void)dec; (void)src; (void)user; }
+int mp3_decoder_read_input(mp3_decoder_t* dec, uint8_t* buf, size_t n) { (void)dec; (void)buf; (void)n; return 0; }
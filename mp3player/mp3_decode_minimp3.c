@@ -6,29 +6,64 @@
 #define MINIMP3_IMPLEMENTATION
 #define MINIMP3_ONLY_MP3
 #define MINIMP3_NO_SIMD
+#define MINIMP3_STATIC_SCRATCH   // single decoder; keeps ~16KB off the (core 1) stack
 #include "mp3_decode.h"
+#if MP3_FIXED_POINT
+#include "minimp3_fixed.h"   // integer-only engine, same mp3dec_* API
+#else
 #include "minimp3.h"
+#endif
 #include <string.h>
 #include <stdlib.h>
 #include "vfs_bridge.h"
+#include "fat_direct.h"
+#include "mp3_index.h"
+#include "mp3_meta.h"
+#include "audio_trace.h"
+
+// Upper bound on frames decoded and dropped ahead of a seek target, so the bit
+// reservoir (up to 511 bytes of earlier frames) and the MDCT overlap are rebuilt
+#define SEEK_PREROLL_MAX 16
 
 typedef struct mp3_decoder_s {
     mp3dec_t      core;
-    mp_obj_t      file_obj;      // MicroPython file object
+    mp_obj_t      file_obj;      // MicroPython file object (kept open; stream fallback)
+    fat_direct_t  fat;           // sector reader when the file lives on a VfsFat mount
+    bool          use_fat;
+    mp3_byte_source_t source;    // if set, input comes from here instead of file_obj
+    void*         source_user;
     char          path_copy[128];
     uint8_t       inbuf[16384];
     int           inbuf_len;
     int           inbuf_pos;
+    uint32_t      inbuf_file_off; // file offset of inbuf[0]
     int           sample_rate;
     int           channels;
-    int           fixed_channels; // desired output channel count (1 or 2)
-    // Stash for leftover decoded samples
-    int16_t       stash[MINIMP3_MAX_SAMPLES_PER_FRAME];
-    int           stash_frames;
-    int           stash_pos;
+    int           fixed_channels; // output channel count: the first frame's
+    bool          fast;           // mp3_decoder_set_fast, applied at open
+    int           half;           // 1 while decoding at half rate (fast on this stream)
     int           eof;
     uint32_t      frames_decoded;
     uint32_t      zero_returns;
+    // Stream layout, from the first frame
+    uint32_t      file_size;
+    uint32_t      first_off;      // first frame header (after any ID3v2 tag)
+    uint32_t      spf;            // samples per channel per frame
+    int           kbps;           // first frame bitrate
+    bool          vbr;            // Xing or VBRI header present
+    bool          has_toc;
+    uint32_t      toc_frames;     // from the Xing/VBRI header, 0 if absent
+    uint32_t      toc_bytes;
+    uint8_t       toc[100];       // stream position (in 1/256 of toc_bytes) at each percent
+    // Gapless trimming (LAME tag): output sample n is stream sample n + lead
+    uint32_t      lead;           // Xing frame + encoder delay + decoder delay, dropped
+    uint32_t      total_out;      // samples of actual audio, 0 if unknown
+    // Position
+    uint32_t      frame_no;       // number of the next frame in the stream
+    bool          frame_exact;    // frame_no is known exactly, so frames can go in the index
+    uint32_t      pos_samples;    // per-channel position of the next sample returned
+    uint32_t      skip_samples;   // output still to drop after a seek
+    mp3_index_t   index;
 } mp3_decoder_impl_t;
 
 static mp3_decoder_impl_t g_impl; // single instance (adjust to malloc if multiple needed)
@@ -45,13 +80,49 @@ mp3_decoder_t* mp3_decoder_create(void){
     return (mp3_decoder_t*)&g_impl;
 }
 
+// Persist newly indexed frames next to the file (VM context only)
+static void save_index(mp3_decoder_impl_t* d){
+    if (d->index.dirty && d->file_obj != MP_OBJ_NULL) mp3_index_save(&d->index, d->path_copy, d->file_size);
+}
+
 void mp3_decoder_destroy(mp3_decoder_t* dec){
-    mp3_decoder_impl_t* d = (mp3_decoder_impl_t*)dec; if (d->file_obj != MP_OBJ_NULL) { vfs_close(&d->file_obj); }
+    mp3_decoder_impl_t* d = (mp3_decoder_impl_t*)dec;
+    save_index(d);
+    if (d->file_obj != MP_OBJ_NULL) { vfs_close(&d->file_obj); }
+}
+
+// Raw file bytes: direct sector reads when mapped, otherwise the stream layer
+static int read_file(mp3_decoder_impl_t* d, uint8_t* buf, size_t n){
+    trace_mark_t tm = trace_begin();
+    int got = d->use_fat ? fat_direct_read(&d->fat, buf, n) : vfs_read(d->file_obj, buf, n);
+    trace_end(TR_READ, tm);
+    return got;
+}
+
+static bool seek_file(mp3_decoder_impl_t* d, uint32_t off){
+    if (d->use_fat) { fat_direct_seek(&d->fat, off); return true; }
+    return vfs_seek(d->file_obj, off);
+}
+
+static bool open_file(mp3_decoder_impl_t* d){
+    if (!vfs_open_rb(d->path_copy, &d->file_obj)) return false;
+    d->use_fat = fat_direct_open(&d->fat, d->file_obj);
+    if (d->use_fat) {
+        d->file_size = d->fat.size;
+    } else {
+        int32_t sz = vfs_size(d->file_obj);
+        d->file_size = sz > 0 ? (uint32_t)sz : 0;
+    }
+    return true;
 }
 
+// Refill once fewer than this many bytes are buffered: a full frame is at most 1441
+// bytes (320kbps @ 32kHz, free format aside) plus the next header for sync checks
+#define REFILL_LOW_WATER 4096
+
 // Refill while preserving leftover tail bytes (frame header may straddle boundary)
 static int refill(mp3_decoder_impl_t* d){
-    if (d->file_obj == MP_OBJ_NULL) return 0;
+    if (d->source == NULL && d->file_obj == MP_OBJ_NULL) return 0;
     int remain = 0;
     if (d->inbuf_pos < d->inbuf_len) {
         remain = d->inbuf_len - d->inbuf_pos;
@@ -61,9 +132,21 @@ static int refill(mp3_decoder_impl_t* d){
             remain = 0;
         }
     }
+    d->inbuf_file_off += (uint32_t)(d->inbuf_len - remain);
     int space = (int)sizeof(d->inbuf) - remain;
     if (space < 0) space = 0;
-    int n = vfs_read(d->file_obj, d->inbuf + remain, space);
+    int n;
+    if (d->source) {
+        n = d->source(d->inbuf + remain, (size_t)space, d->source_user);
+        if (n == 0) {
+            // Starved, not finished: keep what we have and try again later
+            d->inbuf_len = remain;
+            d->inbuf_pos = 0;
+            return d->inbuf_len;
+        }
+    } else {
+        n = read_file(d, d->inbuf + remain, space);
+    }
     if (n <= 0) {
         d->inbuf_len = remain;
         d->inbuf_pos = 0;
@@ -75,14 +158,56 @@ static int refill(mp3_decoder_impl_t* d){
     return d->inbuf_len;
 }
 
+// Drop buffered input and continue reading the file at `off`. The next frame is
+// found with a full sync search, which also resets the decoder state.
+static bool restart_at(mp3_decoder_impl_t* d, uint32_t off){
+    if (!seek_file(d, off)) return false;
+    d->inbuf_len = d->inbuf_pos = 0;
+    d->inbuf_file_off = off;
+    d->eof = 0;
+    d->core.header[0] = 0;
+    return true;
+}
+
+// Input exhausted: if every frame was counted, the index now knows the length
+static void note_end(mp3_decoder_impl_t* d){
+    if (d->frame_exact && !d->index.total_frames) { d->index.total_frames = d->frame_no; d->index.dirty = true; }
+}
+
+// Xing/Info or VBRI header in the first frame `h` (mp3_meta.c parses it): the seek
+// table, and the gapless trim of a LAME tag
+static void parse_vbr_header(mp3_decoder_impl_t* d, const uint8_t* h, int avail){
+    mp3_vbr_t v;
+    if (!mp3_vbr_parse(h, avail, &v)) return;
+    d->vbr = v.vbr;
+    d->toc_frames = v.frames;
+    d->toc_bytes = v.bytes;
+    if (v.has_toc) { memcpy(d->toc, v.toc, 100); d->has_toc = true; }
+    if (!v.xing) return;
+    // The Xing frame itself holds no audio
+    d->lead = d->spf;
+    // The decoder adds 528 + 1 samples of its own delay to the encoder's (all counts are
+    // in output samples, so halved at half rate)
+    if (v.lame) {
+        d->lead += (v.delay + 529u) >> d->half;
+        uint64_t total = (uint64_t)d->toc_frames * d->spf;
+        uint32_t cut = (v.delay + 529u + (v.pad > 529 ? v.pad - 529u : 0)) >> d->half;
+        if (d->toc_frames && total > cut) d->total_out = (uint32_t)(total - cut);
+    }
+}
+
 bool mp3_decoder_open(mp3_decoder_t* dec, const char* path, mp3_stream_info_t* out_info){
     mp3_decoder_impl_t* d = (mp3_decoder_impl_t*)dec;
-    if (d->file_obj != MP_OBJ_NULL) { vfs_close(&d->file_obj); }
-    d->inbuf_len = d->inbuf_pos = 0; d->eof = 0; d->stash_pos = d->stash_frames = 0; d->frames_decoded = 0; d->zero_returns = 0;
+    if (d->file_obj != MP_OBJ_NULL) { save_index(d); vfs_close(&d->file_obj); }
+    d->source = NULL;
+    d->inbuf_len = d->inbuf_pos = 0; d->inbuf_file_off = 0; d->eof = 0; d->frames_decoded = 0; d->zero_returns = 0;
+    d->vbr = d->has_toc = false; d->toc_frames = d->toc_bytes = 0; d->kbps = 0;
+    d->lead = d->total_out = 0;
+    d->frame_no = 0; d->frame_exact = true; d->pos_samples = d->skip_samples = 0;
     size_t plen = strlen(path);
     if (plen >= sizeof(d->path_copy)) plen = sizeof(d->path_copy)-1;
     memcpy(d->path_copy, path, plen); d->path_copy[plen] = '\0';
-    if (!vfs_open_rb(d->path_copy, &d->file_obj)) return false;
+    if (!open_file(d)) return false;
     // Prime header to get sample rate / channels. Also skip ID3v2 tag if present.
     refill(d);
     // ID3v2 header is 10 bytes: 'ID3' + ver + flags + 4-byte synchsafe size
@@ -92,67 +217,78 @@ bool mp3_decoder_open(mp3_decoder_t* dec, const char* path, mp3_stream_info_t* o
                        ( (d->inbuf[8] & 0x7f) << 7  ) |
                        ( (d->inbuf[9] & 0x7f) );
         tag_size += 10; // include header
-        // Skip tag_size bytes by draining current buffer then skipping remainder in chunks
-        int to_skip = tag_size;
-        while (to_skip > 0) {
-            if (d->inbuf_pos >= d->inbuf_len) {
-                if (refill(d)==0) break; // EOF prematurely
-            }
-            int avail = d->inbuf_len - d->inbuf_pos;
-            if (avail > to_skip) avail = to_skip;
-            d->inbuf_pos += avail;
-            to_skip -= avail;
-        }
-        // If we stopped mid-buffer, compact remaining bytes to front to decode seamlessly
-        if (d->inbuf_pos < d->inbuf_len) {
-            int remain = d->inbuf_len - d->inbuf_pos;
-            memmove(d->inbuf, d->inbuf + d->inbuf_pos, remain);
-            d->inbuf_len = remain;
-            d->inbuf_pos = 0;
+        if (tag_size < d->inbuf_len) {
+            d->inbuf_pos = tag_size;
         } else {
-            d->inbuf_len = d->inbuf_pos = 0;
+            // Tag larger than the buffer (cover art): seek past it rather than read it
+            if (!restart_at(d, (uint32_t)tag_size)) return false;
+            refill(d);
         }
-        if (d->inbuf_len == 0) refill(d);
     }
-    mp3dec_frame_info_t fi; int16_t pcm[MINIMP3_MAX_SAMPLES_PER_FRAME];
-    int samples = mp3dec_decode_frame(&d->core, d->inbuf + d->inbuf_pos, d->inbuf_len - d->inbuf_pos, pcm, &fi); // samples per channel
+    // Header-only probe (NULL pcm): nothing is decoded, so the first frame still plays
+    mp3dec_frame_info_t fi = {0};
+    int samples = mp3dec_decode_frame(&d->core, d->inbuf + d->inbuf_pos, d->inbuf_len - d->inbuf_pos, NULL, &fi); // samples per channel
+    // Fast decode only where half the rate still leaves speech its bandwidth. Positions,
+    // frame lengths and the rate are then all in output samples.
+    d->half = 0;
+#if MP3_FIXED_POINT
+    d->half = d->fast && fi.hz >= 22050;
+    d->core.half_rate = (unsigned char)d->half;
+#endif
     if (fi.hz) {
-        d->sample_rate = fi.hz;
+        d->sample_rate = fi.hz >> d->half;
     }
     if (fi.channels) {
         d->channels = fi.channels;
     }
-    (void)samples; // initial header probe only
-    // Decide fixed output channels (expand mono to stereo to keep mixer simple)
-    d->fixed_channels = (d->channels == 1) ? 2 : d->channels;
-    if (fi.frame_bytes > 0) {
-        d->inbuf_pos += fi.frame_bytes; // consume the probed frame so we don't replay it
+    // A mono stream stays mono: the output stage duplicates it, after the ring and mixer
+    d->fixed_channels = d->channels;
+    d->spf = 1152 >> d->half;
+    if (samples > 0) {
+        d->inbuf_pos += fi.frame_offset; // drop junk before the first header only
+        d->spf = (uint32_t)samples >> d->half;
+        d->kbps = fi.bitrate_kbps;
+        parse_vbr_header(d, d->inbuf + d->inbuf_pos, d->inbuf_len - d->inbuf_pos);
     }
+    d->skip_samples = d->lead;
+    d->first_off = d->inbuf_file_off + (uint32_t)d->inbuf_pos;
+    // A failed load may leave the table half-read, so always start over from a reset
+    if (!mp3_index_load(&d->index, d->path_copy, d->file_size)) mp3_index_reset(&d->index, d->first_off);
     if (out_info){ out_info->sample_rate = d->sample_rate; out_info->channels = d->fixed_channels; }
     return true;
 }
 
 int mp3_decoder_decode(mp3_decoder_t* dec, int16_t* out, size_t max_frames){
     mp3_decoder_impl_t* d = (mp3_decoder_impl_t*)dec;
-    if (d->stash_pos < d->stash_frames){
-        int avail = d->stash_frames - d->stash_pos;
-        if ((size_t)avail > max_frames) avail = (int)max_frames;
-        memcpy(out, d->stash + d->stash_pos * d->channels, (size_t)avail * d->channels * sizeof(int16_t));
-        d->stash_pos += avail;
-        return avail;
-    }
-    d->stash_pos = d->stash_frames = 0;
-    if (d->eof) return 0;
+    // Frames are decoded straight into `out`, so it has to hold a whole one
+    if (max_frames < MP3_DECODE_MAX_FRAMES) return -1;
+    if (d->eof && d->inbuf_pos >= d->inbuf_len) return 0;
     // Single-attempt decode per call (keep ISR work bounded). On failure, skip by reported frame_bytes (offset) if any.
     mp3dec_frame_info_t fi; int samples_per_ch = 0;
+    if (!d->eof && d->inbuf_len - d->inbuf_pos < REFILL_LOW_WATER) {
+        refill(d);
+    }
     if (d->inbuf_pos >= d->inbuf_len - 4) {
-        if (refill(d) <= 0) {
-            // nothing more to read
-            return 0;
+        // nothing more to read (or source starved); drop a trailing partial header at EOF
+        if (d->eof) { d->inbuf_pos = d->inbuf_len; note_end(d); }
+        return 0;
+    }
+    fi.hz = 0; // only set when a frame was found
+    const uint8_t* in = d->inbuf + d->inbuf_pos;
+    int in_len = d->inbuf_len - d->inbuf_pos;
+    trace_mark_t tm = trace_begin();
+    if (d->fixed_channels == 1) {
+        // `out` holds one mono frame: a stereo frame in a mono stream (a splice, or a
+        // corrupt header) is probed first and played as silence instead
+        samples_per_ch = mp3dec_decode_frame(&d->core, in, in_len, NULL, &fi);
+        if (samples_per_ch > 0) {
+            samples_per_ch = fi.channels == 1 ? mp3dec_decode_frame(&d->core, in, in_len, out, &fi) : 0;
         }
+    } else {
+        samples_per_ch = mp3dec_decode_frame(&d->core, in, in_len, out, &fi);
     }
-    samples_per_ch = mp3dec_decode_frame(&d->core, d->inbuf + d->inbuf_pos, d->inbuf_len - d->inbuf_pos, d->stash, &fi);
-    if (samples_per_ch <= 0) {
+    trace_end(TR_DECODE, tm);
+    if (samples_per_ch <= 0 && fi.hz == 0) {
         // If decoder suggests an offset to next header (fi.frame_bytes holds skip on failure), advance by that many bytes.
         if (fi.frame_bytes > 0) {
             int skip = fi.frame_bytes;
@@ -162,52 +298,207 @@ int mp3_decoder_decode(mp3_decoder_t* dec, int16_t* out, size_t max_frames){
             // Make forward progress to avoid re-scanning same byte forever
             if (d->inbuf_pos < d->inbuf_len) d->inbuf_pos++;
         }
-        // Refill if we consumed most of the buffer
-        if (d->inbuf_pos >= d->inbuf_len - 4) {
-            refill(d);
-        }
         d->zero_returns++;
         return 0;
     }
+    if (d->frame_exact) {
+        mp3_index_note(&d->index, d->frame_no, d->inbuf_file_off + (uint32_t)(d->inbuf_pos + fi.frame_offset));
+    }
+    d->frame_no++;
     d->inbuf_pos += fi.frame_bytes;
+    if (d->eof && d->inbuf_pos >= d->inbuf_len) note_end(d);
+    if (samples_per_ch <= 0) {
+        // Frame found but no audio (bit reservoir not filled yet): play it as silence
+        // so the sample position stays in step with the frame count
+        samples_per_ch = (int)hdr_frame_samples(d->core.header) >> d->half;
+        memset(out, 0, (size_t)samples_per_ch * d->fixed_channels * sizeof(int16_t));
+        fi.channels = d->fixed_channels;
+        d->zero_returns++;
+    }
     if (fi.hz) {
-        d->sample_rate = fi.hz;
+        d->sample_rate = fi.hz >> d->half;
     }
     if (fi.channels) {
         d->channels = fi.channels;
     }
-    // Expand mono to stereo if needed
+    // A mono frame in a stereo stream: expand it in place (back to front)
     if (d->channels == 1 && d->fixed_channels == 2) {
         for (int i = samples_per_ch - 1; i >= 0; --i) {
-            int16_t s = d->stash[i];
-            d->stash[2*i] = s;
-            d->stash[2*i + 1] = s;
+            int16_t s = out[i];
+            out[2*i] = s;
+            out[2*i + 1] = s;
         }
         d->channels = 2;
     }
-    d->stash_frames = samples_per_ch; // frames
-    d->stash_pos = 0;
-    if (d->stash_frames == 0) return 0;
-    // Serve immediately
-    int serve = d->stash_frames;
-    if ((size_t)serve > max_frames) serve = (int)max_frames;
-    memcpy(out, d->stash, (size_t)serve * d->channels * sizeof(int16_t));
-    d->stash_pos = serve;
     d->frames_decoded++;
-    return serve;
+    // After a seek: drop the pre-roll frames and the part of the target frame before it
+    if (d->skip_samples) {
+        uint32_t k = d->skip_samples < (uint32_t)samples_per_ch ? d->skip_samples : (uint32_t)samples_per_ch;
+        d->skip_samples -= k;
+        samples_per_ch -= (int)k;
+        if (samples_per_ch > 0) {
+            memmove(out, out + k * d->fixed_channels, (size_t)samples_per_ch * d->fixed_channels * sizeof(int16_t));
+        }
+    }
+    // End padding: stop at the last real sample (remaining frames are never decoded)
+    if (d->total_out && d->pos_samples + (uint32_t)samples_per_ch >= d->total_out) {
+        samples_per_ch = (int)(d->total_out - d->pos_samples);
+        d->eof = 1;
+        d->inbuf_pos = d->inbuf_len;
+    }
+    d->pos_samples += (uint32_t)samples_per_ch;
+    return samples_per_ch;
 }
 
-bool mp3_decoder_rewind(mp3_decoder_t* dec){
+// Step over frame headers (no decoding) from index entry `frame` at `off` up to frame
+// `to`, extending the index on the way. False if the file ends first, in which case
+// the frame count is now known.
+static bool walk_frames(mp3_decoder_impl_t* d, uint32_t frame, uint32_t off, uint32_t to, uint32_t* out_off){
+    if (!restart_at(d, off)) return false;
+    for (;;) {
+        if (!d->eof && d->inbuf_len - d->inbuf_pos < REFILL_LOW_WATER) refill(d);
+        if (d->inbuf_pos >= d->inbuf_len - 4) break;
+        mp3dec_frame_info_t fi;
+        int n = mp3dec_decode_frame(&d->core, d->inbuf + d->inbuf_pos, d->inbuf_len - d->inbuf_pos, NULL, &fi);
+        if (n <= 0) {
+            d->inbuf_pos += fi.frame_bytes > 0 ? fi.frame_bytes : 1;
+            continue;
+        }
+        uint32_t at = d->inbuf_file_off + (uint32_t)(d->inbuf_pos + fi.frame_offset);
+        mp3_index_note(&d->index, frame, at);
+        if (frame == to) { *out_off = at; return true; }
+        d->inbuf_pos += fi.frame_bytes;
+        frame++;
+    }
+    d->index.total_frames = frame;
+    d->index.dirty = true;
+    return false;
+}
+
+// First frame header at or after `off`, confirmed by the usual multi-frame sync check
+static bool sync_from(mp3_decoder_impl_t* d, uint32_t off, uint32_t* out_off){
+    if (!restart_at(d, off)) return false;
+    refill(d);
+    mp3dec_frame_info_t fi;
+    if (mp3dec_decode_frame(&d->core, d->inbuf, d->inbuf_len, NULL, &fi) <= 0) return false;
+    *out_off = off + (uint32_t)fi.frame_offset;
+    return true;
+}
+
+// Byte position of `frame` from the VBR table, interpolating within the percent step
+static uint32_t toc_offset(const mp3_decoder_impl_t* d, uint32_t frame){
+    uint32_t pm = (uint32_t)((uint64_t)frame * 100000u / d->toc_frames);   // 1/1000 percent
+    uint32_t pct = pm / 1000, frac = pm % 1000;
+    if (pct > 99) { pct = 99; frac = 1000; }
+    uint32_t a = d->toc[pct], b = pct < 99 ? d->toc[pct + 1] : 256;
+    uint32_t pos = a * 1000 + (b - a) * frac;      // in 1/256000 of toc_bytes
+    return d->first_off + (uint32_t)((uint64_t)d->toc_bytes * pos / 256000u);
+}
+
+// Frames needed before a seek target to refill its reservoir: 511 bytes of main data
+// at this stream's average frame size, plus one frame for the overlap-add
+static uint32_t preroll_frames(const mp3_decoder_impl_t* d){
+    uint32_t avg = 0;
+    if (d->toc_frames && d->toc_bytes) avg = d->toc_bytes / d->toc_frames;
+    else if (d->kbps) avg = d->spf * (uint32_t)d->kbps * 125 / (uint32_t)d->sample_rate;
+    uint32_t payload = avg > 52 ? avg - 36 : 16;    // minus header and side info
+    uint32_t n = (511 + payload - 1) / payload + 1;
+    return n > SEEK_PREROLL_MAX ? SEEK_PREROLL_MAX : n;
+}
+
+bool mp3_decoder_seek(mp3_decoder_t* dec, uint32_t sample){
     mp3_decoder_impl_t* d = (mp3_decoder_impl_t*)dec;
-    if (d->file_obj != MP_OBJ_NULL) { vfs_close(&d->file_obj); }
-    if (!vfs_open_rb(d->path_copy, &d->file_obj)) return false;
-    d->inbuf_len = d->inbuf_pos = 0; d->eof = 0; d->stash_pos = d->stash_frames = 0;
+    if (d->file_obj == MP_OBJ_NULL) return false;
+    // Frames are located by reading the file directly, whatever feeds the decoder
+    mp3_byte_source_t src = d->source;
+    d->source = NULL;
+    if (d->total_out && sample >= d->total_out) sample = d->total_out - 1;
+    // Work in stream samples (including the trimmed lead-in) until the end
+    sample += d->lead;
+    uint32_t target = sample / d->spf;
+    if (d->index.total_frames && target >= d->index.total_frames) {
+        target = d->index.total_frames - 1;
+        sample = target * d->spf;
+    }
+    uint32_t pre = preroll_frames(d);
+    uint32_t start = target > pre ? target - pre : 0;
+    uint32_t off = d->first_off, ef, eo;
+    bool exact = true, ok = false;
+    if (start <= mp3_index_last_frame(&d->index) || d->index.total_frames) {
+        // Indexed: nearest entry, then at most `stride` headers forward
+        mp3_index_lookup(&d->index, start, &ef, &eo);
+        ok = walk_frames(d, ef, eo, start, &off);
+    } else if (!d->vbr && d->kbps) {
+        // CBR: frames differ only by the padding byte, so the offset is right to within
+        // a few bytes; resync from just before it. The frame number rests on the header
+        // being honest, so it is not trusted enough to go in the index.
+        uint32_t est = d->first_off + (uint32_t)((uint64_t)start * d->spf * (uint32_t)d->kbps * 125 / (uint32_t)d->sample_rate);
+        ok = sync_from(d, est > d->first_off + 2 ? est - 2 : d->first_off, &off);
+        exact = false;
+    } else if (d->has_toc) {
+        // VBR with a table: approximate, so frame numbers are estimates from here on
+        ok = sync_from(d, toc_offset(d, start), &off);
+        exact = false;
+    }
+    if (!ok && !d->index.total_frames) {
+        // No table, or the estimate fell past the end: walk headers on from the index
+        exact = true;
+        mp3_index_lookup(&d->index, start, &ef, &eo);
+        ok = walk_frames(d, ef, eo, start, &off);
+        if (!ok && d->index.total_frames) {
+            // Past the end: land on the last frame instead
+            target = d->index.total_frames - 1;
+            sample = target * d->spf;
+            start = target > pre ? target - pre : 0;
+            mp3_index_lookup(&d->index, start, &ef, &eo);
+            ok = walk_frames(d, ef, eo, start, &off);
+        }
+    }
+    save_index(d);
+    if (!ok || !restart_at(d, off)) { d->source = src; return false; }
+    d->frame_no = start;
+    d->frame_exact = exact;
+    d->skip_samples = sample - start * d->spf;
+    d->pos_samples = sample > d->lead ? sample - d->lead : 0;
+    d->source = src;
     return true;
 }
 
+uint32_t mp3_decoder_tell(mp3_decoder_t* dec){
+    mp3_decoder_impl_t* d = (mp3_decoder_impl_t*)dec;
+    return d->pos_samples;
+}
+
+void mp3_decoder_set_source(mp3_decoder_t* dec, mp3_byte_source_t src, void* user){
+    mp3_decoder_impl_t* d = (mp3_decoder_impl_t*)dec;
+    d->source_user = user;
+    d->source = src;
+}
+
+int mp3_decoder_read_input(mp3_decoder_t* dec, uint8_t* buf, size_t n){
+    mp3_decoder_impl_t* d = (mp3_decoder_impl_t*)dec;
+    if (d->file_obj == MP_OBJ_NULL) return 0;
+    int got = read_file(d, buf, n);
+    return got > 0 ? got : 0;
+}
+
+bool mp3_decoder_rewind(mp3_decoder_t* dec){
+    return mp3_decoder_seek(dec, 0);
+}
+
 bool mp3_decoder_is_eof(mp3_decoder_t* dec){
     mp3_decoder_impl_t* d = (mp3_decoder_impl_t*)dec;
-    return d->eof && d->stash_pos >= d->stash_frames && d->inbuf_pos >= d->inbuf_len;
+    return d->eof && d->inbuf_pos >= d->inbuf_len;
+}
+
+bool mp3_decoder_set_fast(mp3_decoder_t* dec, bool on){
+    mp3_decoder_impl_t* d = (mp3_decoder_impl_t*)dec;
+    d->fast = on;
+#if MP3_FIXED_POINT
+    return true;
+#else
+    return !on;
+#endif
 }
 
 void mp3_decoder_get_diag(mp3_decoder_t* dec, uint32_t* frames, uint32_t* zero_returns){
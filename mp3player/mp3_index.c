@@ -0,0 +1,119 @@
+// mp3_index.c : Compact frame -> byte offset index for seeking
+#include "mp3_index.h"
+#include <string.h>
+#include "py/runtime.h"
+#include "vfs_bridge.h"
+
+#define IDX_MAGIC    0x5849334Du   // "M3IX" little-endian
+#define IDX_VERSION  1
+#define IDX_SUFFIX   ".idx"
+
+typedef struct {
+    uint32_t magic, version, file_size, stride, count, total_frames;
+} idx_header_t;
+
+void mp3_index_reset(mp3_index_t* ix, uint32_t first_off){
+    ix->stride = 1;
+    ix->count = 1;
+    ix->total_frames = 0;
+    ix->dirty = false;
+    ix->off[0] = first_off;
+}
+
+void mp3_index_note(mp3_index_t* ix, uint32_t frame, uint32_t offset){
+    if (frame % ix->stride || frame / ix->stride != ix->count) return;
+    if (ix->count == MP3_INDEX_MAX) {
+        // Full: keep every other entry and double the stride
+        for (uint32_t i = 0; i < MP3_INDEX_MAX / 2; i++) ix->off[i] = ix->off[2 * i];
+        ix->count = MP3_INDEX_MAX / 2;
+        ix->stride *= 2;
+        ix->dirty = true;
+        if (frame % ix->stride) return;
+    }
+    ix->off[ix->count++] = offset;
+    ix->dirty = true;
+}
+
+void mp3_index_lookup(const mp3_index_t* ix, uint32_t frame, uint32_t* entry_frame, uint32_t* offset){
+    uint32_t e = frame / ix->stride;
+    if (e >= ix->count) e = ix->count - 1;
+    *entry_frame = e * ix->stride;
+    *offset = ix->off[e];
+}
+
+static bool sidecar_path(char* out, size_t cap, const char* mp3_path){
+    size_t n = strlen(mp3_path);
+    if (n + sizeof(IDX_SUFFIX) > cap) return false;
+    memcpy(out, mp3_path, n);
+    memcpy(out + n, IDX_SUFFIX, sizeof(IDX_SUFFIX));
+    return true;
+}
+
+// Open sidecar file; at file scope so it is still known after an nlr jump
+static mp_obj_t sidecar = MP_OBJ_NULL;
+
+static void sidecar_close(void){
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        vfs_close(&sidecar);
+        nlr_pop();
+    }
+    sidecar = MP_OBJ_NULL;
+}
+
+static bool read_all(mp_obj_t f, void* buf, size_t n){
+    uint8_t* p = (uint8_t*)buf;
+    while (n) {
+        int got = vfs_read(f, p, n);
+        if (got <= 0) return false;
+        p += got; n -= (size_t)got;
+    }
+    return true;
+}
+
+bool mp3_index_load(mp3_index_t* ix, const char* mp3_path, uint32_t file_size){
+    char path[160];
+    if (!sidecar_path(path, sizeof(path), mp3_path)) return false;
+    bool ok = false;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        idx_header_t h;
+        if (vfs_open_rb(path, &sidecar) &&
+            read_all(sidecar, &h, sizeof(h)) && h.magic == IDX_MAGIC && h.version == IDX_VERSION &&
+            h.file_size == file_size && h.stride && h.count && h.count <= MP3_INDEX_MAX &&
+            read_all(sidecar, ix->off, h.count * sizeof(uint32_t))) {
+            ix->stride = h.stride;
+            ix->count = h.count;
+            ix->total_frames = h.total_frames;
+            ix->dirty = false;
+            ok = true;
+        }
+        nlr_pop();
+    } else {
+        // No sidecar (ENOENT) or unreadable: the index gets built as usual
+        ok = false;
+    }
+    sidecar_close();
+    return ok;
+}
+
+bool mp3_index_save(mp3_index_t* ix, const char* mp3_path, uint32_t file_size){
+    char path[160];
+    if (!sidecar_path(path, sizeof(path), mp3_path)) return false;
+    idx_header_t h = { IDX_MAGIC, IDX_VERSION, file_size, ix->stride, ix->count, ix->total_frames };
+    size_t body = ix->count * sizeof(uint32_t);
+    bool ok = false;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        ok = vfs_open_wb(path, &sidecar) &&
+             vfs_write(sidecar, (const uint8_t*)&h, sizeof(h)) == (int)sizeof(h) &&
+             vfs_write(sidecar, (const uint8_t*)ix->off, body) == (int)body;
+        nlr_pop();
+    } else {
+        // Read-only or full filesystem: keep the in-RAM index and try again next time
+        ok = false;
+    }
+    sidecar_close();
+    if (ok) ix->dirty = false;
+    return ok;
+}
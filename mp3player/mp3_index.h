@@ -0,0 +1,34 @@
+// mp3_index.h : Compact frame -> byte offset index for seeking
+// Holds the offset of every `stride`-th frame. Entries are appended in frame order as
+// frames are seen (playback or a header-only scan); when the table fills, every other
+// entry is dropped and the stride doubles, so any file length fits in fixed RAM and a
+// lookup never needs more than `stride` frame headers walked forward.
+// The table can be saved next to the MP3 as "<file>.idx" so later opens skip the scan.
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#define MP3_INDEX_MAX 1024   // entries (4KB)
+
+typedef struct {
+    uint32_t stride;        // frames between entries
+    uint32_t count;         // off[i] is the byte offset of frame i*stride, for i < count
+    uint32_t total_frames;  // frames in the file once a pass reached EOF, else 0
+    bool     dirty;         // changed since loaded/saved
+    uint32_t off[MP3_INDEX_MAX];
+} mp3_index_t;
+
+// Empty index (stride 1) whose first entry is frame 0 at `first_off`
+void mp3_index_reset(mp3_index_t* ix, uint32_t first_off);
+// Record that `frame` starts at `offset`. Only extends the table (frames at or below the
+// last entry are ignored), so callers can report every frame they walk past.
+void mp3_index_note(mp3_index_t* ix, uint32_t frame, uint32_t offset);
+// Nearest entry at or before `frame`: its frame number and byte offset.
+void mp3_index_lookup(const mp3_index_t* ix, uint32_t frame, uint32_t* entry_frame, uint32_t* offset);
+// Last frame the table reaches exactly (without walking past it)
+static inline uint32_t mp3_index_last_frame(const mp3_index_t* ix) { return (ix->count - 1) * ix->stride; }
+
+// Sidecar persistence (VM context). `file_size` guards against a stale index. Failures
+// (missing file, read-only filesystem) just return false.
+bool mp3_index_load(mp3_index_t* ix, const char* mp3_path, uint32_t file_size);
+bool mp3_index_save(mp3_index_t* ix, const char* mp3_path, uint32_t file_size);
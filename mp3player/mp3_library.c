@@ -0,0 +1,458 @@
+// mp3_library.c : Persistent music library index for a directory tree
+#include "mp3_library.h"
+#include <string.h>
+#include <stddef.h>
+#include "py/runtime.h"
+#include "py/mperrno.h"
+#include "vfs_bridge.h"
+
+#define LIB_MAGIC    0x42494C4Du   // "MLIB" little-endian
+#define LIB_VERSION  1
+#define LIB_TMP      ".tmp"
+#define LIB_ENTRY_MAX (sizeof(mp3_lib_rec_t) + MP3_LIB_PATH + 3 * MP3_META_TEXT)
+
+typedef struct {
+    uint32_t magic, version, count;
+    uint32_t tab[3];
+} lib_header_t;
+
+typedef struct {
+    uint32_t hash, off;
+} lib_path_t;
+
+typedef struct {
+    uint8_t  key[MP3_LIB_KEY];
+    uint32_t off;
+} lib_key_t;
+
+// ===== Helpers =====
+static uint32_t fnv1a(const char* s){
+    uint32_t h = 2166136261u;
+    while (*s) { h ^= (uint8_t)*s++; h *= 16777619u; }
+    return h;
+}
+
+static inline uint8_t fold(uint8_t c){ return (c >= 'A' && c <= 'Z') ? (uint8_t)(c + 32) : c; }
+
+static void make_key(uint8_t* key, const char* s, size_t n){
+    size_t i = 0;
+    for (; i < MP3_LIB_KEY && i < n && s[i]; i++) key[i] = fold((uint8_t)s[i]);
+    for (; i < MP3_LIB_KEY; i++) key[i] = 0;
+}
+
+static bool contains(const char* hay, const char* needle){
+    size_t n = strlen(needle);
+    if (!n) return true;
+    for (; *hay; hay++) {
+        size_t i = 0;
+        while (i < n && hay[i] && fold((uint8_t)hay[i]) == fold((uint8_t)needle[i])) i++;
+        if (i == n) return true;
+    }
+    return false;
+}
+
+static bool is_mp3(const char* name){
+    size_t n = strlen(name);
+    return n > 4 && name[n - 4] == '.' && fold((uint8_t)name[n - 3]) == 'm' &&
+           fold((uint8_t)name[n - 2]) == 'p' && name[n - 1] == '3';
+}
+
+// ===== Reader =====
+// Bytes from `pos` on through the window; *avail is how many (0 past the end)
+static const uint8_t* lib_at(mp3_lib_t* l, uint32_t pos, int n, int* avail){
+    uint32_t w_end = l->off + (uint32_t)l->len;
+    if (pos < l->off || pos > w_end || (pos + (uint32_t)n > w_end && w_end < l->size)) {
+        l->off = pos;
+        l->len = 0;
+        if (pos < l->size && vfs_seek(l->file, pos)) {
+            while (l->len < MP3_LIB_WIN) {
+                int got = vfs_read(l->file, l->buf + l->len, MP3_LIB_WIN - l->len);
+                if (got <= 0) break;
+                l->len += got;
+            }
+        }
+    }
+    *avail = (int)(l->off + (uint32_t)l->len - pos);
+    if (*avail < 0) *avail = 0;
+    return l->buf + (pos - l->off);
+}
+
+static uint32_t lib_u32(mp3_lib_t* l, uint32_t pos){
+    int avail;
+    const uint8_t* p = lib_at(l, pos, 4, &avail);
+    if (avail < 4) return 0;
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+// Entry at `off`; *next is the offset after it
+static bool entry_at(mp3_lib_t* l, uint32_t off, mp3_lib_entry_t* e, uint32_t* next){
+    int avail;
+    const uint8_t* p = lib_at(l, off, (int)LIB_ENTRY_MAX, &avail);
+    if (avail < (int)sizeof(mp3_lib_rec_t)) return false;
+    memcpy(&e->rec, p, sizeof(mp3_lib_rec_t));
+    char* dst[4] = { e->path, e->title, e->artist, e->album };
+    size_t cap[4] = { MP3_LIB_PATH, MP3_META_TEXT, MP3_META_TEXT, MP3_META_TEXT };
+    size_t at = sizeof(mp3_lib_rec_t);
+    for (int k = 0; k < 4; k++) {
+        const uint8_t* s = p + at;
+        size_t room = (size_t)avail - at, max = room < cap[k] ? room : cap[k];
+        const uint8_t* z = memchr(s, 0, max);
+        if (!z) return false;
+        memcpy(dst[k], s, (size_t)(z - s) + 1);
+        at += (size_t)(z - s) + 1;
+    }
+    *next = off + (uint32_t)at;
+    return true;
+}
+
+bool mp3_lib_open(mp3_lib_t* lib, const char* index){
+    memset(lib, 0, offsetof(mp3_lib_t, buf));
+    lib->file = MP_OBJ_NULL;
+    bool ok = false;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        if (vfs_open_rb(index, &lib->file)) {
+            int32_t sz = vfs_size(lib->file);
+            lib->size = sz > 0 ? (uint32_t)sz : 0;
+            int avail;
+            lib_header_t h;
+            const uint8_t* p = lib_at(lib, 0, sizeof(h), &avail);
+            if (avail >= (int)sizeof(h)) {
+                memcpy(&h, p, sizeof(h));
+                ok = h.magic == LIB_MAGIC && h.version == LIB_VERSION &&
+                     h.tab[2] + h.count * sizeof(lib_key_t) <= lib->size;
+                lib->count = h.count;
+                memcpy(lib->tab, h.tab, sizeof(lib->tab));
+            }
+        }
+        nlr_pop();
+    } else {
+        // No index yet (ENOENT)
+        ok = false;
+    }
+    if (!ok) mp3_lib_close(lib);
+    return ok;
+}
+
+void mp3_lib_close(mp3_lib_t* lib){
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        vfs_close(&lib->file);
+        nlr_pop();
+    }
+    lib->file = MP_OBJ_NULL;
+}
+
+static uint32_t entry_off(mp3_lib_t* lib, mp3_lib_order_t order, uint32_t pos){
+    if (order == MP3_LIB_BY_PATH) return lib_u32(lib, lib->tab[0] + pos * sizeof(lib_path_t) + 4);
+    return lib_u32(lib, lib->tab[order] + pos * sizeof(lib_key_t) + MP3_LIB_KEY);
+}
+
+bool mp3_lib_get(mp3_lib_t* lib, mp3_lib_order_t order, uint32_t pos, mp3_lib_entry_t* e){
+    if (pos >= lib->count || (unsigned)order > MP3_LIB_BY_ARTIST) return false;
+    uint32_t next;
+    return entry_at(lib, entry_off(lib, order, pos), e, &next);
+}
+
+uint32_t mp3_lib_find(mp3_lib_t* lib, mp3_lib_order_t order, const char* prefix){
+    if (order != MP3_LIB_BY_TITLE && order != MP3_LIB_BY_ARTIST) return 0;
+    uint8_t want[MP3_LIB_KEY];
+    make_key(want, prefix, strlen(prefix));
+    uint32_t lo = 0, hi = lib->count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        int avail;
+        const uint8_t* k = lib_at(lib, lib->tab[order] + mid * sizeof(lib_key_t), MP3_LIB_KEY, &avail);
+        if (avail < MP3_LIB_KEY) break;
+        if (memcmp(k, want, MP3_LIB_KEY) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+bool mp3_lib_search(mp3_lib_t* lib, const char* text, uint32_t* cursor, mp3_lib_entry_t* e){
+    uint32_t off = *cursor < sizeof(lib_header_t) ? sizeof(lib_header_t) : *cursor;
+    while (off < lib->tab[0]) {
+        uint32_t next;
+        if (!entry_at(lib, off, e, &next)) break;
+        off = next;
+        if (contains(e->title, text) || contains(e->artist, text) ||
+            contains(e->album, text) || contains(e->path, text)) {
+            *cursor = off;
+            return true;
+        }
+    }
+    *cursor = lib->tab[0];
+    return false;
+}
+
+// ===== Scan =====
+typedef struct {
+    uint32_t hash, off;
+    uint8_t  tkey[MP3_LIB_KEY], akey[MP3_LIB_KEY];
+} lib_new_t;
+
+typedef struct {
+    // Output, written through a small buffer
+    mp_obj_t   out;
+    uint32_t   out_off;
+    int        out_len;
+    uint8_t    out_buf[512];
+    // Previous index: its path table, sorted by hash
+    mp3_lib_t  old;
+    lib_path_t* old_tab;
+    uint32_t   old_n, matched;
+    // New entries
+    lib_new_t* tracks;
+    uint32_t   n, cap;
+    uint16_t*  ord;
+    char       path[MP3_LIB_PATH];
+    mp3_lib_entry_t e;
+    mp3_meta_t meta;
+    mp3_lib_scan_t* stats;
+} lib_scan_t;
+
+static void out_flush(lib_scan_t* c){
+    if (c->out_len && vfs_write(c->out, c->out_buf, (size_t)c->out_len) != c->out_len) {
+        mp_raise_OSError(MP_EIO);
+    }
+    c->out_len = 0;
+}
+
+static void out_put(lib_scan_t* c, const void* data, size_t n){
+    const uint8_t* p = (const uint8_t*)data;
+    c->out_off += (uint32_t)n;
+    while (n) {
+        size_t k = sizeof(c->out_buf) - (size_t)c->out_len;
+        if (k > n) k = n;
+        memcpy(c->out_buf + c->out_len, p, k);
+        c->out_len += (int)k;
+        p += k; n -= k;
+        if (c->out_len == (int)sizeof(c->out_buf)) out_flush(c);
+    }
+}
+
+// Shell sort of `ord` by (key, walk position), so equal keys keep walk order
+static inline bool key_less(const lib_scan_t* c, int which, uint16_t a, uint16_t b){
+    const uint8_t* ka = which ? c->tracks[a].akey : c->tracks[a].tkey;
+    const uint8_t* kb = which ? c->tracks[b].akey : c->tracks[b].tkey;
+    int d = memcmp(ka, kb, MP3_LIB_KEY);
+    return d < 0 || (d == 0 && a < b);
+}
+
+static void sort_ord(lib_scan_t* c, int which){
+    uint32_t gap = 1;
+    while (gap < c->n / 3) gap = gap * 3 + 1;
+    for (; gap; gap /= 3) {
+        for (uint32_t i = gap; i < c->n; i++) {
+            uint16_t v = c->ord[i];
+            uint32_t j = i;
+            while (j >= gap && key_less(c, which, v, c->ord[j - gap])) { c->ord[j] = c->ord[j - gap]; j -= gap; }
+            c->ord[j] = v;
+        }
+    }
+}
+
+static void old_load(lib_scan_t* c, const char* index){
+    if (!mp3_lib_open(&c->old, index)) return;
+    c->old_n = c->old.count;
+    c->old_tab = m_new(lib_path_t, c->old_n ? c->old_n : 1);
+    for (uint32_t i = 0; i < c->old_n; i++) {
+        c->old_tab[i].hash = lib_u32(&c->old, c->old.tab[0] + i * sizeof(lib_path_t));
+        c->old_tab[i].off = lib_u32(&c->old, c->old.tab[0] + i * sizeof(lib_path_t) + 4);
+    }
+    // Shell sort by hash, for the lookups in old_lookup
+    uint32_t gap = 1;
+    while (gap < c->old_n / 3) gap = gap * 3 + 1;
+    for (; gap; gap /= 3) {
+        for (uint32_t i = gap; i < c->old_n; i++) {
+            lib_path_t v = c->old_tab[i];
+            uint32_t j = i;
+            while (j >= gap && c->old_tab[j - gap].hash > v.hash) { c->old_tab[j] = c->old_tab[j - gap]; j -= gap; }
+            c->old_tab[j] = v;
+        }
+    }
+}
+
+// Old entry for the current path, if any: true with c->e filled
+static bool old_lookup(lib_scan_t* c, uint32_t hash){
+    uint32_t lo = 0, hi = c->old_n;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (c->old_tab[mid].hash < hash) lo = mid + 1;
+        else hi = mid;
+    }
+    for (; lo < c->old_n && c->old_tab[lo].hash == hash; lo++) {
+        uint32_t next;
+        if (entry_at(&c->old, c->old_tab[lo].off, &c->e, &next) && !strcmp(c->e.path, c->path)) return true;
+    }
+    return false;
+}
+
+static void add_track(lib_scan_t* c){
+    if (c->n == MP3_LIB_MAX) return;
+    uint32_t size, mtime;
+    if (!vfs_stat(c->path, &size, &mtime)) return;
+    uint32_t hash = fnv1a(c->path);
+    mp3_lib_entry_t* e = &c->e;
+    bool found = old_lookup(c, hash);
+    if (found) c->matched++;
+    if (found && e->rec.size == size && e->rec.mtime == mtime) {
+        c->stats->reused++;
+    } else {
+        if (!mp3_meta_read(c->path, &c->meta)) return;   // no audio frames: not listed
+        c->stats->parsed++;
+        memset(&e->rec, 0, sizeof(e->rec));
+        e->rec.duration_ms = c->meta.duration_ms;
+        e->rec.sample_rate = c->meta.sample_rate;
+        e->rec.kbps = (uint16_t)c->meta.kbps;
+        e->rec.channels = c->meta.channels;
+        e->rec.vbr = c->meta.vbr;
+        strcpy(e->path, c->path);
+        memcpy(e->title, c->meta.title, MP3_META_TEXT);
+        memcpy(e->artist, c->meta.artist, MP3_META_TEXT);
+        memcpy(e->album, c->meta.album, MP3_META_TEXT);
+    }
+    e->rec.hash = hash;
+    e->rec.size = size;
+    e->rec.mtime = mtime;
+
+    if (c->n == c->cap) {
+        uint32_t cap = c->cap ? c->cap * 2 : 64;
+        if (cap > MP3_LIB_MAX) cap = MP3_LIB_MAX;
+        c->tracks = m_renew(lib_new_t, c->tracks, c->cap, cap);
+        c->cap = cap;
+    }
+    lib_new_t* t = &c->tracks[c->n++];
+    t->hash = hash;
+    t->off = c->out_off;
+    if (e->title[0]) {
+        make_key(t->tkey, e->title, MP3_META_TEXT);
+    } else {
+        // Untagged: sort by file name
+        const char* base = strrchr(e->path, '/');
+        base = base ? base + 1 : e->path;
+        make_key(t->tkey, base, strlen(base) - 4);
+    }
+    if (e->artist[0]) make_key(t->akey, e->artist, MP3_META_TEXT);
+    else memset(t->akey, 0xFF, MP3_LIB_KEY);
+
+    out_put(c, &e->rec, sizeof(e->rec));
+    out_put(c, e->path, strlen(e->path) + 1);
+    out_put(c, e->title, strlen(e->title) + 1);
+    out_put(c, e->artist, strlen(e->artist) + 1);
+    out_put(c, e->album, strlen(e->album) + 1);
+}
+
+// Depth-first over c->path (`len` long); names are appended in place
+static void walk(lib_scan_t* c, size_t len, int depth){
+    mp_obj_t it = MP_OBJ_NULL;
+    if (!vfs_dir_open(c->path, &it)) return;
+    size_t base = len;
+    if (base == 0 || c->path[base - 1] != '/') c->path[base++] = '/';
+    bool is_dir;
+    while (base + 1 < MP3_LIB_PATH && vfs_dir_next(it, c->path + base, MP3_LIB_PATH - base, &is_dir)) {
+        const char* name = c->path + base;
+        size_t n = strlen(name);
+        if (name[0] == '.' || base + n + 1 >= MP3_LIB_PATH) continue;   // hidden, or too long
+        if (is_dir) {
+            if (depth < MP3_LIB_DEPTH) walk(c, base + n, depth + 1);
+        } else if (is_mp3(name)) {
+            add_track(c);
+        }
+    }
+    vfs_dir_close(&it);
+    c->path[len] = '\0';
+}
+
+static void scan_cleanup(lib_scan_t* c, const char* tmp, bool failed){
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        vfs_close(&c->out);
+        if (failed) vfs_remove(tmp);
+        nlr_pop();
+    }
+    c->out = MP_OBJ_NULL;
+    mp3_lib_close(&c->old);
+    if (c->old_tab) m_del(lib_path_t, c->old_tab, c->old_n ? c->old_n : 1);
+    if (c->tracks) m_del(lib_new_t, c->tracks, c->cap);
+    if (c->ord) m_del(uint16_t, c->ord, c->n ? c->n : 1);
+}
+
+static void scan_write(lib_scan_t* c, const char* tmp){
+    lib_header_t h;
+    memset(&h, 0, sizeof(h));
+    if (!vfs_open_wb(tmp, &c->out)) mp_raise_OSError(MP_EIO);
+    out_put(c, &h, sizeof(h));      // rewritten at the end
+    size_t root_len = strlen(c->path);
+    walk(c, root_len, 0);
+
+    h.magic = LIB_MAGIC;
+    h.version = LIB_VERSION;
+    h.count = c->n;
+    h.tab[MP3_LIB_BY_PATH] = c->out_off;
+    for (uint32_t i = 0; i < c->n; i++) {
+        lib_path_t p = { c->tracks[i].hash, c->tracks[i].off };
+        out_put(c, &p, sizeof(p));
+    }
+    c->ord = m_new(uint16_t, c->n ? c->n : 1);
+    for (int which = 0; which < 2; which++) {
+        h.tab[MP3_LIB_BY_TITLE + which] = c->out_off;
+        for (uint32_t i = 0; i < c->n; i++) c->ord[i] = (uint16_t)i;
+        sort_ord(c, which);
+        for (uint32_t i = 0; i < c->n; i++) {
+            const lib_new_t* t = &c->tracks[c->ord[i]];
+            lib_key_t k;
+            memcpy(k.key, which ? t->akey : t->tkey, MP3_LIB_KEY);
+            k.off = t->off;
+            out_put(c, &k, sizeof(k));
+        }
+    }
+    out_flush(c);
+    if (!vfs_seek(c->out, 0) || vfs_write(c->out, (const uint8_t*)&h, sizeof(h)) != (int)sizeof(h)) {
+        mp_raise_OSError(MP_EIO);
+    }
+}
+
+void mp3_lib_scan(const char* root, const char* index, mp3_lib_scan_t* out){
+    char tmp[MP3_LIB_PATH + sizeof(LIB_TMP)];
+    size_t ilen = strlen(index), rlen = strlen(root);
+    if (ilen >= MP3_LIB_PATH || rlen >= MP3_LIB_PATH - 2) mp_raise_OSError(MP_EIO);
+    memcpy(tmp, index, ilen);
+    memcpy(tmp + ilen, LIB_TMP, sizeof(LIB_TMP));
+
+    memset(out, 0, sizeof(*out));
+    lib_scan_t* c = m_new(lib_scan_t, 1);
+    memset(c, 0, sizeof(*c));
+    c->out = MP_OBJ_NULL;
+    c->old.file = MP_OBJ_NULL;
+    c->stats = out;
+    memcpy(c->path, root, rlen + 1);
+    // Strip a trailing slash (but keep "/")
+    if (rlen > 1 && c->path[rlen - 1] == '/') c->path[rlen - 1] = '\0';
+
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        old_load(c, index);
+        scan_write(c, tmp);
+        nlr_pop();
+    } else {
+        scan_cleanup(c, tmp, true);
+        m_del(lib_scan_t, c, 1);
+        nlr_jump(nlr.ret_val);
+    }
+    out->tracks = c->n;
+    out->removed = c->old_n - c->matched;
+    scan_cleanup(c, tmp, false);
+    m_del(lib_scan_t, c, 1);
+
+    // Replace the old index; a missing one is fine
+    nlr_buf_t nlr2;
+    if (nlr_push(&nlr2) == 0) {
+        vfs_remove(index);
+        nlr_pop();
+    }
+    vfs_rename(tmp, index);
+}
@@ -0,0 +1,83 @@
+// mp3_library.h : Persistent music library index for a directory tree
+// mp3_lib_scan walks a tree once and writes every .mp3 it finds (path, size, mtime,
+// length, rate, tags from mp3_meta) into one index file, plus tables sorted by title
+// and by artist. A rescan copies entries whose size and mtime are unchanged from the
+// old index and only parses new or changed files. Listing, jumping to a letter and
+// searching then read that one file instead of opening every track.
+//
+// File layout (little-endian):
+//   header   magic "MLIB", version, count, offsets of the three tables
+//   entries  mp3_lib_rec_t followed by path, title, artist, album (NUL-terminated)
+//   by path  { hash, entry offset } per track, in walk order
+//   by title { 12-byte key, entry offset }, sorted; the key is the first 12 characters
+//            of the title (the file name if untagged), ASCII case-folded
+//   by artist the same with the artist (untagged last); ties stay in walk order, so an
+//            artist's albums keep their folder and track order
+//
+// Building holds about 40 bytes of GC heap per track; reading needs a 1.5 KB buffer.
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "py/obj.h"
+#include "mp3_meta.h"
+
+#define MP3_LIB_NAME      ".mp3lib"   // default index name, in the scanned root
+#define MP3_LIB_PATH      256         // longest path indexed, with terminator
+#define MP3_LIB_DEPTH     8           // directory levels below the root
+#define MP3_LIB_MAX       65535       // tracks
+#define MP3_LIB_KEY       12
+
+typedef enum { MP3_LIB_BY_PATH = 0, MP3_LIB_BY_TITLE, MP3_LIB_BY_ARTIST } mp3_lib_order_t;
+
+typedef struct {
+    uint32_t tracks;        // in the new index
+    uint32_t parsed;        // new or changed files read with mp3_meta
+    uint32_t reused;        // copied from the old index
+    uint32_t removed;       // in the old index but gone
+} mp3_lib_scan_t;
+
+// Stored per entry, ahead of its strings
+typedef struct {
+    uint32_t hash;          // FNV-1a of the path
+    uint32_t size, mtime;
+    uint32_t duration_ms;
+    uint32_t sample_rate;
+    uint16_t kbps;
+    uint8_t  channels;
+    uint8_t  vbr;
+} mp3_lib_rec_t;
+
+typedef struct {
+    mp3_lib_rec_t rec;
+    char path[MP3_LIB_PATH];
+    char title[MP3_META_TEXT];
+    char artist[MP3_META_TEXT];
+    char album[MP3_META_TEXT];
+} mp3_lib_entry_t;
+
+// Walk `root` and write the index to `index` (VM context). Raises on I/O errors.
+void mp3_lib_scan(const char* root, const char* index, mp3_lib_scan_t* out);
+
+// Reader: one open index with a small read window
+#define MP3_LIB_WIN 1024
+typedef struct {
+    mp_obj_t file;
+    uint32_t count;
+    uint32_t tab[3];        // table offsets, by mp3_lib_order_t
+    uint32_t size;
+    uint32_t off;           // window
+    int      len;
+    uint8_t  buf[MP3_LIB_WIN];
+} mp3_lib_t;
+
+// Open an index; false if missing or not an index. Reads raise on I/O errors, so the
+// caller closes it from its own nlr handler.
+bool     mp3_lib_open(mp3_lib_t* lib, const char* index);
+void     mp3_lib_close(mp3_lib_t* lib);
+// Entry at position `pos` of `order`
+bool     mp3_lib_get(mp3_lib_t* lib, mp3_lib_order_t order, uint32_t pos, mp3_lib_entry_t* e);
+// First position of `order` (title or artist) whose key is not below `prefix`'s
+uint32_t mp3_lib_find(mp3_lib_t* lib, mp3_lib_order_t order, const char* prefix);
+// Sequential search: next entry at or after *cursor (start at 0) whose path, title,
+// artist or album contains `text` (ASCII case-insensitive). False at the end.
+bool     mp3_lib_search(mp3_lib_t* lib, const char* text, uint32_t* cursor, mp3_lib_entry_t* e);
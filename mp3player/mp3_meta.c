@@ -0,0 +1,361 @@
+// mp3_meta.c : Tags and length of an MP3 file, without decoding it
+#include "mp3_meta.h"
+#include <string.h>
+#include "py/runtime.h"
+#include "vfs_bridge.h"
+
+// ===== Frame header =====
+static const uint16_t kbps_mpeg1[15] = { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 };
+static const uint16_t kbps_mpeg2[15] = { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 };
+static const uint16_t hz_mpeg1[3] = { 44100, 48000, 32000 };
+
+bool mp3_hdr_parse(const uint8_t* h, mp3_hdr_t* out){
+    if (h[0] != 0xFF || (h[1] & 0xE0) != 0xE0) return false;
+    uint32_t ver = (h[1] >> 3) & 3;       // 0: MPEG 2.5, 2: MPEG 2, 3: MPEG 1
+    uint32_t br = h[2] >> 4, sr = (h[2] >> 2) & 3;
+    if (ver == 1 || ((h[1] >> 1) & 3) != 1 || br == 15 || sr == 3) return false;
+    bool mpeg1 = ver == 3, mono = (h[3] >> 6) == 3;
+    out->hz = hz_mpeg1[sr] >> (mpeg1 ? 0 : (ver == 2 ? 1 : 2));
+    out->kbps = mpeg1 ? kbps_mpeg1[br] : kbps_mpeg2[br];
+    out->spf = mpeg1 ? 1152 : 576;
+    out->bytes = out->kbps ? (mpeg1 ? 144000u : 72000u) * out->kbps / out->hz + ((h[2] >> 1) & 1) : 0;
+    out->channels = mono ? 1 : 2;
+    out->side = mpeg1 ? (mono ? 17 : 32) : (mono ? 9 : 17);
+    return true;
+}
+
+// ===== Xing / VBRI =====
+static uint32_t rd_be32(const uint8_t* p){ return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3]; }
+static uint32_t rd_be16(const uint8_t* p){ return ((uint32_t)p[0] << 8) | p[1]; }
+
+bool mp3_vbr_parse(const uint8_t* h, int avail, mp3_vbr_t* out){
+    memset(out, 0, sizeof(*out));
+    mp3_hdr_t hd;
+    if (avail < 4 || !mp3_hdr_parse(h, &hd)) return false;
+    const uint8_t* x = h + 4 + hd.side;
+    if (avail >= 4 + hd.side + 120 && (!memcmp(x, "Xing", 4) || !memcmp(x, "Info", 4))) {
+        out->xing = true;
+        out->vbr = x[0] == 'X';
+        uint32_t flags = rd_be32(x + 4);
+        const uint8_t* p = x + 8;
+        if (flags & 1) { out->frames = rd_be32(p); p += 4; }
+        if (flags & 2) { out->bytes = rd_be32(p); p += 4; }
+        if (flags & 4) {
+            if (out->frames && out->bytes) { memcpy(out->toc, p, 100); out->has_toc = true; }
+            p += 100;
+        }
+        if (flags & 8) p += 4;   // quality
+        // LAME extension (also written by libavcodec): encoder delay and end padding, 12 bits each
+        if (p + 24 <= h + avail && (!memcmp(p, "LAME", 4) || !memcmp(p, "Lavc", 4) || !memcmp(p, "Lavf", 4))) {
+            out->lame = true;
+            out->delay = (uint16_t)(((uint32_t)p[21] << 4) | (p[22] >> 4));
+            out->pad = (uint16_t)(((uint32_t)(p[22] & 15) << 8) | p[23]);
+        }
+        return true;
+    }
+    const uint8_t* v = h + 4 + 32;
+    if (avail >= 4 + 32 + 26 && !memcmp(v, "VBRI", 4)) {
+        out->vbr = true;
+        out->bytes  = rd_be32(v + 10);
+        out->frames = rd_be32(v + 14);
+        uint32_t entries = rd_be16(v + 18), scale = rd_be16(v + 20);
+        uint32_t esize = rd_be16(v + 22), fpe = rd_be16(v + 24);
+        if (!out->frames || !out->bytes || !fpe || esize < 1 || esize > 4 ||
+            4 + 32 + 26 + (int)(entries * esize) > avail) return true;
+        // Entries are byte sizes of consecutive `fpe`-frame groups; sum them per percent
+        const uint8_t* t = v + 26;
+        uint64_t cum = 0;
+        uint32_t e = 0;
+        for (int pct = 0; pct < 100; pct++) {
+            uint32_t group = (uint32_t)((uint64_t)out->frames * pct / 100) / fpe;
+            while (e < group && e < entries) {
+                uint32_t sz = 0;
+                for (uint32_t k = 0; k < esize; k++) sz = (sz << 8) | t[e * esize + k];
+                cum += (uint64_t)sz * scale;
+                e++;
+            }
+            uint64_t q = cum * 256 / out->bytes;
+            out->toc[pct] = (uint8_t)(q > 255 ? 255 : q);
+        }
+        out->has_toc = true;
+        return true;
+    }
+    return false;
+}
+
+// ===== Windowed reader =====
+// Everything is read through one small window; skipping a tag frame only moves `pos`,
+// so a frame that does not fit the window is never read at all.
+#define META_WIN   1024
+#define META_SYNC  16384     // bytes searched for the first frame after the tags
+
+typedef struct {
+    uint32_t size;
+    uint32_t off;            // file offset of buf[0]
+    int      len;
+    uint8_t  buf[META_WIN];
+} meta_rd_t;
+
+// Open file; at file scope so it is still known after an nlr jump
+static mp_obj_t meta_file = MP_OBJ_NULL;
+
+// Bytes from `pos` on: returns a pointer and sets *avail (0 past the end). At least `n`
+// (<= META_WIN) are available unless the file ends first.
+static const uint8_t* rd_at(meta_rd_t* r, uint32_t pos, int n, int* avail){
+    uint32_t w_end = r->off + (uint32_t)r->len;
+    if (pos < r->off || pos > w_end || (pos + (uint32_t)n > w_end && w_end < r->size)) {
+        r->off = pos;
+        r->len = 0;
+        if (pos < r->size && vfs_seek(meta_file, pos)) {
+            while (r->len < META_WIN) {
+                int got = vfs_read(meta_file, r->buf + r->len, META_WIN - r->len);
+                if (got <= 0) break;
+                r->len += got;
+            }
+        }
+    }
+    *avail = (int)(r->off + (uint32_t)r->len - pos);
+    if (*avail < 0) *avail = 0;
+    return r->buf + (pos - r->off);
+}
+
+// ===== Text =====
+static size_t put_utf8(char* dst, size_t at, size_t cap, uint32_t c){
+    uint8_t u[4];
+    size_t n;
+    if (c < 0x80) { u[0] = (uint8_t)c; n = 1; }
+    else if (c < 0x800) { u[0] = (uint8_t)(0xC0 | (c >> 6)); u[1] = (uint8_t)(0x80 | (c & 0x3F)); n = 2; }
+    else if (c < 0x10000) { u[0] = (uint8_t)(0xE0 | (c >> 12)); u[1] = (uint8_t)(0x80 | ((c >> 6) & 0x3F)); u[2] = (uint8_t)(0x80 | (c & 0x3F)); n = 3; }
+    else { u[0] = (uint8_t)(0xF0 | (c >> 18)); u[1] = (uint8_t)(0x80 | ((c >> 12) & 0x3F)); u[2] = (uint8_t)(0x80 | ((c >> 6) & 0x3F)); u[3] = (uint8_t)(0x80 | (c & 0x3F)); n = 4; }
+    if (at + n >= cap) return 0;   // whole characters only
+    memcpy(dst + at, u, n);
+    return n;
+}
+
+// ID3 text (encoding byte first) to UTF-8, first value only, truncated to `cap`
+static void id3_text(char* dst, size_t cap, const uint8_t* p, size_t n){
+    size_t at = 0;
+    dst[0] = '\0';
+    if (n < 1) return;
+    uint8_t enc = p[0];
+    p++; n--;
+    if (enc == 1 || enc == 2) {
+        // UTF-16 with BOM (1) or big-endian (2)
+        bool be = enc == 2;
+        if (enc == 1 && n >= 2) {
+            if (p[0] == 0xFE && p[1] == 0xFF) { be = true; p += 2; n -= 2; }
+            else if (p[0] == 0xFF && p[1] == 0xFE) { p += 2; n -= 2; }
+        }
+        for (size_t i = 0; i + 1 < n; i += 2) {
+            uint32_t c = be ? rd_be16(p + i) : (uint32_t)(p[i] | (p[i + 1] << 8));
+            if (c == 0) break;
+            if (c >= 0xD800 && c < 0xDC00 && i + 3 < n) {
+                uint32_t lo = be ? rd_be16(p + i + 2) : (uint32_t)(p[i + 2] | (p[i + 3] << 8));
+                if (lo >= 0xDC00 && lo < 0xE000) { c = 0x10000 + ((c - 0xD800) << 10) + (lo - 0xDC00); i += 2; }
+            }
+            size_t w = put_utf8(dst, at, cap, c);
+            if (!w) break;
+            at += w;
+        }
+    } else {
+        // ISO-8859-1 (0) or UTF-8 (3)
+        for (size_t i = 0; i < n && p[i]; i++) {
+            size_t w;
+            if (enc == 3) {
+                // Keep a multi-byte sequence whole or drop it
+                size_t len = p[i] < 0x80 ? 1 : (p[i] >> 5) == 6 ? 2 : (p[i] >> 4) == 14 ? 3 : 4;
+                if (i + len > n || at + len >= cap) break;
+                memcpy(dst + at, p + i, len);
+                w = len;
+                i += len - 1;
+            } else {
+                w = put_utf8(dst, at, cap, p[i]);
+            }
+            if (!w) break;
+            at += w;
+        }
+    }
+    dst[at] = '\0';
+}
+
+// Fixed-width ID3v1 field: Latin-1, space or NUL padded
+static void v1_text(char* dst, const uint8_t* p, size_t n){
+    size_t at = 0;
+    while (n && (p[n - 1] == ' ' || p[n - 1] == 0)) n--;
+    for (size_t i = 0; i < n && p[i]; i++) {
+        size_t w = put_utf8(dst, at, MP3_META_TEXT, p[i]);
+        if (!w) break;
+        at += w;
+    }
+    dst[at] = '\0';
+}
+
+// ===== ID3v2 =====
+static uint32_t synchsafe(const uint8_t* p){
+    return ((uint32_t)(p[0] & 0x7f) << 21) | ((uint32_t)(p[1] & 0x7f) << 14) | ((uint32_t)(p[2] & 0x7f) << 7) | (p[3] & 0x7f);
+}
+
+// Undo unsynchronisation (FF 00 -> FF) in place; returns the new length
+static size_t unsync(uint8_t* p, size_t n){
+    size_t o = 0;
+    for (size_t i = 0; i < n; i++) {
+        p[o++] = p[i];
+        if (p[i] == 0xFF && i + 1 < n && p[i + 1] == 0) i++;
+    }
+    return o;
+}
+
+// Text frames of the tag at `pos` into the empty fields of `m`; returns the tag length
+static uint32_t id3v2_read(meta_rd_t* r, uint32_t pos, mp3_meta_t* m){
+    int avail;
+    const uint8_t* h = rd_at(r, pos, 10, &avail);
+    uint8_t ver = h[3], flags = h[5];
+    uint32_t size = synchsafe(h + 6);
+    uint32_t end = pos + 10 + size, total = 10 + size + ((ver >= 4 && (flags & 0x10)) ? 10 : 0);
+    if (ver < 2 || ver > 4) return total;
+    bool tag_unsync = (flags & 0x80) != 0;
+    uint32_t p = pos + 10;
+    if (ver >= 3 && (flags & 0x40)) {
+        // Extended header: v2.3 size excludes its own 4 bytes, v2.4 is synchsafe and includes them
+        const uint8_t* e = rd_at(r, p, 4, &avail);
+        if (avail < 4) return total;
+        p += ver == 3 ? 4 + rd_be32(e) : synchsafe(e);
+    }
+    int hdr = ver == 2 ? 6 : 10;
+    while (p + (uint32_t)hdr <= end) {
+        uint8_t fh[10];
+        const uint8_t* f = rd_at(r, p, hdr, &avail);
+        if (avail < hdr || f[0] == 0) break;      // padding
+        memcpy(fh, f, (size_t)hdr);
+        uint32_t len;
+        char* field = NULL;
+        bool frame_unsync = tag_unsync;
+        if (ver == 2) {
+            len = ((uint32_t)fh[3] << 16) | ((uint32_t)fh[4] << 8) | fh[5];
+            if (!memcmp(fh, "TT2", 3)) field = m->title;
+            else if (!memcmp(fh, "TP1", 3)) field = m->artist;
+            else if (!memcmp(fh, "TAL", 3)) field = m->album;
+        } else {
+            len = ver == 4 ? synchsafe(fh + 4) : rd_be32(fh + 4);
+            if (ver == 4) frame_unsync = (fh[9] & 0x02) != 0;
+            // Compressed or encrypted frames are skipped like any other
+            bool plain = ver == 4 ? !(fh[9] & 0x0C) : !(fh[9] & 0xC0);
+            if (plain) {
+                if (!memcmp(fh, "TIT2", 4)) field = m->title;
+                else if (!memcmp(fh, "TPE1", 4)) field = m->artist;
+                else if (!memcmp(fh, "TALB", 4)) field = m->album;
+            }
+        }
+        uint32_t body = p + (uint32_t)hdr;
+        if (len > end - body) break;              // corrupt size
+        if (field && !field[0] && len) {
+            // A few hundred bytes at most make a displayable field
+            size_t n = len < META_WIN / 2 ? len : META_WIN / 2;
+            uint8_t text[META_WIN / 2];
+            const uint8_t* t = rd_at(r, body, (int)n, &avail);
+            if ((size_t)avail < n) break;
+            memcpy(text, t, n);
+            if (frame_unsync) n = unsync(text, n);
+            id3_text(field, MP3_META_TEXT, text, n);
+        }
+        p = body + len;                            // seek over the rest (APIC etc.)
+    }
+    return total;
+}
+
+// ===== Public =====
+static bool meta_scan(meta_rd_t* r, mp3_meta_t* m){
+    int avail;
+    uint32_t pos = 0;
+    // One or more ID3v2 tags
+    for (;;) {
+        const uint8_t* h = rd_at(r, pos, 10, &avail);
+        if (avail < 10 || memcmp(h, "ID3", 3) != 0) break;
+        pos += id3v2_read(r, pos, m);
+    }
+    // ID3v1 for whatever ID3v2 did not give
+    uint32_t end = r->size;
+    if (r->size >= 128 + pos) {
+        const uint8_t* t = rd_at(r, r->size - 128, 128, &avail);
+        if (avail >= 128 && !memcmp(t, "TAG", 3)) {
+            uint8_t v1[128];
+            memcpy(v1, t, 128);
+            if (!m->title[0]) v1_text(m->title, v1 + 3, 30);
+            if (!m->artist[0]) v1_text(m->artist, v1 + 33, 30);
+            if (!m->album[0]) v1_text(m->album, v1 + 63, 30);
+            end -= 128;
+        }
+    }
+    // First frame: a header whose successor is also one, so stray FFs in junk do not count
+    mp3_hdr_t hd;
+    uint32_t first = 0;
+    bool found = false;
+    for (uint32_t s = pos; s < pos + META_SYNC && s + 4 <= end && !found; ) {
+        const uint8_t* w = rd_at(r, s, 4, &avail);
+        if (avail < 4) break;
+        for (int i = 0; i + 4 <= avail && s + (uint32_t)i + 4 <= end; i++) {
+            if (w[i] != 0xFF || !mp3_hdr_parse(w + i, &hd) || !hd.bytes) continue;
+            uint32_t at = s + (uint32_t)i;
+            mp3_hdr_t next;
+            int na;
+            if (at + hd.bytes + 4 <= end) {
+                const uint8_t* nx = rd_at(r, at + hd.bytes, 4, &na);
+                bool ok = na >= 4 && mp3_hdr_parse(nx, &next) && next.hz == hd.hz;
+                w = rd_at(r, s, 4, &avail);       // the window may have moved
+                if (!ok) continue;
+            }
+            first = at;
+            found = true;
+            break;
+        }
+        if (!found) s += (uint32_t)(avail > 3 ? avail - 3 : 1);
+    }
+    if (!found) return false;
+
+    m->sample_rate = hd.hz;
+    m->channels = hd.channels;
+    mp3_vbr_t v;
+    const uint8_t* f = rd_at(r, first, META_WIN, &avail);
+    if (mp3_vbr_parse(f, avail, &v) && v.frames) {
+        uint64_t samples = (uint64_t)v.frames * hd.spf;
+        if (v.lame && samples > (uint64_t)v.delay + v.pad) samples -= (uint64_t)v.delay + v.pad;
+        m->duration_ms = (uint32_t)(samples * 1000u / hd.hz);
+        m->vbr = v.vbr;
+        uint32_t bytes = v.bytes ? v.bytes : end - first;
+        uint64_t us = (uint64_t)v.frames * hd.spf * 1000000u / hd.hz;
+        m->kbps = us ? (uint32_t)((uint64_t)bytes * 8000u / us) : hd.kbps;
+    } else {
+        // No header: constant bitrate assumed
+        m->vbr = v.vbr;
+        m->kbps = hd.kbps;
+        m->duration_ms = (uint32_t)((uint64_t)(end - first) * 8u / hd.kbps);
+    }
+    return true;
+}
+
+bool mp3_meta_read(const char* path, mp3_meta_t* out){
+    memset(out, 0, sizeof(*out));
+    meta_rd_t r;
+    r.off = 0;
+    r.len = 0;
+    bool ok = false;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        if (vfs_open_rb(path, &meta_file)) {
+            int32_t sz = vfs_size(meta_file);
+            r.size = sz > 0 ? (uint32_t)sz : 0;
+            ok = meta_scan(&r, out);
+        }
+        nlr_pop();
+    } else {
+        // Missing or unreadable file
+        ok = false;
+    }
+    nlr_buf_t nlr2;
+    if (nlr_push(&nlr2) == 0) {
+        vfs_close(&meta_file);
+        nlr_pop();
+    }
+    meta_file = MP_OBJ_NULL;
+    return ok;
+}
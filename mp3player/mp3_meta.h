@@ -0,0 +1,55 @@
+// mp3_meta.h : Tags and length of an MP3 file, without decoding it
+// Reads the ID3v2 tag frame by frame through a small window, seeking over everything it
+// does not need (APIC cover art, lyrics, padding), falls back to ID3v1 at the end of the
+// file, then takes the length from the first frame's Xing/Info or VBRI header (or the
+// CBR bitrate). A few KB of reads per file whatever the tag holds, and the player's
+// decoder is not involved, so a browser can list a directory while a track plays.
+//
+// The frame header and Xing/VBRI parsers are shared with the decoder.
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MP3_META_TEXT 64    // bytes per text field, UTF-8 with terminator
+
+typedef struct {
+    char     title[MP3_META_TEXT];     // "" when the tags have none
+    char     artist[MP3_META_TEXT];
+    char     album[MP3_META_TEXT];
+    uint32_t duration_ms;
+    uint32_t kbps;                     // average over the file for VBR
+    bool     vbr;                      // Xing or VBRI header says VBR
+    uint32_t sample_rate;
+    uint8_t  channels;
+} mp3_meta_t;
+
+// Fill `out` from the file at `path` (VM context). False if it cannot be opened or no
+// MPEG audio frame follows the tags.
+bool mp3_meta_read(const char* path, mp3_meta_t* out);
+
+// ===== Shared parsers =====
+typedef struct {
+    uint32_t hz;
+    uint32_t kbps;          // 0 for free format
+    uint32_t spf;           // samples per channel per frame
+    uint32_t bytes;         // frame length including the header (0 for free format)
+    uint8_t  channels;
+    uint8_t  side;          // side info bytes after the header
+} mp3_hdr_t;
+
+// Layer III header at `h` (4 bytes); false if it is not one
+bool mp3_hdr_parse(const uint8_t* h, mp3_hdr_t* out);
+
+typedef struct {
+    bool     xing;          // Xing/Info (else VBRI)
+    bool     vbr;           // "Xing" or VBRI; "Info" marks a CBR file
+    uint32_t frames;        // audio frames, 0 if absent
+    uint32_t bytes;         // audio bytes, 0 if absent
+    bool     has_toc;
+    uint8_t  toc[100];      // Xing form: position in 1/256 of `bytes` at each percent
+    bool     lame;          // LAME/Lavc extension: gapless delay and padding
+    uint16_t delay, pad;
+} mp3_vbr_t;
+
+// Xing/Info or VBRI header in the frame at `h` (`avail` bytes readable from `h`)
+bool mp3_vbr_parse(const uint8_t* h, int avail, mp3_vbr_t* out);
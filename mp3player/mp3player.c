@@ -6,54 +6,280 @@
 
 #include "mp3_decode.h"
 #include "ring_buffer.h"
-#include "audio_out_pwm.h"
+#include "pcm_ring.h"
+#include "audio_out.h"
+#include "mixer.h"
+#include "decode_sched.h"
+#include "mp3_meta.h"
+#include "mp3_library.h"
+#include "audio_trace.h"
+#include "core1_sched.h"
 #include "hardware/timer.h"
-#include "hardware/irq.h"
 #include "pico/stdlib.h"
 
 
 typedef enum { S_IDLE=0, S_LOADED, S_PLAYING, S_EOF } mp3_state_t;
 
+#define MIX_MUSIC  0    // mixer voice for the player (and test_tone); 1.. are effects
+#define SAMPLE_BANK_MAX 16   // registered PCM effects (mp3.sample)
+#define QUEUE_MAX      8     // tracks waiting behind the current one (enqueue)
+#define QUEUE_PATH_MAX 128   // same limit as the decoder's own path copy
+
+// Memory for init(buffer="static"): reserved at link time, outside the GC heap.
+// Set from CMake (MP3_STATIC_RING_BYTES); 0 leaves the option out.
+#ifndef MP3_STATIC_RING_BYTES
+#define MP3_STATIC_RING_BYTES 0
+#endif
+#if MP3_STATIC_RING_BYTES
+static uint8_t static_ring[MP3_STATIC_RING_BYTES] __attribute__((aligned(8)));
+#endif
+
+typedef enum { RING_HEAP = 0, RING_STATIC, RING_USER } ring_src_t;
+
 // GLOBAL STATE (replace your existing `static struct { ... } g = {0};` with this)
 static struct {
     mp3_state_t     state;
     audio_out_cfg_t outcfg;
-    ring_buffer_t   rb;            // PCM bytes
+    pcm_ring_t      pcm;           // decoded PCM (levels below are in int16 bytes)
+    pcm_ring_fmt_t  ring_fmt;      // how pcm stores it
+    ring_src_t      ring_src;      // where its memory comes from
+    uint8_t*        ring_mem;
+    size_t          ring_mem_bytes;
+    int             buffer_ms;
+    int             channels;      // decoded stream channels, so the ring's (1 for a mono track)
+    int             next_channels; // queued track's, while a switch waits for the ring to drain
     size_t          frame_bytes;   // channels * 2
     size_t          target_bytes;  // ring capacity target (e.g., ~150ms)
+    int             src_rate;      // decoded stream rate (outcfg.sample_rate may be scaled)
+    bool            out_on;        // audio_out running (music, test tone or effects)
+    volatile bool   flush;         // seek: consumer drops everything buffered, then clears
 
     mp3_decoder_t*  dec;
 
     char*           path;
     size_t          path_len;
 
-    // Reusable decode buffer to avoid malloc/free in play()/poll()
-    int16_t*        scratch;        // one MP3 frame worth (max 1152 samples * channels)
-    size_t          scratch_frames;
-    size_t          scratch_elems;
-    bool            eof;
+    volatile bool   eof;
     repeating_timer_t decode_timer;
-    // Test tone
+    dsched_t        sched;          // when to wake the timer and how much to decode
+    volatile uint32_t consumed;     // PCM bytes the output took from rb (drain rate)
+    uint8_t         low_pct, high_pct;  // watermarks, percent of rb
+    // decode_core=1: frames are decoded by a core1_sched task into rb, while the VM only
+    // copies compressed bytes from the file into in_rb (the VFS is not usable on core 1)
+    int             decode_core;
+    bool            on_core1;       // decode task registered with core1_sched
+    int             core1_task;     // its id while on_core1
+    ring_buffer_t   in_rb;          // compressed input, VM -> core 1
+    volatile bool   in_eof;         // file fully copied into in_rb
+    // enqueue(): files played after the current one on the same decoder, ring and DMA
+    char            queue[QUEUE_MAX][QUEUE_PATH_MAX];
+    uint8_t         q_head;
+    volatile uint8_t q_len;
+    volatile bool   rate_switch;    // next track is open but needs the ring drained first
+                                    // (another rate or channel count)
+    // Test tone: a mixer tone on the music voice in place of the ring
     bool            tone_mode;
-    uint32_t        tone_phase;
-    uint32_t        tone_step;
+    int             polyphony;      // top voices mp3.trigger() may use
     volatile bool   service_pending;
     // Output sample-rate scaling in Q16 (65536 = 100%). Set via mp3.set_rate(percent).
     uint32_t        rate_scale_q16;
 } g = {0};
 
+// Sample bank: descriptors point into Python buffers, which the root pointer below keeps
+// alive. Outside `g` so registered samples survive mp3.init().
+static mix_sample_t bank[SAMPLE_BANK_MAX];
+MP_REGISTER_ROOT_POINTER(mp_obj_t mp3_sample_bufs[16]);   // SAMPLE_BANK_MAX (copied out as text)
+// Keeps the PCM ring's memory alive: the heap block or the user's buffer object
+MP_REGISTER_ROOT_POINTER(mp_obj_t mp3_ring_keep);
+// Keeps core 1's compressed input ring (in_rb) alive: `g` is not scanned by the GC
+MP_REGISTER_ROOT_POINTER(mp_obj_t mp3_in_keep);
+
+// Output rate for a stream rate, after the mp3.set_rate() scaling
+static int scaled_rate(int hz){
+    if (g.rate_scale_q16 == 65536) return hz;
+    int64_t sr = (int64_t)hz * (int64_t)g.rate_scale_q16;
+    sr = (sr + 32768) >> 16;
+    if (sr < 8000) sr = 8000;
+    if (sr > 192000) sr = 192000;
+    return (int)sr;
+}
+
+// Give back the PCM ring's memory (only heap memory is freed; a static or user buffer
+// stays for the next load)
+static void ring_release(void){
+    if (g.ring_src == RING_HEAP && g.ring_mem) {
+        m_del(uint8_t, g.ring_mem, g.ring_mem_bytes);
+        g.ring_mem = NULL;
+        g.ring_mem_bytes = 0;
+        MP_STATE_VM(mp3_ring_keep) = MP_OBJ_NULL;
+    }
+    memset(&g.pcm, 0, sizeof(g.pcm));
+}
+
+// Give back core 1's input ring (core 1 must be out of the decoder)
+static void in_release(void){
+    if (g.in_rb.data) rb_free(&g.in_rb);
+    MP_STATE_VM(mp3_in_keep) = MP_OBJ_NULL;
+}
+
+// Bytes of ring for buffer_ms of the loaded stream, at its rate and channel count
+static size_t ring_need(void){
+    size_t frames = (size_t)g.buffer_ms * (size_t)g.src_rate / 1000u;
+    if (frames < 3 * MP3_DECODE_MAX_FRAMES) frames = 3 * MP3_DECODE_MAX_FRAMES;
+    return pcm_ring_mem(frames, g.ring_fmt, g.channels, MP3_DECODE_MAX_FRAMES);
+}
+
+// Lay the ring out in the memory it has, capped to what fits
+static bool ring_layout(void){
+    size_t bytes = ring_need();
+    if (bytes > g.ring_mem_bytes) bytes = g.ring_mem_bytes;
+    if (!pcm_ring_init(&g.pcm, g.ring_mem, bytes, g.ring_fmt, g.channels, MP3_DECODE_MAX_FRAMES)) return false;
+    dsched_config(&g.sched, (uint32_t)(pcm_ring_capacity(&g.pcm) * g.frame_bytes), g.low_pct, g.high_pct);
+    g.target_bytes = g.sched.high;
+    return true;
+}
+
+// Lay the PCM ring out for the loaded stream, in the chosen storage format. Heap memory
+// is reused when big enough (a mono track needs half); a static or user buffer caps the
+// length to what fits.
+static void ring_setup(void){
+    size_t need = ring_need();
+    if (g.ring_src == RING_HEAP) {
+        if (g.ring_mem && g.ring_mem_bytes < need) ring_release();
+        if (!g.ring_mem) {
+            g.ring_mem = m_new(uint8_t, need);
+            g.ring_mem_bytes = need;
+            // Only referenced from `g`, which the GC does not scan
+            MP_STATE_VM(mp3_ring_keep) = MP_OBJ_FROM_PTR(g.ring_mem);
+        }
+    }
+    if (!ring_layout()) {
+        mp_raise_ValueError(MP_ERROR_TEXT("buffer too small"));
+    }
+}
+
+// Lay the drained ring out again for a queued track with another channel count, from
+// the decode service: heap memory grows if the GC can spare it (without raising),
+// otherwise the ring holds what fits in the memory it has. False if even that is short.
+static bool ring_reshape(void){
+    size_t need = ring_need();
+    if (g.ring_src == RING_HEAP && g.ring_mem_bytes < need) {
+        uint8_t* mem = m_new_maybe(uint8_t, need);
+        if (mem) {
+            ring_release();
+            g.ring_mem = mem;
+            g.ring_mem_bytes = need;
+            MP_STATE_VM(mp3_ring_keep) = MP_OBJ_FROM_PTR(mem);
+        }
+    }
+    return ring_layout();
+}
+
+// Buffered PCM in int16 bytes, whatever the ring stores
+static size_t ring_level(void){
+    return pcm_ring_frames(&g.pcm) * g.frame_bytes;
+}
+
 static mp_obj_t mp3_init(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args){
-    enum { ARG_pin_l, ARG_pin_r, ARG_buffer_ms };
+    enum { ARG_pin_l, ARG_pin_r, ARG_buffer_ms, ARG_decode_core, ARG_oversample, ARG_dither, ARG_polyphony, ARG_refill_ms,
+           ARG_backend, ARG_i2s_data, ARG_i2s_bclk,
+           ARG_low_water, ARG_high_water, ARG_buffer, ARG_ring_bits };
     static const mp_arg_t allowed[] = {
-        { MP_QSTR_pin_l,     MP_ARG_INT, {.u_int = 26} },
-        { MP_QSTR_pin_r,     MP_ARG_INT, {.u_int = 27} },
-        { MP_QSTR_buffer_ms, MP_ARG_INT, {.u_int = 150} },
+        { MP_QSTR_pin_l,       MP_ARG_INT, {.u_int = 26} },
+        { MP_QSTR_pin_r,       MP_ARG_INT, {.u_int = 27} },
+        { MP_QSTR_buffer_ms,   MP_ARG_INT, {.u_int = 250} },
+        { MP_QSTR_decode_core, MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_oversample,  MP_ARG_INT, {.u_int = 4} },
+        { MP_QSTR_dither,      MP_ARG_BOOL, {.u_bool = true} },
+        { MP_QSTR_polyphony,   MP_ARG_INT, {.u_int = 4} },
+        { MP_QSTR_refill_ms,   MP_ARG_INT, {.u_int = 10} },
+        { MP_QSTR_backend,     MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_i2s_data,    MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = -1} },
+        { MP_QSTR_i2s_bclk,    MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = -1} },
+        { MP_QSTR_low_water,   MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 25} },
+        { MP_QSTR_high_water,  MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 90} },
+        { MP_QSTR_buffer,      MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_ring_bits,   MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 16} },
     };
     mp_arg_val_t a[MP_ARRAY_SIZE(allowed)];
     mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed), allowed, a);
+    if (a[ARG_decode_core].u_int != 0 && a[ARG_decode_core].u_int != 1) {
+        mp_raise_ValueError(MP_ERROR_TEXT("decode_core must be 0 or 1"));
+    }
+    mp_int_t osr = a[ARG_oversample].u_int;
+    if (osr != 1 && osr != 2 && osr != 4 && osr != 8) {
+        mp_raise_ValueError(MP_ERROR_TEXT("oversample must be 1, 2, 4 or 8"));
+    }
+    if (a[ARG_polyphony].u_int < 1 || a[ARG_polyphony].u_int >= MIX_VOICES) {
+        mp_raise_ValueError(MP_ERROR_TEXT("polyphony must be 1..5"));
+    }
+    mp_int_t low = a[ARG_low_water].u_int, high = a[ARG_high_water].u_int;
+    if (low < 5 || high > 95 || high - low < 10) {
+        mp_raise_ValueError(MP_ERROR_TEXT("need 5 <= low_water <= high_water - 10, high_water <= 95"));
+    }
+    audio_out_backend_id_t backend = AUDIO_OUT_PWM;
+    if (a[ARG_backend].u_obj != MP_OBJ_NULL) {
+        const char* name = mp_obj_str_get_str(a[ARG_backend].u_obj);
+        if (strcmp(name, "pwm") == 0) backend = AUDIO_OUT_PWM;
+        else if (strcmp(name, "i2s") == 0) backend = AUDIO_OUT_I2S;
+        else if (strcmp(name, "mock") == 0) backend = AUDIO_OUT_MOCK;
+        else mp_raise_ValueError(MP_ERROR_TEXT("backend must be pwm, i2s or mock"));
+    }
+    if (backend == AUDIO_OUT_I2S && (a[ARG_i2s_data].u_int < 0 || a[ARG_i2s_bclk].u_int < 0)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("i2s needs i2s_data and i2s_bclk"));
+    }
+    mp_int_t bits = a[ARG_ring_bits].u_int;
+    if (bits != 16 && bits != 8 && bits != 4) {
+        mp_raise_ValueError(MP_ERROR_TEXT("ring_bits must be 16, 8 or 4"));
+    }
+    if (a[ARG_buffer_ms].u_int < 50 || a[ARG_buffer_ms].u_int > 5000) {
+        mp_raise_ValueError(MP_ERROR_TEXT("buffer_ms must be 50..5000"));
+    }
+    ring_src_t src = RING_HEAP;
+    mp_obj_t buf = a[ARG_buffer].u_obj;
+    mp_buffer_info_t bi = {0};
+    if (mp_obj_is_str(buf)) {
+        if (strcmp(mp_obj_str_get_str(buf), "static") != 0 || MP3_STATIC_RING_BYTES == 0) {
+            mp_raise_ValueError(MP_ERROR_TEXT("no static ring in this build"));
+        }
+        src = RING_STATIC;
+    } else if (buf != mp_const_none) {
+        mp_get_buffer_raise(buf, &bi, MP_BUFFER_RW);
+        src = RING_USER;
+    }
+    if (g.on_core1) core1_task_remove(g.core1_task);
+    if (g.out_on) audio_out_stop();
+    ring_release();
+    in_release();
     memset(&g, 0, sizeof(g));
+    mixer_init(44100);
+    g.outcfg.backend = backend;
     g.outcfg.pin_l = a[ARG_pin_l].u_int;
     g.outcfg.pin_r = a[ARG_pin_r].u_int;
+    g.outcfg.i2s_data = a[ARG_i2s_data].u_int;
+    g.outcfg.i2s_bclk = a[ARG_i2s_bclk].u_int;
+    g.decode_core = a[ARG_decode_core].u_int;
+    g.outcfg.oversample = (int)osr;
+    g.outcfg.dither = a[ARG_dither].u_bool;
+    g.polyphony = a[ARG_polyphony].u_int;
+    g.low_pct = (uint8_t)low;
+    g.high_pct = (uint8_t)high;
+    g.buffer_ms = a[ARG_buffer_ms].u_int;
+    g.ring_fmt = (pcm_ring_fmt_t)bits;
+    g.ring_src = src;
+    MP_STATE_VM(mp3_ring_keep) = src == RING_USER ? buf : MP_OBJ_NULL;
+    if (src == RING_USER) {
+        g.ring_mem = (uint8_t*)bi.buf;
+        g.ring_mem_bytes = bi.len;
+    }
+#if MP3_STATIC_RING_BYTES
+    if (src == RING_STATIC) {
+        g.ring_mem = static_ring;
+        g.ring_mem_bytes = sizeof(static_ring);
+    }
+#endif
+    // 0 keeps the per-batch DMA IRQ; otherwise the DMA loops over a ring on its own
+    g.outcfg.refill_ms = a[ARG_refill_ms].u_int > 0 ? a[ARG_refill_ms].u_int : 0;
     // ring buffer created after we know sample_rate/channels at load()
     g.state = S_IDLE;
     g.tone_mode = false;
@@ -63,7 +289,7 @@ static mp_obj_t mp3_init(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_a
 static MP_DEFINE_CONST_FUN_OBJ_KW(mp3_init_obj, 0, mp3_init);
 
 
-static mp_obj_t mp3_load(mp_obj_t path_in){
+static mp_obj_t load_track(mp_obj_t path_in){
     if (g.state != S_IDLE && g.state != S_EOF) {
         mp_raise_ValueError(MP_ERROR_TEXT("stop first"));
     }
@@ -84,104 +310,239 @@ static mp_obj_t mp3_load(mp_obj_t path_in){
         mp_raise_ValueError(MP_ERROR_TEXT("open/decode failed"));
     }
 
-    g.outcfg.sample_rate = info.sample_rate;
-    g.outcfg.channels    = (info.channels < 1) ? 1 : ((info.channels > 2) ? 2 : info.channels);
-    g.frame_bytes        = (size_t)g.outcfg.channels * 2;
+    g.src_rate           = info.sample_rate;
+    g.channels           = (info.channels < 1) ? 1 : ((info.channels > 2) ? 2 : info.channels);
+    g.frame_bytes        = (size_t)g.channels * 2;
 
-    // Ring buffer ~48KB (good headroom; ~225ms @ 44.1k stereo)
-    if (g.rb.data) rb_free(&g.rb);
-    const size_t bytes = 48 * 1024;
-    if (!rb_init(&g.rb, bytes)) {
-        mp_raise_msg(&mp_type_MemoryError, MP_ERROR_TEXT("rb init"));
-    }
-    g.target_bytes = bytes * 9 / 10; // high-water 90%
+    ring_setup();
 
     g.state = S_LOADED;
     return mp_const_none;
 }
-static MP_DEFINE_CONST_FUN_OBJ_1(mp3_load_obj, mp3_load);
+
+// load(path, fast=False). fast decodes at half rate, for speech (audiobooks, podcasts):
+// half the spectrum and about half the decode work, see mp3_decoder_set_fast. Tracks
+// queued with enqueue() decode the same way.
+static mp_obj_t mp3_load(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args){
+    enum { ARG_path, ARG_fast };
+    static const mp_arg_t allowed[] = {
+        { MP_QSTR_path, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_fast, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+    };
+    mp_arg_val_t a[MP_ARRAY_SIZE(allowed)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed), allowed, a);
+    if (g.state != S_IDLE && g.state != S_EOF) {
+        mp_raise_ValueError(MP_ERROR_TEXT("stop first"));
+    }
+    if (!g.dec) g.dec = mp3_decoder_create();
+    if (!mp3_decoder_set_fast(g.dec, a[ARG_fast].u_bool)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("fast needs the fixed-point decoder"));
+    }
+    return load_track(a[ARG_path].u_obj);
+}
+static MP_DEFINE_CONST_FUN_OBJ_KW(mp3_load_obj, 1, mp3_load);
 
 
-// Provider callback for audio_out (pull model)
-static size_t provider_cb(int16_t* dst, size_t max_frames, void* user) {
+// Music voice of the mixer (pull model): hands out ring memory in place
+static size_t provider_cb(const int16_t** frames, size_t max_frames, void* user) {
     (void)user;
-    if (g.tone_mode) {
-        for (size_t i=0;i<max_frames;i++) {
-            uint32_t ph = g.tone_phase;
-            g.tone_phase += g.tone_step;
-            int32_t saw = (int32_t)(ph >> 16) - 32768; // -32768..32767
-            // crude shaping to soften saw (optional)
-            int32_t shaped = saw - (saw*saw/32768)/4;
-            int16_t sample = (int16_t)shaped;
-            if (g.outcfg.channels == 2) {
-                dst[2*i] = sample;
-                dst[2*i+1] = sample;
-            } else {
-                dst[i] = sample;
-            }
-        }
-        return max_frames;
+    if (g.flush) {
+        // Only the consumer may move the read index, so a seek's flush happens here
+        pcm_ring_drop(&g.pcm);
+        g.flush = false;
+        return 0;
     }
-    // Need interleaved frames from ring buffer; ring stores raw PCM int16 interleaved.
-    size_t want_bytes = max_frames * g.frame_bytes;
-    size_t have_bytes = rb_used_space(&g.rb);
-    if (have_bytes == 0) return 0;
-    if (want_bytes > have_bytes) want_bytes = have_bytes;
-    size_t frames = want_bytes / g.frame_bytes;
-    rb_read(&g.rb, dst, frames * g.frame_bytes);
-    return frames;
+    // In place for int16 storage, one unpacked block at a time otherwise
+    size_t avail = pcm_ring_peek(&g.pcm, frames);
+    if (avail > max_frames) avail = max_frames;
+    return avail;
+}
+
+static void consume_cb(size_t frames, void* user) {
+    (void)user;
+    pcm_ring_consume(&g.pcm, frames);
+    g.consumed += frames * g.frame_bytes;
+}
+
+// Retune a running output to a new input rate (resampler ratio and mixer tones)
+static void output_rate(int rate){
+    g.outcfg.sample_rate = rate;
+    audio_out_set_rate(rate);
+    mixer_set_rate((uint32_t)rate);
+}
+
+// Start the output at `rate` with the mixer as its provider; if it already runs (effects
+// playing), only retune it, so the voices carry on. `channels` 1 is for a mono track: the
+// ring's frames then go to the backend as they are, which duplicates them as it converts
+// them to output levels. A mono output cannot carry stereo, so one left running by a mono
+// track is restarted for a stereo one; a stereo output plays mono as it is.
+static void output_up(int rate, int channels){
+    if (g.out_on && g.outcfg.channels < channels) { audio_out_stop(); g.out_on = false; }
+    if (g.out_on) { output_rate(rate); return; }
+    g.outcfg.sample_rate = rate;
+    g.outcfg.channels = channels;
+    mixer_set_channels(channels);
+    if (!audio_out_init(&g.outcfg)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("audio init failed"));
+    }
+    mixer_set_rate((uint32_t)rate);
+    audio_out_set_provider(mixer_provide, mixer_consume, NULL);
+    audio_out_start();
+    g.out_on = true;
+}
+
+// Stop the output once no voice needs it
+static void output_down(void){
+    if (g.out_on && !mixer_active()) {
+        audio_out_stop();
+        g.out_on = false;
+    }
+}
+
+// Decode one frame straight into the PCM ring. Returns frames written, 0 if nothing was
+// decoded (resync, starved input, or no room for a whole frame), <0 on error.
+static int decode_into_ring(void) {
+    int16_t* dst;
+    size_t room = pcm_ring_reserve(&g.pcm, &dst);
+    if (room == 0) return 0;
+    uint32_t t0 = time_us_32();
+    int got = mp3_decoder_decode(g.dec, dst, room);
+    if (got > 0) {
+        pcm_ring_commit(&g.pcm, (size_t)got);
+        dsched_note_decode(&g.sched, (uint32_t)got * g.frame_bytes, time_us_32() - t0);
+    }
+    return got;
 }
 
 // Forward declaration of scheduled service (defined later)
 extern const mp_obj_fun_builtin_fixed_t mp3_service_obj;
 
-// Decode timer callback: schedule VM-context refill when below target
+#define IN_RB_BYTES   (16 * 1024)   // compressed input for core 1 decode (~0.4s @ 320kbps)
+
+// Read file bytes straight into in_rb until full, EOF, or `max_bytes` (VM context only)
+static void feed_input(size_t max_bytes) {
+    while (!g.in_eof && max_bytes) {
+        void* dst;
+        size_t space = rb_write_reserve(&g.in_rb, &dst);
+        if (space > max_bytes) space = max_bytes;
+        if (space == 0) break;
+        int n = mp3_decoder_read_input(g.dec, (uint8_t*)dst, space);
+        if (n <= 0) { __atomic_store_n(&g.in_eof, true, __ATOMIC_RELEASE); break; }
+        rb_write_commit(&g.in_rb, (size_t)n);
+        max_bytes -= (size_t)n;
+    }
+}
+
+// Decoder byte source on core 1: drains in_rb, reports end of stream once the VM hit EOF
+static int in_source(uint8_t* dst, size_t max, void* user) {
+    (void)user;
+    // Sample the flag first: bytes written before it was set are then visible to rb_read
+    bool done = __atomic_load_n(&g.in_eof, __ATOMIC_ACQUIRE);
+    size_t n = rb_read(&g.in_rb, dst, max);
+    if (n) return (int)n;
+    return done ? -1 : 0;
+}
+
+// core1_sched task: decode one frame into the PCM ring when it is below target
+static bool decode_core1_task(void* user) {
+    (void)user;
+    if (g.state != S_PLAYING || g.eof) return false;
+    if (ring_level() >= g.target_bytes) return false;
+    int got = decode_into_ring();
+    if (got <= 0) {
+        if (got < 0 || mp3_decoder_is_eof(g.dec)) g.eof = true;
+        return false;
+    }
+    return true;
+}
+
+#define FEED_US  10000u    // core 1 decode: in_rb top-up period (~0.4s of input in it)
+
+// Decode timer callback: schedule VM-context refill when the scheduler asks for it, and
+// sleep as long as the ring allows (the period is rewritten on every tick)
 static bool decode_timer_cb(repeating_timer_t* rt) {
-    (void)rt;
-    if (g.state != S_PLAYING || g.eof) return true;
-    size_t used = rb_used_space(&g.rb);
-    if (used < g.target_bytes && !g.service_pending) {
+    if (g.state != S_PLAYING) return true;
+    bool want;
+    uint32_t next = DSCHED_MIN_US;
+    if (g.eof || g.rate_switch) {
+        // Between tracks: the VM opens the next queued file, or switches rate once drained
+        // (a packed ring's last partial block also waits for the VM to store it)
+        want = g.q_len || g.rate_switch || g.pcm.pend_frames;
+        if (!want) next = DSCHED_MAX_US;
+    } else {
+        size_t level = ring_level();
+        trace_sample(TR_RING, (uint32_t)level);
+        next = dsched_tick(&g.sched, (uint32_t)level, g.consumed, time_us_32(), &want);
+        if (g.on_core1) {
+            // Core 1 decodes; the VM only has to keep the compressed input topped up
+            want = !g.in_eof && rb_used_space(&g.in_rb) < IN_RB_BYTES / 2;
+            if (next > FEED_US) next = FEED_US;
+        }
+    }
+    if (want && !g.service_pending) {
         mp_sched_schedule(MP_OBJ_FROM_PTR(&mp3_service_obj), mp_const_none);
         g.service_pending = true;
+        g.sched.services++;
     }
+    rt->delay_us = -(int64_t)next;
     return true;
 }
 
+// (Re)register the core 1 decode task; false if core1_sched has no free slot
+static bool start_core1_decode(void) {
+    g.core1_task = core1_task_add(decode_core1_task, NULL);
+    g.on_core1 = g.core1_task >= 0;
+    return g.on_core1;
+}
+
+// The current file is fully decoded (the ring still holds its tail): open the next
+// queued one on the same decoder, so its first frames land right behind the old
+// track's last ones. Ring, decoder scratch and DMA channels stay as they are.
+static void next_track(void) {
+    if (g.on_core1) { core1_task_remove(g.core1_task); g.on_core1 = false; }
+    mp3_stream_info_t info;
+    bool opened = false;
+    while (g.q_len && !opened) {
+        const char* path = g.queue[g.q_head];
+        g.q_head = (g.q_head + 1) % QUEUE_MAX;
+        g.q_len--;
+        nlr_buf_t nlr;
+        if (nlr_push(&nlr) == 0) {
+            opened = mp3_decoder_open(g.dec, path, &info);
+            nlr_pop();
+        } else {
+            // Missing or unreadable file: skip to the one after it
+            opened = false;
+        }
+    }
+    if (!opened) return;
+    g.src_rate = info.sample_rate;
+    g.next_channels = info.channels;
+    if (g.in_rb.data) {
+        rb_clear(&g.in_rb);
+        g.in_eof = false;
+        feed_input(IN_RB_BYTES);
+        mp3_decoder_set_source(g.dec, in_source, NULL);
+    }
+    // A different rate or channel count can only start once the old track has played out
+    g.rate_switch = scaled_rate(g.src_rate) != g.outcfg.sample_rate || g.next_channels != g.channels;
+    g.eof = false;
+    if (!g.rate_switch && g.decode_core == 1 && g.in_rb.data) start_core1_decode();
+}
+
 static mp_obj_t mp3_play(void){
-    mp_printf(&mp_plat_print, "play:A enter\n");
     if (g.state != S_LOADED && g.state != S_EOF) {
         mp_raise_ValueError(MP_ERROR_TEXT("load first"));
     }
-    mp_printf(&mp_plat_print, "play:B audio_out_init\n");
-    // Apply optional user rate scaling before audio init
-    if (g.rate_scale_q16 != 65536) {
-        int64_t sr = (int64_t)g.outcfg.sample_rate * (int64_t)g.rate_scale_q16;
-        sr = (sr + 32768) >> 16;
-        if (sr < 8000) sr = 8000;
-        if (sr > 192000) sr = 192000;
-        g.outcfg.sample_rate = (int)sr;
-    }
-    if (!audio_out_init(&g.outcfg)) {
-        mp_raise_ValueError(MP_ERROR_TEXT("audio init failed"));
-    }
-    rb_clear(&g.rb);
-
-    // Allocate reusable scratch buffer once
-    if (g.scratch) { m_del(int16_t, g.scratch, g.scratch_elems); g.scratch = NULL; }
-    // Scratch sized to one MP3 frame (1152) to reduce RAM; we'll loop decode as needed
-    g.scratch_frames = 1152;
-    size_t chans = (g.outcfg.channels < 1) ? 1 : ((g.outcfg.channels > 2) ? 2 : g.outcfg.channels);
-    g.scratch_elems  = g.scratch_frames * chans;
-    mp_printf(&mp_plat_print, "play:C alloc scratch %u elems\n", (unsigned)g.scratch_elems);
-    g.scratch        = m_new(int16_t, g.scratch_elems);
+    pcm_ring_clear(&g.pcm);
     g.eof = false;
 
     // Initial predecode: fill ring up to target_bytes/2 or until timeout
     int zero_runs = 0;
     const int ZERO_SCAN_LIMIT = 1024; // keep pre-start scanning short; proceed and let timer advance
     absolute_time_t start = get_absolute_time();
-    while (rb_used_space(&g.rb) < g.target_bytes / 2) {
-        int got = mp3_decoder_decode(g.dec, g.scratch, g.scratch_frames);
+    while (ring_level() < g.target_bytes / 2) {
+        int got = decode_into_ring();
         if (got < 0) { g.eof = true; break; }
         if (got == 0) {
             if (mp3_decoder_is_eof(g.dec)) { g.eof = true; break; }
@@ -194,37 +555,45 @@ static mp_obj_t mp3_play(void){
             continue; // keep scanning for sync
         }
         zero_runs = 0;
-        size_t bytes = (size_t)got * g.frame_bytes;
-        if (rb_free_space(&g.rb) < bytes) break;
-        rb_write(&g.rb, g.scratch, bytes);
     }
 
-    audio_out_set_provider(provider_cb, NULL);
     // Delay actual start until we have at least a small cushion, else start immediately if EOF or timeout
-    if (rb_used_space(&g.rb) < g.frame_bytes * 256 && !g.eof) {
+    if (ring_level() < g.frame_bytes * 256 && !g.eof) {
         // Fill a minimal cushion synchronously (burst attempts)
         int more_attempts = 0;
-        while (rb_used_space(&g.rb) < g.frame_bytes * 256 && more_attempts < 256 && !g.eof) {
-            int got = mp3_decoder_decode(g.dec, g.scratch, g.scratch_frames);
+        while (ring_level() < g.frame_bytes * 256 && more_attempts < 256 && !g.eof) {
+            int got = decode_into_ring();
             if (got <= 0) {
                 if (mp3_decoder_is_eof(g.dec)) { g.eof = true; break; }
                 more_attempts++;
                 continue;
             }
-            size_t bytes = (size_t)got * g.frame_bytes;
-            if (rb_free_space(&g.rb) < bytes) break;
-            rb_write(&g.rb, g.scratch, bytes);
             // don't count successful attempt toward more_attempts to allow burst fill
         }
     }
-    audio_out_start();
+    // The output may already be running for effects; then only its rate changes
+    mixer_stream(MIX_MUSIC, provider_cb, consume_cb, NULL, g.channels);
+    output_up(scaled_rate(g.src_rate), g.channels);
 
-    // Prioritize DMA IRQ so audio buffer swaps are never delayed by decoding work
-    irq_set_priority(DMA_IRQ_1, 0x80);
+    // Hand decoding to core 1: prefill its input from the file, then register the task
+    if (g.decode_core == 1 && !g.eof) {
+        in_release();
+        if (!rb_init(&g.in_rb, IN_RB_BYTES)) {
+            mp_raise_msg(&mp_type_MemoryError, MP_ERROR_TEXT("rb init"));
+        }
+        MP_STATE_VM(mp3_in_keep) = MP_OBJ_FROM_PTR(g.in_rb.data);
+        g.in_eof = false;
+        feed_input(IN_RB_BYTES);
+        mp3_decoder_set_source(g.dec, in_source, NULL);
+        g.state = S_PLAYING;
+        // No free core 1 slot: mp3_service keeps feeding in_rb and decodes in the VM;
+        // stats() reports which core decodes
+        start_core1_decode();
+    }
 
-    // Start decode maintenance timer every 3ms to further avoid periodic alignment
-    add_repeating_timer_ms(-3, decode_timer_cb, NULL, &g.decode_timer);
-    mp_printf(&mp_plat_print, "play:D started pull-model\n");
+    // Decode maintenance timer; its period adapts from here on
+    dsched_start(&g.sched, (uint32_t)(scaled_rate(g.src_rate) * g.frame_bytes));
+    add_repeating_timer_us(-(int64_t)DSCHED_MIN_US, decode_timer_cb, NULL, &g.decode_timer);
 
     g.state = S_PLAYING;
     return mp_const_none;
@@ -237,11 +606,17 @@ static MP_DEFINE_CONST_FUN_OBJ_0(mp3_poll_obj, mp3_poll);
 
 
 static mp_obj_t mp3_stop(void){
-    audio_out_stop();
+    // Core 1 must be out of the decoder before its buffers go away
+    if (g.on_core1) { core1_task_remove(g.core1_task); g.on_core1 = false; }
+    // Effects keep the output running; the music voice lets go of the ring either way
+    mixer_stop(MIX_MUSIC);
+    output_down();
     cancel_repeating_timer(&g.decode_timer);
-    if (g.scratch) { m_del(int16_t, g.scratch, g.scratch_elems); g.scratch = NULL; }
-    if (g.rb.data) rb_free(&g.rb);
+    in_release();
+    ring_release();
     g.service_pending = false;
+    g.q_len = 0;
+    g.rate_switch = false;
 
     // Close decoder file handle to free VFS resources
     if (g.dec) {
@@ -264,27 +639,84 @@ static mp_obj_t mp3_state(void){
     switch (g.state){
         case S_IDLE:   s="idle"; break;
         case S_LOADED: s="loaded"; break;
-    case S_PLAYING:s = g.eof && rb_used_space(&g.rb)==0 ? "eof" : "playing"; break;
+    case S_PLAYING:s = g.eof && !g.q_len && ring_level()==0 ? "eof" : "playing"; break;
     case S_EOF:    s="eof"; break;
     }
     return mp_obj_new_str(s, strlen(s));
 }
 static MP_DEFINE_CONST_FUN_OBJ_0(mp3_state_obj, mp3_state);
 
+// (rate, channels, ring used, ring free, high watermark, eof, state, underruns,
+//  timer wakeups, service calls, decode calls, decode us per call, drained bytes/s,
+//  time to underrun ms, its minimum ms, fill histogram in eighths of the ring, decoding
+//  core: 1 on core 1, 0 in the VM, e.g. after play() found no free core 1 slot)
 static mp_obj_t mp3_stats(void){
-    mp_obj_t tuple[8];
+    mp_obj_t tuple[17];
     tuple[0] = mp_obj_new_int(g.outcfg.sample_rate);
-    tuple[1] = mp_obj_new_int(g.outcfg.channels);
-    tuple[2] = mp_obj_new_int(rb_used_space(&g.rb));
-    tuple[3] = mp_obj_new_int(rb_free_space(&g.rb));
+    tuple[1] = mp_obj_new_int(g.channels);
+    tuple[2] = mp_obj_new_int(ring_level());
+    tuple[3] = mp_obj_new_int(pcm_ring_capacity(&g.pcm) * g.frame_bytes - ring_level());
     tuple[4] = mp_obj_new_int(g.target_bytes);
     tuple[5] = mp_obj_new_int(g.eof);
     tuple[6] = mp_obj_new_int(g.state);
     tuple[7] = mp_obj_new_int_from_uint(audio_out_underruns());
-    return mp_obj_new_tuple(8, tuple);
+    const dsched_t* d = &g.sched;
+    tuple[8]  = mp_obj_new_int_from_uint(d->wakeups);
+    tuple[9]  = mp_obj_new_int_from_uint(d->services);
+    tuple[10] = mp_obj_new_int_from_uint(d->decodes);
+    tuple[11] = mp_obj_new_int_from_uint(d->cost_us >> 4);
+    tuple[12] = mp_obj_new_int_from_uint(d->drain_bps);
+    tuple[13] = mp_obj_new_int_from_uint(d->ttu_us / 1000u);
+    tuple[14] = mp_obj_new_int_from_uint(d->ttu_min_us == UINT32_MAX ? 0 : d->ttu_min_us / 1000u);
+    mp_obj_t hist[DSCHED_HIST_BINS];
+    for (int i = 0; i < DSCHED_HIST_BINS; ++i) hist[i] = mp_obj_new_int_from_uint(d->hist[i]);
+    tuple[15] = mp_obj_new_tuple(DSCHED_HIST_BINS, hist);
+    tuple[16] = mp_obj_new_int(g.on_core1 ? 1 : 0);
+    return mp_obj_new_tuple(17, tuple);
 }
 static MP_DEFINE_CONST_FUN_OBJ_0(mp3_stats_obj, mp3_stats);
 
+// trace(on): clear the probes and start (or stop) recording. trace(): whether it runs.
+static mp_obj_t mp3_trace(size_t n_args, const mp_obj_t *args){
+#if MP3_TRACE
+    if (n_args) trace_enable(mp_obj_is_true(args[0]));
+    return mp_obj_new_bool(trace_on);
+#else
+    if (n_args && mp_obj_is_true(args[0])) mp_raise_ValueError(MP_ERROR_TEXT("built without MP3_TRACE"));
+    return mp_const_false;
+#endif
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp3_trace_obj, 0, 1, mp3_trace);
+
+// (count, p50, p99, max) of one probe (mp3.TR_*): CPU cycles, bytes for TR_RING
+static mp_obj_t mp3_trace_hist(mp_obj_t probe_in){
+    mp_int_t probe = mp_obj_get_int(probe_in);
+    if (probe < 0 || probe >= TR_PROBES) mp_raise_ValueError(MP_ERROR_TEXT("bad probe"));
+    uint32_t v[4] = {0};
+#if MP3_TRACE
+    trace_stats((uint8_t)probe, &v[0], &v[1], &v[2], &v[3]);
+#endif
+    mp_obj_t tuple[4];
+    for (int i = 0; i < 4; ++i) tuple[i] = mp_obj_new_int_from_uint(v[i]);
+    return mp_obj_new_tuple(4, tuple);
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(mp3_trace_hist_obj, mp3_trace_hist);
+
+// The last TRACE_LEN records, oldest first, as bytes of struct '<IIBBH':
+// (time_us at the end, cycles or value, probe, core, 0)
+static mp_obj_t mp3_trace_dump(void){
+#if MP3_TRACE
+    trace_rec_t* buf = m_new(trace_rec_t, TRACE_LEN);
+    uint32_t n = trace_copy(buf, TRACE_LEN);
+    mp_obj_t out = mp_obj_new_bytes((const byte*)buf, n * sizeof(trace_rec_t));
+    m_del(trace_rec_t, buf, TRACE_LEN);
+    return out;
+#else
+    return mp_obj_new_bytes(NULL, 0);
+#endif
+}
+static MP_DEFINE_CONST_FUN_OBJ_0(mp3_trace_dump_obj, mp3_trace_dump);
+
 static mp_obj_t mp3_diag(void){
     uint32_t f=0,z=0; if (g.dec) mp3_decoder_get_diag(g.dec, &f, &z);
     mp_obj_t tuple[2];
@@ -298,30 +730,179 @@ static mp_obj_t mp3_test_tone(mp_obj_t freq_in){
     mp_int_t freq = mp_obj_get_int(freq_in);
     if (freq < 20) freq = 20;
     if (freq > 12000) freq = 12000;
-    if (g.state == S_IDLE) {
-        g.outcfg.sample_rate = 44100;
-        if (g.rate_scale_q16 != 65536) {
-            int64_t sr = (int64_t)g.outcfg.sample_rate * (int64_t)g.rate_scale_q16;
-            sr = (sr + 32768) >> 16;
-            if (sr < 8000) sr = 8000;
-            if (sr > 192000) sr = 192000;
-            g.outcfg.sample_rate = (int)sr;
-        }
-        g.outcfg.channels = 2;
-        if (!audio_out_init(&g.outcfg)) mp_raise_ValueError(MP_ERROR_TEXT("audio init failed"));
-        audio_out_set_provider(provider_cb, NULL);
-        g.state = S_PLAYING;
-    }
+    // Replaces the music voice; the ring is left alone until stop()
+    mix_note_t note = { (uint16_t)freq, 0 };
     g.tone_mode = true;
-    g.tone_phase = 0;
-    uint64_t step = ((uint64_t)freq << 32) / (uint32_t)g.outcfg.sample_rate;
-    g.tone_step = (uint32_t)step;
-    audio_out_start();
+    mixer_tone(MIX_MUSIC, &note, 1, MIX_WAVE_SAW);
+    if (!g.out_on) output_up(scaled_rate(44100), 2);
+    if (g.state == S_IDLE) g.state = S_PLAYING;
     return mp_const_none;
 }
 static MP_DEFINE_CONST_FUN_OBJ_1(mp3_test_tone_obj, mp3_test_tone);
 
-// Set playback speed as a percent (float allowed). 100.0 = normal, 90.0 = 10% slower, 110.0 = 10% faster.
+static int effect_voice(mp_int_t voice){
+    if (voice < 1 || voice >= MIX_VOICES) {
+        mp_raise_ValueError(MP_ERROR_TEXT("voice must be 1..5"));
+    }
+    return (int)voice;
+}
+
+// One (freq, ms) note, range-checked before it is narrowed to the mixer's 16-bit fields
+static mix_note_t tone_note(mp_float_t freq, mp_float_t ms){
+    if (!(freq >= 0 && freq <= 20000)) mp_raise_ValueError(MP_ERROR_TEXT("freq must be 0..20000"));
+    if (!(ms >= 0 && ms <= 65535)) mp_raise_ValueError(MP_ERROR_TEXT("ms must be 0..65535"));
+    mix_note_t note = { (uint16_t)freq, (uint16_t)ms };
+    return note;
+}
+
+// Play a tone on an effect voice, over the music: tone(freq, ms=0, ...) or a note list
+// tone([(freq, ms), ...], ...) (freq 0 = rest), e.g. PicoSpeaker.rtttl() output.
+// ms=0 on a single note plays until voice_stop(). wave: 0 square, 1 saw.
+static mp_obj_t mp3_tone(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args){
+    enum { ARG_notes, ARG_ms, ARG_voice, ARG_gain, ARG_pan, ARG_wave };
+    static const mp_arg_t allowed[] = {
+        { MP_QSTR_notes, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_ms,    MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_voice, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 1} },
+        { MP_QSTR_gain,  MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_pan,   MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_wave,  MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = MIX_WAVE_SQUARE} },
+    };
+    mp_arg_val_t a[MP_ARRAY_SIZE(allowed)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed), allowed, a);
+    int voice = effect_voice(a[ARG_voice].u_int);
+
+    // Notes on the stack; mixer_tone copies them into the voice
+    mix_note_t notes[MIX_SEQ_MAX];
+    size_t n = 1;
+    mp_obj_t nobj = a[ARG_notes].u_obj;
+    if (mp_obj_is_int(nobj) || mp_obj_is_float(nobj)) {
+        notes[0] = tone_note(mp_obj_get_float(nobj), (mp_float_t)a[ARG_ms].u_int);
+    } else {
+        mp_obj_t* items;
+        mp_obj_get_array(nobj, &n, &items);
+        if (n == 0 || n > MIX_SEQ_MAX) mp_raise_ValueError(MP_ERROR_TEXT("1..128 notes"));
+        for (size_t i = 0; i < n; i++) {
+            mp_obj_t* pair;
+            mp_obj_get_array_fixed_n(items[i], 2, &pair);
+            notes[i] = tone_note(mp_obj_get_float(pair[0]), mp_obj_get_float(pair[1]));
+        }
+    }
+    if (n == 1 && notes[0].freq == 0) {
+        mixer_stop(voice);
+        return mp_const_none;
+    }
+    mp_float_t gain = a[ARG_gain].u_obj != MP_OBJ_NULL ? mp_obj_get_float(a[ARG_gain].u_obj) : 0.5f;
+    mp_float_t pan = a[ARG_pan].u_obj != MP_OBJ_NULL ? mp_obj_get_float(a[ARG_pan].u_obj) : 0.0f;
+    mixer_gain(voice, (int32_t)(gain * MIX_UNITY), (int32_t)(pan * MIX_UNITY));
+    mixer_tone(voice, notes, n, a[ARG_wave].u_int == 1 ? MIX_WAVE_SAW : MIX_WAVE_SQUARE);
+    if (!g.out_on) output_up(44100, 2);
+    return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_KW(mp3_tone_obj, 1, mp3_tone);
+
+// Gain (1.0 = unity, up to 4.0) and pan (-1.0 left .. 1.0 right) of a voice; voice 0
+// is the music. Applies at once, also to a sound already playing.
+static mp_obj_t mp3_mix(size_t n_args, const mp_obj_t *args){
+    mp_int_t voice = mp_obj_get_int(args[0]);
+    if (voice < 0 || voice >= MIX_VOICES) {
+        mp_raise_ValueError(MP_ERROR_TEXT("voice must be 0..5"));
+    }
+    mp_float_t gain = mp_obj_get_float(args[1]);
+    mp_float_t pan = n_args > 2 ? mp_obj_get_float(args[2]) : 0.0f;
+    mixer_gain((int)voice, (int32_t)(gain * MIX_UNITY), (int32_t)(pan * MIX_UNITY));
+    return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp3_mix_obj, 2, 3, mp3_mix);
+
+// Silence one effect voice, or all of them without an argument. The output stops too
+// once nothing (music included) is left playing.
+static mp_obj_t mp3_voice_stop(size_t n_args, const mp_obj_t *args){
+    if (n_args) {
+        mixer_stop(effect_voice(mp_obj_get_int(args[0])));
+    } else {
+        for (int v = 1; v < MIX_VOICES; v++) mixer_stop(v);
+    }
+    output_down();
+    return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp3_voice_stop_obj, 0, 1, mp3_voice_stop);
+
+// Register a PCM effect: sample(buf, rate=22050, channels=1, bits=0) -> handle. The
+// buffer is played in place, so it must not change size while registered. bits=0 takes
+// the format from the buffer: array('h') 16-bit, array('b') signed 8-bit, bytes and
+// bytearray unsigned 8-bit (as in WAV files); bits=16 reads bytes as 16-bit LE.
+static mp_obj_t mp3_sample(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args){
+    enum { ARG_buf, ARG_rate, ARG_channels, ARG_bits };
+    static const mp_arg_t allowed[] = {
+        { MP_QSTR_buf,      MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_rate,     MP_ARG_INT, {.u_int = 22050} },
+        { MP_QSTR_channels, MP_ARG_INT, {.u_int = 1} },
+        { MP_QSTR_bits,     MP_ARG_INT, {.u_int = 0} },
+    };
+    mp_arg_val_t a[MP_ARRAY_SIZE(allowed)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed), allowed, a);
+    mp_buffer_info_t bi;
+    mp_get_buffer_raise(a[ARG_buf].u_obj, &bi, MP_BUFFER_READ);
+    mp_int_t rate = a[ARG_rate].u_int, ch = a[ARG_channels].u_int, bits = a[ARG_bits].u_int;
+    if (rate < 1000 || rate > 96000) mp_raise_ValueError(MP_ERROR_TEXT("rate must be 1000..96000"));
+    if (ch != 1 && ch != 2) mp_raise_ValueError(MP_ERROR_TEXT("channels must be 1 or 2"));
+    mix_format_t fmt;
+    if (bits == 16 || (bits == 0 && bi.typecode == 'h')) fmt = MIX_S16;
+    else if (bits == 0 || bits == 8) fmt = bi.typecode == 'b' ? MIX_S8 : MIX_U8;
+    else mp_raise_ValueError(MP_ERROR_TEXT("bits must be 0, 8 or 16"));
+    size_t frames = bi.len / ((fmt == MIX_S16 ? 2 : 1) * (size_t)ch);
+    if (frames == 0) mp_raise_ValueError(MP_ERROR_TEXT("empty sample"));
+
+    for (int h = 0; h < SAMPLE_BANK_MAX; h++) {
+        if (bank[h].data) continue;
+        MP_STATE_VM(mp3_sample_bufs)[h] = a[ARG_buf].u_obj;
+        bank[h] = (mix_sample_t){ bi.buf, (uint32_t)frames, (uint32_t)rate, (uint8_t)ch, (uint8_t)fmt };
+        return MP_OBJ_NEW_SMALL_INT(h);
+    }
+    mp_raise_ValueError(MP_ERROR_TEXT("sample bank full"));
+}
+static MP_DEFINE_CONST_FUN_OBJ_KW(mp3_sample_obj, 1, mp3_sample);
+
+static mix_sample_t* bank_entry(mp_obj_t handle){
+    mp_int_t h = mp_obj_get_int(handle);
+    if (h < 0 || h >= SAMPLE_BANK_MAX || !bank[h].data) {
+        mp_raise_ValueError(MP_ERROR_TEXT("bad sample handle"));
+    }
+    return &bank[h];
+}
+
+// Unregister a sample; voices still playing it stop
+static mp_obj_t mp3_sample_free(mp_obj_t handle){
+    mix_sample_t* e = bank_entry(handle);
+    mixer_stop_data(e->data);
+    e->data = NULL;
+    MP_STATE_VM(mp3_sample_bufs)[e - bank] = MP_OBJ_NULL;
+    return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(mp3_sample_free_obj, mp3_sample_free);
+
+// Play a registered sample once: trigger(handle, gain=1.0, pan=0.0) -> voice. Uses one
+// of the top `polyphony` voices (the oldest sample is cut when all are busy); nothing is
+// allocated or read from storage, so it is cheap enough for every game frame.
+static mp_obj_t mp3_trigger(size_t n_args, const mp_obj_t *args){
+    mix_sample_t* e = bank_entry(args[0]);
+    mp_float_t gain = n_args > 1 ? mp_obj_get_float(args[1]) : 1.0f;
+    mp_float_t pan = n_args > 2 ? mp_obj_get_float(args[2]) : 0.0f;
+    int poly = g.polyphony ? g.polyphony : 4;
+    int voice = mixer_trigger(e, MIX_VOICES - poly, MIX_VOICES - 1,
+                              (int32_t)(gain * MIX_UNITY), (int32_t)(pan * MIX_UNITY));
+    if (!g.out_on) output_up(44100, 2);
+    return MP_OBJ_NEW_SMALL_INT(voice);
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp3_trigger_obj, 1, 3, mp3_trigger);
+
+static mp_obj_t mp3_voice_busy(mp_obj_t voice_in){
+    return mp_obj_new_bool(mixer_busy(effect_voice(mp_obj_get_int(voice_in))));
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(mp3_voice_busy_obj, mp3_voice_busy);
+
+// Set playback speed as a percent (float allowed), also while playing. 100.0 = normal, 90.0 = 10% slower, 110.0 = 10% faster.
 static mp_obj_t mp3_set_rate(mp_obj_t percent_in){
     mp_float_t pct = mp_obj_get_float(percent_in);
     if (pct < 50.0f) pct = 50.0f;        // clamp to sane range
@@ -331,34 +912,309 @@ static mp_obj_t mp3_set_rate(mp_obj_t percent_in){
     uint32_t q16 = (uint32_t)(q + 0.5f);
     if (q16 == 0) q16 = 1;
     g.rate_scale_q16 = q16;
+    // Only the resampler ratio depends on it, so a playing track changes speed at once
+    if (g.state == S_PLAYING && !g.tone_mode && !g.rate_switch) output_rate(scaled_rate(g.src_rate));
     return mp_const_none;
 }
 static MP_DEFINE_CONST_FUN_OBJ_1(mp3_set_rate_obj, mp3_set_rate);
 
-// Return the actual output sample rate chosen by the PWM fitter
+// Ring mode: refill period in ms, also while playing (longer = fewer interrupts, more
+// latency). Returns False in per-batch IRQ mode (init(refill_ms=0)) and on backends
+// without a ring (i2s, mock).
+static mp_obj_t mp3_set_refill(mp_obj_t ms_in){
+    mp_int_t ms = mp_obj_get_int(ms_in);
+    if (ms <= 0) mp_raise_ValueError(MP_ERROR_TEXT("refill_ms must be > 0"));
+    if (!g.outcfg.refill_ms || g.outcfg.backend != AUDIO_OUT_PWM) return mp_const_false;
+    g.outcfg.refill_ms = (int)ms;
+    if (g.out_on) audio_out_set_refill_ms((int)ms);
+    return mp_const_true;
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(mp3_set_refill_obj, mp3_set_refill);
+
+// Return the rate the output really plays at (PWM: the fixed rate everything is
+// resampled to; I2S: the stream rate as the PIO divider hits it)
 static mp_obj_t mp3_out_rate(void){
     return mp_obj_new_int_from_uint(audio_out_actual_rate());
 }
 static MP_DEFINE_CONST_FUN_OBJ_0(mp3_out_rate_obj, mp3_out_rate);
 
+// Queue a file to follow the current one without a gap. With nothing loaded this is
+// load(path). Returns the number of files waiting.
+static mp_obj_t mp3_enqueue(mp_obj_t path_in){
+    if (g.state == S_IDLE || g.state == S_EOF) {
+        load_track(path_in);
+        return MP_OBJ_NEW_SMALL_INT(0);
+    }
+    if (g.tone_mode) mp_raise_ValueError(MP_ERROR_TEXT("stop first"));
+    const char* path = mp_obj_str_get_str(path_in);
+    size_t len = strlen(path);
+    if (len >= QUEUE_PATH_MAX) mp_raise_ValueError(MP_ERROR_TEXT("path too long"));
+    if (g.q_len == QUEUE_MAX) mp_raise_ValueError(MP_ERROR_TEXT("queue full"));
+    memcpy(g.queue[(g.q_head + g.q_len) % QUEUE_MAX], path, len + 1);
+    g.q_len++;
+    return MP_OBJ_NEW_SMALL_INT(g.q_len);
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(mp3_enqueue_obj, mp3_enqueue);
+
+// Jump to `seconds` into the loaded track. Buffered PCM is dropped, so playback continues
+// from the new position after one ring refill.
+static mp_obj_t mp3_seek(mp_obj_t seconds_in){
+    if (g.state != S_LOADED && g.state != S_PLAYING && g.state != S_EOF) {
+        mp_raise_ValueError(MP_ERROR_TEXT("load first"));
+    }
+    if (g.tone_mode || !g.dec) return mp_const_none;
+    mp_float_t sec = mp_obj_get_float(seconds_in);
+    if (sec < 0) sec = 0;
+    uint32_t sample = (uint32_t)(sec * (mp_float_t)g.src_rate);
+
+    // Stop the producer: core 1 out of the decoder; VM-context decode cannot run meanwhile
+    bool was_on_core1 = g.on_core1;
+    if (g.on_core1) { core1_task_remove(g.core1_task); g.on_core1 = false; }
+    if (g.state == S_PLAYING && g.out_on) {
+        // The output IRQ owns the read side: ask it to drop the ring and wait for it
+        g.flush = true;
+        absolute_time_t t0 = get_absolute_time();
+        while (g.flush && absolute_time_diff_us(t0, get_absolute_time()) < 200000) tight_loop_contents();
+        if (g.flush) {
+            // The mixer never pulled: stop the output so nothing reads the ring, then restart
+            audio_out_stop();
+            g.out_on = false;
+            g.flush = false;
+            pcm_ring_clear(&g.pcm);
+            output_up(scaled_rate(g.src_rate), g.channels);
+        } else {
+            pcm_ring_restart(&g.pcm);
+        }
+    } else {
+        // No consumer running, so both sides can be reset from here
+        g.flush = false;
+        pcm_ring_clear(&g.pcm);
+    }
+
+    bool ok = mp3_decoder_seek(g.dec, sample);
+    // Compressed bytes already queued for core 1 belong to the old position
+    if (g.in_rb.data) {
+        rb_clear(&g.in_rb);
+        g.in_eof = false;
+        feed_input(IN_RB_BYTES);
+    }
+    g.eof = false;
+    if (was_on_core1) start_core1_decode();
+    if (!ok) mp_raise_ValueError(MP_ERROR_TEXT("seek failed"));
+    return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(mp3_seek_obj, mp3_seek);
+
+// Playback position in seconds: decoder position less what is still buffered
+static mp_obj_t mp3_position(void){
+    if (!g.dec || g.tone_mode || g.src_rate <= 0) return mp_obj_new_float(0);
+    uint32_t pos = mp3_decoder_tell(g.dec);
+    uint32_t buffered = (uint32_t)pcm_ring_frames(&g.pcm);
+    pos = pos > buffered ? pos - buffered : 0;
+    return mp_obj_new_float((mp_float_t)pos / (mp_float_t)g.src_rate);
+}
+static MP_DEFINE_CONST_FUN_OBJ_0(mp3_position_obj, mp3_position);
+
+// mp3.info(path) -> (title, artist, album, seconds, kbps, vbr, rate, channels)
+// Tags and length without loading the file; works while another track plays. Missing
+// text fields are None.
+static mp_obj_t meta_str(const char* s){
+    return s[0] ? mp_obj_new_str(s, strlen(s)) : mp_const_none;
+}
+
+static mp_obj_t mp3_info(mp_obj_t path_in){
+    const char* path = mp_obj_str_get_str(path_in);
+    mp3_meta_t m;
+    if (!mp3_meta_read(path, &m)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("open/parse failed"));
+    }
+    mp_obj_t tuple[8];
+    tuple[0] = meta_str(m.title);
+    tuple[1] = meta_str(m.artist);
+    tuple[2] = meta_str(m.album);
+    tuple[3] = mp_obj_new_float((mp_float_t)m.duration_ms / 1000);
+    tuple[4] = mp_obj_new_int_from_uint(m.kbps);
+    tuple[5] = mp_obj_new_bool(m.vbr);
+    tuple[6] = mp_obj_new_int_from_uint(m.sample_rate);
+    tuple[7] = MP_OBJ_NEW_SMALL_INT(m.channels);
+    return mp_obj_new_tuple(8, tuple);
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(mp3_info_obj, mp3_info);
+
+// ===== Music library (mp3_library.h) =====
+// mp3.library_scan(root, index=root + "/.mp3lib") -> (tracks, parsed, reused, removed)
+static mp_obj_t mp3_library_scan(size_t n_args, const mp_obj_t *args){
+    const char* root = mp_obj_str_get_str(args[0]);
+    char index[MP3_LIB_PATH];
+    if (n_args > 1) {
+        const char* s = mp_obj_str_get_str(args[1]);
+        if (strlen(s) >= sizeof(index)) mp_raise_ValueError(MP_ERROR_TEXT("path too long"));
+        strcpy(index, s);
+    } else {
+        size_t n = strlen(root);
+        if (n + 1 + sizeof(MP3_LIB_NAME) > sizeof(index)) mp_raise_ValueError(MP_ERROR_TEXT("path too long"));
+        memcpy(index, root, n);
+        if (n == 0 || root[n - 1] != '/') index[n++] = '/';
+        memcpy(index + n, MP3_LIB_NAME, sizeof(MP3_LIB_NAME));
+    }
+    mp3_lib_scan_t st;
+    mp3_lib_scan(root, index, &st);
+    mp_obj_t tuple[4];
+    tuple[0] = mp_obj_new_int_from_uint(st.tracks);
+    tuple[1] = mp_obj_new_int_from_uint(st.parsed);
+    tuple[2] = mp_obj_new_int_from_uint(st.reused);
+    tuple[3] = mp_obj_new_int_from_uint(st.removed);
+    return mp_obj_new_tuple(4, tuple);
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp3_library_scan_obj, 1, 2, mp3_library_scan);
+
+// Readers open the index per call and close it even when building the result raises
+typedef struct {
+    mp3_lib_t       lib;
+    mp3_lib_entry_t e;
+} lib_call_t;
+
+typedef mp_obj_t (*lib_fn_t)(lib_call_t* c, const mp_obj_t* args);
+
+static mp_obj_t lib_run(mp_obj_t index_in, lib_fn_t fn, const mp_obj_t* args){
+    lib_call_t* c = m_new(lib_call_t, 1);
+    if (!mp3_lib_open(&c->lib, mp_obj_str_get_str(index_in))) {
+        m_del(lib_call_t, c, 1);
+        mp_raise_ValueError(MP_ERROR_TEXT("no library index"));
+    }
+    mp_obj_t res;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        res = fn(c, args);
+        nlr_pop();
+    } else {
+        mp3_lib_close(&c->lib);
+        m_del(lib_call_t, c, 1);
+        nlr_jump(nlr.ret_val);
+    }
+    mp3_lib_close(&c->lib);
+    m_del(lib_call_t, c, 1);
+    return res;
+}
+
+// (path, title, artist, album, seconds)
+static mp_obj_t lib_entry(const mp3_lib_entry_t* e){
+    mp_obj_t tuple[5];
+    tuple[0] = mp_obj_new_str(e->path, strlen(e->path));
+    tuple[1] = meta_str(e->title);
+    tuple[2] = meta_str(e->artist);
+    tuple[3] = meta_str(e->album);
+    tuple[4] = mp_obj_new_float((mp_float_t)e->rec.duration_ms / 1000);
+    return mp_obj_new_tuple(5, tuple);
+}
+
+static mp_obj_t lib_count_fn(lib_call_t* c, const mp_obj_t* args){
+    (void)args;
+    return mp_obj_new_int_from_uint(c->lib.count);
+}
+
+// mp3.library_count(index)
+static mp_obj_t mp3_library_count(mp_obj_t index_in){
+    return lib_run(index_in, lib_count_fn, NULL);
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(mp3_library_count_obj, mp3_library_count);
+
+static mp_obj_t lib_list_fn(lib_call_t* c, const mp_obj_t* args){
+    mp3_lib_order_t order = (mp3_lib_order_t)mp_obj_get_int(args[0]);
+    mp_int_t start = mp_obj_get_int(args[1]), count = mp_obj_get_int(args[2]);
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    for (mp_int_t i = 0; i < count && start >= 0; i++) {
+        if (!mp3_lib_get(&c->lib, order, (uint32_t)(start + i), &c->e)) break;
+        mp_obj_list_append(list, lib_entry(&c->e));
+    }
+    return list;
+}
+
+// mp3.library_list(index, order=LIB_PATH, start=0, count=20) -> [entry, ...]
+static mp_obj_t mp3_library_list(size_t n_args, const mp_obj_t *args){
+    mp_obj_t a[3] = {
+        n_args > 1 ? args[1] : MP_OBJ_NEW_SMALL_INT(MP3_LIB_BY_PATH),
+        n_args > 2 ? args[2] : MP_OBJ_NEW_SMALL_INT(0),
+        n_args > 3 ? args[3] : MP_OBJ_NEW_SMALL_INT(20),
+    };
+    return lib_run(args[0], lib_list_fn, a);
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp3_library_list_obj, 1, 4, mp3_library_list);
+
+static mp_obj_t lib_find_fn(lib_call_t* c, const mp_obj_t* args){
+    mp3_lib_order_t order = (mp3_lib_order_t)mp_obj_get_int(args[1]);
+    return mp_obj_new_int_from_uint(mp3_lib_find(&c->lib, order, mp_obj_str_get_str(args[0])));
+}
+
+// mp3.library_find(index, prefix, order=LIB_TITLE) -> position of the first entry not
+// sorting below `prefix` (compared on 12 case-folded characters), for library_list
+static mp_obj_t mp3_library_find(size_t n_args, const mp_obj_t *args){
+    mp_obj_t a[2] = { args[1], n_args > 2 ? args[2] : MP_OBJ_NEW_SMALL_INT(MP3_LIB_BY_TITLE) };
+    return lib_run(args[0], lib_find_fn, a);
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp3_library_find_obj, 2, 3, mp3_library_find);
+
+static mp_obj_t lib_search_fn(lib_call_t* c, const mp_obj_t* args){
+    const char* text = mp_obj_str_get_str(args[0]);
+    mp_int_t max = mp_obj_get_int(args[1]);
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    uint32_t cursor = 0;
+    for (mp_int_t i = 0; i < max && mp3_lib_search(&c->lib, text, &cursor, &c->e); i++) {
+        mp_obj_list_append(list, lib_entry(&c->e));
+    }
+    return list;
+}
+
+// mp3.library_search(index, text, max=20) -> entries whose path or tags contain `text`,
+// in one sequential read of the index
+static mp_obj_t mp3_library_search(size_t n_args, const mp_obj_t *args){
+    mp_obj_t a[2] = { args[1], n_args > 2 ? args[2] : MP_OBJ_NEW_SMALL_INT(20) };
+    return lib_run(args[0], lib_search_fn, a);
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp3_library_search_obj, 2, 3, mp3_library_search);
+
 // Scheduled service: runs in VM context. Refill ring up to target.
 static mp_obj_t mp3_service(mp_obj_t _arg){
-    if (g.state != S_PLAYING || g.eof) { g.service_pending = false; return mp_const_none; }
+    if (g.state != S_PLAYING || g.tone_mode) { g.service_pending = false; return mp_const_none; }
+    if (g.eof && g.q_len) next_track();
+    // Neither core decodes now: store what a packed ring holds back of the last block
+    if (g.eof || g.rate_switch) pcm_ring_finish(&g.pcm);
+    if (g.rate_switch) {
+        // Change the resampler ratio or the ring's layout only once the previous track
+        // has fully played
+        if (ring_level()) { g.service_pending = false; return mp_const_none; }
+        if (g.next_channels != g.channels) {
+            // The music voice lets go of the ring while it is laid out again
+            mixer_stop(MIX_MUSIC);
+            g.channels = g.next_channels;
+            g.frame_bytes = (size_t)g.channels * 2;
+            if (!ring_reshape()) {
+                g.eof = true;
+                g.rate_switch = false;
+                g.service_pending = false;
+                return mp_const_none;
+            }
+            mixer_stream(MIX_MUSIC, provider_cb, consume_cb, NULL, g.channels);
+        }
+        output_up(scaled_rate(g.src_rate), g.channels);
+        g.rate_switch = false;
+        if (g.decode_core == 1 && g.in_rb.data) start_core1_decode();
+    }
+    if (g.eof) { g.service_pending = false; return mp_const_none; }
+    if (g.in_rb.data) feed_input(IN_RB_BYTES / 2);
+    if (g.on_core1) { g.service_pending = false; return mp_const_none; }
+    // As many decode calls as reach the high watermark within the time budget
     size_t need_level = g.target_bytes;
-    size_t low_level  = g.frame_bytes * 256; // keep a healthy cushion
-    int attempts = 0;
-    int attempt_cap = (rb_used_space(&g.rb) < low_level) ? 96 : 32;
-    while (attempts < attempt_cap && rb_used_space(&g.rb) < need_level) {
-        int got = mp3_decoder_decode(g.dec, g.scratch, g.scratch_frames);
+    uint32_t attempts = 0;
+    uint32_t attempt_cap = dsched_budget(&g.sched, ring_level());
+    while (attempts < attempt_cap && ring_level() < need_level) {
+        int got = decode_into_ring();
         if (got < 0) { g.eof = true; break; }
         if (got == 0) {
             if (mp3_decoder_is_eof(g.dec)) { g.eof = true; break; }
             attempts++;
             continue;
         }
-        size_t to_write_bytes = (size_t)got * g.frame_bytes;
-        if (rb_free_space(&g.rb) < to_write_bytes) break;
-        rb_write(&g.rb, g.scratch, to_write_bytes);
         attempts++;
     }
     g.service_pending = false;
@@ -371,6 +1227,7 @@ static const mp_rom_map_elem_t mp3_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_mp3) },
     { MP_ROM_QSTR(MP_QSTR_init),     MP_ROM_PTR(&mp3_init_obj) },
     { MP_ROM_QSTR(MP_QSTR_load),     MP_ROM_PTR(&mp3_load_obj) },
+    { MP_ROM_QSTR(MP_QSTR_enqueue),  MP_ROM_PTR(&mp3_enqueue_obj) },
     { MP_ROM_QSTR(MP_QSTR_play),     MP_ROM_PTR(&mp3_play_obj) },
     { MP_ROM_QSTR(MP_QSTR_poll),     MP_ROM_PTR(&mp3_poll_obj) },
     { MP_ROM_QSTR(MP_QSTR_stop),     MP_ROM_PTR(&mp3_stop_obj) },
@@ -380,6 +1237,33 @@ static const mp_rom_map_elem_t mp3_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_test_tone), MP_ROM_PTR(&mp3_test_tone_obj) },
     { MP_ROM_QSTR(MP_QSTR_set_rate), MP_ROM_PTR(&mp3_set_rate_obj) },
     { MP_ROM_QSTR(MP_QSTR_out_rate), MP_ROM_PTR(&mp3_out_rate_obj) },
+    { MP_ROM_QSTR(MP_QSTR_set_refill), MP_ROM_PTR(&mp3_set_refill_obj) },
+    { MP_ROM_QSTR(MP_QSTR_seek),     MP_ROM_PTR(&mp3_seek_obj) },
+    { MP_ROM_QSTR(MP_QSTR_position), MP_ROM_PTR(&mp3_position_obj) },
+    { MP_ROM_QSTR(MP_QSTR_info),     MP_ROM_PTR(&mp3_info_obj) },
+    { MP_ROM_QSTR(MP_QSTR_library_scan),   MP_ROM_PTR(&mp3_library_scan_obj) },
+    { MP_ROM_QSTR(MP_QSTR_library_count),  MP_ROM_PTR(&mp3_library_count_obj) },
+    { MP_ROM_QSTR(MP_QSTR_library_list),   MP_ROM_PTR(&mp3_library_list_obj) },
+    { MP_ROM_QSTR(MP_QSTR_library_find),   MP_ROM_PTR(&mp3_library_find_obj) },
+    { MP_ROM_QSTR(MP_QSTR_library_search), MP_ROM_PTR(&mp3_library_search_obj) },
+    { MP_ROM_QSTR(MP_QSTR_tone),     MP_ROM_PTR(&mp3_tone_obj) },
+    { MP_ROM_QSTR(MP_QSTR_mix),      MP_ROM_PTR(&mp3_mix_obj) },
+    { MP_ROM_QSTR(MP_QSTR_voice_stop), MP_ROM_PTR(&mp3_voice_stop_obj) },
+    { MP_ROM_QSTR(MP_QSTR_voice_busy), MP_ROM_PTR(&mp3_voice_busy_obj) },
+    { MP_ROM_QSTR(MP_QSTR_sample),   MP_ROM_PTR(&mp3_sample_obj) },
+    { MP_ROM_QSTR(MP_QSTR_sample_free), MP_ROM_PTR(&mp3_sample_free_obj) },
+    { MP_ROM_QSTR(MP_QSTR_trigger),  MP_ROM_PTR(&mp3_trigger_obj) },
+    { MP_ROM_QSTR(MP_QSTR_trace),    MP_ROM_PTR(&mp3_trace_obj) },
+    { MP_ROM_QSTR(MP_QSTR_trace_hist), MP_ROM_PTR(&mp3_trace_hist_obj) },
+    { MP_ROM_QSTR(MP_QSTR_trace_dump), MP_ROM_PTR(&mp3_trace_dump_obj) },
+    { MP_ROM_QSTR(MP_QSTR_TR_IRQ),     MP_ROM_INT(TR_IRQ) },
+    { MP_ROM_QSTR(MP_QSTR_TR_PROVIDE), MP_ROM_INT(TR_PROVIDE) },
+    { MP_ROM_QSTR(MP_QSTR_TR_DECODE),  MP_ROM_INT(TR_DECODE) },
+    { MP_ROM_QSTR(MP_QSTR_TR_READ),    MP_ROM_INT(TR_READ) },
+    { MP_ROM_QSTR(MP_QSTR_TR_RING),    MP_ROM_INT(TR_RING) },
+    { MP_ROM_QSTR(MP_QSTR_LIB_PATH),   MP_ROM_INT(MP3_LIB_BY_PATH) },
+    { MP_ROM_QSTR(MP_QSTR_LIB_TITLE),  MP_ROM_INT(MP3_LIB_BY_TITLE) },
+    { MP_ROM_QSTR(MP_QSTR_LIB_ARTIST), MP_ROM_INT(MP3_LIB_BY_ARTIST) },
 };
 static MP_DEFINE_CONST_DICT(mp3_module_globals, mp3_module_globals_table);
 
@@ -0,0 +1,67 @@
+// noise_shaper.h : PCM16 -> PWM level conversion with error-feedback noise shaping
+// The level is computed in Q16 (16 fractional bits below one PWM step). Instead of
+// dropping the fraction, earlier quantisation errors are fed back so the noise transfer
+// function is (1 - z^-1)^order, which moves the noise up towards Nyquist. That only
+// pays off when the PWM runs at a multiple of the sample rate (audio_out oversampling):
+// the shaped noise then lands far above the audio band. Optional TPDF dither goes
+// through the same loop, so it is shaped as well and low-level signals do not turn into
+// correlated distortion.
+// Integer only, a handful of operations per PWM period: cheap enough for the DMA IRQ.
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#define NS_MAX_ORDER 3
+
+typedef struct {
+    int32_t e[NS_MAX_ORDER];   // last quantisation errors, newest first, Q16
+} ns_chan_t;
+
+typedef struct {
+    ns_chan_t ch[2];
+    uint32_t  seed;     // dither LCG state
+    uint32_t  steps;    // TOP + 1
+    uint8_t   order;    // 0: plain truncation (no feedback, no dither)
+    bool      dither;
+} noise_shaper_t;
+
+// Error feedback taps per order: binomial coefficients of (1 - z^-1)^order, signs folded in
+static const int8_t ns_taps[NS_MAX_ORDER + 1][NS_MAX_ORDER] = {
+    { 0, 0, 0 }, { 1, 0, 0 }, { 2, -1, 0 }, { 3, -3, 1 },
+};
+
+static inline void ns_init(noise_shaper_t* ns, uint16_t top, uint8_t order, bool dither){
+    for (int c = 0; c < 2; c++) for (int k = 0; k < NS_MAX_ORDER; k++) ns->ch[c].e[k] = 0;
+    ns->seed = 0x1234567u;
+    ns->steps = (uint32_t)top + 1;
+    ns->order = order > NS_MAX_ORDER ? NS_MAX_ORDER : order;
+    ns->dither = dither && ns->order;
+}
+
+// One uniform value in [-32768, 32767] (half a step either way in Q16)
+static inline int32_t ns_rand(noise_shaper_t* ns){
+    ns->seed = ns->seed * 1664525u + 1013904223u;
+    return (int32_t)(ns->seed >> 16) - 32768;
+}
+
+static inline uint16_t ns_level(noise_shaper_t* ns, ns_chan_t* c, int16_t sample){
+    // Target level in Q16: 0 .. steps << 16 (fits easily, steps < 2^15)
+    int32_t target = (int32_t)((uint32_t)(sample + 32768) * ns->steps);
+    if (!ns->order) return (uint16_t)(target >> 16);
+    const int8_t* t = ns_taps[ns->order];
+    int32_t v = target - t[0] * c->e[0] - t[1] * c->e[1] - t[2] * c->e[2];
+    int32_t vq = v;
+    if (ns->dither) vq += ns_rand(ns) + ns_rand(ns);
+    int32_t q = (vq + 32768) >> 16;
+    if (q < 0) q = 0;
+    if (q > (int32_t)ns->steps - 1) q = (int32_t)ns->steps - 1;
+    // Error against the undithered value, so the dither is shaped too. Clipped samples
+    // leave a large error; bounding it keeps the loop stable.
+    int32_t e = (q << 16) - v;
+    if (e > (4 << 16)) e = 4 << 16;
+    if (e < -(4 << 16)) e = -(4 << 16);
+    c->e[2] = c->e[1];
+    c->e[1] = c->e[0];
+    c->e[0] = e;
+    return (uint16_t)q;
+}
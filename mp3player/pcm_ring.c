@@ -0,0 +1,233 @@
+// pcm_ring.c : Decoded PCM ring between the decoder and the music voice
+#include "pcm_ring.h"
+#include <string.h>
+
+// ===== IMA ADPCM =====
+static const uint16_t adpcm_step[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253,
+    279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166,
+    1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428,
+    4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289,
+    16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+static const int8_t adpcm_index_adj[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+// Apply one code to the predictor (shared by encoder and decoder, so they track)
+static inline void adpcm_step_state(pcm_adpcm_t* st, uint8_t code) {
+    int32_t step = adpcm_step[st->index];
+    int32_t diff = step >> 3;
+    if (code & 4) diff += step;
+    if (code & 2) diff += step >> 1;
+    if (code & 1) diff += step >> 2;
+    int32_t p = st->pred + ((code & 8) ? -diff : diff);
+    if (p > 32767) p = 32767;
+    if (p < -32768) p = -32768;
+    st->pred = (int16_t)p;
+    int idx = st->index + adpcm_index_adj[code & 7];
+    st->index = (uint8_t)(idx < 0 ? 0 : (idx > 88 ? 88 : idx));
+}
+
+static inline uint8_t adpcm_encode(pcm_adpcm_t* st, int16_t s) {
+    int32_t step = adpcm_step[st->index];
+    int32_t diff = (int32_t)s - st->pred;
+    uint8_t code = 0;
+    if (diff < 0) { code = 8; diff = -diff; }
+    if (diff >= step) { code |= 4; diff -= step; }
+    step >>= 1;
+    if (diff >= step) { code |= 2; diff -= step; }
+    step >>= 1;
+    if (diff >= step) code |= 1;
+    adpcm_step_state(st, code);
+    return code;
+}
+
+// Block layout per channel: pred (int16 LE), index, pad, then PCM_RING_BLOCK nibbles
+#define ADPCM_HDR   4
+#define ADPCM_DATA  (PCM_RING_BLOCK / 2)
+
+static size_t block_bytes_of(pcm_ring_fmt_t fmt, int channels) {
+    switch (fmt) {
+        case PCM_RING_S8:    return (size_t)PCM_RING_BLOCK * channels;
+        case PCM_RING_ADPCM: return (size_t)(ADPCM_HDR + ADPCM_DATA) * channels;
+        default:             return (size_t)PCM_RING_BLOCK * channels * 2;
+    }
+}
+
+static void pack_block(pcm_ring_t* pr, const int16_t* src, uint8_t* dst) {
+    int ch = pr->channels;
+    if (pr->fmt == PCM_RING_S8) {
+        for (int k = 0; k < PCM_RING_BLOCK * ch; ++k) {
+            int32_t v = ((int32_t)src[k] + 128) >> 8;
+            dst[k] = (uint8_t)(int8_t)(v > 127 ? 127 : v);
+        }
+        return;
+    }
+    for (int c = 0; c < ch; ++c) {
+        pcm_adpcm_t* st = &pr->enc[c];
+        uint8_t* hdr = dst + c * (ADPCM_HDR + ADPCM_DATA);
+        uint8_t* data = hdr + ADPCM_HDR;
+        hdr[0] = (uint8_t)st->pred;
+        hdr[1] = (uint8_t)((uint16_t)st->pred >> 8);
+        hdr[2] = st->index;
+        hdr[3] = 0;
+        for (int i = 0; i < PCM_RING_BLOCK; i += 2) {
+            uint8_t lo = adpcm_encode(st, src[i * ch + c]);
+            uint8_t hi = adpcm_encode(st, src[(i + 1) * ch + c]);
+            data[i / 2] = (uint8_t)(lo | (hi << 4));
+        }
+    }
+}
+
+static void unpack_block(pcm_ring_t* pr, const uint8_t* src, int16_t* dst) {
+    int ch = pr->channels;
+    if (pr->fmt == PCM_RING_S8) {
+        for (int k = 0; k < PCM_RING_BLOCK * ch; ++k) dst[k] = (int16_t)((int8_t)src[k] * 256);
+        return;
+    }
+    for (int c = 0; c < ch; ++c) {
+        const uint8_t* hdr = src + c * (ADPCM_HDR + ADPCM_DATA);
+        const uint8_t* data = hdr + ADPCM_HDR;
+        pcm_adpcm_t st = { (int16_t)(hdr[0] | (hdr[1] << 8)), hdr[2] > 88 ? 88 : hdr[2] };
+        for (int i = 0; i < PCM_RING_BLOCK; ++i) {
+            adpcm_step_state(&st, (uint8_t)((data[i / 2] >> ((i & 1) * 4)) & 0xF));
+            dst[i * ch + c] = st.pred;
+        }
+    }
+}
+
+// ===== Layout =====
+// S16:    [ring][slack for one write across the wrap]
+// packed: [pending frames, max_write + one block][ring of whole blocks]
+static size_t head_bytes(pcm_ring_fmt_t fmt, int channels, size_t max_write) {
+    if (fmt == PCM_RING_S16) return 0;
+    return (max_write + PCM_RING_BLOCK) * (size_t)channels * 2;
+}
+
+size_t pcm_ring_mem(size_t frames, pcm_ring_fmt_t fmt, int channels, size_t max_write) {
+    size_t bb = block_bytes_of(fmt, channels);
+    size_t blocks = (frames + PCM_RING_BLOCK - 1) / PCM_RING_BLOCK + 1;   // +1: never full
+    if (fmt == PCM_RING_S16) return blocks * bb + max_write * (size_t)channels * 2;
+    return head_bytes(fmt, channels, max_write) + blocks * bb;
+}
+
+bool pcm_ring_init(pcm_ring_t* pr, void* mem, size_t bytes, pcm_ring_fmt_t fmt,
+                   int channels, size_t max_write) {
+    memset(pr, 0, sizeof(*pr));
+    pr->fmt = fmt;
+    pr->channels = channels;
+    pr->frame_bytes = (size_t)channels * 2;
+    pr->block_bytes = block_bytes_of(fmt, channels);
+    pr->max_write = max_write;
+
+    size_t head = head_bytes(fmt, channels, max_write);
+    size_t slack = fmt == PCM_RING_S16 ? max_write * pr->frame_bytes : 0;
+    if (bytes < head + slack) return false;
+    // Whole blocks only, so a packed block never straddles the wrap
+    size_t size = (bytes - head - slack) / pr->block_bytes * pr->block_bytes;
+    size_t min_blocks = 2 * ((max_write + PCM_RING_BLOCK - 1) / PCM_RING_BLOCK + 1);
+    if (size < min_blocks * pr->block_bytes) return false;
+
+    pr->pend = head ? (int16_t*)mem : NULL;
+    rb_init_mem(&pr->rb, (uint8_t*)mem + head, size, slack);
+    return true;
+}
+
+void pcm_ring_clear(pcm_ring_t* pr) {
+    rb_clear(&pr->rb);
+    pr->pend_frames = 0;
+    pr->out_pos = pr->out_len = 0;
+    memset(pr->enc, 0, sizeof(pr->enc));
+}
+
+// ===== Producer =====
+void pcm_ring_restart(pcm_ring_t* pr) {
+    pr->pend_frames = 0;
+    memset(pr->enc, 0, sizeof(pr->enc));
+}
+
+size_t pcm_ring_reserve(pcm_ring_t* pr, int16_t** dst) {
+    if (pr->fmt == PCM_RING_S16) {
+        void* p;
+        size_t room = rb_write_reserve(&pr->rb, &p) / pr->frame_bytes;
+        *dst = (int16_t*)p;
+        return room < pr->max_write ? 0 : room;
+    }
+    // Every block the pending frames plus a full write can make must fit
+    size_t blocks = (pr->pend_frames + pr->max_write) / PCM_RING_BLOCK;
+    if (rb_free_space(&pr->rb) < blocks * pr->block_bytes) return 0;
+    *dst = pr->pend + pr->pend_frames * pr->channels;
+    return pr->max_write;
+}
+
+void pcm_ring_commit(pcm_ring_t* pr, size_t frames) {
+    if (pr->fmt == PCM_RING_S16) {
+        rb_write_commit(&pr->rb, frames * pr->frame_bytes);
+        return;
+    }
+    pr->pend_frames += frames;
+    size_t done = 0;
+    while (pr->pend_frames - done >= PCM_RING_BLOCK) {
+        void* p;
+        rb_write_reserve(&pr->rb, &p);
+        pack_block(pr, pr->pend + done * pr->channels, (uint8_t*)p);
+        rb_write_commit(&pr->rb, pr->block_bytes);
+        done += PCM_RING_BLOCK;
+    }
+    pr->pend_frames -= done;
+    if (done && pr->pend_frames) {
+        memmove(pr->pend, pr->pend + done * pr->channels, pr->pend_frames * pr->frame_bytes);
+    }
+}
+
+bool pcm_ring_finish(pcm_ring_t* pr) {
+    if (pr->fmt == PCM_RING_S16 || pr->pend_frames == 0) return true;
+    if (rb_free_space(&pr->rb) < pr->block_bytes) return false;
+    size_t n = PCM_RING_BLOCK - pr->pend_frames;
+    memset(pr->pend + pr->pend_frames * pr->channels, 0, n * pr->frame_bytes);
+    pcm_ring_commit(pr, n);
+    return true;
+}
+
+// ===== Consumer =====
+size_t pcm_ring_peek(pcm_ring_t* pr, const int16_t** src) {
+    if (pr->fmt == PCM_RING_S16) {
+        const void* p;
+        size_t n = rb_read_peek(&pr->rb, &p) / pr->frame_bytes;
+        *src = (const int16_t*)p;
+        return n;
+    }
+    if (pr->out_pos == pr->out_len) {
+        const void* p;
+        if (rb_read_peek(&pr->rb, &p) < pr->block_bytes) return 0;
+        unpack_block(pr, (const uint8_t*)p, pr->out);
+        rb_read_consume(&pr->rb, pr->block_bytes);
+        pr->out_pos = 0;
+        pr->out_len = PCM_RING_BLOCK;
+    }
+    *src = pr->out + pr->out_pos * pr->channels;
+    return pr->out_len - pr->out_pos;
+}
+
+void pcm_ring_consume(pcm_ring_t* pr, size_t frames) {
+    if (pr->fmt == PCM_RING_S16) rb_read_consume(&pr->rb, frames * pr->frame_bytes);
+    else pr->out_pos += frames;
+}
+
+void pcm_ring_drop(pcm_ring_t* pr) {
+    rb_read_consume(&pr->rb, rb_used_space(&pr->rb));
+    pr->out_pos = pr->out_len;
+}
+
+size_t pcm_ring_frames(const pcm_ring_t* pr) {
+    if (!pr->rb.data) return 0;
+    size_t used = rb_used_space(&pr->rb);
+    if (pr->fmt == PCM_RING_S16) return used / pr->frame_bytes;
+    return used / pr->block_bytes * PCM_RING_BLOCK + (pr->out_len - pr->out_pos);
+}
+
+size_t pcm_ring_capacity(const pcm_ring_t* pr) {
+    if (!pr->rb.data) return 0;
+    if (pr->fmt == PCM_RING_S16) return (pr->rb.size - 1) / pr->frame_bytes;
+    return (pr->rb.size / pr->block_bytes - 1) * PCM_RING_BLOCK;
+}
@@ -0,0 +1,72 @@
+// pcm_ring.h : Decoded PCM ring between the decoder and the music voice
+// Wraps ring_buffer_t with a storage format, so long buffers fit low-memory builds:
+//   PCM_RING_S16    int16 as decoded; decoder and consumer work in place (zero-copy)
+//   PCM_RING_S8     top 8 bits of each sample (rounded), half the RAM
+//   PCM_RING_ADPCM  IMA ADPCM, 4 bits per sample, a bit over a quarter of the RAM
+// Packed formats are stored in blocks of PCM_RING_BLOCK frames. An ADPCM block starts
+// with the predictor state of each channel, so every block decodes on its own (a
+// seek's flush can drop any number of them). The decoder writes full frames into a
+// scratch area which is packed on commit; the consumer unpacks one block at a time.
+//
+// The caller provides the memory (GC heap, a static region or a user bytearray), sized
+// with pcm_ring_mem(). Same threading rules as ring_buffer_t: one producer, one consumer.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "ring_buffer.h"
+
+typedef enum {
+    PCM_RING_S16   = 16,
+    PCM_RING_S8    = 8,
+    PCM_RING_ADPCM = 4,
+} pcm_ring_fmt_t;
+
+#define PCM_RING_BLOCK  64      // frames per packed block
+
+typedef struct {
+    int16_t pred;
+    uint8_t index;
+} pcm_adpcm_t;
+
+typedef struct {
+    ring_buffer_t  rb;
+    pcm_ring_fmt_t fmt;
+    int            channels;
+    size_t         frame_bytes;     // decoded frame, channels * 2
+    size_t         block_bytes;     // stored bytes per block (packed formats)
+    size_t         max_write;       // frames the producer writes at once
+
+    // Producer side (packed formats): decoded frames waiting to fill a block
+    int16_t*       pend;
+    size_t         pend_frames;
+    pcm_adpcm_t    enc[2];
+
+    // Consumer side (packed formats): the block being played
+    int16_t        out[PCM_RING_BLOCK * 2];
+    size_t         out_pos, out_len;
+} pcm_ring_t;
+
+// Bytes of memory for a ring holding about `frames` frames, written `max_write` at a time
+size_t pcm_ring_mem(size_t frames, pcm_ring_fmt_t fmt, int channels, size_t max_write);
+// Lay the ring out in `mem` (`bytes` long, from pcm_ring_mem or larger). False if too
+// small to take two writes.
+bool   pcm_ring_init(pcm_ring_t* pr, void* mem, size_t bytes, pcm_ring_fmt_t fmt,
+                     int channels, size_t max_write);
+void   pcm_ring_clear(pcm_ring_t* pr);            // both sides stopped
+
+// Producer: room for up to max_write frames at *dst (0 if not enough room), then commit
+size_t pcm_ring_reserve(pcm_ring_t* pr, int16_t** dst);
+void   pcm_ring_commit(pcm_ring_t* pr, size_t frames);
+// End of stream: pad the last partial block with silence and store it. False while the
+// ring has no room for it yet.
+bool   pcm_ring_finish(pcm_ring_t* pr);
+void   pcm_ring_restart(pcm_ring_t* pr);          // forget a partial block, after a drop
+
+// Consumer: contiguous readable frames at *src, then release n of them
+size_t pcm_ring_peek(pcm_ring_t* pr, const int16_t** src);
+void   pcm_ring_consume(pcm_ring_t* pr, size_t frames);
+void   pcm_ring_drop(pcm_ring_t* pr);             // consume everything buffered
+
+size_t pcm_ring_frames(const pcm_ring_t* pr);     // frames buffered
+size_t pcm_ring_capacity(const pcm_ring_t* pr);   // frames it can hold
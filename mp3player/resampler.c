@@ -0,0 +1,146 @@
+// resampler.c
+#include "resampler.h"
+#include <math.h>
+#include <string.h>
+
+#define RS_HALF  (RS_TAPS / 2)   // taps on each side of the output position
+#define RS_PI    3.14159265f
+#define RS_ONE   (1u << 16)      // step of a 1:1 ratio
+#define RS_FRAC_BITS (16 - RS_PHASE_BITS)   // position bits below the phase index
+#define RS_CUTOFF 0.9f           // of the lower Nyquist: margin for the transition band
+#define RS_BETA   9.0f           // Kaiser window shape: ~90 dB sidelobes
+
+// Modified Bessel function of the first kind, order 0 (series; the window needs a few
+// terms only)
+static float bessel_i0(float x){
+    float sum = 1.0f, term = 1.0f, q = x * x / 4.0f;
+    for (int k = 1; k < 20; k++) {
+        term *= q / (float)(k * k);
+        sum += term;
+    }
+    return sum;
+}
+
+static inline int16_t sat16(int32_t v){
+    if (v > 32767) return 32767;
+    if (v < -32768) return -32768;
+    return (int16_t)v;
+}
+
+// Filter for `step` into table `t` (float, but only when the ratio changes). Phase p sits
+// p/RS_PHASES of an input frame past the centre tap, up to and including a whole frame,
+// so a run can interpolate between any phase and the next. Each phase is normalised to a
+// gain of exactly 1.0 in Q15 so DC and quiet passages stay clean.
+static void build_table(int16_t t[RS_PHASES + 1][RS_TAPS], uint32_t step){
+    // Cutoff relative to the input Nyquist, below it when decimating
+    float fc = RS_CUTOFF * 65536.0f / (float)(step > 65536 ? step : 65536);
+    for (uint32_t p = 0; p <= RS_PHASES; p++) {
+        float frac = (float)p / (float)RS_PHASES;
+        float h[RS_TAPS], sum = 0;
+        for (int k = 0; k < RS_TAPS; k++) {
+            float x = (float)(k - (RS_HALF - 1)) - frac;   // distance to the output point
+            float s = x == 0.0f ? 1.0f : sinf(RS_PI * fc * x) / (RS_PI * fc * x);
+            // Kaiser window over the RS_TAPS span
+            float r = x / (float)RS_HALF;
+            float w = r * r < 1.0f ? bessel_i0(RS_BETA * sqrtf(1.0f - r * r)) / bessel_i0(RS_BETA) : 0.0f;
+            h[k] = fc * s * w;
+            sum += h[k];
+        }
+        int32_t q[RS_TAPS], total = 0, big = 0;
+        for (int k = 0; k < RS_TAPS; k++) {
+            q[k] = (int32_t)lroundf(h[k] / sum * 32768.0f);
+            total += q[k];
+            if (q[k] > q[big]) big = k;
+        }
+        q[big] += 32768 - total;   // rounding residue onto the main tap
+        for (int k = 0; k < RS_TAPS; k++) t[p][k] = sat16(q[k]);
+    }
+}
+
+void resampler_set_ratio(resampler_t* rs, uint32_t in_rate, uint32_t out_rate){
+    uint32_t step = (uint32_t)(((uint64_t)in_rate << 16) / out_rate);
+    if (step > (RS_MAX_STEP << 16)) step = RS_MAX_STEP << 16;
+    if (step == 0) step = 1;
+    uint32_t off = step > RS_ONE ? step - RS_ONE : RS_ONE - step;
+    if ((uint64_t)off * 1000000u <= (uint64_t)RS_PASS_PPM * RS_ONE) {
+        // Pass-through needs no table: runs check the step before they touch one
+        rs->step = RS_ONE;
+        return;
+    }
+    if (step == rs->step) return;
+    uint32_t next = rs->active ^ 1u;
+    build_table(rs->coef[next], step);
+    __atomic_store_n(&rs->active, next, __ATOMIC_RELEASE);
+    rs->step = step;
+}
+
+void resampler_init(resampler_t* rs, uint32_t in_rate, uint32_t out_rate){
+    // Zero history ahead of the first input so the first output lands on it
+    memset(rs->hist, 0, sizeof(rs->hist));
+    rs->have = RS_HALF - 1;
+    rs->pos = (uint32_t)(RS_HALF - 1) << 16;
+    resampler_set_ratio(rs, in_rate, out_rate);
+}
+
+size_t resampler_needed(const resampler_t* rs, size_t n_out){
+    if (n_out == 0) return 0;
+    size_t last = (size_t)((rs->pos + (uint32_t)(n_out - 1) * rs->step) >> 16);
+    size_t want = last + RS_HALF + 1;
+    return want > rs->have ? want - rs->have : 0;
+}
+
+size_t resampler_space(resampler_t* rs, int16_t** dst){
+    // Drop input no longer under the filter
+    size_t base = (rs->pos >> 16) - (RS_HALF - 1);
+    if (base > rs->have) base = rs->have;
+    if (base) {
+        memmove(rs->hist, rs->hist + 2 * base, (rs->have - base) * 2 * sizeof(int16_t));
+        rs->have -= base;
+        rs->pos -= (uint32_t)base << 16;
+    }
+    *dst = rs->hist + 2 * rs->have;
+    return RS_HIST - rs->have;
+}
+
+void resampler_push(resampler_t* rs, size_t frames){
+    rs->have += frames;
+}
+
+size_t resampler_run(resampler_t* rs, int16_t* out, size_t n_out){
+    const int16_t (*coef)[RS_TAPS] = rs->coef[__atomic_load_n(&rs->active, __ATOMIC_ACQUIRE)];
+    uint32_t step = rs->step;
+    uint32_t pos = rs->pos;
+    size_t n = 0;
+    if (step == RS_ONE) {
+        // 1:1: the nearest input frame, unfiltered (the position keeps any fraction it
+        // had from an earlier ratio)
+        size_t first = pos >> 16;
+        size_t avail = first + RS_HALF < rs->have ? rs->have - RS_HALF - first : 0;
+        n = n_out < avail ? n_out : avail;
+        memcpy(out, rs->hist + 2 * ((pos + 0x8000u) >> 16), n * 2 * sizeof(int16_t));
+        rs->pos = pos + (uint32_t)n * RS_ONE;
+        return n;
+    }
+    while (n < n_out) {
+        uint32_t i = pos >> 16;
+        if (i + RS_HALF >= rs->have) break;   // starved: resume here after the next push
+        // Coefficients between the two nearest phases, by the position bits below them
+        uint32_t ph = (pos & 0xFFFFu) >> RS_FRAC_BITS;
+        int32_t f = (int32_t)(pos & ((1u << RS_FRAC_BITS) - 1u));
+        const int16_t* c0 = coef[ph];
+        const int16_t* c1 = coef[ph + 1];
+        const int16_t* x = rs->hist + 2 * (i - (RS_HALF - 1));
+        int32_t l = 0, r = 0;
+        for (int k = 0; k < RS_TAPS; k++) {
+            int32_t c = c0[k] + (((c1[k] - c0[k]) * f) >> RS_FRAC_BITS);
+            l += c * x[2*k];
+            r += c * x[2*k + 1];
+        }
+        out[2*n]     = sat16((l + (1 << 14)) >> 15);
+        out[2*n + 1] = sat16((r + (1 << 14)) >> 15);
+        pos += step;
+        n++;
+    }
+    rs->pos = pos;
+    return n;
+}
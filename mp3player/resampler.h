@@ -0,0 +1,48 @@
+// resampler.h : Fixed-point polyphase sample-rate converter for the audio output
+// Windowed-sinc (Kaiser) filter, RS_TAPS taps in each of RS_PHASES phases, with the
+// coefficients interpolated linearly between the two phases nearest each output, Q15
+// coefficients and 32-bit accumulators, so it runs on the M0+ without an FPU. The
+// cutoff follows the ratio, so downsampling (48 kHz files, speed-up) does not alias.
+// Over 20 Hz..20 kHz it stays within about 1 dB of the PWM's own SNR up to 4x
+// oversampling, and above 80 dB at 8x (host/snrbench).
+//
+// Input is interleaved stereo int16 pushed into an internal history; the caller asks
+// how many frames the next run needs, copies them in, then runs.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#define RS_TAPS        16
+#define RS_PHASE_BITS  7
+#define RS_PHASES      (1u << RS_PHASE_BITS)
+#define RS_MAX_STEP    5        // input/output ratio limit (192 kHz in at 44.1 kHz out)
+#define RS_MAX_OUT     64       // output frames per run
+// Ratios within this of 1:1 copy samples through instead of filtering. The PWM output
+// cannot hit 44.1 kHz exactly (44075 Hz at 125 MHz and 4x), and at that offset a pitch
+// shift of under 2 cents is cheaper than ~2 multiplies per tap for every sample.
+#define RS_PASS_PPM    1000
+#define RS_HIST        (RS_TAPS + RS_MAX_OUT * RS_MAX_STEP)   // input frames held
+
+typedef struct {
+    volatile uint32_t step;     // input frames per output frame, Q16.16
+    volatile uint32_t active;   // coefficient table in use
+    uint32_t pos;               // next output position in hist, Q16.16
+    size_t   have;              // input frames in hist
+    int16_t  hist[2 * RS_HIST];
+    int16_t  coef[2][RS_PHASES + 1][RS_TAPS];
+} resampler_t;
+
+// Clear the history and set the ratio. `rs` must start zeroed (static); the filter is
+// kept when the ratio is unchanged.
+void   resampler_init(resampler_t* rs, uint32_t in_rate, uint32_t out_rate);
+// Change the ratio while running: the new filter is built in the idle table, then
+// swapped in, so the consumer never sees a half-written one. Within RS_PASS_PPM of 1:1
+// the step becomes exactly 1.0 and runs copy the input.
+void   resampler_set_ratio(resampler_t* rs, uint32_t in_rate, uint32_t out_rate);
+// Input frames still missing for `n_out` more output frames
+size_t resampler_needed(const resampler_t* rs, size_t n_out);
+// Writable input space: up to the returned frame count at *dst, published by push
+size_t resampler_space(resampler_t* rs, int16_t** dst);
+void   resampler_push(resampler_t* rs, size_t frames);
+// Produce up to `n_out` (<= RS_MAX_OUT) stereo frames from what was pushed
+size_t resampler_run(resampler_t* rs, int16_t* out, size_t n_out);
@@ -6,39 +6,81 @@
 
 static size_t minz(size_t a, size_t b){ return a < b ? a : b; }
 
+// Index handoff between producer and consumer (dmb on Cortex-M0+/M33)
+static inline size_t idx_load(const volatile size_t* p){ return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+static inline void   idx_store(volatile size_t* p, size_t v){ __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+
 bool rb_init(ring_buffer_t* rb, size_t size_bytes) {
-    rb->data = (uint8_t*)m_new(uint8_t, size_bytes);
+    return rb_init_contig(rb, size_bytes, 0);
+}
+
+bool rb_init_contig(ring_buffer_t* rb, size_t size_bytes, size_t max_contig) {
+    rb->data = (uint8_t*)m_new(uint8_t, size_bytes + max_contig);
     if (!rb->data) return false;
-    rb->size = size_bytes; rb->r = rb->w = 0;
+    rb->size = size_bytes; rb->slack = max_contig; rb->r = rb->w = 0;
     return true;
 }
 
+void rb_init_mem(ring_buffer_t* rb, void* mem, size_t size_bytes, size_t max_contig) {
+    rb->data = (uint8_t*)mem;
+    rb->size = size_bytes; rb->slack = max_contig; rb->r = rb->w = 0;
+}
+
 void rb_free(ring_buffer_t* rb){
-    if (rb->data) m_del(uint8_t, rb->data, rb->size);
-    rb->data=NULL; rb->size=rb->r=rb->w=0;
+    if (rb->data) m_del(uint8_t, rb->data, rb->size + rb->slack);
+    rb->data=NULL; rb->size=rb->slack=rb->r=rb->w=0;
+}
+static size_t used_of(size_t size, size_t r, size_t w){
+    return (w >= r) ? (w - r) : (size - (r - w));
 }
 size_t rb_used_space(const ring_buffer_t* rb){
-    return (rb->w >= rb->r) ? (rb->w - rb->r) : (rb->size - (rb->r - rb->w));
+    return used_of(rb->size, idx_load(&rb->r), idx_load(&rb->w));
 }
 size_t rb_free_space(const ring_buffer_t* rb){ return rb->size - rb_used_space(rb) - 1; }
 size_t rb_write(ring_buffer_t* rb, const void* src, size_t n){
-    size_t free1 = rb_free_space(rb); if (n > free1) n = free1;
-    size_t tail = rb->size - rb->w;
+    size_t w = rb->w;
+    size_t free1 = rb->size - used_of(rb->size, idx_load(&rb->r), w) - 1;
+    if (n > free1) n = free1;
+    size_t tail = rb->size - w;
     size_t n1 = minz(n, tail);
-    memcpy(rb->data + rb->w, src, n1);
+    memcpy(rb->data + w, src, n1);
     size_t n2 = n - n1;
     if (n2) memcpy(rb->data, (const uint8_t*)src + n1, n2);
-    rb->w = (rb->w + n) % rb->size;
+    idx_store(&rb->w, (w + n) % rb->size);
     return n;
 }
 size_t rb_read(ring_buffer_t* rb, void* dst, size_t n){
-    size_t used = rb_used_space(rb); if (n > used) n = used;
-    size_t tail = rb->size - rb->r;
+    size_t r = rb->r;
+    size_t used = used_of(rb->size, r, idx_load(&rb->w));
+    if (n > used) n = used;
+    size_t tail = rb->size - r;
     size_t n1 = minz(n, tail);
-    memcpy(dst, rb->data + rb->r, n1);
+    memcpy(dst, rb->data + r, n1);
     size_t n2 = n - n1;
     if (n2) memcpy((uint8_t*)dst + n1, rb->data, n2);
-    rb->r = (rb->r + n) % rb->size;
+    idx_store(&rb->r, (r + n) % rb->size);
     return n;
 }
 void rb_clear(ring_buffer_t* rb){ rb->r = rb->w = 0; }
+
+size_t rb_write_reserve(ring_buffer_t* rb, void** ptr){
+    size_t w = rb->w;
+    size_t free1 = rb->size - used_of(rb->size, idx_load(&rb->r), w) - 1;
+    *ptr = rb->data + w;
+    return minz(free1, rb->size - w + rb->slack);
+}
+void rb_write_commit(ring_buffer_t* rb, size_t n){
+    size_t w = rb->w;
+    // Bytes written into the slack belong at the start of the ring
+    if (w + n > rb->size) memcpy(rb->data, rb->data + rb->size, w + n - rb->size);
+    idx_store(&rb->w, (w + n) % rb->size);
+}
+size_t rb_read_peek(const ring_buffer_t* rb, const void** ptr){
+    size_t r = rb->r;
+    size_t w = idx_load(&rb->w);
+    *ptr = rb->data + r;
+    return (w >= r) ? (w - r) : (rb->size - r);
+}
+void rb_read_consume(ring_buffer_t* rb, size_t n){
+    idx_store(&rb->r, (rb->r + n) % rb->size);
+}
@@ -4,17 +4,40 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+// Single-producer/single-consumer: one context may write while another reads (e.g.
+// core 1 decode -> DMA IRQ on core 0) without locks. Each index is only stored by its
+// owner, with release/acquire ordering so the data is visible before the index moves.
+// rb_init/rb_free/rb_clear need both sides stopped.
+//
+// Zero-copy access: the producer reserves a contiguous region at the write index, fills
+// it in place and commits; the consumer peeks the contiguous readable region, uses it in
+// place and consumes. With `slack` bytes allocated past the end (rb_init_contig), a
+// reservation can run over the wrap point by up to `slack`; commit folds that overflow
+// back to the start, so a writer can always get a full fixed-size block in one piece.
 typedef struct {
-    uint8_t* data;
-    size_t   size;   // bytes
-    size_t   r;      // read index
-    size_t   w;      // write index
+    uint8_t*        data;
+    size_t          size;   // bytes
+    size_t          slack;  // extra writable bytes past `size` (see rb_init_contig)
+    volatile size_t r;      // read index (owned by the consumer)
+    volatile size_t w;      // write index (owned by the producer)
 } ring_buffer_t;
 
 bool  rb_init(ring_buffer_t* rb, size_t size_bytes);
+// As rb_init, but rb_write_reserve can return up to `max_contig` contiguous bytes anywhere
+bool  rb_init_contig(ring_buffer_t* rb, size_t size_bytes, size_t max_contig);
+// As rb_init_contig, on memory the caller owns (`size_bytes + max_contig` long); such a
+// ring is not passed to rb_free
+void  rb_init_mem(ring_buffer_t* rb, void* mem, size_t size_bytes, size_t max_contig);
 void  rb_free(ring_buffer_t* rb);
 size_t rb_free_space(const ring_buffer_t* rb); // bytes
 size_t rb_used_space(const ring_buffer_t* rb); // bytes
 size_t rb_write(ring_buffer_t* rb, const void* src, size_t nbytes);
 size_t rb_read(ring_buffer_t* rb, void* dst, size_t nbytes);
 void   rb_clear(ring_buffer_t* rb);
+
+// Producer: contiguous writable bytes at *ptr (limited by free space), then publish n of them
+size_t rb_write_reserve(ring_buffer_t* rb, void** ptr);
+void   rb_write_commit(ring_buffer_t* rb, size_t n);
+// Consumer: contiguous readable bytes at *ptr (up to the wrap point), then release n of them
+size_t rb_read_peek(const ring_buffer_t* rb, const void** ptr);
+void   rb_read_consume(ring_buffer_t* rb, size_t n);
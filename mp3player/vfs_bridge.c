@@ -2,17 +2,26 @@
 #include "vfs_bridge.h"
 #include "py/runtime.h"
 #include "py/stream.h"
+#include "extmod/vfs.h"
 #include <string.h>
 
-bool vfs_open_rb(const char* path, mp_obj_t* out_file){
+static bool vfs_open_mode(const char* path, const char* mode, mp_obj_t* out_file){
 	mp_obj_t open_fn = mp_load_global(MP_QSTR_open);
-	mp_obj_t args[2] = { mp_obj_new_str(path, strlen(path)), mp_obj_new_str("rb", 2) };
+	mp_obj_t args[2] = { mp_obj_new_str(path, strlen(path)), mp_obj_new_str(mode, strlen(mode)) };
 	mp_obj_t file = mp_call_function_n_kw(open_fn, 2, 0, args);
 	if (file == MP_OBJ_NULL) return false;
 	*out_file = file;
 	return true;
 }
 
+bool vfs_open_rb(const char* path, mp_obj_t* out_file){
+	return vfs_open_mode(path, "rb", out_file);
+}
+
+bool vfs_open_wb(const char* path, mp_obj_t* out_file){
+	return vfs_open_mode(path, "wb", out_file);
+}
+
 int vfs_read(mp_obj_t file, uint8_t* buf, size_t nbytes){
 	if (file == MP_OBJ_NULL) return -1;
 	if (nbytes == 0) return 0;
@@ -23,9 +32,83 @@ int vfs_read(mp_obj_t file, uint8_t* buf, size_t nbytes){
 	return (int)r;
 }
 
+int vfs_write(mp_obj_t file, const uint8_t* buf, size_t nbytes){
+	if (file == MP_OBJ_NULL) return -1;
+	const mp_stream_p_t* stream_p = mp_get_stream(file);
+	int err = 0;
+	mp_uint_t r = stream_p->write(file, buf, nbytes, &err);
+	if (r == MP_STREAM_ERROR) return -err;
+	return (int)r;
+}
+
+bool vfs_seek(mp_obj_t file, uint32_t offset){
+	if (file == MP_OBJ_NULL) return false;
+	int err = 0;
+	mp_stream_seek(file, (mp_off_t)offset, MP_SEEK_SET, &err);
+	return err == 0;
+}
+
+int32_t vfs_size(mp_obj_t file){
+	if (file == MP_OBJ_NULL) return -1;
+	int err = 0;
+	mp_off_t cur = mp_stream_seek(file, 0, MP_SEEK_CUR, &err);
+	if (err) return -err;
+	mp_off_t end = mp_stream_seek(file, 0, MP_SEEK_END, &err);
+	if (err) return -err;
+	mp_stream_seek(file, cur, MP_SEEK_SET, &err);
+	return (int32_t)end;
+}
+
 void vfs_close(mp_obj_t* file){
 	if (!file || *file == MP_OBJ_NULL) return;
 	mp_obj_t close_meth = mp_load_attr(*file, MP_QSTR_close);
 	mp_call_function_0(close_meth);
 	*file = MP_OBJ_NULL;
 }
+
+bool vfs_stat(const char* path, uint32_t* size, uint32_t* mtime){
+	mp_obj_t st = mp_vfs_stat(mp_obj_new_str(path, strlen(path)));
+	size_t n;
+	mp_obj_t* items;
+	mp_obj_get_array(st, &n, &items);
+	if (n < 9) return false;
+	*size = (uint32_t)mp_obj_get_int_truncated(items[6]);
+	*mtime = (uint32_t)mp_obj_get_int_truncated(items[8]);
+	return true;
+}
+
+bool vfs_dir_open(const char* path, mp_obj_t* out_iter){
+	mp_obj_t arg = mp_obj_new_str(path, strlen(path));
+	*out_iter = mp_vfs_ilistdir(1, &arg);
+	return *out_iter != MP_OBJ_NULL;
+}
+
+bool vfs_dir_next(mp_obj_t iter, char* name, size_t cap, bool* is_dir){
+	mp_obj_t entry = mp_iternext(iter);
+	if (entry == MP_OBJ_STOP_ITERATION) return false;
+	size_t n;
+	mp_obj_t* items;
+	mp_obj_get_array(entry, &n, &items);
+	size_t len;
+	const char* s = mp_obj_str_get_data(items[0], &len);
+	if (len >= cap) len = cap - 1;
+	memcpy(name, s, len);
+	name[len] = '\0';
+	*is_dir = n > 1 && (mp_obj_get_int(items[1]) & MP_S_IFDIR) == MP_S_IFDIR;
+	return true;
+}
+
+void vfs_dir_close(mp_obj_t* iter){
+	// The iterator closes the directory itself when exhausted or collected
+	*iter = MP_OBJ_NULL;
+}
+
+bool vfs_remove(const char* path){
+	mp_vfs_remove(mp_obj_new_str(path, strlen(path)));
+	return true;
+}
+
+bool vfs_rename(const char* from, const char* to){
+	mp_vfs_rename(mp_obj_new_str(from, strlen(from)), mp_obj_new_str(to, strlen(to)));
+	return true;
+}
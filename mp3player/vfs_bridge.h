@@ -11,3 +11,21 @@ bool vfs_open_rb(const char* path, mp_obj_t* out_file);
 int  vfs_read(mp_obj_t file, uint8_t* buf, size_t nbytes);
 // Close file if open.
 void vfs_close(mp_obj_t* file);
+// Open file for binary write (truncating). Returns true on success and stores file object.
+bool vfs_open_wb(const char* path, mp_obj_t* out_file);
+// Write nbytes from buf. Returns bytes written, <0 on error.
+int  vfs_write(mp_obj_t file, const uint8_t* buf, size_t nbytes);
+// Move the read position to an absolute byte offset.
+bool vfs_seek(mp_obj_t file, uint32_t offset);
+// File size in bytes (read position is restored), <0 on error.
+int32_t vfs_size(mp_obj_t file);
+// Size and modification time (seconds, filesystem epoch) of `path`; false if missing.
+bool vfs_stat(const char* path, uint32_t* size, uint32_t* mtime);
+// Directory listing: open an iterator over `path`, then take entries one by one (name
+// copied into `name`, truncated to `cap`). vfs_dir_next returns false after the last.
+bool vfs_dir_open(const char* path, mp_obj_t* out_iter);
+bool vfs_dir_next(mp_obj_t iter, char* name, size_t cap, bool* is_dir);
+void vfs_dir_close(mp_obj_t* iter);
+// Delete / rename a file. False on failure.
+bool vfs_remove(const char* path);
+bool vfs_rename(const char* from, const char* to);
@@ -80,7 +80,11 @@ fb_s.buf_ptr = addressof(buf2)
 
 '''
 class PicoDisplay(framebuf.FrameBuffer):
-    def __init__(self, width, height,color_type = framebuf.GS4_HMSB):
+    # Refreshes send only what was drawn since the last one (partial=True). The drawing
+    # methods below mark what they touch; after writing the buffer or the LUT view any
+    # other way, call markDirty(). With doubleBuffer() they draw into a back buffer that
+    # show() flips onto the screen.
+    def __init__(self, width, height,color_type = framebuf.GS4_HMSB,partial=True):
         self.width = width
         self.height = height
         if color_type == framebuf.GS4_HMSB:
@@ -96,7 +100,83 @@ class PicoDisplay(framebuf.FrameBuffer):
 
 
         super().__init__(buffer, self.width, self.height, color_type)
+        self._buffer = buffer
+        self._format = color_type
+        self._draw = framebuf.FrameBuffer(buffer, self.width, self.height, color_type)
+        self._shown = None
         picocalcdisplay.init(buffer,color_type,True)
+        picocalcdisplay.partialUpdate(partial)
+
+    def doubleBuffer(self, on=True):
+        if on and self._shown is None:
+            back = bytearray(len(self._buffer))
+            picocalcdisplay.doubleBuffer(back)
+            self._shown = self._draw
+            self._draw = framebuf.FrameBuffer(back, self.width, self.height, self._format)
+        elif not on and self._shown is not None:
+            picocalcdisplay.doubleBuffer(None)
+            self._draw = framebuf.FrameBuffer(self._buffer, self.width, self.height, self._format)
+            self._shown = None
+
+    def markDirty(self, x=0, y=0, w=None, h=None):
+        if w is None:
+            picocalcdisplay.markDirty()
+        else:
+            picocalcdisplay.markDirty(x, y, w, h)
+
+    def fill(self, c):
+        self._draw.fill(c)
+        picocalcdisplay.markDirty()
+
+    def pixel(self, x, y, c=None):
+        if c is None:
+            return self._draw.pixel(x, y)
+        self._draw.pixel(x, y, c)
+        picocalcdisplay.markDirty(x, y, 1, 1)
+
+    def hline(self, x, y, w, c):
+        self._draw.hline(x, y, w, c)
+        picocalcdisplay.markDirty(x, y, w, 1)
+
+    def vline(self, x, y, h, c):
+        self._draw.vline(x, y, h, c)
+        picocalcdisplay.markDirty(x, y, 1, h)
+
+    def line(self, x1, y1, x2, y2, c):
+        self._draw.line(x1, y1, x2, y2, c)
+        picocalcdisplay.markDirty(min(x1, x2), min(y1, y2), abs(x2 - x1) + 1, abs(y2 - y1) + 1)
+
+    def rect(self, x, y, w, h, c, f=False):
+        self._draw.rect(x, y, w, h, c, f)
+        picocalcdisplay.markDirty(x, y, w, h)
+
+    def fill_rect(self, x, y, w, h, c):
+        self._draw.fill_rect(x, y, w, h, c)
+        picocalcdisplay.markDirty(x, y, w, h)
+
+    def ellipse(self, x, y, xr, yr, c, f=False, m=15):
+        self._draw.ellipse(x, y, xr, yr, c, f, m)
+        picocalcdisplay.markDirty(x - xr, y - yr, 2 * xr + 1, 2 * yr + 1)
+
+    def poly(self, x, y, coords, c, f=False):
+        self._draw.poly(x, y, coords, c, f)
+        xs = coords[0::2]
+        ys = coords[1::2]
+        if xs:
+            picocalcdisplay.markDirty(x + min(xs), y + min(ys), max(xs) - min(xs) + 1, max(ys) - min(ys) + 1)
+
+    def blit(self, fbuf, x, y, key=-1, palette=None):
+        self._draw.blit(fbuf, x, y, key, palette)
+        if isinstance(fbuf, tuple):
+            picocalcdisplay.markDirty(x, y, fbuf[1], fbuf[2])
+        elif hasattr(fbuf, 'width'):
+            picocalcdisplay.markDirty(x, y, fbuf.width, fbuf.height)
+        else:
+            picocalcdisplay.markDirty()
+
+    def scroll(self, xstep, ystep):
+        self._draw.scroll(xstep, ystep)
+        picocalcdisplay.markDirty()
 
     def restLUT(self):
         picocalcdisplay.resetLUT(0)
@@ -129,10 +209,21 @@ class PicoDisplay(framebuf.FrameBuffer):
 
     def show(self,core=1):
         picocalcdisplay.update(core)
+        if self._shown is not None:
+            self._shown, self._draw = self._draw, self._shown
 
     def isScreenUpdateDone(self):
         return picocalcdisplay.isScreenUpdateDone()
 
+    def setMaxFps(self, fps):
+        picocalcdisplay.setMaxFps(fps)
+
+    def refreshStats(self, reset=False):
+        return picocalcdisplay.refreshStats(reset)
+
+    def vsync(self, pin=None):
+        return picocalcdisplay.vsync(pin)
+
 class PicoKeyboard:
     def __init__(self,sclPin=7,sdaPin=6,address=0x1f):
         self.hardwarekeyBuf = deque((),30)
@@ -0,0 +1,3 @@
+// hardware/gpio.h : Host stand-in, see sdk_host.h
+#pragma once
+#include "sdk_host.h"
@@ -0,0 +1,367 @@
+// panelmodel.c : Host model of the display path, checked against the framebuffer
+// Builds picocalcdisplay.c against sdk_host.h with a model of the panel on the SPI bus
+// (CASET/RASET windows, RAMWR pixels), a DMA that copies at once, a settable clock and
+// a TE pin. Checks, exiting 1 on any failure:
+//  - core 1 pacing: one wake per burst of marks, the frame rate cap, sleeping when clean
+//  - vsync: the TE period, refreshing on a fresh edge, the timeout when TE stops
+//  - per format (RGB565, GS8, GS4, GS2, MONO): the panel matches the framebuffer after
+//    random partial refreshes, a keystroke and drawTxt6x8 send one small window
+//  - double buffering: nothing shows before a flip, each flip shows the back buffer,
+//    the back catches up after it, and text drawn through pSetPixel lands in the back
+//    buffer and stays on screen across later flips
+//
+//   cmake -S picocalcdisplay/host -B build-lut && cmake --build build-lut
+//   build-lut/panelmodel
+#include <stdio.h>
+#include <stdlib.h>
+#include "picocalcdisplay.c"
+
+static int failures;
+
+static void check(bool ok, const char *what){
+    if (!ok){
+      printf("FAIL: %s\n", what);
+      failures++;
+    }
+}
+
+// ===== MicroPython =====
+const mp_obj_type_t mp_type_module;
+const int mp_const_none_obj;
+#define I(v) ((mp_obj_t)(intptr_t)(v))
+static mp_obj_t lastTuple[8];
+static float lastFloat;
+mp_obj_t mp_obj_new_int_from_uint(mp_uint_t v) { return I(v); }
+mp_obj_t mp_obj_new_float(mp_float_t f) { lastFloat = f; return &lastFloat; }
+mp_obj_t mp_obj_new_bool(mp_int_t v) { return I(v != 0); }
+mp_obj_t mp_obj_new_tuple(size_t n, const mp_obj_t *items) { memcpy(lastTuple, items, n * sizeof(mp_obj_t)); return NULL; }
+mp_obj_t mp_obj_new_memoryview(char typecode, size_t nitems, void *items) { (void)typecode; (void)nitems; return items; }
+mp_int_t mp_obj_get_int(mp_obj_t o) { return (mp_int_t)(intptr_t)o; }
+bool mp_obj_is_true(mp_obj_t o) { return o != NULL; }
+const char *mp_obj_str_get_str(mp_obj_t o) { return (const char *)o; }
+void mp_raise_ValueError(const char *msg) { printf("FAIL: ValueError %s\n", msg); exit(1); }
+
+static uint8_t fb[DISPLAY_WIDTH * DISPLAY_HEIGHT * 2], fb2[DISPLAY_WIDTH * DISPLAY_HEIGHT * 2];
+static size_t fbBytes;
+void mp_get_buffer_raise(mp_obj_t o, mp_buffer_info_t *info, int flags){
+    (void)flags;
+    info->buf = o == (mp_obj_t)fb2 ? fb2 : fb;
+    info->len = fbBytes;
+}
+
+// ===== Clock and TE pin =====
+#define TE_PERIOD 16667
+static int64_t nowUs;
+static bool clockRuns;          // each time_us_32() call advances 10 us (busy waits)
+static int tePinModel = -1;     // pin the panel drives TE on, -1 when it is silent
+static int64_t lastTe;
+io_bank0_hw_t io_bank0_host;
+scb_hw_t scb_host;
+static bool teIrqEnabled;
+
+static void te_advance(void){
+    if (tePinModel < 0) return;
+    while (lastTe + TE_PERIOD <= nowUs){
+      lastTe += TE_PERIOD;
+      io_bank0_host.intr[tePinModel >> 3] |= GPIO_IRQ_EDGE_RISE << (4 * (tePinModel & 7));
+    }
+}
+uint32_t time_us_32(void){
+    if (clockRuns) nowUs += 10;
+    te_advance();
+    return (uint32_t)nowUs;
+}
+absolute_time_t get_absolute_time(void) { return nowUs; }
+absolute_time_t make_timeout_time_us(uint64_t us) { return nowUs + us; }
+absolute_time_t delayed_by_us(absolute_time_t t, uint64_t us) { return t + us; }
+int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to) { return to - from; }
+void sleep_ms(uint32_t ms) { (void)ms; }
+void gpio_acknowledge_irq(uint pin, uint32_t events) { io_bank0_host.intr[pin >> 3] &= ~(events << (4 * (pin & 7))); }
+void gpio_set_irq_enabled(uint pin, uint32_t events, bool enabled) { (void)pin; (void)events; teIrqEnabled = enabled; }
+void irq_clear(uint num) { (void)num; }
+uint get_core_num(void) { return 1; }
+
+// ===== Core 1 scheduler =====
+static uint32_t idleFor;
+static int wakes;
+int core1_task_add(core1_task_fn_t fn, void *user) { (void)fn; (void)user; return 0; }
+void core1_task_sync(int id) { (void)id; }
+void core1_task_idle_for(uint32_t us) { idleFor = us; }
+void core1_wake(void) { wakes++; }
+
+// ===== Panel on SPI1 =====
+struct spi_inst { int unused; };
+static struct spi_inst spi1Inst;
+spi_inst_t *spi1 = &spi1Inst;
+static spi_hw_t spiHw;
+static bool csHigh = true, dcData;
+static int cmd = -1, paramCount, halfPixel;
+static uint8_t params[4], firstByte;
+static int winX0, winX1 = DISPLAY_WIDTH - 1, winY0, winY1 = DISPLAY_HEIGHT - 1, px, py;
+static uint16_t panel[DISPLAY_WIDTH * DISPLAY_HEIGHT];
+static long bytes, windows;
+
+static void panel_data(uint8_t b){
+    bytes++;
+    if (cmd == CASET || cmd == RASET){
+      if (paramCount < 4) params[paramCount++] = b;
+      if (paramCount == 4){
+        int a = params[0] << 8 | params[1], e = params[2] << 8 | params[3];
+        if (cmd == CASET){ winX0 = a; winX1 = e; }else{ winY0 = a; winY1 = e; }
+      }
+      return;
+    }
+    if (cmd != RAMWR) return;
+    if (!halfPixel){
+      firstByte = b;
+      halfPixel = 1;
+      return;
+    }
+    halfPixel = 0;
+    if (py <= winY1) panel[py * DISPLAY_WIDTH + px] = firstByte | b << 8;
+    if (++px > winX1){ px = winX0; py++; }
+}
+spi_hw_t *spi_get_hw(spi_inst_t *spi) { (void)spi; return &spiHw; }
+uint spi_get_dreq(spi_inst_t *spi, bool tx) { (void)spi; (void)tx; return 0; }
+uint spi_init(spi_inst_t *spi, uint baudrate) { (void)spi; return baudrate; }
+int spi_write_blocking(spi_inst_t *spi, const uint8_t *src, size_t len){
+    (void)spi;
+    check(!csHigh, "SPI write with CS high");
+    for (size_t i = 0; i < len; i++){
+      if (dcData){
+        panel_data(src[i]);
+        continue;
+      }
+      bytes++;
+      cmd = src[i];
+      paramCount = 0;
+      if (cmd == RAMWR){ px = winX0; py = winY0; halfPixel = 0; windows++; }
+    }
+    return (int)len;
+}
+void gpio_init(uint pin) { (void)pin; }
+void gpio_put(uint pin, bool value){
+    if (pin == CS_PIN) csHigh = value;
+    if (pin == DC_PIN) dcData = value;
+}
+void gpio_set_dir(uint pin, bool out) { (void)pin; (void)out; }
+void gpio_set_function(uint pin, int fn) { (void)pin; (void)fn; }
+
+// ===== DMA (copies when started) and locks =====
+static uint32_t dmaCount;
+int dma_claim_unused_channel(bool required) { (void)required; return 0; }
+dma_channel_config dma_channel_get_default_config(uint channel) { (void)channel; dma_channel_config c = {0}; return c; }
+void channel_config_set_transfer_data_size(dma_channel_config *c, int size) { (void)c; (void)size; }
+void channel_config_set_bswap(dma_channel_config *c, bool bswap) { (void)c; (void)bswap; }
+void channel_config_set_dreq(dma_channel_config *c, uint dreq) { (void)c; (void)dreq; }
+void dma_channel_configure(uint channel, const dma_channel_config *c, volatile void *write,
+                           const volatile void *read, uint count, bool trigger){
+    (void)channel; (void)c; (void)write; (void)read; (void)count; (void)trigger;
+}
+bool dma_channel_is_busy(uint channel) { (void)channel; return false; }
+void dma_channel_set_trans_count(uint channel, uint32_t count, bool trigger) { (void)channel; (void)trigger; dmaCount = count; }
+void dma_channel_set_read_addr(uint channel, const volatile void *read, bool trigger){
+    (void)channel; (void)trigger;
+    check(dcData && !csHigh, "DMA outside a data phase");
+    const uint8_t *p = (const uint8_t *)read;
+    for (uint32_t i = 0; i < dmaCount; i++) panel_data(p[i]);
+}
+static spin_lock_t lockWord;
+int spin_lock_claim_unused(bool required) { (void)required; return 0; }
+spin_lock_t *spin_lock_init(uint num) { (void)num; return &lockWord; }
+uint32_t spin_lock_blocking(spin_lock_t *lock){
+    check(*lock == 0, "dirty lock taken twice");
+    *lock = 1;
+    return 0;
+}
+void spin_unlock(spin_lock_t *lock, uint32_t saved) { (void)saved; *lock = 0; }
+
+// ===== Checks =====
+static int format;
+static const uint8_t *shownBuff;   // the buffer the panel should show
+
+static uint16_t expected_pixel(int x, int y){
+    const uint8_t *b = shownBuff;
+    int i = y * DISPLAY_WIDTH + x;
+    switch (format){
+      case 1: return ((const uint16_t *)b)[i];
+      case 6: return LUT[b[i]];
+      case 2: return LUT[(x & 1) ? b[i >> 1] & 0x0F : b[i >> 1] >> 4];
+      case 5: return LUT[(b[i >> 2] >> ((x & 3) * 2)) & 0x03];
+      default: return LUT[(b[i >> 3] >> (x & 7)) & 0x01];
+    }
+}
+
+static int bad_pixels(void){
+    int bad = 0;
+    for (int y = 0; y < DISPLAY_HEIGHT; y++){
+      for (int x = 0; x < DISPLAY_WIDTH; x++){
+        bad += panel[y * DISPLAY_WIDTH + x] != expected_pixel(x, y);
+      }
+    }
+    return bad;
+}
+
+static void draw_random_rect(int maxW, int maxH){
+    int x = rand() % 340 - 10, y = rand() % 340 - 10;
+    int w = 1 + rand() % maxW, h = 1 + rand() % maxH;
+    for (int yy = y; yy < y + h; yy++){
+      for (int xx = x; xx < x + w; xx++){
+        if (xx >= 0 && xx < DISPLAY_WIDTH && yy >= 0 && yy < DISPLAY_HEIGHT) pSetPixel(xx, yy, rand());
+      }
+    }
+    picocalcdisplay_mark_dirty(x, y, w, h);
+}
+
+static void pacing(void){
+    fbBytes = DISPLAY_WIDTH * DISPLAY_HEIGHT / 2;
+    pd_init(fb, I(2), I(1));
+    pd_partialUpdate(I(1));
+    pd_setMaxFps(I(50));
+    display_core1_task(NULL);
+    check(idleFor == CORE1_UNTIL_WAKE, "clean screen sleeps until woken");
+    wakes = 0;
+    for (int k = 0; k < 100; k++) picocalcdisplay_mark_dirty(k, 10, 1, 1);
+    check(wakes == 1, "a burst of marks rings once");
+    check(display_core1_task(NULL), "the wake refreshes");
+    picocalcdisplay_mark_dirty(0, 0, 6, 8);
+    nowUs += 3000;
+    bytes = 0;
+    check(!display_core1_task(NULL) && bytes == 0, "a mark inside the cap waits");
+    check(idleFor == 17000, "until the 50 fps frame is over");
+    nowUs += idleFor;
+    check(display_core1_task(NULL) && bytes > 0, "and then goes out");
+    stopAutoUpdate();
+    wakes = 0;
+    pd_update(I(1));
+    check(wakes == 1 && display_core1_task(NULL) && oneShotisDone, "show(1) runs on core 1");
+    printf("pacing: ok\n");
+}
+
+static void vsync(void){
+    tePinModel = 5;
+    lastTe = nowUs;
+    clockRuns = true;
+    startAutoUpdate();
+    mp_int_t period = (mp_int_t)(intptr_t)pd_vsync(I(5));
+    clockRuns = false;
+    check(period >= TE_PERIOD && period < TE_PERIOD + 50, "vsync() measures the TE period");
+    pd_refreshStats(1, (mp_obj_t[]){I(1)});
+    display_core1_task(NULL);
+    check(teIrqEnabled && scb_host.scr, "core 1 takes TE as a wake");
+    picocalcdisplay_mark_dirty(0, 0, 6, 8);
+    nowUs += 40000;
+    te_advance();
+    bytes = 0;
+    check(!display_core1_task(NULL) && bytes == 0, "an edge from before the change is not used");
+    nowUs = lastTe + TE_PERIOD + 5;
+    te_advance();
+    check(display_core1_task(NULL) && bytes > 0, "the next edge refreshes");
+    tePinModel = -1;
+    picocalcdisplay_mark_dirty(0, 0, 6, 8);
+    nowUs += 20000;
+    display_core1_task(NULL);
+    nowUs += idleFor;
+    check(display_core1_task(NULL), "a silent TE times out and refreshes anyway");
+    pd_refreshStats(0, NULL);
+    check(lastTuple[5] == I(1) && lastTuple[6] == I(1), "one vsync and one miss counted");
+    pd_vsync(mp_const_none);
+    display_core1_task(NULL);
+    check(!teIrqEnabled, "vsync(None) drops the wake");
+    printf("vsync: period %ld us, ok\n", (long)period);
+}
+
+static void double_buffer(void){
+    static uint8_t onScreen[sizeof(fb)];
+    pd_doubleBuffer(fb2);
+    int bad = 0, early = 0, behind = 0;
+    long sent = 0;
+    for (int it = 0; it < 500; it++){
+      draw_random_rect(it % 10 == 0 ? 320 : 20, 12);
+      bytes = 0;
+      display_refresh();
+      early += bytes != 0;
+      bytes = 0;
+      pd_update(I(0));
+      sent += bytes;
+      shownBuff = frameBuff;
+      bad += bad_pixels();
+      behind += memcmp(frameBuff, backBuff, fbBytes) != 0;
+    }
+    // Text goes through pSetPixel, not the Python FrameBuffer
+    int textBad = 0;
+    for (int it = 0; it < 6; it++){
+      memcpy(onScreen, frameBuff, fbBytes);
+      drawTxt6x8(4, (const mp_obj_t[]){(mp_obj_t)"flip", I(3), I(40 + it * 8), I(0)});
+      textBad += memcmp(onScreen, frameBuff, fbBytes) != 0;
+      textBad += memcmp(frameBuff, backBuff, fbBytes) == 0;
+      pd_update(I(0));
+      shownBuff = frameBuff;
+      textBad += bad_pixels() != 0;
+      textBad += memcmp(frameBuff, backBuff, fbBytes) != 0;
+    }
+    memcpy(onScreen, frameBuff, fbBytes);
+    for (int it = 0; it < 3; it++){
+      bytes = 0;
+      pd_update(I(0));
+      textBad += bytes != 0 || memcmp(onScreen, frameBuff, fbBytes) != 0;
+    }
+    pd_doubleBuffer(mp_const_none);
+    shownBuff = fb;
+    check(bad == 0, "each flip shows the back buffer");
+    check(early == 0, "nothing drawn shows before the flip");
+    check(behind == 0, "the back buffer catches up after a flip");
+    check(textBad == 0, "text stays in the back buffer and on screen across flips");
+    check(!memcmp(onScreen, fb, fbBytes) && drawBuff == fb, "single buffered again on the init buffer");
+    printf("  double buffered: %ld bytes/flip\n", sent / 500);
+}
+
+int main(void){
+    pacing();
+    vsync();
+    startAutoUpdate();
+    static const int formats[] = {1, 6, 2, 5, 4}, bits[] = {16, 8, 4, 2, 1};
+    srand(1);
+    for (int f = 0; f < 5; f++){
+      format = formats[f];
+      fbBytes = DISPLAY_WIDTH * DISPLAY_HEIGHT * bits[f] / 8;
+      for (size_t i = 0; i < fbBytes; i++) fb[i] = rand();
+      shownBuff = fb;
+      memset(panel, 0, sizeof(panel));
+      pd_init(fb, I(format), I(0));
+      check(bad_pixels() == 0, "init draws the framebuffer");
+      pd_partialUpdate(I(1));
+      bytes = 0;
+      pd_update(I(0));
+      check(bytes == 0, "a clean screen sends nothing");
+      long sent = 0, rects = 0;
+      int bad = 0;
+      for (int it = 0; it < 2000; it++){
+        for (int n = 1 + rand() % 4; n; n--) draw_random_rect(it % 10 == 0 ? 320 : 20, it % 7 == 0 ? 320 : 12);
+        bytes = windows = 0;
+        pd_update(I(0));
+        sent += bytes;
+        rects += windows;
+        bad += bad_pixels();
+      }
+      check(bad == 0, "partial refreshes match the framebuffer");
+      printf("format %d: %ld bytes/refresh, %.1f windows\n", format, sent / 2000, rects / 2000.0);
+      if (format == 2){
+        for (int k = 0; k < 2; k++){
+          for (int y = 80; y < 88; y++) for (int x = 60 + 6 * k; x < 66 + 6 * k; x++) pSetPixel(x, y, rand());
+          picocalcdisplay_mark_dirty(60 + 6 * k, 80, 6, 8);
+        }
+        bytes = windows = 0;
+        pd_update(I(0));
+        check(windows == 1 && bad_pixels() == 0, "a keystroke is one window");
+        printf("  keystroke: %ld bytes\n", bytes);
+      }
+      double_buffer();
+      pd_partialUpdate(I(0));
+      bytes = 0;
+      pd_update(I(0));
+      check(bad_pixels() == 0, "a full refresh matches");
+    }
+    printf(failures ? "%d FAILED\n" : "all ok\n", failures);
+    return failures != 0;
+}
@@ -0,0 +1,113 @@
+// sdk_host.h : Host stand-ins for the Pico SDK and MicroPython API picocalcdisplay.c uses
+// Declarations only: panelmodel.c defines them as a model of the SPI panel, DMA, GPIOs,
+// clock and core 1 scheduler. Each SDK/MicroPython header under host/ includes this.
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef unsigned int uint;
+
+// ===== MicroPython =====
+typedef void *mp_obj_t;
+typedef intptr_t mp_int_t;
+typedef uintptr_t mp_uint_t;
+typedef float mp_float_t;
+typedef struct { const void *type; } mp_obj_base_t;
+typedef struct { mp_obj_base_t base; } mp_obj_type_t;
+typedef struct { mp_obj_base_t base; const void *fun; } mp_obj_fun_builtin_t;
+typedef struct { const void *key, *value; } mp_rom_map_elem_t;
+typedef struct { mp_obj_base_t base; const mp_rom_map_elem_t *table; size_t len; } mp_obj_dict_t;
+typedef struct { mp_obj_base_t base; mp_obj_dict_t *globals; } mp_obj_module_t;
+typedef struct { void *buf; size_t len; int typecode; } mp_buffer_info_t;
+#define MP_BUFFER_READ  1
+#define MP_BUFFER_RW    3
+extern const mp_obj_type_t mp_type_module;
+extern const int mp_const_none_obj;
+#define mp_const_none ((mp_obj_t)&mp_const_none_obj)
+#define mp_const_true ((mp_obj_t)1)
+#define MP_ERROR_TEXT(s) s
+// Names are not looked up on the host: the qstr argument is dropped unexpanded
+#define MP_ROM_QSTR(q) ((const void *)0)
+#define MP_ROM_PTR(p) ((const void *)(p))
+#define MP_DEFINE_CONST_FUN_OBJ_0(n, f) const mp_obj_fun_builtin_t n = {{0}, (const void *)(f)}
+#define MP_DEFINE_CONST_FUN_OBJ_1(n, f) const mp_obj_fun_builtin_t n = {{0}, (const void *)(f)}
+#define MP_DEFINE_CONST_FUN_OBJ_3(n, f) const mp_obj_fun_builtin_t n = {{0}, (const void *)(f)}
+#define MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(n, lo, hi, f) const mp_obj_fun_builtin_t n = {{0}, (const void *)(f)}
+#define MP_DEFINE_CONST_DICT(n, t) const mp_obj_dict_t n = {{0}, t, sizeof(t) / sizeof((t)[0])}
+#define MP_REGISTER_MODULE(name, module)
+mp_obj_t mp_obj_new_int_from_uint(mp_uint_t v);
+mp_obj_t mp_obj_new_float(mp_float_t f);
+mp_obj_t mp_obj_new_bool(mp_int_t v);
+mp_obj_t mp_obj_new_tuple(size_t n, const mp_obj_t *items);
+mp_obj_t mp_obj_new_memoryview(char typecode, size_t nitems, void *items);
+mp_int_t mp_obj_get_int(mp_obj_t o);
+bool mp_obj_is_true(mp_obj_t o);
+const char *mp_obj_str_get_str(mp_obj_t o);
+void mp_get_buffer_raise(mp_obj_t o, mp_buffer_info_t *info, int flags);
+_Noreturn void mp_raise_ValueError(const char *msg);
+
+// ===== Time =====
+typedef int64_t absolute_time_t;
+#define at_the_end_of_time ((absolute_time_t)INT64_MAX)
+uint32_t time_us_32(void);
+absolute_time_t get_absolute_time(void);
+absolute_time_t make_timeout_time_us(uint64_t us);
+absolute_time_t delayed_by_us(absolute_time_t t, uint64_t us);
+int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to);
+void sleep_ms(uint32_t ms);
+static inline void tight_loop_contents(void) {}
+
+// ===== GPIO, SPI, DMA =====
+#define GPIO_FUNC_SPI 1
+#define GPIO_OUT 1
+#define GPIO_IN 0
+#define GPIO_IRQ_EDGE_RISE 0x8u
+#define NUM_BANK0_GPIOS 30
+void gpio_init(uint pin);
+void gpio_put(uint pin, bool value);
+void gpio_set_dir(uint pin, bool out);
+void gpio_set_function(uint pin, int fn);
+void gpio_acknowledge_irq(uint pin, uint32_t events);
+void gpio_set_irq_enabled(uint pin, uint32_t events, bool enabled);
+typedef struct { volatile uint32_t intr[4]; } io_bank0_hw_t;
+extern io_bank0_hw_t io_bank0_host;
+#define io_bank0_hw (&io_bank0_host)
+
+typedef struct spi_inst spi_inst_t;
+extern spi_inst_t *spi1;
+typedef struct { volatile uint32_t cr0, cr1, dr, sr; } spi_hw_t;
+#define SPI_SSPSR_BSY_BITS 0x10
+spi_hw_t *spi_get_hw(spi_inst_t *spi);
+uint spi_get_dreq(spi_inst_t *spi, bool tx);
+uint spi_init(spi_inst_t *spi, uint baudrate);
+int spi_write_blocking(spi_inst_t *spi, const uint8_t *src, size_t len);
+
+#define DMA_SIZE_8 0
+typedef struct { uint32_t ctrl; } dma_channel_config;
+int dma_claim_unused_channel(bool required);
+dma_channel_config dma_channel_get_default_config(uint channel);
+void channel_config_set_transfer_data_size(dma_channel_config *c, int size);
+void channel_config_set_bswap(dma_channel_config *c, bool bswap);
+void channel_config_set_dreq(dma_channel_config *c, uint dreq);
+void dma_channel_configure(uint channel, const dma_channel_config *c, volatile void *write,
+                           const volatile void *read, uint count, bool trigger);
+bool dma_channel_is_busy(uint channel);
+void dma_channel_set_trans_count(uint channel, uint32_t count, bool trigger);
+void dma_channel_set_read_addr(uint channel, const volatile void *read, bool trigger);
+
+// ===== Sync, IRQ, cores =====
+typedef volatile uint32_t spin_lock_t;
+int spin_lock_claim_unused(bool required);
+spin_lock_t *spin_lock_init(uint num);
+uint32_t spin_lock_blocking(spin_lock_t *lock);
+void spin_unlock(spin_lock_t *lock, uint32_t saved);
+uint get_core_num(void);
+#define IO_IRQ_BANK0 13
+void irq_clear(uint num);
+typedef struct { volatile uint32_t scr; } scb_hw_t;
+extern scb_hw_t scb_host;
+#define scb_hw (&scb_host)
+#define ARM_CPU_PREFIXED(x) M0PLUS_##x
+#define M0PLUS_SCR_SEVONPEND_BITS 0x10u
@@ -0,0 +1,202 @@
+// lut_expand.c : Palette expansion of packed framebuffer pixels to RGB565
+#include <string.h>
+#include "lut_expand.h"
+
+#if PICO_ON_DEVICE
+#include "hardware/interp.h"
+#define LUT_EXPAND_INTERP 1
+#else
+#define LUT_EXPAND_INTERP 0
+#endif
+
+// One source byte to its pixels as line buffer words (first pixel in the low half)
+static union {
+  uint32_t pairs[256];      // 4bpp: byte -> 2 pixels (high nibble first)
+  uint32_t quads[256][2];   // 2bpp: byte -> 4 pixels (low bits first)
+  uint32_t mono[16][2];     // 1bpp: nibble -> 4 pixels (low bit first)
+} expandTable;
+static uint16_t builtFrom[16];  // the LUT entries the table holds
+static uint8_t builtBits;
+
+void LUTExpandPrepare(const uint16_t *LUT, uint8_t bits){
+    if (bits >= 8){
+      return;
+    }
+    uint32_t entries = 1u << bits;
+    if (bits == builtBits && memcmp(builtFrom, LUT, entries * sizeof(uint16_t)) == 0){
+      return;
+    }
+    memcpy(builtFrom, LUT, entries * sizeof(uint16_t));
+    builtBits = bits;
+    switch (bits){
+      case 4:
+        for (uint32_t b = 0; b < 256; b++){
+          expandTable.pairs[b] = LUT[b >> 4] | (uint32_t)LUT[b & 0x0F] << 16;
+        }
+        break;
+      case 2:
+        for (uint32_t b = 0; b < 256; b++){
+          expandTable.quads[b][0] = LUT[b & 0x03] | (uint32_t)LUT[(b >> 2) & 0x03] << 16;
+          expandTable.quads[b][1] = LUT[(b >> 4) & 0x03] | (uint32_t)LUT[b >> 6] << 16;
+        }
+        break;
+      case 1:
+        for (uint32_t n = 0; n < 16; n++){
+          expandTable.mono[n][0] = LUT[n & 0x01] | (uint32_t)LUT[(n >> 1) & 0x01] << 16;
+          expandTable.mono[n][1] = LUT[(n >> 2) & 0x01] | (uint32_t)LUT[n >> 3] << 16;
+        }
+        break;
+    }
+}
+
+#if LUT_EXPAND_INTERP
+static interp_hw_save_t savedInterp;
+#endif
+
+// interp1 lane 0 gives &pairs[accum bits 2..9] and lane 1, reading the same accumulator,
+// &pairs[bits 10..17]. Loading a source word shifted left by 2 and then right by 14
+// makes that its four bytes' entries: one SIO read per byte in place of the shift,
+// mask and scale the M0+ needs to index the table.
+void LUTExpandBegin(uint8_t bits){
+#if LUT_EXPAND_INTERP
+    if (bits != 4){
+      return;
+    }
+    interp_save(interp1, &savedInterp);
+    interp_config cfg = interp_default_config();
+    interp_config_set_mask(&cfg, 2, 9);
+    interp_set_config(interp1, 0, &cfg);
+    interp_config_set_shift(&cfg, 8);
+    interp_config_set_cross_input(&cfg, true);
+    interp_set_config(interp1, 1, &cfg);
+    interp1->base[0] = (uintptr_t)expandTable.pairs;
+    interp1->base[1] = (uintptr_t)expandTable.pairs;
+#else
+    (void)bits;
+#endif
+}
+
+void LUTExpandEnd(uint8_t bits){
+#if LUT_EXPAND_INTERP
+    if (bits == 4){
+      interp_restore(interp1, &savedInterp);
+    }
+#else
+    (void)bits;
+#endif
+}
+
+void LUT8Expand(const uint8_t *frameBuff, uint16_t *currentLineBuff, uint32_t length, const uint16_t *LUT){
+    uint8_t currentPixel;
+    uint16_t color;
+    for (;length>=32;length-=32){
+        currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
+        currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
+        currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
+        currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
+        currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
+        currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
+        currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
+        currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
+        currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
+        currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
+        currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
+        currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
+        currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
+        currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
+        currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
+        currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
+        currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
+        currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
+        currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
+        currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
+        currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
+        currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
+        currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
+        currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
+        currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
+        currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
+        currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
+        currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
+        currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
+        currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
+        currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
+        currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
+    }
+    while(length--){
+      currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
+    }
+}
+
+void LUT4Expand(const uint8_t *frameBuff, uint16_t *currentLineBuff, uint32_t length, const uint16_t *LUT){
+    const uint32_t *pairs = expandTable.pairs;
+    uint32_t *out = (uint32_t *)currentLineBuff;
+    (void)LUT;
+    length >>= 1;
+#if LUT_EXPAND_INTERP
+    for (; length && ((uintptr_t)frameBuff & 3); length--){
+      *out++ = pairs[*frameBuff++];
+    }
+    const uint32_t *words = (const uint32_t *)frameBuff;
+    for (; length >= 4; length -= 4){
+      uint32_t w = *words++;
+      interp1->accum[0] = w << 2;
+      out[0] = *(const uint32_t *)(uintptr_t)interp1->peek[0];
+      out[1] = *(const uint32_t *)(uintptr_t)interp1->peek[1];
+      interp1->accum[0] = w >> 14;
+      out[2] = *(const uint32_t *)(uintptr_t)interp1->peek[0];
+      out[3] = *(const uint32_t *)(uintptr_t)interp1->peek[1];
+      out += 4;
+    }
+    frameBuff = (const uint8_t *)words;
+#else
+    for (; length >= 8; length -= 8){
+      out[0] = pairs[frameBuff[0]]; out[1] = pairs[frameBuff[1]];
+      out[2] = pairs[frameBuff[2]]; out[3] = pairs[frameBuff[3]];
+      out[4] = pairs[frameBuff[4]]; out[5] = pairs[frameBuff[5]];
+      out[6] = pairs[frameBuff[6]]; out[7] = pairs[frameBuff[7]];
+      out += 8;
+      frameBuff += 8;
+    }
+#endif
+    while (length--){
+      *out++ = pairs[*frameBuff++];
+    }
+}
+
+void LUT2Expand(const uint8_t *frameBuff, uint16_t *currentLineBuff, uint32_t length, const uint16_t *LUT){
+    uint32_t *out = (uint32_t *)currentLineBuff;
+    (void)LUT;
+    length >>= 2;
+    for (; length >= 4; length -= 4){
+      const uint32_t *q = expandTable.quads[frameBuff[0]];
+      out[0] = q[0]; out[1] = q[1];
+      q = expandTable.quads[frameBuff[1]];
+      out[2] = q[0]; out[3] = q[1];
+      q = expandTable.quads[frameBuff[2]];
+      out[4] = q[0]; out[5] = q[1];
+      q = expandTable.quads[frameBuff[3]];
+      out[6] = q[0]; out[7] = q[1];
+      out += 8;
+      frameBuff += 4;
+    }
+    while (length--){
+      const uint32_t *q = expandTable.quads[*frameBuff++];
+      out[0] = q[0]; out[1] = q[1];
+      out += 2;
+    }
+}
+
+void LUT1Expand(const uint8_t *frameBuff, uint16_t *currentLineBuff, uint32_t length, const uint16_t *LUT){
+    uint32_t *out = (uint32_t *)currentLineBuff;
+    (void)LUT;
+    length >>= 3;
+    while (length--){
+      uint8_t b = *frameBuff++;
+      const uint32_t *lo = expandTable.mono[b & 0x0F];
+      const uint32_t *hi = expandTable.mono[b >> 4];
+      out[0] = lo[0]; out[1] = lo[1];
+      out[2] = hi[0]; out[3] = hi[1];
+      out += 4;
+    }
+}
@@ -0,0 +1,27 @@
+// lut_expand.h : Palette expansion of packed framebuffer pixels to RGB565
+// The LUT modes go through these on every refresh, 64 pixels at a time into the DMA
+// line buffers. 8bpp looks each pixel up in the LUT; 4, 2 and 1bpp look each source
+// byte (1bpp: each nibble) up in a table of ready-made 32-bit pairs of RGB565 pixels,
+// built from the LUT by LUTExpandPrepare. On the device the 4bpp kernel also lets the
+// interpolator turn source bytes into table addresses (LUTExpandBegin/LUTExpandEnd).
+#pragma once
+#include <stdint.h>
+
+// Build the table for `bits` per pixel (4, 2 or 1; 8 and 16 need none) from the LUT
+// entries it uses, if they changed since it was last built. The LUT view is writable
+// from Python, so this runs at the start of every refresh; an unchanged LUT costs one
+// compare of up to 16 entries.
+void LUTExpandPrepare(const uint16_t *LUT, uint8_t bits);
+
+// Around a refresh's expansions, on the core that does them: set up (and afterwards
+// restore) that core's interp1 for the 4bpp kernel. Nothing on the host.
+void LUTExpandBegin(uint8_t bits);
+void LUTExpandEnd(uint8_t bits);
+
+// `length` pixels from frameBuff (starting on a byte, whole bytes) to RGB565 in
+// currentLineBuff, which must be 4-byte aligned. The 4/2/1bpp kernels take the LUT
+// from the prepared table and ignore the argument.
+void LUT8Expand(const uint8_t *frameBuff, uint16_t *currentLineBuff, uint32_t length, const uint16_t *LUT);
+void LUT4Expand(const uint8_t *frameBuff, uint16_t *currentLineBuff, uint32_t length, const uint16_t *LUT);
+void LUT2Expand(const uint8_t *frameBuff, uint16_t *currentLineBuff, uint32_t length, const uint16_t *LUT);
+void LUT1Expand(const uint8_t *frameBuff, uint16_t *currentLineBuff, uint32_t length, const uint16_t *LUT);
@@ -4,6 +4,7 @@ add_library(usermod_picocalcdisplay INTERFACE)
 # Add our source files to the lib
 target_sources(usermod_picocalcdisplay INTERFACE
     ${CMAKE_CURRENT_LIST_DIR}/picocalcdisplay.c
+    ${CMAKE_CURRENT_LIST_DIR}/lut_expand.c
 )
 
 # Add the current directory as an include directory.
@@ -11,5 +12,12 @@ target_include_directories(usermod_picocalcdisplay INTERFACE
     ${CMAKE_CURRENT_LIST_DIR}
 )
 
+# Core 1 is shared with other modules through the core1sched task loop.
+include(${CMAKE_CURRENT_LIST_DIR}/../core1sched/micropython.cmake)
+target_link_libraries(usermod_picocalcdisplay INTERFACE usermod_core1sched)
+
+# The 4bpp palette expansion takes its table addresses from interp1.
+target_link_libraries(usermod_picocalcdisplay INTERFACE hardware_interp)
+
 # Link our INTERFACE library to the usermod target.
 target_link_libraries(usermod INTERFACE usermod_picocalcdisplay)
@@ -2,7 +2,10 @@ PICOCALCDISPLAY_MOD_DIR := $(USERMOD_DIR)
 
 # Add all C files to SRC_USERMOD.
 SRC_USERMOD += $(PICOCALCDISPLAY_MOD_DIR)/picocalcdisplay.c
+SRC_USERMOD += $(PICOCALCDISPLAY_MOD_DIR)/lut_expand.c
+SRC_USERMOD += $(PICOCALCDISPLAY_MOD_DIR)/../core1sched/core1_sched.c
 
 # We can add our module folder to include paths if needed
 # This is not actually needed in this example.
 CFLAGS_USERMOD += -I$(PICOCALCDISPLAY_MOD_DIR)
+CFLAGS_USERMOD += -I$(PICOCALCDISPLAY_MOD_DIR)/../core1sched
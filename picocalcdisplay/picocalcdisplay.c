@@ -15,7 +15,11 @@
 #include "pico/stdlib.h"
 #include "pico/multicore.h"
 #include "hardware/sync.h"
+#include "hardware/irq.h"
+#include "hardware/structs/scb.h"
 #include "font6x8e500.h"
+#include "lut_expand.h"
+#include "core1_sched.h"
 
 
 #define    SWRESET   0x01
@@ -25,6 +29,7 @@
 #define    CASET     0x2A
 #define    RASET     0x2B
 #define    RAMWR     0x2C
+#define    TEOFF     0x34
 #define    TEON      0x35
 #define    MADCTL    0x36  // Memory Data Access Control
 #define    COLMOD    0x3A//
@@ -38,16 +43,74 @@
 #define    VMCTR1    0xC5
 #define    PGAMCTRL  0xE0
 #define    NGAMCTRL  0xE1
-#define CORE1_STACK_SIZE 1024
-uint32_t core1_stack[CORE1_STACK_SIZE];
+#define AUTO_UPDATE_GAP_US 5000 // idle time after an auto refresh, whatever the frame rate
+#define DEFAULT_MAX_FPS 60
+#define TE_TIMEOUT_US 100000    // refresh anyway when the TE pin stays quiet this long
+#define RECT_JOIN_PX 16         // rows whose spans come this close share one window
 
 static uint st_dma;
-static uint8_t *frameBuff;
+static uint8_t *frameBuff;      // front: what refreshes send
+// Double buffering: drawing goes to backBuff and a flip swaps it with frameBuff. A flip
+// waits for a refresh in progress (refreshing) to finish with the old front, so every
+// refresh streams one complete frame.
+static uint8_t *backBuff;       // NULL when single buffered
+static uint8_t *drawBuff;       // where the setpixel functions draw
+static uint8_t *initBuff;       // the buffer given to init
+static size_t frameBytes;
+static volatile bool refreshing;
 static volatile bool oneShotisDone=true;
 static volatile bool autoUpdate;
-static uint16_t lineBuffA[64];
-static uint16_t lineBuffB[64];
-void (*pColorUpdate)(uint8_t *, uint32_t, const uint16_t *);
+static volatile bool oneShotPending=false;
+static int core1Task=-1;
+static absolute_time_t nextAutoUpdate;
+static uint32_t framePeriodUs = 1000000 / DEFAULT_MAX_FPS;
+static bool capCounted;         // this frame's wait for the cap is already in the stats
+// Refresh telemetry (refreshStats): written by whichever core refreshes
+static struct {
+  uint32_t refreshes;   // refreshes that sent something
+  uint32_t capped;      // changes held back by the frame rate cap
+  uint32_t pixels;      // pixels sent
+  uint32_t busy_us;     // time spent refreshing
+  uint32_t max_us;      // longest refresh
+  uint32_t vsyncs;      // refreshes started on a TE edge
+  uint32_t missed;      // TE edges a refresh overran, plus TE waits that timed out
+} stats;
+static uint32_t statsSince;     // time_us_32() of the last reset, for the frame rate
+// Vsync mode: refreshes start on the rising edge of the panel's TE output (top of the
+// vertical blank) and go out top to bottom, behind the blank and ahead of the scan.
+// MicroPython owns the GPIO IRQ handler, so core 1 takes the edge as a WFE wake instead:
+// the pin is enabled in core 1's GPIO interrupt mask, IO_IRQ_BANK0 stays off in its
+// NVIC and SEVONPEND turns the pending interrupt into an event.
+static volatile int tePin = -1;
+static int teCore1Pin = -1;     // the pin core 1 has set up as its wake
+static uint32_t tePeriodUs;     // measured when vsync mode was turned on
+static bool teArmed;            // core 1 is waiting for a fresh edge
+static uint32_t teArmedAt;
+// Word aligned: the expansion kernels store pixel pairs
+static uint16_t lineBuffA[64] __attribute__((aligned(4)));
+static uint16_t lineBuffB[64] __attribute__((aligned(4)));
+static bool lineFlip;
+static void (*pExpand)(const uint8_t *, uint16_t *, uint32_t, const uint16_t *); // NULL for RGB565
+static uint8_t pixelBits;
+static uint32_t pixelAlign;     // pixels per framebuffer byte - 1
+// Dirty regions: each row keeps the span [dirtyX0, dirtyX1) drawn since it was last sent
+// (clean when x0 >= x1), and dirtyTop..dirtyBottom bound the rows that have one. Drawing
+// marks them on core 0 (thread and the vtterminal cursor IRQ) while a refresh takes them
+// on either core, so both hold dirtyLock.
+static uint16_t dirtyX0[DISPLAY_HEIGHT];
+static uint16_t dirtyX1[DISPLAY_HEIGHT];
+static volatile int dirtyTop = DISPLAY_HEIGHT;
+static volatile int dirtyBottom = -1;
+static spin_lock_t *dirtyLock;
+static volatile bool partialOn; // false: every refresh sends the whole frame
+// Double buffered, marks describe the back buffer and collect in drawnX0/drawnX1 until
+// a flip hands them to the refresh and copies them forward (flipX0/flipX1)
+static uint16_t drawnX0[DISPLAY_HEIGHT];
+static uint16_t drawnX1[DISPLAY_HEIGHT];
+static int drawnTop = DISPLAY_HEIGHT;
+static int drawnBottom = -1;
+static uint16_t flipX0[DISPLAY_HEIGHT];
+static uint16_t flipX1[DISPLAY_HEIGHT];
 void (*pSetPixel)(int32_t,int32_t,uint16_t);
 static uint8_t currentTextY;
 static uint8_t currentTextX;
@@ -98,11 +161,9 @@ static const uint16_t defaultLUT[256] = {
 
 static void Write_dma(const uint8_t *src, size_t len);
 static void command(uint8_t com, size_t len, const char *data) ;
-void RGB565Update(uint8_t *frameBuff,uint32_t length, const uint16_t *LUT);
-void LUT8Update(uint8_t *frameBuff, uint32_t length,  const uint16_t *LUT);
-void LUT4Update(uint8_t *frameBuff, uint32_t length,  const uint16_t *LUT);
-void LUT2Update(uint8_t *frameBuff, uint32_t length,  const uint16_t *LUT);
-void LUT1Update(uint8_t *frameBuff, uint32_t length,  const uint16_t *LUT);
+static bool display_refresh(void);
+static void mark_front(int x, int y, int w, int h);
+static void flip_buffers(void);
 //void core1_main(void);
 void setpixelRGB565(int32_t x, int32_t y,uint16_t color);
 void setpixelLUT8(int32_t x, int32_t y,uint16_t color);
@@ -119,39 +180,137 @@ void setpixelLUT1(int32_t x, int32_t y,uint16_t color);
 #define FRAMEBUF_MHLSB    (3)
 #define FRAMEBUF_MHMSB    (4)
 */
-static void core1_main(void);
-static void core1_singleShot(void);
-
-static void core1_main(void) {
-  //multicore_lockout_victim_init();
-  //static int frame = 0;
-  while (1) {
-    //if (++frame % 100 == 0) {
-    //  printf("Core1 alive: %d\n", frame);
-    //}
-    if (autoUpdate){
-      pColorUpdate(frameBuff,DISPLAY_HEIGHT*DISPLAY_WIDTH, LUT);
-    }     
-    sleep_ms(5); 
+// Drop a latched TE edge (and, on core 1, the pending interrupt, so the next edge is a
+// new event for WFE)
+static void te_clear(void){
+  gpio_acknowledge_irq(tePin, GPIO_IRQ_EDGE_RISE);
+  if (get_core_num() == 1){
+    irq_clear(IO_IRQ_BANK0);
+  }
+}
 
+// Whether the TE pin rose since the last clear; consumes the edge. Reads the raw
+// interrupt latch, which needs no interrupt enabled on either core.
+static bool te_edge_take(void){
+  uint32_t bit = GPIO_IRQ_EDGE_RISE << (4 * (tePin & 7));
+  if (!(io_bank0_hw->intr[tePin >> 3] & bit)){
+    return false;
   }
+  te_clear();
+  return true;
 }
 
-static void core1_singleShot(void){
-  pColorUpdate(frameBuff,DISPLAY_HEIGHT*DISPLAY_WIDTH, LUT);
-  oneShotisDone=true;
+// Wait for the next TE edge (core 0, or while core 1 is kept off the display)
+static bool te_wait(uint32_t timeout_us){
+  te_clear();
+  uint32_t t0 = time_us_32();
+  while (!te_edge_take()){
+    if (time_us_32() - t0 > timeout_us){
+      return false;
+    }
+  }
+  return true;
+}
+
+// Core 1: follow tePin in this core's GPIO interrupt mask
+static void te_core1_setup(void){
+  if (teCore1Pin >= 0){
+    gpio_set_irq_enabled(teCore1Pin, GPIO_IRQ_EDGE_RISE, false);
+  }
+  teCore1Pin = tePin;
+  teArmed = false;
+  if (teCore1Pin >= 0){
+    gpio_set_irq_enabled(teCore1Pin, GPIO_IRQ_EDGE_RISE, true);
+    scb_hw->scr |= ARM_CPU_PREFIXED(SCR_SEVONPEND_BITS);
+  }
+}
+
+// Core 1, vsync mode: true once a TE edge newer than the decision to refresh has come
+// (an edge latched before it is of unknown age); until then core 1 sleeps and the edge
+// wakes it. With no edge for TE_TIMEOUT_US the refresh goes out anyway, as a miss.
+static bool te_ready(void){
+  if (tePin < 0){
+    return true;
+  }
+  uint32_t now = time_us_32();
+  if (!teArmed){
+    te_clear();
+    teArmed = true;
+    teArmedAt = now;
+  }
+  if (te_edge_take()){
+    stats.vsyncs++;
+  }else if (now - teArmedAt < TE_TIMEOUT_US){
+    core1_task_idle_for(TE_TIMEOUT_US - (now - teArmedAt));
+    return false;
+  }else{
+    stats.missed++;
+  }
+  teArmed = false;
+  return true;
+}
+
+// Display task on the shared core 1 loop (see core1sched): one refresh per call, so
+// other core 1 work (e.g. mp3 decode) runs between frames. Core 1 sleeps while nothing
+// is drawn: the first mark after a refresh (or a show()) wakes it. Marks arriving faster
+// than the frame rate cap pile up and go out together in the next frame. Partial
+// updates off, it refreshes the whole frame at the capped rate, as nothing marks.
+static bool display_core1_task(void *user){
+  (void)user;
+  if (teCore1Pin != tePin){
+    te_core1_setup();
+  }
+  bool oneShot = oneShotPending;
+  if (!oneShot){
+    if (!autoUpdate || (partialOn && dirtyTop > dirtyBottom)){
+      core1_task_idle_for(CORE1_UNTIL_WAKE);
+      return false;
+    }
+    int64_t wait = absolute_time_diff_us(get_absolute_time(), nextAutoUpdate);
+    if (wait > 0){
+      if (!capCounted){
+        stats.capped++;
+        capCounted = true;
+      }
+      core1_task_idle_for((uint32_t)wait);
+      return false;
+    }
+  }
+  if (!te_ready()){
+    return false;
+  }
+  absolute_time_t frameStart = get_absolute_time();
+  display_refresh();
+  if (oneShot){
+    oneShotPending=false;
+    oneShotisDone=true;
+    return true;
+  }
+  nextAutoUpdate = delayed_by_us(frameStart, framePeriodUs);
+  absolute_time_t gapEnd = make_timeout_time_us(AUTO_UPDATE_GAP_US);
+  if (absolute_time_diff_us(nextAutoUpdate, gapEnd) > 0){
+    nextAutoUpdate = gapEnd;
+  }
+  capCounted = false;
+  return true;
+}
+
+static void display_core1_attach(void){
+  if (core1Task < 0){
+    core1Task = core1_task_add(display_core1_task, NULL);
+  }
 }
 
 void setpixelRGB565(int32_t x, int32_t y,uint16_t color){
-  ((uint16_t *)frameBuff)[x + DISPLAY_WIDTH*y]= color;
+  ((uint16_t *)drawBuff)[x + DISPLAY_WIDTH*y]= color;
 }
 
 void setpixelLUT8(int32_t x, int32_t y,uint16_t color){
-  ((uint8_t *)frameBuff)[x + DISPLAY_WIDTH*y]= (uint8_t)color;
+  ((uint8_t *)drawBuff)[x + DISPLAY_WIDTH*y]= (uint8_t)color;
 }
 
 void setpixelLUT4(int32_t x, int32_t y,uint16_t color){
-  uint8_t *pixel = &((uint8_t *)frameBuff)[(x + (DISPLAY_WIDTH*y))>>1];
+  uint8_t *pixel = &((uint8_t *)drawBuff)[(x + (DISPLAY_WIDTH*y))>>1];
 
   if (x&0x01) {
     *pixel = ((uint8_t)color & 0x0f) | (*pixel & 0xf0);
@@ -161,7 +320,7 @@ void setpixelLUT4(int32_t x, int32_t y,uint16_t color){
 }
 
 void setpixelLUT2(int32_t x, int32_t y,uint16_t color){
-  uint8_t *pixel = &((uint8_t *)frameBuff)[(x + (DISPLAY_WIDTH*y))>>2];
+  uint8_t *pixel = &((uint8_t *)drawBuff)[(x + (DISPLAY_WIDTH*y))>>2];
   uint8_t shift = (x & 0x3) << 1;
   uint8_t mask = 0x3 << shift;
   color = ((uint8_t)color & 0x3) << shift;
@@ -171,7 +330,7 @@ void setpixelLUT2(int32_t x, int32_t y,uint16_t color){
 void setpixelLUT1(int32_t x, int32_t y,uint16_t color){
   size_t index = (x + y * DISPLAY_WIDTH) >> 3;
   unsigned int offset =  x & 0x07;
-  ((uint8_t *)frameBuff)[index] = (((uint8_t *)frameBuff)[index] & ~(0x01 << offset)) | ((color != 0) << offset);
+  ((uint8_t *)drawBuff)[index] = (((uint8_t *)drawBuff)[index] & ~(0x01 << offset)) | ((color != 0) << offset);
 }
 
 static mp_obj_t pd_resetLUT(mp_obj_t index){
@@ -185,6 +344,7 @@ static mp_obj_t pd_resetLUT(mp_obj_t index){
       break;
 
   }
+  mark_front(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT);
   return mp_const_none;
 }
 static MP_DEFINE_CONST_FUN_OBJ_1(pd_resetLUT_obj, pd_resetLUT);
@@ -205,6 +365,9 @@ static mp_obj_t pd_init(mp_obj_t fb_obj, mp_obj_t color_type, mp_obj_t autoR){
     mp_buffer_info_t buf_info;
     mp_get_buffer_raise(fb_obj, &buf_info, MP_BUFFER_READ);
     frameBuff=(uint8_t *)buf_info.buf;
+    drawBuff = initBuff = frameBuff;
+    backBuff = NULL;
+    frameBytes = buf_info.len;
     autoUpdate = mp_obj_is_true(autoR);
 
     int32_t colorType = mp_obj_get_int(color_type);
@@ -214,27 +377,38 @@ static mp_obj_t pd_init(mp_obj_t fb_obj, mp_obj_t color_type, mp_obj_t autoR){
     currentTextTable=CP437_display;
     switch (colorType){
       case 1: //565
-        pColorUpdate = RGB565Update;
+        pExpand = NULL;
+        pixelBits = 16;
         pSetPixel = setpixelRGB565;
         break;
       case 2: //16 color
-        pColorUpdate = LUT4Update;
+        pExpand = LUT4Expand;
+        pixelBits = 4;
         pSetPixel = setpixelLUT4;
         break;
       case 4: //2 color
-        pColorUpdate = LUT1Update;
+        pExpand = LUT1Expand;
+        pixelBits = 1;
         pSetPixel = setpixelLUT1;
         break;
       case 5: //4 color
-        pColorUpdate = LUT2Update;
+        pExpand = LUT2Expand;
+        pixelBits = 2;
         pSetPixel = setpixelLUT2;
         break;
       case 6: //256 color
-        pColorUpdate = LUT8Update;
+        pExpand = LUT8Expand;
+        pixelBits = 8;
         pSetPixel = setpixelLUT8;
         break;
  
     }
+    pixelAlign = pixelBits < 8 ? (8 / pixelBits) - 1 : 0;
+    if (dirtyLock == NULL){
+      dirtyLock = spin_lock_init(spin_lock_claim_unused(true));
+    }
+    picocalcdisplay_mark_dirty(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+    statsSince = time_us_32();
  //spi init
     spi_init(SPI_DISP, 40000000);
     gpio_set_function(CLK_PIN, GPIO_FUNC_SPI);
@@ -286,7 +460,7 @@ static mp_obj_t pd_init(mp_obj_t fb_obj, mp_obj_t color_type, mp_obj_t autoR){
     command(RASET,4,"\x00\x00\x01\x3F");
     command(SLPOUT,0,NULL);
     sleep_ms(120);
-    pColorUpdate(frameBuff,DISPLAY_HEIGHT*DISPLAY_WIDTH, LUT);
+    display_refresh();
     command(DISPON,0,NULL);
     sleep_ms(120);
     command(RAMWR,0,NULL);
@@ -295,10 +469,8 @@ static mp_obj_t pd_init(mp_obj_t fb_obj, mp_obj_t color_type, mp_obj_t autoR){
     //pColorUpdate(frameBuff,DISPLAY_HEIGHT*DISPLAY_WIDTH, LUT);
     //sleep_ms(10);
     if (autoUpdate==true){
-      multicore_reset_core1();
-      multicore_launch_core1_with_stack(core1_main, core1_stack, CORE1_STACK_SIZE);
+      display_core1_attach();
     }
-    //multicore_launch_core1_with_stack(core1_main, core1_stack, CORE1_STACK_SIZE);
 
     return mp_const_true;
 }
@@ -318,6 +490,7 @@ static mp_obj_t drawTxt6x8(mp_uint_t n_args, const mp_obj_t *args){
   uint16_t color = mp_obj_get_int(args[3]);
   int x;
   int y;
+  int xStart = x0;
 
   // loop over chars
   for (; *str; ++str) {
@@ -347,6 +520,7 @@ static mp_obj_t drawTxt6x8(mp_uint_t n_args, const mp_obj_t *args){
     }
     x0 +=currentTextX;
   }
+  picocalcdisplay_mark_dirty(xStart, y0, x0 - xStart, currentTextY);
   return mp_const_none;
 }
 static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(drawTxt6x8_obj, 4, 4, drawTxt6x8);
@@ -361,15 +535,15 @@ static mp_obj_t pd_setLUT(mp_obj_t LUT_obj){
         bufLen = sizeof(LUT);
     }
     memcpy(LUT,buf_info.buf,bufLen* sizeof(uint16_t));
-    
+    mark_front(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT);
     return mp_const_true;
 }
 static MP_DEFINE_CONST_FUN_OBJ_1(setLUT_obj, pd_setLUT);
 
 static mp_obj_t startAutoUpdate(void){
   autoUpdate = true;
-  multicore_reset_core1();
-  multicore_launch_core1_with_stack(core1_main, core1_stack, CORE1_STACK_SIZE);
+  display_core1_attach();
+  core1_wake();
   return mp_const_true;
 }
 static MP_DEFINE_CONST_FUN_OBJ_0(startAutoUpdate_obj, startAutoUpdate);
@@ -377,7 +551,8 @@ static MP_DEFINE_CONST_FUN_OBJ_0(startAutoUpdate_obj, startAutoUpdate);
 
 static mp_obj_t stopAutoUpdate(void){
   autoUpdate = false;
-  multicore_reset_core1();
+  //let a refresh already in progress on core 1 finish, other core 1 tasks keep running
+  core1_task_sync(core1Task);
   //wait until possible dma is done
   while (dma_channel_is_busy(st_dma)){
     tight_loop_contents(); 
@@ -386,6 +561,146 @@ static mp_obj_t stopAutoUpdate(void){
 }
 static MP_DEFINE_CONST_FUN_OBJ_0(stopAutoUpdate_obj, stopAutoUpdate);
 
+// markDirty() marks the whole screen, markDirty(x, y, w, h) a rectangle (clipped)
+static mp_obj_t pd_markDirty(size_t n_args, const mp_obj_t *args){
+  if (n_args == 0){
+    picocalcdisplay_mark_dirty(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+  }else{
+    picocalcdisplay_mark_dirty(mp_obj_get_int(args[0]), mp_obj_get_int(args[1]),
+                               mp_obj_get_int(args[2]), mp_obj_get_int(args[3]));
+  }
+  return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(pd_markDirty_obj, 0, 4, pd_markDirty);
+
+// With partial updates on, refreshes send only what was marked; everything that draws
+// into the framebuffer has to mark it
+static mp_obj_t pd_partialUpdate(mp_obj_t on){
+  partialOn = mp_obj_is_true(on);
+  return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(pd_partialUpdate_obj, pd_partialUpdate);
+
+// Cap on auto refreshes per second; changes made in between share the next frame
+static mp_obj_t pd_setMaxFps(mp_obj_t fps_obj){
+  mp_int_t fps = mp_obj_get_int(fps_obj);
+  if (fps < 1 || fps > 1000){
+    mp_raise_ValueError(MP_ERROR_TEXT("fps must be 1..1000"));
+  }
+  framePeriodUs = 1000000 / fps;
+  return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(pd_setMaxFps_obj, pd_setMaxFps);
+
+// (refreshes, capped, pixels, busy_us, max_us, vsyncs, missed, fps) since init or the
+// last reset: refreshes that sent something, changes held back by the cap, pixels sent,
+// time spent refreshing, the longest refresh, refreshes started on a TE edge, TE edges
+// missed, and refreshes per second
+static mp_obj_t pd_refreshStats(size_t n_args, const mp_obj_t *args){
+  mp_obj_t tuple[8];
+  uint32_t now = time_us_32();
+  uint32_t elapsed = now - statsSince;
+  tuple[0] = mp_obj_new_int_from_uint(stats.refreshes);
+  tuple[1] = mp_obj_new_int_from_uint(stats.capped);
+  tuple[2] = mp_obj_new_int_from_uint(stats.pixels);
+  tuple[3] = mp_obj_new_int_from_uint(stats.busy_us);
+  tuple[4] = mp_obj_new_int_from_uint(stats.max_us);
+  tuple[5] = mp_obj_new_int_from_uint(stats.vsyncs);
+  tuple[6] = mp_obj_new_int_from_uint(stats.missed);
+  tuple[7] = mp_obj_new_float(elapsed ? stats.refreshes * 1e6f / elapsed : 0.0f);
+  if (n_args && mp_obj_is_true(args[0])){
+    memset(&stats, 0, sizeof(stats));
+    statsSince = now;
+  }
+  return mp_obj_new_tuple(8, tuple);
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(pd_refreshStats_obj, 0, 1, pd_refreshStats);
+
+// vsync(pin): start refreshes on the panel's tearing-effect output wired to GPIO `pin`
+// (TEON, vertical blank only) and return its period in us; raises if the pin does not
+// toggle. vsync(None) turns it off.
+static mp_obj_t pd_vsync(mp_obj_t pin_obj){
+  int pin = pin_obj == mp_const_none ? -1 : mp_obj_get_int(pin_obj);
+  if (pin >= NUM_BANK0_GPIOS){
+    mp_raise_ValueError(MP_ERROR_TEXT("bad pin"));
+  }
+  //keep core 1 off the bus while the command goes out
+  bool wasAuto = autoUpdate;
+  autoUpdate = false;
+  core1_task_sync(core1Task);
+  while(oneShotisDone==false);
+  while (dma_channel_is_busy(st_dma));
+  tePin = -1;
+  bool ok = true;
+  if (pin >= 0){
+    gpio_init(pin);
+    gpio_set_dir(pin, GPIO_IN);
+    command(TEON,1,"\x00");
+    tePin = pin;
+    uint32_t t1 = 0;
+    ok = te_wait(TE_TIMEOUT_US);
+    if (ok){
+      t1 = time_us_32();
+      ok = te_wait(TE_TIMEOUT_US);
+    }
+    if (ok){
+      tePeriodUs = time_us_32() - t1;
+    }else{
+      tePin = -1;
+    }
+  }
+  if (tePin < 0){
+    command(TEOFF,0,NULL);
+  }
+  autoUpdate = wasAuto;
+  core1_wake();
+  if (!ok){
+    mp_raise_ValueError(MP_ERROR_TEXT("no TE signal on pin"));
+  }
+  return pin < 0 ? mp_const_none : mp_obj_new_int_from_uint(tePeriodUs);
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(pd_vsync_obj, pd_vsync);
+
+// doubleBuffer(buf): draw into `buf` (the size of the init buffer, which is filled from
+// the screen) and show it with update(), which flips the two. doubleBuffer(None) goes
+// back to drawing on screen in the init buffer.
+static mp_obj_t pd_doubleBuffer(mp_obj_t buf_obj){
+  uint8_t *back = NULL;
+  if (buf_obj != mp_const_none){
+    mp_buffer_info_t buf_info;
+    mp_get_buffer_raise(buf_obj, &buf_info, MP_BUFFER_RW);
+    if (buf_info.len != frameBytes){
+      mp_raise_ValueError(MP_ERROR_TEXT("buffer size differs from the framebuffer"));
+    }
+    back = (uint8_t *)buf_info.buf;
+  }
+  //wait for a refresh to finish with the current front
+  uint32_t save;
+  for (;;){
+    save = spin_lock_blocking(dirtyLock);
+    if (!refreshing) break;
+    spin_unlock(dirtyLock, save);
+    tight_loop_contents();
+  }
+  if (frameBuff != initBuff){
+    memcpy(initBuff, frameBuff, frameBytes);
+    frameBuff = initBuff;
+  }
+  for (int row = drawnTop; row <= drawnBottom; row++){
+    drawnX0[row] = drawnX1[row] = 0;
+  }
+  drawnTop = DISPLAY_HEIGHT;
+  drawnBottom = -1;
+  if (back != NULL){
+    memcpy(back, frameBuff, frameBytes);
+  }
+  backBuff = back;
+  drawBuff = back != NULL ? back : frameBuff;
+  spin_unlock(dirtyLock, save);
+  return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(pd_doubleBuffer_obj, pd_doubleBuffer);
+
 
 static void Write_dma(const uint8_t *src, size_t len) {
     while (dma_channel_is_busy(st_dma));
@@ -411,17 +726,30 @@ static void command(uint8_t com, size_t len, const char *data) {
 
 static mp_obj_t pd_update(mp_obj_t core){
     int coreNum = mp_obj_get_int(core);
+    if (backBuff != NULL){
+      flip_buffers();
+    }
     if (autoUpdate==false){//only work when autoUpdate is false
       if (coreNum == 0){
+          //a core 1 one-shot may still be sending from the same line buffers
+          while(oneShotisDone==false);
           oneShotisDone=false;
-          pColorUpdate(frameBuff,DISPLAY_HEIGHT*DISPLAY_WIDTH, LUT);
+          if (tePin >= 0 && (!partialOn || dirtyTop <= dirtyBottom)){
+            if (te_wait(TE_TIMEOUT_US)){
+              stats.vsyncs++;
+            }else{
+              stats.missed++;
+            }
+          }
+          display_refresh();
           oneShotisDone=true;
       }else{
         //single shot core 1 update
         while(oneShotisDone==false);
         oneShotisDone=false;
-        multicore_reset_core1();
-        multicore_launch_core1_with_stack(core1_singleShot, core1_stack, CORE1_STACK_SIZE);
+        display_core1_attach();
+        oneShotPending=true;
+        core1_wake();
       }
     }
     return mp_const_true;
@@ -437,371 +765,229 @@ static mp_obj_t pd_isScreenUpdateDone(void){
 }
 static MP_DEFINE_CONST_FUN_OBJ_0(pd_isScreenUpdateDone_obj, pd_isScreenUpdateDone);
 
-void RGB565Update(uint8_t *frameBuff,uint32_t length,const uint16_t *LUT) {
-    //gpio_put(CS_PIN, 1);
-    //gpio_put(CS_PIN, 0);
-    while (dma_channel_is_busy(st_dma));
-    uint8_t cmd = RAMWR;
-    gpio_put(CS_PIN, 0);
-    gpio_put(DC_PIN, 0); // command mode
-    
-    spi_write_blocking(SPI_DISP,&cmd, 1);
+// Widen the spans of rows [y, y + h) to take in [x0, x1); the caller holds dirtyLock
+static void add_span(uint16_t *spanX0, uint16_t *spanX1, int x0, int x1, int y, int h){
+    for (int row = y; row < y + h; row++){
+      if (spanX0[row] >= spanX1[row]){
+        spanX0[row] = x0;
+        spanX1[row] = x1;
+      }else{
+        if (x0 < spanX0[row]) spanX0[row] = x0;
+        if (x1 > spanX1[row]) spanX1[row] = x1;
+      }
+    }
+}
 
-    gpio_put(DC_PIN, 1); // data mode
-    Write_dma((const uint8_t*)frameBuff, length*2);    
-    while (dma_channel_is_busy(st_dma));
-    while (spi_get_hw(SPI_DISP)->sr & SPI_SSPSR_BSY_BITS) {
-      tight_loop_contents();  
+// Clip a rectangle to the screen; false if nothing is left
+static bool clip_rect(int *x, int *y, int *w, int *h){
+    if (*x < 0) { *w += *x; *x = 0; }
+    if (*y < 0) { *h += *y; *y = 0; }
+    if (*w > DISPLAY_WIDTH - *x) *w = DISPLAY_WIDTH - *x;
+    if (*h > DISPLAY_HEIGHT - *y) *h = DISPLAY_HEIGHT - *y;
+    return *w > 0 && *h > 0 && dirtyLock != NULL;
+}
+
+// Mark a rectangle of the front buffer for the next refresh
+static void mark_front(int x, int y, int w, int h){
+    if (!clip_rect(&x, &y, &w, &h)) return;
+    uint32_t save = spin_lock_blocking(dirtyLock);
+    bool wasClean = dirtyTop > dirtyBottom;
+    add_span(dirtyX0, dirtyX1, x, x + w, y, h);
+    if (y < dirtyTop) dirtyTop = y;
+    if (y + h - 1 > dirtyBottom) dirtyBottom = y + h - 1;
+    spin_unlock(dirtyLock, save);
+    // Only the first mark after a refresh rings: later ones go out in the same frame
+    if (wasClean && autoUpdate){
+      core1_wake();
     }
-    gpio_put(CS_PIN, 1);    
 }
 
-void LUT8Update(uint8_t *frameBuff, uint32_t length,  const uint16_t *LUT){
-    while (dma_channel_is_busy(st_dma));
-    //uint16_t lineBuffA[64];
-    //uint16_t lineBuffB[64];
-    uint16_t *currentLineBuff=lineBuffA;
-    uint16_t *updateLineBuff=lineBuffA;
-    uint32_t leftPixels = length - (length&0xFFFFFFC0);
-    uint32_t count = length>>6;
-    uint8_t currentPixel=0;
-    uint16_t color;
-    uint8_t cmd = RAMWR;
-    gpio_put(CS_PIN, 0);
-    gpio_put(DC_PIN, 0); // command mode
-    
-    spi_write_blocking(SPI_DISP,&cmd, 1);
-    gpio_put(DC_PIN, 1); // data mode
-    while(count--){
-      if (count&0x00000001){
-        currentLineBuff = lineBuffA;
-        updateLineBuff = lineBuffA;
-      }else{
-        currentLineBuff = lineBuffB;
-        updateLineBuff = lineBuffB;
-      }
-      for (int i=2;i>0;i--){
-          currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
-      }
-      while (dma_channel_is_busy(st_dma));
-      Write_dma((const uint8_t *)updateLineBuff,64*2);
+void picocalcdisplay_mark_dirty(int x, int y, int w, int h){
+    if (backBuff == NULL){
+      mark_front(x, y, w, h);
+      return;
     }
-    if (leftPixels != 0){
-      if   (updateLineBuff == lineBuffB){
-        currentLineBuff = lineBuffA;
-        updateLineBuff = lineBuffA;
-      }else{
-        currentLineBuff = lineBuffB;
-        updateLineBuff = lineBuffB;
-      }
-      while(leftPixels--){
-        currentPixel = *frameBuff++;color = LUT[currentPixel];*currentLineBuff++ = color;
+    if (!clip_rect(&x, &y, &w, &h)) return;
+    uint32_t save = spin_lock_blocking(dirtyLock);
+    add_span(drawnX0, drawnX1, x, x + w, y, h);
+    if (y < drawnTop) drawnTop = y;
+    if (y + h - 1 > drawnBottom) drawnBottom = y + h - 1;
+    spin_unlock(dirtyLock, save);
+}
+
+// Show the back buffer (core 0). Waits for a refresh still reading the old front, then
+// swaps and queues what was drawn since the last flip, so only the difference is sent.
+// Those spans are copied into the new back buffer, which then holds the frame just
+// shown and drawing carries on from it.
+static void flip_buffers(void){
+    uint32_t save;
+    for (;;){
+      save = spin_lock_blocking(dirtyLock);
+      if (!refreshing) break;
+      spin_unlock(dirtyLock, save);
+      tight_loop_contents();
+    }
+    uint8_t *shown = frameBuff;
+    frameBuff = backBuff;
+    backBuff = drawBuff = shown;
+    int top = drawnTop;
+    int bottom = drawnBottom;
+    bool wasClean = dirtyTop > dirtyBottom;
+    for (int row = top; row <= bottom; row++){
+      flipX0[row] = drawnX0[row];
+      flipX1[row] = drawnX1[row];
+      drawnX0[row] = drawnX1[row] = 0;
+      if (flipX0[row] < flipX1[row]){
+        add_span(dirtyX0, dirtyX1, flipX0[row], flipX1[row], row, 1);
       }
-      while (dma_channel_is_busy(st_dma));
-      Write_dma((const uint8_t *)lineBuffB,leftPixels*2);
     }
-    while (dma_channel_is_busy(st_dma));
-    while (spi_get_hw(SPI_DISP)->sr & SPI_SSPSR_BSY_BITS) {
-      tight_loop_contents(); 
+    drawnTop = DISPLAY_HEIGHT;
+    drawnBottom = -1;
+    if (top <= bottom){
+      if (top < dirtyTop) dirtyTop = top;
+      if (bottom > dirtyBottom) dirtyBottom = bottom;
     }
-    gpio_put(CS_PIN, 1);
-  }
-  
-  
-  void LUT4Update(uint8_t *frameBuff, uint32_t length,  const uint16_t *LUT){
-    while (dma_channel_is_busy(st_dma));
-    //uint16_t lineBuffA[64];
-    //uint16_t lineBuffB[64];
-    uint16_t *currentLineBuff =lineBuffA;
-    uint16_t *updateLineBuff =lineBuffA;
-    uint32_t leftPixels = (length - (length&0xFFFFFFC0))>>1;
-    uint32_t count = length>>6;
-    uint8_t currentPixel=0;
-    uint16_t color;
-    uint8_t cmd = RAMWR;
-    gpio_put(CS_PIN, 0);
-    gpio_put(DC_PIN, 0); // command mode
-    
-    spi_write_blocking(SPI_DISP,&cmd, 1);
-    gpio_put(DC_PIN, 1); // data mode
-    while(count--){
-      if (count&0x00000001){
-        currentLineBuff = lineBuffA;
-        updateLineBuff = lineBuffA;
-      }else{
-        currentLineBuff = lineBuffB;
-        updateLineBuff = lineBuffB;
-      }
-      for (int i=2;i>0;i--){
-          currentPixel = *frameBuff++;color = LUT[currentPixel>>4];*currentLineBuff++ = color;
-          color = LUT[currentPixel&0x0F];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel>>4];*currentLineBuff++ = color;
-          color = LUT[currentPixel&0x0F];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel>>4];*currentLineBuff++ = color;
-          color = LUT[currentPixel&0x0F];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel>>4];*currentLineBuff++ = color;
-          color = LUT[currentPixel&0x0F];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel>>4];*currentLineBuff++ = color;
-          color = LUT[currentPixel&0x0F];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel>>4];*currentLineBuff++ = color;
-          color = LUT[currentPixel&0x0F];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel>>4];*currentLineBuff++ = color;
-          color = LUT[currentPixel&0x0F];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel>>4];*currentLineBuff++ = color;
-          color = LUT[currentPixel&0x0F];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel>>4];*currentLineBuff++ = color;
-          color = LUT[currentPixel&0x0F];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel>>4];*currentLineBuff++ = color;
-          color = LUT[currentPixel&0x0F];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel>>4];*currentLineBuff++ = color;
-          color = LUT[currentPixel&0x0F];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel>>4];*currentLineBuff++ = color;
-          color = LUT[currentPixel&0x0F];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel>>4];*currentLineBuff++ = color;
-          color = LUT[currentPixel&0x0F];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel>>4];*currentLineBuff++ = color;
-          color = LUT[currentPixel&0x0F];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel>>4];*currentLineBuff++ = color;
-          color = LUT[currentPixel&0x0F];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel>>4];*currentLineBuff++ = color;
-          color = LUT[currentPixel&0x0F];*currentLineBuff++ = color;
-      }
-      while (dma_channel_is_busy(st_dma));
-      Write_dma((const uint8_t *)updateLineBuff,64*2);
+    spin_unlock(dirtyLock, save);
+    if (top <= bottom && wasClean && autoUpdate){
+      core1_wake();
     }
-    if (leftPixels != 0){
-      if   (updateLineBuff == lineBuffB){
-        currentLineBuff = lineBuffA;
-        updateLineBuff = lineBuffA;
-      }else{
-        currentLineBuff = lineBuffB;
-        updateLineBuff = lineBuffB;
-      }
-      
-      while(leftPixels--){
-        currentPixel = *frameBuff++;color = LUT[currentPixel>>4];*currentLineBuff++ = color;
-        color = LUT[currentPixel&0x0F];*currentLineBuff++ = color;
+    uint32_t stride = (DISPLAY_WIDTH * pixelBits) >> 3;
+    for (int row = top; row <= bottom; row++){
+      uint32_t x0 = flipX0[row] & ~pixelAlign;
+      uint32_t x1 = (flipX1[row] + pixelAlign) & ~pixelAlign;
+      if (x0 < x1){
+        uint32_t at = row * stride + ((x0 * pixelBits) >> 3);
+        memcpy(backBuff + at, frameBuff + at, ((x1 - x0) * pixelBits) >> 3);
       }
-      while (dma_channel_is_busy(st_dma));
-      Write_dma((const uint8_t *)lineBuffB,leftPixels*4);
     }
-    while (dma_channel_is_busy(st_dma));
-    while (spi_get_hw(SPI_DISP)->sr & SPI_SSPSR_BSY_BITS) {
-      tight_loop_contents(); 
+}
+
+// Take row `row`'s span, widened to whole framebuffer bytes; false if it is clean
+static bool take_row(int row, int *x0, int *x1){
+    uint32_t save = spin_lock_blocking(dirtyLock);
+    *x0 = dirtyX0[row];
+    *x1 = dirtyX1[row];
+    dirtyX0[row] = dirtyX1[row] = 0;
+    spin_unlock(dirtyLock, save);
+    *x0 &= ~pixelAlign;
+    *x1 = (*x1 + pixelAlign) & ~pixelAlign;
+    return *x0 < *x1;
+}
+
+// Stream `length` pixels from src inside an open RAMWR. RGB565 goes straight from the
+// framebuffer; the LUT modes expand 64 pixels at a time into the two line buffers in
+// turn, so one fills while DMA sends the other (the turn carries across calls).
+static void stream_pixels(const uint8_t *src, uint32_t length){
+    if (pExpand == NULL){
+      Write_dma(src, length*2);
+      return;
     }
-    gpio_put(CS_PIN, 1);
-  }
-  
-  void LUT2Update(uint8_t *frameBuff, uint32_t length,  const uint16_t *LUT){
-    while (dma_channel_is_busy(st_dma));
-    //uint16_t lineBuffA[64];
-    //uint16_t lineBuffB[64];
-    uint16_t *currentLineBuff=lineBuffA;
-    uint16_t *updateLineBuff=lineBuffA;
-    uint32_t leftPixels = (length - (length&0xFFFFFFC0))>>2;
-    uint32_t count = length>>6;
-    uint8_t currentPixel=0;
-    uint16_t color;
+    while (length){
+      uint32_t chunk = length < 64 ? length : 64;
+      uint16_t *lineBuff = lineFlip ? lineBuffB : lineBuffA;
+      lineFlip = !lineFlip;
+      pExpand(src, lineBuff, chunk, LUT);
+      src += (chunk * pixelBits) >> 3;
+      Write_dma((const uint8_t *)lineBuff, chunk*2);
+      length -= chunk;
+    }
+}
+
+// One CASET/RASET window [x0, x1) x [y0, y1) and its pixels: row by row, or in a single
+// run when the window is the full width and the rows are contiguous in the framebuffer
+static void send_rect(int x0, int y0, int x1, int y1){
+    char window[4];
+    window[0] = x0 >> 8; window[1] = x0; window[2] = (x1 - 1) >> 8; window[3] = x1 - 1;
+    stats.pixels += (uint32_t)(x1 - x0) * (uint32_t)(y1 - y0);
+    command(CASET, 4, window);
+    window[0] = y0 >> 8; window[1] = y0; window[2] = (y1 - 1) >> 8; window[3] = y1 - 1;
+    command(RASET, 4, window);
+
     uint8_t cmd = RAMWR;
     gpio_put(CS_PIN, 0);
     gpio_put(DC_PIN, 0); // command mode
-    
     spi_write_blocking(SPI_DISP,&cmd, 1);
     gpio_put(DC_PIN, 1); // data mode
-    while(count--){
-      if (count&0x00000001){
-        currentLineBuff = lineBuffA;
-        updateLineBuff = lineBuffA;
-      }else{
-        currentLineBuff = lineBuffB;
-        updateLineBuff = lineBuffB;
-      }
-      for (int i=2;i>0;i--){
-          currentPixel = *frameBuff++;color = LUT[currentPixel&0x03];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>2)&0x03];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>4)&0x03];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>6)];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel&0x03];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>2)&0x03];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>4)&0x03];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>6)];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel&0x03];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>2)&0x03];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>4)&0x03];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>6)];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel&0x03];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>2)&0x03];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>4)&0x03];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>6)];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel&0x03];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>2)&0x03];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>4)&0x03];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>6)];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel&0x03];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>2)&0x03];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>4)&0x03];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>6)];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel&0x03];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>2)&0x03];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>4)&0x03];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>6)];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel&0x03];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>2)&0x03];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>4)&0x03];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>6)];*currentLineBuff++ = color;
-      }
-      while (dma_channel_is_busy(st_dma));
-      Write_dma((const uint8_t *)updateLineBuff,64*2);
-    }
-    if (leftPixels != 0){
-      if   (updateLineBuff == lineBuffB){
-        currentLineBuff = lineBuffA;
-        updateLineBuff = lineBuffA;
-      }else{
-        currentLineBuff = lineBuffB;
-        updateLineBuff = lineBuffB;
-      }
-      
-      while(leftPixels--){
-        currentPixel = *frameBuff++;color = LUT[currentPixel&0x03];*currentLineBuff++ = color;
-        color = LUT[(currentPixel>>2)&0x03];*currentLineBuff++ = color;
-        color = LUT[(currentPixel>>4)&0x03];*currentLineBuff++ = color;
-        color = LUT[(currentPixel>>6)];*currentLineBuff++ = color;
+    uint32_t stride = (DISPLAY_WIDTH * pixelBits) >> 3;
+    const uint8_t *row = frameBuff + y0 * stride + ((x0 * pixelBits) >> 3);
+    if (x1 - x0 == DISPLAY_WIDTH){
+      stream_pixels(row, DISPLAY_WIDTH * (y1 - y0));
+    }else{
+      for (int y = y0; y < y1; y++, row += stride){
+        stream_pixels(row, x1 - x0);
       }
-      while (dma_channel_is_busy(st_dma));
-      Write_dma((const uint8_t *)lineBuffB,leftPixels*8);
     }
     while (dma_channel_is_busy(st_dma));
     while (spi_get_hw(SPI_DISP)->sr & SPI_SSPSR_BSY_BITS) {
       tight_loop_contents(); 
     }
     gpio_put(CS_PIN, 1);
-}  
-  
-void LUT1Update(uint8_t *frameBuff, uint32_t length,  const uint16_t *LUT){
+}
+
+// Send what was drawn since the last refresh, or the whole frame with partial updates
+// off; false if there was nothing. Rows are taken one at a time, so drawing carries on
+// meanwhile and a row marked after it was taken goes out next time. Consecutive rows
+// share a window while their spans overlap, so a typed character with the cursor
+// beside it is one small window and a scrolled screen is one full one.
+static bool display_refresh(void){
+    if (!partialOn){
+      mark_front(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+    }
+    uint32_t save = spin_lock_blocking(dirtyLock);
+    int top = dirtyTop;
+    int bottom = dirtyBottom;
+    dirtyTop = DISPLAY_HEIGHT;
+    dirtyBottom = -1;
+    refreshing = top <= bottom;
+    spin_unlock(dirtyLock, save);
+    if (top > bottom){
+      return false;
+    }
+    uint32_t t0 = time_us_32();
+    LUTExpandPrepare(LUT, pixelBits);
+    LUTExpandBegin(pixelBits);
     while (dma_channel_is_busy(st_dma));
-    //uint16_t lineBuffA[64];
-    //uint16_t lineBuffB[64];
-    uint16_t *currentLineBuff=lineBuffA;
-    uint16_t *updateLineBuff=lineBuffA;
-    uint32_t leftPixels = (length - (length&0xFFFFFFC0))>>3;
-    uint32_t count = length>>6;
-    uint8_t currentPixel=0;
-    uint16_t color;
-    uint8_t cmd = RAMWR;
-    gpio_put(CS_PIN, 0);
-    gpio_put(DC_PIN, 0); // command mode
-    
-    spi_write_blocking(SPI_DISP,&cmd, 1);
-    gpio_put(DC_PIN, 1); // data mode
-    while(count--){
-      if (count&0x00000001){
-        currentLineBuff = lineBuffA;
-        updateLineBuff = lineBuffA;
-      }else{
-        currentLineBuff = lineBuffB;
-        updateLineBuff = lineBuffB;
-      }
-      for (int i=2;i>0;i--){
-          currentPixel = *frameBuff++;color = LUT[currentPixel&0x01];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>0x01)&0x01];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>0x02)&0x01];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>0x03)&0x01];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>0x04)&0x01];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>0x05)&0x01];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>0x06)&0x01];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>0x07)&0x01];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel&0x01];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>0x01)&0x01];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>0x02)&0x01];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>0x03)&0x01];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>0x04)&0x01];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>0x05)&0x01];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>0x06)&0x01];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>0x07)&0x01];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel&0x01];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>0x01)&0x01];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>0x02)&0x01];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>0x03)&0x01];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>0x04)&0x01];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>0x05)&0x01];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>0x06)&0x01];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>0x07)&0x01];*currentLineBuff++ = color;
-          currentPixel = *frameBuff++;color = LUT[currentPixel&0x01];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>0x01)&0x01];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>0x02)&0x01];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>0x03)&0x01];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>0x04)&0x01];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>0x05)&0x01];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>0x06)&0x01];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>0x07)&0x01];*currentLineBuff++ = color;
+    bool open = false;
+    int rx0 = 0, rx1 = 0, ry0 = 0;
+    for (int row = top; row <= bottom; row++){
+      int x0, x1;
+      if (!take_row(row, &x0, &x1)){
+        if (open){
+          send_rect(rx0, ry0, rx1, row);
+          open = false;
+        }
+        continue;
       }
-      while (dma_channel_is_busy(st_dma));
-      Write_dma((const uint8_t *)updateLineBuff,64*2);
-    }
-    if (leftPixels != 0){
-      if   (updateLineBuff == lineBuffB){
-        currentLineBuff = lineBuffA;
-        updateLineBuff = lineBuffA;
+      if (open && x0 <= rx1 + RECT_JOIN_PX && x1 + RECT_JOIN_PX >= rx0){
+        if (x0 < rx0) rx0 = x0;
+        if (x1 > rx1) rx1 = x1;
       }else{
-        currentLineBuff = lineBuffB;
-        updateLineBuff = lineBuffB;
-      }
-      
-      while(leftPixels--){
-        currentPixel = *frameBuff++;color = LUT[currentPixel&0x01];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>0x01)&0x01];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>0x02)&0x01];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>0x03)&0x01];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>0x04)&0x01];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>0x05)&0x01];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>0x06)&0x01];*currentLineBuff++ = color;
-          color = LUT[(currentPixel>>0x07)&0x01];*currentLineBuff++ = color;
+        if (open){
+          send_rect(rx0, ry0, rx1, row);
+        }
+        rx0 = x0;
+        rx1 = x1;
+        ry0 = row;
+        open = true;
       }
-      while (dma_channel_is_busy(st_dma));
-      Write_dma((const uint8_t *)lineBuffB,leftPixels*16);
     }
-    while (dma_channel_is_busy(st_dma));
-    while (spi_get_hw(SPI_DISP)->sr & SPI_SSPSR_BSY_BITS) {
-      tight_loop_contents(); 
+    if (open){
+      send_rect(rx0, ry0, rx1, bottom + 1);
     }
-    gpio_put(CS_PIN, 1);
-  }
-  
-  
-
-
+    LUTExpandEnd(pixelBits);
+    save = spin_lock_blocking(dirtyLock);
+    refreshing = false;
+    spin_unlock(dirtyLock, save);
+    uint32_t took = time_us_32() - t0;
+    stats.refreshes++;
+    stats.busy_us += took;
+    if (took > stats.max_us) stats.max_us = took;
+    if (tePin >= 0 && tePeriodUs){
+      // Longer than a panel frame: the scan caught up with the write
+      stats.missed += took / tePeriodUs;
+    }
+    return true;
+}
 
 
 // Define all attributes of the module.
@@ -820,6 +1006,12 @@ static const mp_rom_map_elem_t picocalcdisplay_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_resetLUT), MP_ROM_PTR(&pd_resetLUT_obj) },
     { MP_ROM_QSTR(MP_QSTR_getLUTview), MP_ROM_PTR(&pd_getLUTview_obj) },
     { MP_ROM_QSTR(MP_QSTR_isScreenUpdateDone), MP_ROM_PTR(&pd_isScreenUpdateDone_obj) },
+    { MP_ROM_QSTR(MP_QSTR_markDirty), MP_ROM_PTR(&pd_markDirty_obj) },
+    { MP_ROM_QSTR(MP_QSTR_partialUpdate), MP_ROM_PTR(&pd_partialUpdate_obj) },
+    { MP_ROM_QSTR(MP_QSTR_setMaxFps), MP_ROM_PTR(&pd_setMaxFps_obj) },
+    { MP_ROM_QSTR(MP_QSTR_refreshStats), MP_ROM_PTR(&pd_refreshStats_obj) },
+    { MP_ROM_QSTR(MP_QSTR_vsync), MP_ROM_PTR(&pd_vsync_obj) },
+    { MP_ROM_QSTR(MP_QSTR_doubleBuffer), MP_ROM_PTR(&pd_doubleBuffer_obj) },
 
 };
 static MP_DEFINE_CONST_DICT(picocalcdisplay_globals, picocalcdisplay_globals_table);
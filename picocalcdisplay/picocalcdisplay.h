@@ -15,6 +15,10 @@
 #define RST_PIN 15
 #define SPI_DISP spi1
 
+// Mark a rectangle of the framebuffer as drawn (clipped to the screen). With partial
+// updates on, a refresh sends only marked rows and spans; callable from any core or IRQ.
+void picocalcdisplay_mark_dirty(int x, int y, int w, int h);
+
 
 
 
@@ -9,7 +9,11 @@ target_sources(usermod_vtterminal INTERFACE
 # Add the current directory as an include directory.
 target_include_directories(usermod_vtterminal INTERFACE
     ${CMAKE_CURRENT_LIST_DIR}
+    ${CMAKE_CURRENT_LIST_DIR}/../picocalcdisplay
 )
 
+# The terminal draws into the display's framebuffer and marks what it changed through
+# picocalcdisplay, so both modules go in USER_C_MODULES.
+
 # Link our INTERFACE library to the usermod target.
 target_link_libraries(usermod INTERFACE usermod_vtterminal)
@@ -1,6 +1,7 @@
 //A modified version of vt100 emulator from https://github.com/ht-deko/vt100_stm32
 #include "font6x8.h"
 #include "vtterminal.h"
+#include "picocalcdisplay.h"
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
@@ -1516,8 +1517,10 @@ static void scroll_framebuffer(uint8_t *fb, int scroll_y1, int scroll_y2, int n,
     }
 }
 */
+// Every cell redraw (character, cursor, clear) starts with this fill, so marking the
+// rectangle here covers the glyph drawn over it too
 static void fill_rect_4bpp(uint8_t *fb,  int x, int y, int w, int h, uint8_t color){
-
+    picocalcdisplay_mark_dirty(x, y, w, h);
     int row_bytes = SC_PIXEL_WIDTH >> 1;  
     uint8_t fill_byte = (color << 4) | (color & 0x0F);
     for (int row = y; row < y + h; row++) {